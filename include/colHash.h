@@ -29,12 +29,43 @@ They are always mutable.
 \{*//*==========================================================================
 */
 
+/***************************************************************************//*!
+ * \name Hash Map Weakness
+ *
+ * Weak hash maps remove entries whose weak parts get collected, so that they
+ * shrink automatically. Weak parts do not keep other parts alive: with
+ * #COL_WEAK_KEYS, values are kept alive only as long as their key is
+ * reachable from outside of the map (ephemerons), and conversely.
+ *
+ * As with weak references, weak entries are held strongly until the
+ * generation the map belongs to gets collected, and are only removed then:
+ * maps that got promoted to older generations shrink less often. Entries
+ * shared with copies of the map (see Col_CopyHashMap()) are held strongly.
+ *
+ * Integer keys are not words, so integer hash maps only accept
+ * #COL_WEAK_VALUES.
+ *
+ * @see Col_NewWeakStringHashMap
+ * @see Col_NewWeakRef
+ ***************************************************************************\{*/
+
+#define COL_WEAK_KEYS   0x01    /*!< Remove entries whose key is collected. */
+#define COL_WEAK_VALUES 0x02    /*!< Remove entries whose value is
+                                     collected. */
+
+/* End of Hash Map Weakness *//*!\}*/
+
+
 /***************************************************************************//*!
  * \name Hash Map Creation
  ***************************************************************************\{*/
 
 EXTERN Col_Word         Col_NewStringHashMap(size_t capacity);
 EXTERN Col_Word         Col_NewIntHashMap(size_t capacity);
+EXTERN Col_Word         Col_NewWeakStringHashMap(size_t capacity,
+                            int weakness);
+EXTERN Col_Word         Col_NewWeakIntHashMap(size_t capacity,
+                            int weakness);
 EXTERN Col_Word         Col_CopyHashMap(Col_Word map);
 
 /* End of Hash Map Creation *//*!\}*/
@@ -89,6 +89,7 @@ typedef uintptr_t Col_Word;
 #define COL_HASHMAP     0x2000  /*!< Hash map. */
 #define COL_TRIEMAP     0x4000  /*!< Trie map. */
 #define COL_STRBUF      0x8000  /*!< String buffer. */
+#define COL_WEAKREF     0x10000 /*!< Weak reference. */
 
 /* End of Word Types *//*!\}*/
 
@@ -127,12 +128,44 @@ EXTERN void         Col_WordClearSynonym(Col_Word word);
 /* End of Word Synonyms *//*!\}*/
 
 
+/***************************************************************************//*!
+ * \name Weak References
+ *
+ * Weak references hold a word without keeping it alive. Once the word gets
+ * collected, the reference value becomes nil.
+ *
+ * The GC only clears references along with the generations they belong to:
+ * until then, their value is kept alive.
+ *
+ * @see Col_NewWeakStringHashMap
+ ***************************************************************************\{*/
+
+EXTERN Col_Word     Col_NewWeakRef(Col_Word word);
+EXTERN Col_Word     Col_WeakRefValue(Col_Word ref);
+
+/* End of Weak References *//*!\}*/
+
+
 /***************************************************************************//*!
  * \name Word Lifetime Management
  ***************************************************************************\{*/
 
+/**
+ * Handle scope marker, as returned by Col_OpenHandleScope().
+ *
+ * @see Col_OpenHandleScope
+ * @see Col_CloseHandleScope
+ */
+typedef size_t Col_HandleScope;
+
 EXTERN void         Col_WordPreserve(Col_Word word);
 EXTERN void         Col_WordRelease(Col_Word word);
+EXTERN void         Col_WordPreserveA(size_t nbWords, const Col_Word *words);
+EXTERN void         Col_WordReleaseA(size_t nbWords, const Col_Word *words);
+EXTERN void         Col_WordPublish(Col_Word word);
+EXTERN Col_HandleScope Col_OpenHandleScope(void);
+EXTERN Col_Word *   Col_NewHandle(Col_Word word);
+EXTERN void         Col_CloseHandleScope(Col_HandleScope scope);
 
 /* End of Word Lifetime Management *//*!\}*/
 
@@ -201,6 +234,12 @@ typedef size_t (Col_CustomWordSizeProc) (Col_Word word);
  * Function signature of custom word cleanup procs. Called on collected
  * words during the sweep phase of the garbage collection.
  *
+ * When #COL_GC_ASYNC_FINALIZE is enabled, collected words are queued instead
+ * and cleaned up once the GC pause is over: upon leaving the GC-protected
+ * section with #COL_SINGLE, else on the GC worker thread while other threads
+ * run. The word itself stays valid until its proc returns, but the words it
+ * refers to may already be reused and must not be accessed.
+ *
  * @param word  Custom word to cleanup.
  *
  * @see Col_CustomWordType
@@ -281,6 +320,15 @@ EXTERN Col_CustomWordType * Col_CustomWordInfo(Col_Word word, void **dataPtr);
 
 /* End of Custom Word Accessors *//*!\}*/
 
+
+/***************************************************************************//*!
+ * \name Custom Word Operations
+ ***************************************************************************\{*/
+
+EXTERN void         Col_CustomWordModified(Col_Word word);
+
+/* End of Custom Word Operations *//*!\}*/
+
 /* End of Custom Words *//*!\}*/
 
 #endif /* _COLIBRI_WORD */
@@ -448,9 +448,9 @@ EXTERN const Col_Char2 *    Col_Utf16Prev(const Col_Char2 * data);
 #ifdef COL_USE_THREADS
 
 /**
- * Strict appartment model with asynchronous GC. GC uses a dedicated thread
- * for asynchronous processing, the client thread cannot pause a running GC
- * and is blocked until completion.
+ * Strict appartment model with asynchronous GC. GC runs on the process-wide
+ * pool of GC worker threads (see #COL_GC_WORKERS), the client thread cannot
+ * pause a running GC and is blocked until completion.
  *
  * @see Col_Init
  * @see Col_PauseGC
@@ -461,9 +461,16 @@ EXTERN const Col_Char2 *    Col_Utf16Prev(const Col_Char2 * data);
 /**
  * Shared multithreaded model with GC-preference. Data can be shared across
  * client threads of the same group (COL_SHARED is the base index value). GC
- * uses a dedicated thread for asynchronous processing.; GC process starts
- * once all client threads get out of pause, no client thread can pause a
- * scheduled GC.
+ * runs on the process-wide pool of GC worker threads (see #COL_GC_WORKERS);
+ * GC process starts once all client threads get out of pause, no client
+ * thread can pause a scheduled GC.
+ *
+ * When #COL_GC_LOCAL_COLLECT is enabled, threads whose eden words were not
+ * published since the last GC, i.e.\ that neither preserved them nor stored
+ * them into words they don't own, collect their eden on their own when
+ * leaving their outermost GC-protected section, without stopping other
+ * threads. Words handed over to other threads by other means, e.g.\ C
+ * variables, must then be published with Col_WordPublish().
  *
  * @see Col_Init
  * @see Col_PauseGC
@@ -482,6 +489,7 @@ EXTERN const Col_Char2 *    Col_Utf16Prev(const Col_Char2 * data);
 
 EXTERN void     Col_Init(unsigned int model);
 EXTERN void     Col_Cleanup(void);
+EXTERN int      Col_ReserveMemory(size_t size, int prefault);
 
 /* End of Initialization/Cleanup Functions *//*!\}*/
 
@@ -619,6 +627,11 @@ typedef enum Col_ErrorCode {
     COL_ERROR_MAPITER_END,          /*!< Map iterator at end. */
     COL_ERROR_STRBUF,               /*!< Not a string buffer. */
     COL_ERROR_STRBUF_FORMAT,        /*!< String format not supported. */
+    COL_ERROR_GCPARAM,              /*!< Invalid GC parameter. */
+    COL_ERROR_HEAPLIMIT,            /*!< Heap size limit exceeded. */
+    COL_ERROR_HANDLESCOPE,          /*!< Invalid handle scope. */
+    COL_ERROR_WEAKREF,              /*!< Not a weak reference. */
+    COL_ERROR_WEAKNESS,             /*!< Invalid hash map weakness. */
 } Col_ErrorCode;
 
 /*
@@ -641,7 +654,217 @@ EXTERN Col_ErrorDomain  Col_GetErrorDomain();
 EXTERN void     Col_PauseGC(void);
 EXTERN int      Col_TryPauseGC(void);
 EXTERN void     Col_ResumeGC(void);
+EXTERN void     Col_CompactHeap(void);
+
+
+/***************************************************************************//*!
+ * \name GC Parameters
+ *
+ * GC parameters are group-specific settings that can be changed at runtime.
+ * Parameters marked as process-wide are shared by all groups.
+ *
+ * @see Col_GetGcParam
+ * @see Col_SetGcParam
+ ***************************************************************************\{*/
+
+/**
+ * GC parameter identifiers.
+ */
+typedef enum Col_GcParam {
+    COL_GC_MARKERS,     /*!< Number of threads used during the mark phase,
+                             including the thread performing the GC. 1 means
+                             serial marking. Collections that relocate words
+                             (see Col_CompactHeap()) mark serially, so
+                             parallel marking disables the compaction of
+                             sparse generations during regular
+                             collections. */
+    COL_GC_INCREMENTAL, /*!< Whether collections of older generations are
+                             marked incrementally, in bounded slices run when
+                             leaving GC-protected sections. Nonzero to enable,
+                             default is 0. */
+    COL_GC_SLICE_BUDGET,/*!< Time budget of incremental mark slices in
+                             microseconds. */
+    COL_GC_DECOMMIT_DELAY,/*!< Delay in milliseconds before free memory is
+                             returned to the system, 0 to return it right
+                             away. Free memory is returned during GCs and
+                             periodically by idle GC workers. Process-wide. */
+    COL_GC_GEN_FACTOR,  /*!< Generational factor, i.e.\ number of
+                             collections of a generation between two
+                             collections of the next one. */
+    COL_GC_MIN_PAGE_ALLOC,/*!< Minimum number of pages allocated in a
+                             generation before it gets collected. */
+    COL_GC_MAX_PAGE_ALLOC,/*!< Number of pages allocated in a generation
+                             above which it always gets collected. */
+    COL_GC_PROMOTE_FILL_RATIO,/*!< Fill ratio of a collected generation in
+                             percent below which surviving cells are
+                             compacted when promoted. */
+    COL_GC_ADAPTIVE,    /*!< Whether the eden collection threshold adapts
+                             to the survival rate and pause times. Nonzero
+                             to enable, default is 0. */
+    COL_GC_PAUSE_TARGET,/*!< Pause time target of eden collections in
+                             microseconds, in adaptive mode. */
+    COL_GC_SOFT_LIMIT,  /*!< Heap size in bytes above which the next
+                             collection is a full one with compaction, 0 for
+                             no limit (default). */
+    COL_GC_HARD_LIMIT,  /*!< Heap size in bytes above which allocations fail
+                             with a #COL_ERROR_HEAPLIMIT error, 0 for no limit
+                             (default). Allocations keep failing until
+                             collections bring the heap size back below the
+                             limit. */
+    COL_GC_WORKERS,     /*!< Maximum number of GC worker threads, which
+                             perform collections of #COL_ASYNC and
+                             #COL_SHARED groups and help with parallel
+                             marking (see #COL_GC_MARKERS). Defaults to the
+                             number of processors. Process-wide. */
+    COL_GC_WORKER_AFFINITY,/*!< Bit mask of processors GC worker threads may
+                             run on, 0 for all processors (default).
+                             Process-wide. */
+    COL_GC_WORKER_PRIORITY,/*!< Priority of GC worker threads, from 0
+                             (lowest) to 4 (highest), default is 2 (normal).
+                             Raising priority may require privileges.
+                             Process-wide. */
+    COL_GC_ASYNC_FINALIZE,/*!< Whether freeProcs of collected custom words
+                             are called outside of GC pauses rather than
+                             during the sweep phase (see
+                             #Col_CustomWordFreeProc). Nonzero to enable,
+                             default is 0. */
+    COL_GC_LOCAL_COLLECT,/*!< Whether threads of #COL_SHARED groups collect
+                             their eden on their own when none of its words
+                             were published (see #COL_SHARED). Nonzero to
+                             enable, default is 0. */
+} Col_GcParam;
+
+/*
+ * Remaining declarations.
+ */
+
+EXTERN size_t   Col_GetGcParam(Col_GcParam param);
+EXTERN void     Col_SetGcParam(Col_GcParam param, size_t value);
+
+/* End of GC Parameters *//*!\}*/
+
+
+/***************************************************************************//*!
+ * \name GC Statistics
+ *
+ * GC statistics describe the heap and the collections of the calling
+ * thread's group. They help sizing heaps and tuning GC parameters.
+ *
+ * @see Col_GetHeapStats
+ * @see Col_GetGcStats
+ ***************************************************************************\{*/
+
+/**
+ * Memory statistics of a generation. Sizes are given in pages, whose size is
+ * 1 KB on 32-bit systems and 4 KB on 64-bit systems.
+ *
+ * @see Col_GetHeapStats
+ */
+typedef struct Col_HeapStats {
+    size_t pages;           /*!< Number of pages. */
+    size_t cells;           /*!< Number of allocated cells. Unreachable cells
+                                 are only accounted for until they get
+                                 collected. Eden figures include cells
+                                 reserved for bump allocation. */
+    size_t allocated;       /*!< Number of pages allocated or promoted since
+                                 the last collection of the generation. */
+    size_t totalAllocated;  /*!< Number of pages allocated or promoted since
+                                 initialization. Sampling this value over
+                                 time gives the allocation rate. */
+    size_t collections;     /*!< Number of collections of the generation. */
+} Col_HeapStats;
+
+/**
+ * GC statistics. Durations are cumulative and given in microseconds.
+ *
+ * @see Col_GetGcStats
+ */
+typedef struct Col_GcStats {
+    size_t collections;     /*!< Number of collections performed. */
+    size_t slices;          /*!< Number of incremental mark slices performed
+                                 (see #COL_GC_INCREMENTAL). */
+    size_t localCollections;/*!< Number of thread-local eden collections
+                                 performed (see #COL_SHARED). */
+    unsigned int lastGeneration;
+                            /*!< Oldest generation collected by the last
+                                 collection. */
+    size_t roots;           /*!< Number of roots, i.e.\ preserved words. */
+    size_t parents;         /*!< Number of parent pages, i.e.\ pages of older
+                                 generations that may refer to younger
+                                 cells. */
+    uint64_t lastPause;     /*!< Duration of the last GC pause. */
+    uint64_t maxPause;      /*!< Duration of the longest GC pause. */
+    uint64_t totalPause;    /*!< Time spent in GC pauses. */
+    uint64_t markTime;      /*!< Time spent marking reachable cells. */
+    uint64_t sweepTime;     /*!< Time spent sweeping unreachable cells. */
+    uint64_t freeTime;      /*!< Time spent freeing empty pages. */
+    uint64_t promoteTime;   /*!< Time spent promoting pages to older
+                                 generations. */
+} Col_GcStats;
+
+/*
+ * Remaining declarations.
+ */
+
+EXTERN int      Col_GetHeapStats(unsigned int generation,
+                    Col_HeapStats *stats);
+EXTERN void     Col_GetGcStats(Col_GcStats *stats);
+
+/* End of GC Statistics *//*!\}*/
+
+
+/***************************************************************************//*!
+ * \name GC Events
+ *
+ * GC events notify the phases of collections performed for the calling
+ * thread's group. They help correlating latency spikes with collections.
+ *
+ * @see Col_SetGcEventProc
+ * @see Col_StartGcTrace
+ ***************************************************************************\{*/
+
+/**
+ * GC event identifiers. Collections span phases, which occur in order.
+ */
+typedef enum Col_GcEvent {
+    COL_GC_EVENT_COLLECT,   /*!< Whole collection. */
+    COL_GC_EVENT_MARK,      /*!< Mark phase. */
+    COL_GC_EVENT_SWEEP,     /*!< Sweep phase. */
+    COL_GC_EVENT_FREE,      /*!< Page freeing phase. */
+    COL_GC_EVENT_PROMOTE,   /*!< Promotion phase. */
+    COL_GC_EVENT_SLICE,     /*!< Incremental mark slice (see
+                                 #COL_GC_INCREMENTAL). */
+} Col_GcEvent;
+
+/**
+ * Function signature of GC event handlers. Handlers are called by the
+ * thread performing the GC, which may not be a group member, at the
+ * beginning and end of each event. They must not call Colibri functions.
+ *
+ * @param event         Event identifier.
+ * @param begin         Nonzero at the beginning of the event, zero at its
+ *                      end.
+ * @param time          Event timestamp in microseconds, from an arbitrary
+ *                      origin.
+ * @param generation    Oldest generation collected.
+ * @param clientData    Opaque value passed to Col_SetGcEventProc().
+ *
+ * @see Col_SetGcEventProc
+ */
+typedef void (Col_GcEventProc) (Col_GcEvent event, int begin, uint64_t time,
+    unsigned int generation, Col_ClientData clientData);
+
+/*
+ * Remaining declarations.
+ */
+
+EXTERN Col_GcEventProc *    Col_GetGcEventProc(Col_ClientData *clientDataPtr);
+EXTERN Col_GcEventProc *    Col_SetGcEventProc(Col_GcEventProc *proc,
+                                Col_ClientData clientData);
+EXTERN int                  Col_StartGcTrace(const char *path);
+EXTERN void                 Col_StopGcTrace(void);
 
+/* End of GC Events *//*!\}*/
 
 /* End of Garbage Collection *//*!\}*/
 
@@ -19,13 +19,29 @@
 
 /*! \cond IGNORE */
 typedef struct AddressRange *pAddressRange;
+static size_t           FindRangeIndex(void *addr);
+static pAddressRange    FindRange(void *addr);
+static void             InsertRange(struct AddressRange *range);
+static void             RemoveRange(struct AddressRange *range);
+static void             MarkRangePages(struct AddressRange *range,
+                            size_t first, size_t number, int used);
+static void             DecommitRangePages(struct AddressRange *range,
+                            size_t word, uint64_t pages);
 static size_t           FindFreePagesInRange(struct AddressRange *range,
                             size_t number, size_t index);
+static pAddressRange    NewRange(void *base, size_t size);
 static void *           SysPageAlloc(size_t number, int written);
+static void *           RangeAllocPages(size_t number, int written);
 static void             SysPageFree(void * base);
+static void             RangeFreePages(void * base, struct ThreadData *data);
 static void             SysPageTrim(void * base);
+static void             ProtectPageGroup(void *base, size_t size,
+                            int protect);
 static Cell *           PageAllocCells(size_t number, Cell *firstCell);
 static size_t           FindFreeCells(void *page, size_t number, size_t index);
+static uint64_t         BitmaskWord(Page *page, size_t index);
+static void             GrowParents(GroupData *data);
+static void             RememberWrittenPages(GroupData *data, Page *page);
 /*! \endcond *//* IGNORE */
 
 
@@ -76,186 +92,34 @@ size_t shiftPage;
 /** @beginprivate @cond PRIVATE */
 
 /**
- * Position of the first zero-bit sequence of a given length in byte.
- * First index is length of zero-bit sequence to look for, minus 1. Second
- * index is value of byte in which to search. Result is index of the first
- * bit in matching zero-bit sequence, or -1 if none.
- */
-static const char firstZeroBitSequence[7][256] = {
-    { /* single bit */
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  4,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  5,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  4,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  6,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  4,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  5,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  4,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  7,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  4,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  5,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  4,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  6,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  4,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  5,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0,  4,
-         0,  1,  0,  2,  0,  1,  0,  3,  0,  1,  0,  2,  0,  1,  0, -1
-    },
-    { /*  2-bit sequence */
-         0,  1,  2,  2,  0,  3,  3,  3,  0,  1,  4,  4,  0,  4,  4,  4,
-         0,  1,  2,  2,  0,  5,  5,  5,  0,  1,  5,  5,  0,  5,  5,  5,
-         0,  1,  2,  2,  0,  3,  3,  3,  0,  1,  6,  6,  0,  6,  6,  6,
-         0,  1,  2,  2,  0,  6,  6,  6,  0,  1,  6,  6,  0,  6,  6,  6,
-         0,  1,  2,  2,  0,  3,  3,  3,  0,  1,  4,  4,  0,  4,  4,  4,
-         0,  1,  2,  2,  0, -1, -1, -1,  0,  1, -1, -1,  0, -1, -1, -1,
-         0,  1,  2,  2,  0,  3,  3,  3,  0,  1, -1, -1,  0, -1, -1, -1,
-         0,  1,  2,  2,  0, -1, -1, -1,  0,  1, -1, -1,  0, -1, -1, -1,
-         0,  1,  2,  2,  0,  3,  3,  3,  0,  1,  4,  4,  0,  4,  4,  4,
-         0,  1,  2,  2,  0,  5,  5,  5,  0,  1,  5,  5,  0,  5,  5,  5,
-         0,  1,  2,  2,  0,  3,  3,  3,  0,  1, -1, -1,  0, -1, -1, -1,
-         0,  1,  2,  2,  0, -1, -1, -1,  0,  1, -1, -1,  0, -1, -1, -1,
-         0,  1,  2,  2,  0,  3,  3,  3,  0,  1,  4,  4,  0,  4,  4,  4,
-         0,  1,  2,  2,  0, -1, -1, -1,  0,  1, -1, -1,  0, -1, -1, -1,
-         0,  1,  2,  2,  0,  3,  3,  3,  0,  1, -1, -1,  0, -1, -1, -1,
-         0,  1,  2,  2,  0, -1, -1, -1,  0,  1, -1, -1,  0, -1, -1, -1
-    },
-    { /*  3-bit sequence */
-         0,  1,  2,  2,  3,  3,  3,  3,  0,  4,  4,  4,  4,  4,  4,  4,
-         0,  1,  5,  5,  5,  5,  5,  5,  0,  5,  5,  5,  5,  5,  5,  5,
-         0,  1,  2,  2, -1, -1, -1, -1,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1,  2,  2,  3,  3,  3,  3,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1,  2,  2, -1, -1, -1, -1,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1,  2,  2,  3,  3,  3,  3,  0,  4,  4,  4,  4,  4,  4,  4,
-         0,  1, -1, -1, -1, -1, -1, -1,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1,  2,  2, -1, -1, -1, -1,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1,  2,  2,  3,  3,  3,  3,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1,  2,  2, -1, -1, -1, -1,  0, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1,  0, -1, -1, -1, -1, -1, -1, -1
-    },
-    { /*  4-bit sequence */
-         0,  1,  2,  2,  3,  3,  3,  3,  4,  4,  4,  4,  4,  4,  4,  4,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0,  1,  2,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0,  1,  2,  2,  3,  3,  3,  3, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0,  1,  2,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
-    },
-    { /*  5-bit sequence */
-         0,  1,  2,  2,  3,  3,  3,  3, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0,  1,  2,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
-    },
-    { /*  6-bit sequence */
-         0,  1,  2,  2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
-    },
-    { /*  7-bit sequence */
-         0,  1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-         0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
-        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
-    }
-    /* 8-bit sequences need no table, just test for zero byte */
-};
-
-/**
- * Longest leading zero-bit sequence in byte. Index is value of byte.
- * Result is number of consecutive cleared bytes starting at MSB.
+ * Get 64-bit word of page bitmask in cell order, i.e.\ bit i (LSB = 0) of
+ * the result is the bit of cell 64*index+i.
+ *
+ * @return The bitmask word.
  */
-static const char longestLeadingZeroBitSequence[256] = {
-    8, 7, 6, 6, 5, 5, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4,
-    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-};
+static uint64_t
+BitmaskWord(
+    Page *page,     /*!< The page. */
+    size_t index)   /*!< Index of word. */
+{
+#ifdef COL_BIGENDIAN
+    /*
+     * Bitmask layout doesn't match native word order, build word cell by
+     * cell.
+     */
 
-/**
- * Number of bits set in byte. Index is value of byte. Result is number of
- * set bits.
- */
-static const char nbBitsSet[256] = {
-    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
-    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6,
-    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-    3, 4, 4, 5, 4, 5, 5, 6, 4, 5, 5, 6, 5, 6, 6, 7,
-    4, 5, 5, 6, 5, 6, 6, 7, 5, 6, 6, 7, 6, 7, 7, 8
-};
+    uint64_t word = 0;
+    size_t i;
+    for (i=0; i < 64; i++) {
+        if (TestCell(page, (index<<6)+i)) {
+            word |= ((uint64_t)1)<<i;
+        }
+    }
+    return word;
+#else
+    return ((uint64_t *) PAGE_BITMASK(page))[index];
+#endif
+}
 
 /** @endcond @endprivate */
 
@@ -357,15 +221,22 @@ PoolCleanup(
  * - When positive, the page is the n-th in a group whose first
  *   page is the n-th previous one.
  *
- * To allocate a group of pages in an address range, the alloc info table
- * is scanned until a large enough group of free pages is found.
+ * To allocate a group of pages in an address range, a bitmap of allocated
+ * pages is searched 64 pages at a time until a large enough group of free
+ * pages is found. Full ranges at the head of the list are skipped.
  *
  * To free a group of pages, the containing address range is found by
- * scanning all ranges in order (this is fast, as this only involves
- * address comparison and the ranges grow geometrically). In either cases
- * the descriptor is updated accordingly. If a containing range is not
- * found we assume that it was a dedicated range and we attempt to release
- * it at once.
+ * binary search in an index of all ranges (regular and dedicated) sorted
+ * by base address, so that lookups stay logarithmic as the heap grows.
+ * Dedicated ranges are released at once, else the descriptor is updated
+ * accordingly.
+ *
+ * Freed pages are made inaccessible but remain resident until
+ * SysPageDecommit() returns them to the system, after a configurable delay
+ * that spares the cost of faulting them again when they get quickly
+ * reused. Regular ranges that remain empty are then released. This happens
+ * during GCs and periodically on idle GC workers. Pages left unused in
+ * per-thread page caches are returned to their ranges beforehand.
  *
  * Just following this alloc info table is a bitmask table used for write
  * tracking. With our generational GC, pages of older generations are
@@ -399,6 +270,14 @@ typedef struct AddressRange {
     size_t size;                /*!< Size in pages. */
     size_t free;                /*!< Number of free pages in range. */
     size_t first;               /*!< First free page in range. */
+    size_t rank;                /*!< Position in list. */
+    int pinned;                 /*!< Whether range is kept when empty. */
+    uint64_t *used;             /*!< Bitmap of allocated pages, NULL for
+                                     dedicated ranges. */
+    uint64_t *dirty;            /*!< Bitmap of pages freed since last
+                                     decommit. */
+    uint64_t *aged;             /*!< Bitmap of pages freed before last
+                                     decommit, and still resident. */
     char allocInfo[0];          /*!< Info about allocated pages in range. */
 } AddressRange;
 
@@ -411,12 +290,56 @@ typedef struct AddressRange {
 static AddressRange *ranges = NULL;
 
 /**
- * Dedicated address ranges for large pages.
+ * Last reserved address range for general purpose, where new ranges get
+ * appended.
+ *
+ * @see SysPageAlloc
+ */
+static AddressRange *lastRange = NULL;
+
+/**
+ * First reserved address range that may have free pages. All previous
+ * ones in list are full.
  *
  * @see SysPageAlloc
  * @see SysPageFree
  */
-static AddressRange *dedicatedRanges = NULL;
+static AddressRange *freeRange = NULL;
+
+/**
+ * Index of all address ranges, regular and dedicated, sorted by base
+ * address.
+ *
+ * @see FindRange
+ */
+static AddressRange **rangeIndex = NULL;
+
+/**
+ * Number of address ranges in #rangeIndex.
+ */
+static size_t nbRanges = 0;
+
+/**
+ * Capacity of #rangeIndex.
+ */
+static size_t rangeIndexSize = 0;
+
+/**
+ * Delay in milliseconds before free pages are returned to the system. Only
+ * accessed atomically, as it is process-wide.
+ *
+ * @see SysPageDecommit
+ * @see COL_GC_DECOMMIT_DELAY
+ */
+size_t decommitDelay = GC_DEFAULT_DECOMMIT_DELAY;
+
+/**
+ * Time of last decommit in milliseconds, modulo the range of **size_t**.
+ * Only accessed atomically.
+ *
+ * @see SysPageDecommit
+ */
+static size_t lastDecommit = 0;
 
 /**
  * Size of first reserved range.
@@ -429,7 +352,163 @@ static AddressRange *dedicatedRanges = NULL;
 #define MAX_RANGE_SIZE      32768   /* 128 MB */
 
 /**
- * Find given number of free consecutive pages in alloc info table.
+ * Find the index entry of the address range containing the given address,
+ * or where a range starting at this address would be inserted.
+ *
+ * @return Index in #rangeIndex.
+ */
+static size_t
+FindRangeIndex(
+    void *addr) /*!< Address to look for. */
+{
+    size_t low = 0, high = nbRanges, mid;
+
+    /*
+     * Binary search for the last range whose base is not after the address.
+     */
+
+    while (low < high) {
+        mid = (low + high) >> 1;
+        if ((char *) rangeIndex[mid]->base <= (char *) addr) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/**
+ * Find address range containing the given address.
+ *
+ * @retval range    containing the address if found.
+ * @retval NULL     otherwise.
+ */
+static AddressRange *
+FindRange(
+    void *addr) /*!< Address to look for. */
+{
+    size_t i = FindRangeIndex(addr);
+    AddressRange *range;
+
+    if (i == 0) {
+        /*
+         * Before first range.
+         */
+
+        return NULL;
+    }
+    range = rangeIndex[i-1];
+    if ((char *) addr >= (char *) range->base + (range->size << shiftPage)) {
+        /*
+         * Beyond range.
+         */
+
+        return NULL;
+    }
+    return range;
+}
+
+/**
+ * Insert address range into #rangeIndex.
+ */
+static void
+InsertRange(
+    AddressRange *range)    /*!< Address range to insert. */
+{
+    size_t i;
+
+    if (nbRanges == rangeIndexSize) {
+        rangeIndexSize = (rangeIndexSize ? rangeIndexSize*2 : 16);
+        rangeIndex = (AddressRange **) realloc(rangeIndex,
+                rangeIndexSize * sizeof(*rangeIndex));
+    }
+    i = FindRangeIndex(range->base);
+    memmove(rangeIndex+i+1, rangeIndex+i, (nbRanges-i) * sizeof(*rangeIndex));
+    rangeIndex[i] = range;
+    nbRanges++;
+}
+
+/**
+ * Remove address range from #rangeIndex.
+ */
+static void
+RemoveRange(
+    AddressRange *range)    /*!< Address range to remove. */
+{
+    size_t i = FindRangeIndex(range->base);
+
+    ASSERT(i > 0 && rangeIndex[i-1] == range);
+    memmove(rangeIndex+i-1, rangeIndex+i, (nbRanges-i) * sizeof(*rangeIndex));
+    nbRanges--;
+}
+
+/**
+ * Mark sequence of pages as used or free in the range's bitmap of allocated
+ * pages. Free pages remain resident until decommitted: they are either
+ * decommitted right away or marked as dirty depending on #decommitDelay.
+ */
+static void
+MarkRangePages(
+    AddressRange *range,    /*!< Address range. */
+    size_t first,           /*!< Index of first page. */
+    size_t number,          /*!< Number of pages. */
+    int used)               /*!< Whether pages are used. */
+{
+    size_t i;
+    uint64_t mask;
+    for (i = first; i < first+number; i++) {
+        mask = ((uint64_t)1)<<(i&63);
+        if (used) {
+            range->used[i>>6] |= mask;
+            range->dirty[i>>6] &= ~mask;
+            range->aged[i>>6] &= ~mask;
+        } else {
+            range->used[i>>6] &= ~mask;
+            if (decommitDelay) {
+                range->dirty[i>>6] |= mask;
+            } else {
+                DecommitRangePages(range, i>>6, mask);
+            }
+        }
+    }
+}
+
+/**
+ * Return free pages of a 64-page word of range to the system. Consecutive
+ * pages are decommitted together.
+ *
+ * @see SysPageDecommit
+ */
+static void
+DecommitRangePages(
+    AddressRange *range,    /*!< Address range. */
+    size_t word,            /*!< Index of bitmap word. */
+    uint64_t pages)         /*!< Bitmask of pages to decommit. */
+{
+    size_t first, length;
+    uint64_t rest;
+
+    while (pages) {
+        first = PlatCountTrailingZeros64(pages);
+        rest = ~(pages >> first);
+        length = (rest ? PlatCountTrailingZeros64(rest) : 64);
+
+        /*
+         * Failure only means that pages remain resident.
+         */
+
+        PlatDecommitPages((char *) range->base
+                + (((word<<6) + first) << shiftPage), length);
+
+        pages = (first+length == 64 ? 0
+                : pages & (~(uint64_t)0 << (first+length)));
+    }
+}
+
+/**
+ * Find given number of free consecutive pages in range. The bitmap of
+ * allocated pages is searched 64 pages at a time.
  *
  * @retval index   of first page of sequence if found.
  * @retval -1      otherwise.
@@ -440,39 +519,70 @@ FindFreePagesInRange(
     size_t number,          /*!< Number of free consecutive entries to find. */
     size_t index)           /*!< First entry to consider. */
 {
-    size_t i, first = (size_t)-1, remaining;
+    size_t i, run = 0, length, shift;
+    uint64_t avail, seq;
 
     /*
-     * Iterate over alloc info table to find a chain of <number> zero entries.
+     * Iterate over bitmap words, with free pages as set bits. <run> is the
+     * length of the free sequence that ends at the current word.
      */
 
-    remaining = number;
-    for (i = index; i < range->size; i++) {
-        if (range->allocInfo[i] == 0) {
-            if (remaining == number) {
-                /*
-                 * Beginning of sequence.
-                 */
+    for (i = (index>>6); i < (range->size>>6); i++) {
+        avail = ~range->used[i];
+        if (i == (index>>6)) {
+            avail &= ~(uint64_t)0 << (index&63);
+        }
 
-                first = i;
+        if (avail == ~(uint64_t)0) {
+            /*
+             * Whole word is free, continue sequence.
+             */
+
+            run += 64;
+            if (run >= number) {
+                return ((i+1)<<6) - run;
             }
+            continue;
+        }
 
-            remaining--;
-            if (remaining == 0) {
-                /*
-                 * End of sequence reached.
-                 */
+        /*
+         * Sequence may end with leading free pages of word.
+         */
 
-                return first;
-            }
+        if (run + PlatCountTrailingZeros64(~avail) >= number) {
+            return (i<<6) - run;
+        }
 
-        } else {
-            /*
-             * Sequence interrupted, restart.
-             */
+        /*
+         * Look for sequence within word: bit j remains set iff pages j to
+         * j+length-1 are free.
+         */
 
-            remaining = number;
+        if (number <= 64) {
+            seq = avail;
+            for (length = 1; length < number; length += shift) {
+                shift = (number-length < length) ? number-length : length;
+                seq &= seq >> shift;
+            }
+            if (seq) {
+                return (i<<6) + PlatCountTrailingZeros64(seq);
+            }
         }
+
+        /*
+         * New sequence starts with trailing free pages of word: smear used
+         * bits towards LSB, the remaining clear bits are the trailing free
+         * pages.
+         */
+
+        seq = ~avail;
+        seq |= seq >> 1;
+        seq |= seq >> 2;
+        seq |= seq >> 4;
+        seq |= seq >> 8;
+        seq |= seq >> 16;
+        seq |= seq >> 32;
+        run = 64 - PlatPopCount64(seq);
     }
 
     /*
@@ -482,6 +592,96 @@ FindFreePagesInRange(
     return (size_t) -1;
 }
 
+/**
+ * Create descriptor for newly reserved address range and append it to the
+ * list of regular ranges. Caller must hold the address range protection.
+ *
+ * @return The new descriptor.
+ *
+ * @see RangeAllocPages
+ * @see SysPageReserve
+ */
+static AddressRange *
+NewRange(
+    void *base,     /*!< Base address of reserved range. */
+    size_t size)    /*!< Size of range in pages. */
+{
+    AddressRange *range = (AddressRange *) (malloc(sizeof(AddressRange)
+            + size + ((size+7)>>3)));
+    range->base = base;
+    range->next = NULL;
+    range->size = size;
+    range->free = size;
+    range->first = 0;
+    range->pinned = 0;
+    range->used = (uint64_t *) calloc(3*(size>>6), sizeof(uint64_t));
+    range->dirty = range->used + (size>>6);
+    range->aged = range->dirty + (size>>6);
+    memset(range->allocInfo, 0, size + ((size+7)>>3));
+    if (lastRange) {
+        range->rank = lastRange->rank+1;
+        lastRange->next = range;
+    } else {
+        range->rank = 0;
+        ranges = range;
+    }
+    lastRange = range;
+    if (!freeRange) freeRange = range;
+    InsertRange(range);
+    return range;
+}
+
+/**
+ * Reserve address ranges ahead of time for the given number of pages, so
+ * that subsequent page allocations don't have to. Ranges are at most
+ * #MAX_RANGE_SIZE pages.
+ *
+ * @retval <>0  for success.
+ * @retval 0    for failure.
+ *
+ * @see Col_ReserveMemory
+ */
+int
+SysPageReserve(
+    size_t number,  /*!< Number of pages to reserve. */
+    int prefault)   /*!< Whether to prefault reserved pages. */
+{
+    void *addr;
+    size_t size;
+
+    while (number) {
+        /*
+         * Ranges are a power of two in size.
+         */
+
+        for (size = FIRST_RANGE_SIZE; size < number && size < MAX_RANGE_SIZE;
+                size <<= 1);
+
+        addr = PlatReserveRange(size, 0);
+        if (!addr) {
+            return 0;
+        }
+
+        /*
+         * Prefault before the range becomes visible to other threads.
+         */
+
+        if (prefault && !PlatPrefaultRange(addr, size)) {
+            PlatReleaseRange(addr, size);
+            return 0;
+        }
+
+        PlatEnterProtectAddressRanges();
+        {
+            NewRange(addr, size)->pinned = 1;
+        }
+        PlatLeaveProtectAddressRanges();
+
+        number -= (size < number ? size : number);
+    }
+    return 1;
+}
+
 /**
  * Allocate system pages.
  *
@@ -498,8 +698,7 @@ SysPageAlloc(
     int written)    /*!< Initial write tracking flag value. */
 {
     void *addr = NULL;
-    AddressRange *range, **prevPtr;
-    size_t first, size, i;
+    AddressRange *range;
 
     if (number > LARGE_PAGE_SIZE || !(number
             & ((allocGranularity >> shiftPage)-1))) {
@@ -521,284 +720,387 @@ SysPageAlloc(
         }
 
         /*
-         * Create descriptor without page alloc table and insert at head.
+         * Create descriptor without page alloc table and insert into index.
          */
 
         PlatEnterProtectAddressRanges();
         {
             range = (AddressRange *) (malloc(sizeof(AddressRange)+1));
-            range->next = dedicatedRanges;
+            range->next = NULL;
             range->base = addr;
             range->size = number;
             range->free = 0;
             range->first = number;
+            range->rank = 0;
+            range->pinned = 0;
+            range->used = NULL;
+            range->dirty = NULL;
+            range->aged = NULL;
             range->allocInfo[0] = written;
-            dedicatedRanges = range;
+            InsertRange(range);
         }
         PlatLeaveProtectAddressRanges();
 
         return addr;
     }
 
-    /*
-     * Try to find address range with enough consecutive pages.
-     */
+    if (number == 1 && !written) {
+        /*
+         * Most common case: single system page for young pools. Pick it from
+         * the thread's page cache, refilling the latter in one go if needed.
+         */
 
-    PlatEnterProtectAddressRanges();
-    {
-        first = (size_t)-1;
-        prevPtr = &ranges;
-        range = ranges;
-        while (range) {
-            size = range->size;
-            if (range->free >= number) {
+        ThreadData *data = PlatGetThreadData();
+        if (!data->nbCachedPages) {
+            PlatEnterProtectAddressRanges();
+            {
                 /*
-                 * Range has the required number of pages.
+                 * Pages freed by the thread go to the cache first.
                  */
 
-                first = range->first;
-
-                if (number == 1 && !range->allocInfo[first]) {
-                    /*
-                     * Fast-track the most common case: allocate the first free
-                     * page.
-                     */
-
-                    break;
+                while (data->nbFreedPages) {
+                    RangeFreePages(data->freedPages[--data->nbFreedPages],
+                            data);
                 }
-
-                /*
-                 * Find the first available bit sequence.
-                 */
-
-                first = FindFreePagesInRange(range, number, first);
-                if (first != (size_t)-1) {
-                    break;
+                while (data->nbCachedPages < PAGE_CACHE_REFILL) {
+                    addr = RangeAllocPages(1, 0);
+                    if (!addr) break;
+                    data->pageCache[data->nbCachedPages++] = addr;
                 }
             }
-
-            /*
-             * Not found, try next range.
-             */
-
-            prevPtr = &range->next;
-            range = range->next;
+            PlatLeaveProtectAddressRanges();
+            if (!data->nbCachedPages) {
+                return NULL;
+            }
         }
+        addr = data->pageCache[--data->nbCachedPages];
+        if (data->nbCachedPages < data->minCachedPages) {
+            data->minCachedPages = data->nbCachedPages;
+        }
+        return addr;
+    }
 
-        if (!range) {
-            /*
-             * No range was found with available pages. Create a new one.
-             */
+    /*
+     * Allocate pages in address ranges.
+     */
 
-            if (!ranges) {
-                size = FIRST_RANGE_SIZE;
-            } else {
-                /*
-                 * New range size is double that of the previous one.
-                 */
+    PlatEnterProtectAddressRanges();
+    {
+        addr = RangeAllocPages(number, written);
+    }
+    PlatLeaveProtectAddressRanges();
+    return addr;
+}
 
-                size <<= 1;
-                if (size > MAX_RANGE_SIZE) size = MAX_RANGE_SIZE;
-            }
-            ASSERT(number <= size-1);
+/**
+ * Allocate system pages in regular address ranges. Caller must hold the
+ * address range protection.
+ *
+ * @return The allocated system pages' base address, or NULL on failure.
+ *
+ * @sideeffect
+ *      May reserve new address ranges.
+ *
+ * @see SysPageAlloc
+ */
+static void *
+RangeAllocPages(
+    size_t number,  /*!< Number of system pages to alloc. */
+    int written)    /*!< Initial write tracking flag value. */
+{
+    void *addr;
+    AddressRange *range;
+    size_t first, size, i;
+
+    /*
+     * Try to find address range with enough consecutive pages, starting from
+     * the first one that isn't full.
+     */
 
+    while (freeRange && !freeRange->free) {
+        freeRange = freeRange->next;
+    }
+    first = (size_t)-1;
+    for (range = freeRange; range; range = range->next) {
+        if (range->free >= number) {
             /*
-             * Reserve address range.
+             * Range has the required number of pages.
              */
 
-            addr = PlatReserveRange(size, 0);
-            if (!addr) {
+            first = range->first;
+
+            if (number == 1 && !range->allocInfo[first]) {
                 /*
-                 * Fatal error!
+                 * Fast-track the most common case: allocate the first free
+                 * page.
                  */
 
-                /*! @fatal{COL_ERROR_MEMORY,Address range reservation failed} */
-                Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
-                        "Address range reservation failed");
-                goto end;
+                break;
             }
 
             /*
-             * Create descriptor.
+             * Find the first available bit sequence.
              */
 
-            range = (AddressRange *) (malloc(sizeof(AddressRange) + size
-                        + ((size+7)>>3)));
-            *prevPtr = range;
-            range->base = addr;
-            range->next = NULL;
-            range->size = size;
-            range->free = size;
-            range->first = 0;
-            memset(range->allocInfo, 0, size + ((size+7)>>3));
-            first = 0;
+            first = FindFreePagesInRange(range, number, first);
+            if (first != (size_t)-1) {
+                break;
+            }
         }
+    }
 
+    if (!range) {
         /*
-         * Allocate pages.
+         * No range was found with available pages. Create a new one.
          */
 
-        ASSERT(first+number <= size);
-        ASSERT(number <= range->free);
-        addr = (char *) range->base + (first << shiftPage);
-        if (!PlatAllocPages(addr, number)) {
+        if (!lastRange) {
+            size = FIRST_RANGE_SIZE;
+        } else {
             /*
-             * Fatal error!
+             * New range size is double that of the previous one.
              */
 
-            /*! @fatal{COL_ERROR_MEMORY,Page allocation failed} */
-            Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
-                    "Page allocation failed");
-            goto end;
+            size = lastRange->size << 1;
+            if (size > MAX_RANGE_SIZE) size = MAX_RANGE_SIZE;
         }
+        ASSERT(number <= size-1);
 
         /*
-         * Update metadata. Only clear first page's written flag.
+         * Reserve address range.
          */
 
-        ASSERT(number < LARGE_PAGE_SIZE && number-1 <= CHAR_MAX && -(char) number >= CHAR_MIN);
-        range->allocInfo[first] = -(char) number;
-        for (i=1; i < number; i++) {
-            range->allocInfo[first+i] = (char) i;
-        }
-        if (written) {
-            range->allocInfo[range->size+(first>>3)] |= (1<<(first&7));
-        } else {
-            range->allocInfo[range->size+(first>>3)] &= ~(1<<(first&7));
-        }
-        range->free -= number;
-        if (first == range->first) {
+        addr = PlatReserveRange(size, 0);
+        if (!addr) {
             /*
-             * Simply increase the first free page index, the actual index will
-             * be updated on next allocation.
+             * Fatal error!
              */
 
-            range->first += number;
+            /*! @fatal{COL_ERROR_MEMORY,Address range reservation failed} */
+            Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
+                    "Address range reservation failed");
+            return NULL;
         }
+
+        range = NewRange(addr, size);
+        first = 0;
+    }
+
+    /*
+     * Allocate pages.
+     */
+
+    ASSERT(first+number <= range->size);
+    ASSERT(number <= range->free);
+    addr = (char *) range->base + (first << shiftPage);
+    if (!PlatAllocPages(addr, number)) {
+        /*
+         * Fatal error!
+         */
+
+        /*! @fatal{COL_ERROR_MEMORY,Page allocation failed} */
+        Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
+                "Page allocation failed");
+        return NULL;
+    }
+
+    /*
+     * Update metadata. Only clear first page's written flag.
+     */
+
+    ASSERT(number < LARGE_PAGE_SIZE && number-1 <= CHAR_MAX && -(char) number >= CHAR_MIN);
+    range->allocInfo[first] = -(char) number;
+    for (i=1; i < number; i++) {
+        range->allocInfo[first+i] = (char) i;
+    }
+    MarkRangePages(range, first, number, 1);
+    if (written) {
+        range->allocInfo[range->size+(first>>3)] |= (1<<(first&7));
+    } else {
+        range->allocInfo[range->size+(first>>3)] &= ~(1<<(first&7));
+    }
+    range->free -= number;
+    if (first == range->first) {
+        /*
+         * Simply increase the first free page index, the actual index will
+         * be updated on next allocation.
+         */
+
+        range->first += number;
     }
-end:
-    PlatLeaveProtectAddressRanges();
     return addr;
 }
 
 /**
- * Free system pages.
+ * Free system pages. Pages are queued in the thread's batch of freed pages,
+ * which is flushed once full. Single pages are then kept in the thread's page
+ * cache while it has room, and are only returned to their address range
+ * otherwise.
  *
  * @sideeffect
  *      May release address ranges.
  *
  * @see SysPageAlloc
+ * @see SysPageFlush
+ * @see PAGE_FREE_BATCH
  */
 static void
 SysPageFree(
     void * base)    /*!< Base address of the pages to free. */
 {
-    size_t index, size, i;
-    AddressRange * range;
+    ThreadData *data = PlatGetThreadData();
+
+    if (!data) {
+        PlatEnterProtectAddressRanges();
+        {
+            RangeFreePages(base, NULL);
+        }
+        PlatLeaveProtectAddressRanges();
+        return;
+    }
+
+    data->freedPages[data->nbFreedPages++] = base;
+    if (data->nbFreedPages == PAGE_FREE_BATCH) {
+        SysPageFlush(data);
+    }
+}
+
+/**
+ * Return the batch of pages freed by a thread at once.
+ *
+ * @sideeffect
+ *      May release address ranges.
+ *
+ * @see SysPageFree
+ */
+void
+SysPageFlush(
+    ThreadData *data)   /*!< Thread-specific data. */
+{
+    if (!data->nbFreedPages) {
+        return;
+    }
 
     PlatEnterProtectAddressRanges();
     {
-        /*
-         * Get range info for page.
-         */
-
-        range = ranges;
-        while (range) {
-            if (base >= range->base && (char *) base < (char *) range->base
-                    + (range->size << shiftPage)) {
-                break;
-            }
-            range = range->next;
+        while (data->nbFreedPages) {
+            RangeFreePages(data->freedPages[--data->nbFreedPages], data);
         }
-        if (!range) {
-            /*
-             * Likely dedicated address range.
-             */
-
-            AddressRange **prevPtr = &dedicatedRanges;
-            range = dedicatedRanges;
-            while (range) {
-                if (base >= range->base && (char *) base < (char *) range->base
-                        + (range->size << shiftPage)) {
-                    break;
-                }
-                prevPtr = &range->next;
-                range = range->next;
-            }
-            if (!range) {
-                /*
-                 * Not found.
-                 */
+    }
+    PlatLeaveProtectAddressRanges();
+}
 
-                /*! @fatal{COL_ERROR_MEMORY,Page not found} */
-                Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
-                        "Page not found");
-                goto end;
-            }
+/**
+ * Free system pages in address ranges. Caller must hold the address range
+ * protection.
+ *
+ * @sideeffect
+ *      May release address ranges.
+ *
+ * @see SysPageFree
+ */
+static void
+RangeFreePages(
+    void * base,        /*!< Base address of the pages to free. */
+    ThreadData *data)   /*!< Thread whose page cache receives single pages,
+                             NULL to return them to their range. */
+{
+    size_t index, size, i;
+    AddressRange * range;
 
-            /*
-             * Release whole range.
-             */
+    /*
+     * Get range info for page.
+     */
 
-            if (!PlatReleaseRange(range->base, range->size)) {
-                /*
-                 * Fatal error!
-                 */
+    range = FindRange(base);
+    if (!range) {
+        /*
+         * Not found.
+         */
 
-                /*! @fatal{COL_ERROR_MEMORY,Address range release failed} */
-                Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
-                        "Address range release failed");
-                goto end;
-            }
+        /*! @fatal{COL_ERROR_MEMORY,Page not found} */
+        Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
+                "Page not found");
+        return;
+    }
+    if (!range->used) {
+        /*
+         * Dedicated address range, release whole range.
+         */
 
+        if (!PlatReleaseRange(range->base, range->size)) {
             /*
-             * Remove from dedicated range list.
+             * Fatal error!
              */
 
-            *prevPtr = range->next;
-            free(range);
-            goto end;
+            /*! @fatal{COL_ERROR_MEMORY,Address range release failed} */
+            Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
+                    "Address range release failed");
+            return;
         }
 
-        index = ((char *) base - (char *) range->base) >> shiftPage;
-        size = -range->allocInfo[index];
-        ASSERT(size > 0);
-        ASSERT(index+size <= range->size);
+        /*
+         * Remove from index.
+         */
 
+        RemoveRange(range);
+        free(range);
+        return;
+    }
+
+    index = ((char *) base - (char *) range->base) >> shiftPage;
+    size = -range->allocInfo[index];
+    ASSERT(size > 0);
+    ASSERT(index+size <= range->size);
+
+    if (data && size == 1 && data->nbCachedPages < PAGE_CACHE_SIZE) {
         /*
-         * Free pages.
+         * Keep single page in thread's cache for reuse. Clear its write
+         * tracking flag and unprotect it, as SysPageAlloc() would do for
+         * a fresh page.
          */
 
-        if (!PlatFreePages(base, size)) {
-            /*
-             * Fatal error!
-             */
+        range->allocInfo[range->size+(index>>3)] &= ~(1<<(index&7));
+        ProtectPageGroup(base, 1, 0);
+        data->pageCache[data->nbCachedPages++] = base;
+        return;
+    }
 
-            /*! @fatal{COL_ERROR_MEMORY,Page deallocation failed} */
-            Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
-                    "Page deallocation failed");
-            goto end;
-        }
+    /*
+     * Free pages.
+     */
 
+    if (!PlatFreePages(base, size)) {
         /*
-         * Update metadata.
+         * Fatal error!
          */
 
-        for (i=index; i < index+size; i++) {
-            range->allocInfo[i] = 0;
-        }
-        range->free += size;
-        ASSERT(range->free <= range->size);
-        if (range->first > index) {
-            /*
-             * Old first free page is beyond the one we just freed, update.
-             */
+        /*! @fatal{COL_ERROR_MEMORY,Page deallocation failed} */
+        Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
+                "Page deallocation failed");
+        return;
+    }
 
-            range->first = index;
-        }
+    /*
+     * Update metadata.
+     */
+
+    for (i=index; i < index+size; i++) {
+        range->allocInfo[i] = 0;
+    }
+    MarkRangePages(range, index, size, 0);
+    range->free += size;
+    ASSERT(range->free <= range->size);
+    if (range->first > index) {
+        /*
+         * Old first free page is beyond the one we just freed, update.
+         */
+
+        range->first = index;
+    }
+    if (!freeRange || range->rank < freeRange->rank) {
+        freeRange = range;
     }
-end:
-    PlatLeaveProtectAddressRanges();
 }
 
 /**
@@ -819,15 +1121,8 @@ SysPageTrim(
          * Get range info for page.
          */
 
-        range = ranges;
-        while (range) {
-            if (base >= range->base && (char *) base < (char *) range->base
-                    + (range->size << shiftPage)) {
-                break;
-            }
-            range = range->next;
-        }
-        if (!range) {
+        range = FindRange(base);
+        if (!range || !range->used) {
             /*
              * Not found. Cannot trim dedicated ranges.
              */
@@ -874,6 +1169,7 @@ SysPageTrim(
         for (i=index+1; i < index+size; i++) {
             range->allocInfo[i] = 0;
         }
+        MarkRangePages(range, index+1, size-1, 0);
         range->free += size-1;
         ASSERT(range->free <= range->size);
         if (range->first > index) {
@@ -883,9 +1179,118 @@ SysPageTrim(
 
             range->first = index;
         }
+        if (!freeRange || range->rank < freeRange->rank) {
+            freeRange = range;
+        }
+    }
+end:
+    PlatLeaveProtectAddressRanges();
+}
+
+/**
+ * Return free pages to the system once #decommitDelay has elapsed since the
+ * last call. Pages that were already free at the last call are decommitted,
+ * and regular ranges that remained empty since then are released, except
+ * those reserved by SysPageReserve().
+ *
+ * Besides GCs, idle GC worker threads call this periodically.
+ *
+ * @retval <>0  if the delay had elapsed.
+ * @retval 0    if it was too early.
+ *
+ * @sideeffect
+ *      May release address ranges.
+ *
+ * @see SysPageFree
+ * @see SysPageCacheTrim
+ */
+int
+SysPageDecommit()
+{
+    AddressRange *range, *prev, *next;
+    uint64_t pages, pending;
+    size_t now = (size_t) (PlatGetMicroseconds() / 1000), i;
+    int done = 0;
+
+    if (now - PlatAtomicLoad(&lastDecommit)
+            < PlatAtomicLoad(&decommitDelay)) {
+        /*
+         * Too early.
+         */
+
+        return 0;
+    }
+
+    PlatEnterProtectAddressRanges();
+    {
+        if (now - PlatAtomicLoad(&lastDecommit)
+                < PlatAtomicLoad(&decommitDelay)) {
+            /*
+             * Another thread got there first.
+             */
+
+            goto end;
+        }
+        PlatAtomicStore(&lastDecommit, now);
+        done = 1;
+
+        for (prev = NULL, range = ranges; range; range = next) {
+            next = range->next;
+
+            /*
+             * Decommit aged pages, and age dirty ones.
+             */
+
+            pending = 0;
+            for (i = 0; i < (range->size>>6); i++) {
+                pages = range->aged[i];
+                range->aged[i] = range->dirty[i];
+                range->dirty[i] = 0;
+                pending |= range->aged[i];
+                if (pages) {
+                    DecommitRangePages(range, i, pages);
+                }
+            }
+
+            if (range->free < range->size || pending || range->pinned) {
+                prev = range;
+                continue;
+            }
+
+            /*
+             * Range is empty, release it.
+             */
+
+            if (!PlatReleaseRange(range->base, range->size)) {
+                /*
+                 * Fatal error!
+                 */
+
+                /*! @fatal{COL_ERROR_MEMORY,Address range release failed} */
+                Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
+                        "Address range release failed");
+                goto end;
+            }
+
+            /*
+             * Remove from list and index.
+             */
+
+            if (prev) {
+                prev->next = next;
+            } else {
+                ranges = next;
+            }
+            if (lastRange == range) lastRange = prev;
+            if (freeRange == range) freeRange = next;
+            RemoveRange(range);
+            free(range->used);
+            free(range);
+        }
     }
 end:
     PlatLeaveProtectAddressRanges();
+    return done;
 }
 
 /** @endcond @endprivate */
@@ -899,8 +1304,39 @@ end:
 
 /** @beginprivate @cond PRIVATE */
 
+/**
+ * Write-protect system page group. When #COL_USE_SOFTWARE_BARRIER is
+ * defined, the logical pages of the group are flagged instead, and
+ * WriteBarrier() catches writes in place of the system.
+ *
+ * @see SysPageProtect
+ */
+static void
+ProtectPageGroup(
+    void *base,     /*!< First page of page group. */
+    size_t size,    /*!< Number of system pages in page group. */
+    int protect)    /*!< Whether to protect or unprotect page group. */
+{
+#ifdef COL_USE_SOFTWARE_BARRIER
+    Page *page;
+
+    for (page = (Page *) base; ; page++) {
+        if (protect) {
+            PAGE_SET_FLAG(page, PAGE_FLAG_PROTECTED);
+        } else {
+            PAGE_CLEAR_FLAG(page, PAGE_FLAG_PROTECTED);
+        }
+        if (PAGE_FLAG(page, PAGE_FLAG_LAST)) break;
+    }
+#else
+    PlatProtectPages(base, size, protect);
+#endif /* COL_USE_SOFTWARE_BARRIER */
+}
+
 /**
  * Write-protect system page group.
+ *
+ * @see WriteBarrier
  */
 void
 SysPageProtect(
@@ -916,43 +1352,24 @@ SysPageProtect(
          * Get range info for page.
          */
 
-        range = ranges;
-        while (range) {
-            if (page >= range->base && (char *) page < (char *) range->base
-                    + (range->size << shiftPage)) {
-                break;
-            }
-            range = range->next;
-        }
+        range = FindRange(page);
         if (!range) {
             /*
-             * Likely dedicated address range.
+             * Not found.
              */
 
-            range = dedicatedRanges;
-            while (range) {
-                if (page >= range->base && (char *) page < (char *) range->base
-                        + (range->size << shiftPage)) {
-                    break;
-                }
-                range = range->next;
-            }
-            if (!range) {
-                /*
-                 * Not found.
-                 */
-
-                /*! @fatal{COL_ERROR_MEMORY,Page not found} */
-                Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
-                        "Page not found");
-                goto end;
-            }
-
+            /*! @fatal{COL_ERROR_MEMORY,Page not found} */
+            Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
+                    "Page not found");
+            goto end;
+        }
+        if (!range->used) {
             /*
-             * Update protection & write tracking flag for whole range.
+             * Dedicated address range, update protection & write tracking
+             * flag for whole range.
              */
 
-            PlatProtectPages(range->base, range->size, protect);
+            ProtectPageGroup(range->base, range->size, protect);
             range->allocInfo[0] = !protect;
             goto end;
         }
@@ -969,7 +1386,7 @@ SysPageProtect(
          * first one in page group).
          */
 
-        PlatProtectPages((char *) range->base + (index << shiftPage), size,
+        ProtectPageGroup((char *) range->base + (index << shiftPage), size,
                 protect);
         if (protect) {
             range->allocInfo[range->size+(index>>3)] &= ~(1<<(index&7));
@@ -981,6 +1398,68 @@ end:
     PlatLeaveProtectAddressRanges();
 }
 
+/**
+ * Return all pages freed by a thread or kept in its page cache to their
+ * address ranges. Called when the thread's data is about to be freed, and
+ * by GC worker threads after each GC, as they never allocate eden pages
+ * from their cache.
+ *
+ * @see SysPageFree
+ * @see SysPageFlush
+ */
+void
+SysPageCacheCleanup(
+    ThreadData *data)   /*!< Thread-specific data. */
+{
+    if (!data->nbCachedPages && !data->nbFreedPages) {
+        return;
+    }
+
+    PlatEnterProtectAddressRanges();
+    {
+        while (data->nbFreedPages) {
+            RangeFreePages(data->freedPages[--data->nbFreedPages], NULL);
+        }
+        while (data->nbCachedPages) {
+            RangeFreePages(data->pageCache[--data->nbCachedPages], NULL);
+        }
+    }
+    PlatLeaveProtectAddressRanges();
+    data->minCachedPages = 0;
+}
+
+/**
+ * Return pages that remained in a thread's page cache since the last call to
+ * their address ranges, where they get decommitted in due time like other
+ * free pages. As the cache is a stack, these are the bottommost ones.
+ *
+ * @attention
+ *      The thread must not allocate or free pages meanwhile, e.g.\ it must
+ *      be out of GC-protected sections of a group being collected.
+ *
+ * @see SysPageDecommit
+ */
+void
+SysPageCacheTrim(
+    ThreadData *data)   /*!< Thread-specific data. */
+{
+    size_t nbTrimmed = data->minCachedPages, i;
+
+    if (nbTrimmed) {
+        PlatEnterProtectAddressRanges();
+        {
+            for (i = 0; i < nbTrimmed; i++) {
+                RangeFreePages(data->pageCache[i], NULL);
+            }
+        }
+        PlatLeaveProtectAddressRanges();
+        data->nbCachedPages -= nbTrimmed;
+        memmove(data->pageCache, data->pageCache + nbTrimmed,
+                data->nbCachedPages * sizeof(*data->pageCache));
+    }
+    data->minCachedPages = data->nbCachedPages;
+}
+
 /** @endcond @endprivate */
 
 /* End of System Page Allocation */
@@ -996,9 +1475,19 @@ end:
  * Allocate pages in pool. Pages are inserted after the given page. This
  * guarantees better performances by avoiding the traversal of previous pages.
  *
+ * @retval <>0  if successful.
+ * @retval 0    if eden pages would exceed the group's hard heap limit, or if
+ *              system pages cannot be allocated. An error is raised in both
+ *              cases.
+ *
+ * @sideeffect
+ *      Eden pools sweep pending pages from older generations beforehand.
+ *
  * @see SysPageAlloc
+ * @see SweepPendingPages
+ * @see CheckHeapLimits
  */
-void
+int
 PoolAllocPages(
     MemoryPool *pool,   /*!< Pool to allocate pages into. */
     size_t number)      /*!< Number of pages to allocate. */
@@ -1009,6 +1498,15 @@ PoolAllocPages(
     size_t nbSysPages, nbPages;
     size_t i;
 
+    if (pool->generation == 1) {
+        /*
+         * Sweep pages left pending by the last GC first, so that freed system
+         * pages can be reused right away.
+         */
+
+        SweepPendingPages(data->groupData, GC_SWEEP_STEP);
+    }
+
     if (number == 1) {
         /*
          * Regular case: allocate one physical page divided into equally sized
@@ -1035,12 +1533,34 @@ PoolAllocPages(
         }
     }
 
+    /*
+     * Account for pages in the group's heap size. Limits only apply to
+     * mutator allocations, GCs must be able to promote words.
+     */
+
+    if (pool->generation == 1 && (data->groupData->softLimit
+            || data->groupData->hardLimit)) {
+        if (!CheckHeapLimits(data->groupData, nbPages)) {
+            return 0;
+        }
+    } else {
+        PlatAtomicAdd(&data->groupData->nbPages, nbPages);
+    }
+
     /*
      * Allocate system pages. Make sure to mark pages as written for older
      * generations for proper parent tracking.
      */
 
     base = (Page *) SysPageAlloc(nbSysPages, (pool->generation >= 2));
+    if (!base) {
+        PlatAtomicAdd(&data->groupData->nbPages, -(intptr_t) nbPages);
+
+        /*! @fatal{COL_ERROR_MEMORY,Page allocation failed} */
+        Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
+                "Page allocation failed");
+        return 0;
+    }
 
     if (!pool->pages) {
         pool->pages = base;
@@ -1049,9 +1569,10 @@ PoolAllocPages(
         }
     }
 
-    pool->nbPages += nbPages;
-    pool->nbAlloc += nbPages;
-    pool->nbSetCells += RESERVED_CELLS*nbPages;
+    POOL_ADD_COUNTER(pool->nbPages, nbPages);
+    POOL_ADD_COUNTER(pool->nbAlloc, nbPages);
+    POOL_ADD_COUNTER(pool->totalAlloc, nbPages);
+    POOL_ADD_COUNTER(pool->nbSetCells, RESERVED_CELLS*nbPages);
 
     /*
      * Initialize pages.
@@ -1070,7 +1591,15 @@ PoolAllocPages(
 
         PAGE_SET_GENERATION(page, pool->generation);
         PAGE_CLEAR_FLAG(page, PAGE_FLAGS_MASK);
-        PAGE_GROUPDATA(page) = data->groupData;
+        if (pool->generation == 1) {
+            /*
+             * Eden pages remember their owner thread.
+             */
+
+            PAGE_THREADDATA(page) = data;
+        } else {
+            PAGE_GROUPDATA(page) = data->groupData;
+        }
 
         /* Initialize bit mask for allocated cells. */
         ClearAllCells(page);
@@ -1079,30 +1608,80 @@ PoolAllocPages(
     PAGE_SET_FLAG(base, PAGE_FLAG_FIRST);
     PAGE_SET_NEXT(prev, NULL);
     PAGE_SET_FLAG(prev, PAGE_FLAG_LAST);
+    return 1;
 }
 
 /**
  * Free empty system pages in pool. Refresh page count in the process.
  *
- * @see SysPageFree
+ * @see PoolStartSweep
+ * @see PoolSweepPages
  */
 void
 PoolFreeEmptyPages(
     MemoryPool *pool)   /*!< Pool with pages to free. */
 {
-    ThreadData *data = PlatGetThreadData();
+    pool->nbPages = 0;
+    pool->nbSetCells = 0;
+    PoolStartSweep(pool, NULL);
+    PoolSweepPages(pool, 0);
+}
+
+/**
+ * Start sweeping pool pages, from the head of the pool up to the given page.
+ * Swept pages are accounted in the pool's page and cell counts as they get
+ * swept by PoolSweepPages().
+ *
+ * @see PoolSweepPages
+ */
+void
+PoolStartSweep(
+    MemoryPool *pool,   /*!< Pool with pages to sweep. */
+    Page *end)          /*!< First page not to sweep, NULL for all pages. */
+{
+    ASSERT(!pool->sweepPage);
+    pool->sweepPage = (pool->pages != end ? pool->pages : NULL);
+    pool->sweepPrev = NULL;
+    pool->sweepEnd = end;
+}
+
+/**
+ * Sweep pool pages pending since PoolStartSweep(): free empty system pages,
+ * and account the remaining ones in the pool's page and cell counts. Freed
+ * pages are no longer accounted as allocated since the last GC.
+ *
+ * @retval 1    if sweeping is complete.
+ * @retval 0    if pages remain to be swept.
+ *
+ * @see SysPageFree
+ */
+int
+PoolSweepPages(
+    MemoryPool *pool,   /*!< Pool with pages to sweep. */
+    size_t max)         /*!< Maximum number of system pages to sweep, 0 for
+                             no limit. */
+{
     Page *page, *base, *prev, *next;
+    GroupData *groupData;
     const size_t nbPagesPerSysPage = systemPageSize/PAGE_SIZE;
-    size_t nbSetCells, nbPages, i;
+    size_t nbSetCells, nbPages, nbSwept, i;
 
-    pool->nbPages = 0;
-    pool->nbSetCells = 0;
+    if (!pool->sweepPage) {
+        /*
+         * Nothing to sweep.
+         */
+
+        return 1;
+    }
 
     /*
      * Iterate over system pages...
      */
 
-    for (prev = NULL, base = pool->pages; base; base = next) {
+    prev = pool->sweepPrev;
+    for (base = pool->sweepPage, nbSwept = 0;
+            base != pool->sweepEnd && (!max || nbSwept < max);
+            base = next, nbSwept++) {
         /*
          * ... then over logical pages within the system page.
          */
@@ -1116,6 +1695,8 @@ PoolFreeEmptyPages(
             if (PAGE_FLAG(page, PAGE_FLAG_LAST)) break;
         }
         next = PAGE_NEXT(page);
+        groupData = (pool->generation == 1 ? PAGE_THREADDATA(base)->groupData
+                : PAGE_GROUPDATA(base));
         if (nbSetCells > RESERVED_CELLS * nbPages) {
             /*
              * At least one page contains allocated cells.
@@ -1134,6 +1715,8 @@ PoolFreeEmptyPages(
                      * trailing cells.
                      */
 
+                    PlatAtomicAdd(&groupData->nbPages,
+                            nbPagesPerSysPage - nbPages);
                     PAGE_CLEAR_FLAG(page, PAGE_FLAG_LAST);
                     for (i = nbPages; i < nbPagesPerSysPage; i++) {
                         PAGE_SET_NEXT(page, page+1);
@@ -1141,7 +1724,9 @@ PoolFreeEmptyPages(
 
                         PAGE_SET_GENERATION(page, pool->generation);
                         PAGE_CLEAR_FLAG(page, PAGE_FLAGS_MASK);
-                        PAGE_GROUPDATA(page) = data->groupData;
+                        PAGE_SET_FLAG(page,
+                                PAGE_FLAG(base, PAGE_FLAG_PROTECTED));
+                        PAGE_GROUPDATA(page) = PAGE_GROUPDATA(base);
 
                         /* Initialize bit mask for allocated cells. */
                         ClearAllCells(page);
@@ -1180,10 +1765,34 @@ PoolFreeEmptyPages(
              */
 
             SysPageFree(base);
+            PlatAtomicAdd(&groupData->nbPages, -(intptr_t) nbPages);
+            pool->nbAlloc -= (pool->nbAlloc < nbPages ? pool->nbAlloc : nbPages);
         }
     }
-    ASSERT(!prev||!PAGE_NEXT(prev));
-    pool->lastPage = prev;
+
+    if (base != pool->sweepEnd) {
+        /*
+         * Remember where to resume.
+         */
+
+        pool->sweepPage = base;
+        pool->sweepPrev = prev;
+        return 0;
+    }
+
+    /*
+     * Sweep complete. Free cell pointers may refer to freed pages.
+     */
+
+    if (!pool->sweepEnd) {
+        ASSERT(!prev||!PAGE_NEXT(prev));
+        pool->lastPage = prev;
+    }
+    pool->sweepPage = NULL;
+    for (i = 0; i < AVAILABLE_CELLS; i++) {
+        pool->lastFreeCell[i] = PAGE_CELL(pool->pages, 0);
+    }
+    return 1;
 }
 
 /** @endcond @endprivate */
@@ -1236,15 +1845,7 @@ PoolAllocCells(
 
         d = lldiv(number-AVAILABLE_CELLS, CELLS_PER_PAGE);
         nbPages = 1 + d.quot + (d.rem?1:0);
-        PoolAllocPages(pool, nbPages);
-        if (!pool->lastPage) {
-            /*
-             * Fatal error!
-             */
-
-            /*! @fatal{COL_ERROR_MEMORY,Page allocation failed} */
-            Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
-                    "Page allocation failed");
+        if (!PoolAllocPages(pool, nbPages)) {
             return NULL;
         }
 
@@ -1273,6 +1874,9 @@ PoolAllocCells(
         }
         first = CELLS_PER_PAGE - nbFirst;
         SetCells(pool->lastPage, first, nbFirst);
+        if (pool->generation == 1) {
+            POOL_ADD_COUNTER(pool->nbSetCells, nbFirst);
+        }
         return (Cell *) pool->lastPage + first;
     }
 
@@ -1281,7 +1885,9 @@ PoolAllocCells(
          * Alloc first pages in pool.
          */
 
-        PoolAllocPages(pool, 1);
+        if (!PoolAllocPages(pool, 1)) {
+            return NULL;
+        }
     }
     cells = PageAllocCells(number, pool->lastFreeCell[number-1]);
     if (cells) {
@@ -1291,6 +1897,9 @@ PoolAllocCells(
          */
 
         pool->lastFreeCell[number-1] = cells;
+        if (pool->generation == 1) {
+            POOL_ADD_COUNTER(pool->nbSetCells, number);
+        }
         return cells;
     }
 
@@ -1299,15 +1908,7 @@ PoolAllocCells(
      */
 
     tail = pool->lastPage;
-    PoolAllocPages(pool, 1);
-    if (!PAGE_NEXT(tail)) {
-        /*
-         * Fatal error!
-         */
-
-        /*! @fatal{COL_ERROR_MEMORY,Page allocation failed} */
-        Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
-                "Page allocation failed");
+    if (!PoolAllocPages(pool, 1)) {
         return NULL;
     }
     cells = PageAllocCells(number, PAGE_CELL(PAGE_NEXT(tail), 0));
@@ -1322,6 +1923,75 @@ PoolAllocCells(
         pool->lastFreeCell[i] = cells;
     }
 
+    if (pool->generation == 1) {
+        POOL_ADD_COUNTER(pool->nbSetCells, number);
+    }
+    return cells;
+}
+
+/**
+ * Allocate cells in a pool and start a new bump allocation run with the free
+ * cells that follow them in the same page. Subsequent allocations simply
+ * advance the pool's cursor until the run is exhausted.
+ *
+ * Cells of the run are all set upfront so that the page bitmask remains a
+ * valid allocation map. This is only suitable for eden pools, which are
+ * fully collected at each GC: unused cells of the run are cleared by the
+ * mark phase.
+ *
+ * @retval pointer  to the first allocated cell if successful
+ * @retval NULL     otherwise
+ *
+ * @see PoolAllocCells
+ * @see AllocCells
+ */
+Cell *
+PoolBumpAllocCells(
+    MemoryPool *pool,   /*!< Pool to allocate cells into. */
+    size_t number)      /*!< Number of cells to allocate. */
+{
+    Cell *cells;
+    Page *page;
+    size_t first, last;
+
+    ASSERT(pool->generation == 1);
+    if (number > AVAILABLE_CELLS) {
+        /*
+         * Cells span several pages, keep current run.
+         */
+
+        return PoolAllocCells(pool, number);
+    }
+
+    if (pool->cursor != pool->limit) {
+        /*
+         * Give unused cells of the current run back to the page.
+         */
+
+        ClearCells(CELL_PAGE(pool->cursor), CELL_INDEX(pool->cursor),
+                pool->limit - pool->cursor);
+        POOL_ADD_COUNTER(pool->nbSetCells, -(pool->limit - pool->cursor));
+    }
+    pool->cursor = pool->limit = NULL;
+
+    cells = PoolAllocCells(pool, number);
+    if (!cells) return NULL;
+
+    /*
+     * Extend run to the free cells following the allocated ones.
+     */
+
+    page = CELL_PAGE(cells);
+    first = CELL_INDEX(cells) + number;
+    for (last = first; last < CELLS_PER_PAGE && !TestCell(page, last);
+            last++);
+    if (last > first) {
+        SetCells(page, first, last - first);
+        POOL_ADD_COUNTER(pool->nbSetCells, last - first);
+    }
+    pool->cursor = cells + number;
+    pool->limit = cells + (last - CELL_INDEX(cells));
+
     return cells;
 }
 
@@ -1388,7 +2058,9 @@ PageAllocCells(
 }
 
 /**
- * Find sequence of free cells in page.
+ * Find sequence of free cells in page. The bitmask is processed 64 cells at
+ * a time using bitwise operations, and pages with fewer free cells than
+ * needed are rejected using a population count.
  *
  * @retval index    of first cell of sequence if found
  * @retval -1       if none found
@@ -1399,96 +2071,60 @@ FindFreeCells(
     size_t number,  /*!< Number of cells to look for. */
     size_t index)   /*!< First cell to consider. */
 {
-    size_t i, first = (size_t)-1, remaining;
-    char seq;
-    unsigned char *mask = PAGE_BITMASK(page);
+    uint64_t lo, hi;
+    size_t length, shift;
+
+    ASSERT(number > 0 && number <= AVAILABLE_CELLS);
 
     /*
-     * Iterate over bytes of the bitmask to find a chain of <number> zero bits.
+     * Work on free cells as set bits, one 64-bit word at a time. With 64
+     * cells per page there is no upper word, so treat it as full.
      */
 
-    ASSERT(number <= AVAILABLE_CELLS);
-    remaining = number;
-    for (i = (index>>3); i < (CELLS_PER_PAGE>>3); i++) {
-        if (remaining <= 7) {
-            /*
-             * End of sequence, or whole sequence for number < 8.
-             * Find sequence in byte.
-             */
-
-            seq = firstZeroBitSequence[remaining-1][mask[i]];
-            if (seq != -1) {
-                if (remaining == number) {
-                    /*
-                     * Sequence fits into one byte.
-                     */
-
-                    return (i<<3) + seq;
-                }
-
-                /*
-                 * Sequence spans over several bytes.
-                 */
-
-                if (seq == 0) {
-                    /*
-                     * Sequence is contiguous.
-                     */
-
-                    return first;
-                }
-            }
-
-            /*
-             * Sequence interrupted, restart.
-             */
-
-            remaining = number;
-        }
-
-        /*
-         * Sequence may span over several bytes.
-         */
+    lo = ~BitmaskWord(page, 0);
+#if CELLS_PER_PAGE == 128
+    hi = ~BitmaskWord(page, 1);
+#else
+    hi = 0;
+#endif
 
-        if (remaining == number) {
-            /*
-             * Beginning of sequence.
-             *
-             * @note leading bits actually denote trailing cells: bit 0 (LSB) is
-             * first cell, bit 7 (MSB) is last.
-             */
+    /*
+     * Skip pages that don't have enough free cells without scanning them.
+     */
 
-            seq = longestLeadingZeroBitSequence[mask[i]];
-            if (seq) {
-                first = (i<<3) + (8-seq);
-                remaining -= seq;
-            }
-        } else {
-            /*
-             * Middle of sequence, look for 8 bits cleared = zero byte.
-             */
+    if (PlatPopCount64(lo) + PlatPopCount64(hi) < number) {
+        return (size_t)-1;
+    }
 
-            if (mask[i] == 0) {
-                /*
-                 * Continue sequence.
-                 */
+    /*
+     * Keep only the bits that start a chain of <number> free cells. At each
+     * step bit i remains set iff cells i to i+length-1 are free, and length
+     * at most doubles, so this takes log2(number) steps.
+     */
 
-                remaining -= 8;
-            } else {
-                /*
-                 * Sequence interrupted, restart.
-                 */
+    for (length = 1; length < number; length += shift) {
+        shift = (number-length < length) ? number-length : length;
+        ASSERT(shift < 64);
+        lo &= (lo >> shift) | (hi << (64-shift));
+        hi &= hi >> shift;
+    }
 
-                remaining = number;
-            }
-        }
-        if (remaining == 0) {
-            /*
-             * End of sequence reached.
-             */
+    /*
+     * Ignore sequences starting before the first cell to consider, then pick
+     * the first remaining one.
+     */
 
-            return first;
-        }
+    if (index < 64) {
+        lo &= ~(uint64_t)0 << index;
+    } else {
+        lo = 0;
+        hi &= ~(uint64_t)0 << (index-64);
+    }
+    if (lo) {
+        return PlatCountTrailingZeros64(lo);
+    }
+    if (hi) {
+        return 64 + PlatCountTrailingZeros64(hi);
     }
 
     /*
@@ -1522,6 +2158,60 @@ SetCells(
 #endif
 }
 
+/**
+ * Atomically set the page bitmask for a given sequence of cells. Contrary to
+ * SetCells(), this can be called concurrently on the same page by several
+ * threads, e.g. during parallel marking.
+ *
+ * @retval <>0  if the first cell was set by the caller.
+ * @retval 0    if the first cell was already set, in which case the
+ *              remaining cells are left untouched.
+ *
+ * @see SetCells
+ */
+int
+SetCellsAtomic(
+    Page *page,     /*!< The page. */
+    size_t first,   /*!< Index of first cell. */
+    size_t number)  /*!< Number of cells in sequence. */
+{
+/*! \cond IGNORE */
+#if CELLS_PER_PAGE == 64 && defined(COL_BIGENDIAN)
+#   define CELL_BIT(index) (0x80>>((index)&7))
+#else
+#   define CELL_BIT(index) (1<<((index)&7))
+#endif
+/*! \endcond *//* IGNORE */
+
+    unsigned char *mask = PAGE_BITMASK(page);
+    size_t i, last = first+number;
+    unsigned char bits;
+
+    /*
+     * The first cell decides which thread owns the sequence.
+     */
+
+    if (PlatAtomicOrByte(mask+(first>>3), CELL_BIT(first)) & CELL_BIT(first)) {
+        return 0;
+    }
+
+    /*
+     * Set remaining cells one byte at a time.
+     */
+
+    for (i = first+1; i < last; ) {
+        bits = 0;
+        do {
+            bits |= CELL_BIT(i);
+            i++;
+        } while (i < last && (i&7));
+        PlatAtomicOrByte(mask+((i-1)>>3), bits);
+    }
+    return 1;
+
+#undef CELL_BIT
+}
+
 /**
  * Clear the page bitmask for a given sequence of cells.
  */
@@ -1605,37 +2295,15 @@ size_t
 NbSetCells(
     Page *page) /*!< The page. */
 {
-#if 0 && CELLS_PER_PAGE == 64 //FIXME?
     /*
-     * Hamming weight on bitstring.
-     *
-     * See http://en.wikipedia.org/wiki/Hamming_weight
-     *
-     * " This uses fewer arithmetic operations than any other known
-     * implementation on machines with fast multiplication.
-     * It uses 12 arithmetic operations, one of which is a multiply. "
+     * Bit order doesn't matter here, use native words.
      */
 
-    const uint64_t m1  = 0x5555555555555555; /* binary: 0101... */
-    const uint64_t m2  = 0x3333333333333333; /* binary: 00110011..  */
-    const uint64_t m4  = 0x0f0f0f0f0f0f0f0f; /* binary:  4 zeros,  4 ones ...  */
-    const uint64_t m8  = 0x00ff00ff00ff00ff; /* binary:  8 zeros,  8 ones ...  */
-    const uint64_t m16 = 0x0000ffff0000ffff; /* binary: 16 zeros, 16 ones ...  */
-    const uint64_t m32 = 0x00000000ffffffff; /* binary: 32 zeros, 32 ones */
-    const uint64_t hff = 0xffffffffffffffff; /* binary: all ones */
-    const uint64_t h01 = 0x0101010101010101; /* the sum of 256 to the power of 0,1,2,3...  */
-    uint64_t x = PAGE_BITMASK(page);
-    x -= (x >> 1) & m1;             /* put count of each 2 bits into those 2 bits */
-    x = (x & m2) + ((x >> 2) & m2); /* put count of each 4 bits into those 4 bits */
-    x = (x + (x >> 4)) & m4;        /* put count of each 8 bits into those 8 bits */
-    return (x * h01)>>56;  /* returns left 8 bits of x + (x<<8) + (x<<16) + (x<<24) + ...  */
+    uint64_t *mask = (uint64_t *) PAGE_BITMASK(page);
+#if CELLS_PER_PAGE == 128
+    return PlatPopCount64(mask[0]) + PlatPopCount64(mask[1]);
 #else
-    unsigned char *mask = PAGE_BITMASK(page);
-    size_t i, nb = 0;
-    for (i=0; i < (CELLS_PER_PAGE>>3); i++) {
-        nb += nbBitsSet[mask[i]];
-    }
-    return nb;
+    return PlatPopCount64(mask[0]);
 #endif
 }
 
@@ -1654,35 +2322,181 @@ NbSetCells(
 
 /** @beginprivate @cond PRIVATE */
 
+#ifdef COL_USE_THREADS
+/**
+ * Record modification of a word outside of the calling thread's eden, or
+ * within any eden in #COL_SHARED groups. Such modifications may publish
+ * eden words of the calling thread, which then rules out thread-local
+ * collection of its eden until the next group-wide one.
+ *
+ * @sideeffect
+ *      When #COL_USE_SOFTWARE_BARRIER is defined and the page is protected,
+ *      calls SysPageProtect().
+ *
+ * @see WriteBarrier
+ * @see ThreadData
+ */
+void
+TrackWrite(
+    Page *page) /*!< Page containing the modified word. */
+{
+    ThreadData *data = PlatGetThreadData();
+
+    if (PAGE_GENERATION(page) != 1 || PAGE_THREADDATA(page) != data) {
+        data->published = 1;
+    }
+
+#ifdef COL_USE_SOFTWARE_BARRIER
+    if (PAGE_FLAG(page, PAGE_FLAG_PROTECTED)) {
+        SysPageProtect(page, 0);
+    }
+#endif /* COL_USE_SOFTWARE_BARRIER */
+}
+#endif /* COL_USE_THREADS */
+
+/**
+ * Find remembered set entry for page.
+ *
+ * @return The entry, or NULL if the page is not remembered.
+ *
+ * @see PARENT_HASH
+ */
+ParentEntry *
+FindParent(
+    GroupData *data,    /*!< Group-specific data. */
+    Page *page)         /*!< Page to find entry for. */
+{
+    size_t mask = data->parentsSize-1, i;
+
+    if (!data->parents) {
+        return NULL;
+    }
+    for (i = PARENT_HASH(page) & mask; data->parents[i].page;
+            i = (i+1) & mask) {
+        if (data->parents[i].page == page) return data->parents+i;
+    }
+    return NULL;
+}
+
+/**
+ * Add page to remembered set. New entries have no card set.
+ *
+ * @return The page entry.
+ *
+ * @see FindParent
+ */
+ParentEntry *
+AddParent(
+    GroupData *data,    /*!< Group-specific data. */
+    Page *page)         /*!< Page to add. */
+{
+    ParentEntry *entry;
+    size_t mask, i;
+
+    entry = FindParent(data, page);
+    if (entry) {
+        /*
+         * Already remembered.
+         */
+
+        return entry;
+    }
+
+    if ((data->nbParents+1)*2 > data->parentsSize) {
+        GrowParents(data);
+    }
+    mask = data->parentsSize-1;
+    for (i = PARENT_HASH(page) & mask; data->parents[i].page;
+            i = (i+1) & mask);
+    entry = data->parents+i;
+    entry->page = page;
+    entry->written = 0;
+    ClearAllCells((Page *) entry);
+    data->nbParents++;
+    return entry;
+}
+
+/**
+ * Double the size of the remembered set table, keeping it at most half full.
+ *
+ * @see AddParent
+ */
+static void
+GrowParents(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    ParentEntry *entries = data->parents;
+    size_t size = data->parentsSize, mask, i, j;
+
+    data->parentsSize = (size ? size*2 : 16);
+    data->parents = (ParentEntry *) calloc(data->parentsSize,
+            sizeof(ParentEntry));
+    mask = data->parentsSize-1;
+    for (i = 0; i < size; i++) {
+        if (!entries[i].page) continue;
+        for (j = PARENT_HASH(entries[i].page) & mask; data->parents[j].page;
+                j = (j+1) & mask);
+        data->parents[j] = entries[i];
+    }
+    free(entries);
+}
+
+/**
+ * Add pages of a page group written since the last GC to the remembered
+ * set. All their words will be traversed during the mark phase.
+ *
+ * @see UpdateParents
+ */
+static void
+RememberWrittenPages(
+    GroupData *data,    /*!< Group-specific data. */
+    Page *page)         /*!< First page of page group. */
+{
+    ParentEntry *entry;
+
+    for (; page; page = PAGE_NEXT(page)) {
+        entry = AddParent(data, page);
+        entry->written = 1;
+        PAGE_CLEAR_FLAG(page, PAGE_FLAG_PARENT);
+        if (PAGE_FLAG(page, PAGE_FLAG_LAST)) break;
+    }
+}
+
 /**
- * Add pages written since the last GC to parent tracking structures. Then
- * each page's parent flag is cleared for the mark phase.
+ * Add pages written since the last GC to the remembered set, clearing their
+ * parent flag for the mark phase.
+ *
+ * Write tracking flags of page groups are left as is: they get cleared along
+ * with write protection once parents are purged (see PurgeParents()).
  */
 void
 UpdateParents(
     GroupData *data)    /*!< Group-specific data. */
 {
     Page *page;
+    ParentEntry *entry;
     size_t i, size;
     AddressRange * range;
-    Cell *cell;
 
     /*
-     * First clear parent flags for existing parents.
+     * First reset existing parents. Their pages may be write-protected, so
+     * parent state is kept in their cards rather than in page flags. Cards of
+     * pages from collected generations are computed again during the mark
+     * phase.
      */
 
-    for (cell = data->parents; cell; cell = PARENT_NEXT(cell)) {
-        ASSERT(TestCell(CELL_PAGE(cell), CELL_INDEX(cell)));
-        ASSERT(PAGE_FLAG(PARENT_PAGE(cell), PAGE_FLAG_FIRST));
-        for (page = PARENT_PAGE(cell); page; page = PAGE_NEXT(page)) {
-            PAGE_CLEAR_FLAG(page, PAGE_FLAG_PARENT);
-            if (PAGE_FLAG(page, PAGE_FLAG_LAST)) break;
+    for (i = 0; i < data->parentsSize; i++) {
+        entry = data->parents+i;
+        if (!entry->page) continue;
+        entry->written = 0;
+        if (PAGE_GENERATION(entry->page) <= data->maxCollectedGeneration) {
+            ClearAllCells((Page *) entry);
         }
     }
 
     /*
      * Iterate over ranges and find modified page groups belonging to the given
-     * thread group, adding them to its parent list.
+     * thread group, adding them to its remembered set.
      */
 
     PlatEnterProtectAddressRanges();
@@ -1726,23 +2540,7 @@ UpdateParents(
                     continue;
                 }
 
-                /*
-                 * Clear write tracking flag.
-                 */
-
-                range->allocInfo[range->size+(i>>3)] &= ~(1<<(i&7));
-
-                /*
-                 * Add first page to the thread group's parent list.
-                 */
-
-                cell = PoolAllocCells(&data->rootPool, 1);
-                PARENT_INIT(cell, data->parents, page);
-                data->parents = cell;
-                for (; page; page = PAGE_NEXT(page)) {
-                    PAGE_CLEAR_FLAG(page, PAGE_FLAG_PARENT);
-                    if (PAGE_FLAG(page, PAGE_FLAG_LAST)) break;
-                }
+                RememberWrittenPages(data, page);
 
                 i += size;
             }
@@ -1752,10 +2550,11 @@ UpdateParents(
          * Now iterate over dedicated ranges.
          */
 
-        for (range = dedicatedRanges; range; range= range->next) {
-            if (!range->allocInfo[0]) {
+        for (i = 0; i < nbRanges; i++) {
+            range = rangeIndex[i];
+            if (range->used || !range->allocInfo[0]) {
                 /*
-                 * Not modified.
+                 * Regular range, or not modified.
                  */
 
                 continue;
@@ -1770,19 +2569,7 @@ UpdateParents(
                 continue;
             }
 
-            /*
-             * Clear write tracking flag.
-             */
-
-            range->allocInfo[0] = 0;
-
-            /*
-             * Add first page to the thread group's parent list.
-             */
-
-            cell = PoolAllocCells(&data->rootPool, 1);
-            PARENT_INIT(cell, data->parents, page);
-            data->parents = cell;
+            RememberWrittenPages(data, page);
         }
     }
     PlatLeaveProtectAddressRanges();
@@ -90,7 +90,10 @@
 #define GC_MAX_GENERATIONS      6
 
 /**
- * Generational factor, i.e.\ number of GCs between generations.
+ * Default generational factor, i.e.\ number of GCs between generations.
+ *
+ * @see Col_SetGcParam
+ * @see COL_GC_GEN_FACTOR
  */
 #define GC_GEN_FACTOR           10
 
@@ -116,56 +119,229 @@
 #define PROMOTE_COMPACT
 
 /**
- * Threshold value on a pool's fill ratio to decide whether to activate
- * compaction.
+ * Default threshold value on a pool's fill ratio to decide whether to
+ * activate compaction, in percent.
  *
  * @see PerformGC
  * @see MarkWord
  * @see PROMOTE_COMPACT
+ * @see COL_GC_PROMOTE_FILL_RATIO
+ */
+#define PROMOTE_PAGE_FILL_RATIO 90
+
+/**
+ * Fill ratio of system pages below which full collections evacuate their
+ * words, in percent. Evacuated words are packed into fresh pages of the same
+ * generation so that sparse pages get freed, including in the oldest
+ * generation that promotion never compacts.
+ *
+ * @see Col_CompactHeap
+ * @see SelectEvacuatedPages
+ * @see MarkWord
+ * @see PROMOTE_COMPACT
  */
-#define PROMOTE_PAGE_FILL_RATIO 0.90
+#define GC_EVACUATE_FILL_RATIO  50
 
 /*---------------------------------------------------------------------------
  * Control when garbage collection are performed.
  *--------------------------------------------------------------------------*/
 
 /**
- * Minimum number of page allocations in a pool since last GC before
+ * Default minimum number of page allocations in a pool since last GC before
  * triggering a new one.
  *
  * @see Col_ResumeGC
  * @see PerformGC
- * @see GC_THRESHOLD
+ * @see GcThreshold
+ * @see COL_GC_MIN_PAGE_ALLOC
  */
 #define GC_MIN_PAGE_ALLOC       64
 
 /**
- * Number of page allocations in a pool since last GC above which to always
- * trigger a new one.
+ * Default number of page allocations in a pool since last GC above which to
+ * always trigger a new one.
  *
  * @see Col_ResumeGC
  * @see PerformGC
- * @see GC_THRESHOLD
+ * @see GcThreshold
+ * @see COL_GC_MAX_PAGE_ALLOC
  */
 #define GC_MAX_PAGE_ALLOC       1024
 
+/*---------------------------------------------------------------------------
+ * Control adaptive GC thresholds.
+ *--------------------------------------------------------------------------*/
+
 /**
- * Utility macro that combines both min and max page allocation numbers
- * for GC trigger control.
+ * Default pause time target of eden collections in adaptive mode, in
+ * microseconds.
  *
- * @param threshold     Threshold value.
+ * @see Col_SetGcParam
+ * @see COL_GC_PAUSE_TARGET
+ * @see AdaptEdenThreshold
+ */
+#define GC_DEFAULT_PAUSE_TARGET 10000
+
+/**
+ * Eden survival rate in percent below which adaptive mode grows eden. Eden
+ * collection cost mostly depends on surviving cells, so a larger eden
+ * lowers the overall GC cost of short-lived data.
  *
- * @return Actual threshold value compared to number of allocations.
+ * @see AdaptEdenThreshold
+ */
+#define GC_ADAPTIVE_SURVIVAL    10
+
+/*---------------------------------------------------------------------------
+ * Control how the mark phase is parallelized.
+ *--------------------------------------------------------------------------*/
+
+/**
+ * Default number of marker threads used during the mark phase. A value of 1
+ * means that marking is done serially by the thread performing the GC.
  *
- * @see Col_ResumeGC
- * @see PerformGC
- * @see GC_MIN_PAGE_ALLOC
- * @see GC_MAX_PAGE_ALLOC
+ * @see Col_SetGcParam
+ * @see COL_GC_MARKERS
+ */
+#define GC_DEFAULT_MARKERS      1
+
+/**
+ * Maximum number of marker threads.
+ *
+ * @see Col_SetGcParam
+ * @see COL_GC_MARKERS
+ */
+#define GC_MAX_MARKERS          64
+
+/**
+ * Capacity of the per-marker work-stealing deques. When a deque is full,
+ * pending words go to the marker's private mark stack.
+ *
+ * @attention
+ *      Value must be a power of 2.
+ *
+ * @see Marker
+ */
+#define GC_MARK_DEQUE_SIZE      4096
+
+/**
+ * Number of cells in mark stack segments. Segments are allocated in the
+ * root pool as the mark stack grows, and freed at the end of the mark phase.
+ *
+ * @attention
+ *      Value must not exceed #AVAILABLE_CELLS.
+ *
+ * @see MarkSegment
+ */
+#define GC_MARK_SEGMENT_CELLS   64
+
+/**
+ * Number of mark stack entries ahead of the current one whose cells get
+ * prefetched.
+ *
+ * @see MarkPending
+ */
+#define GC_MARK_PREFETCH_DISTANCE 4
+
+/*---------------------------------------------------------------------------
+ * Control GC worker threads.
+ *--------------------------------------------------------------------------*/
+
+/**
+ * Maximum number of GC worker threads. Workers are shared by all groups of
+ * the process; by default their number matches the number of processors.
+ *
+ * @see Col_SetGcParam
+ * @see COL_GC_WORKERS
+ */
+#define GC_MAX_WORKERS          64
+
+/**
+ * Default priority of GC worker threads, from 0 (lowest) to 4 (highest).
+ *
+ * @see Col_SetGcParam
+ * @see COL_GC_WORKER_PRIORITY
+ */
+#define GC_DEFAULT_WORKER_PRIORITY 2
+
+/*---------------------------------------------------------------------------
+ * Control incremental GC.
+ *--------------------------------------------------------------------------*/
+
+/**
+ * Default time budget of incremental mark slices, in microseconds.
+ *
+ * @see Col_SetGcParam
+ * @see COL_GC_SLICE_BUDGET
+ */
+#define GC_DEFAULT_SLICE_BUDGET 1000
+
+/**
+ * Number of words marked between two clock checks during incremental mark
+ * slices.
+ *
+ * @see MarkSlice
+ */
+#define GC_SLICE_CHECK_INTERVAL 64
+
+/*---------------------------------------------------------------------------
+ * Control how free pages are returned to the system.
+ *--------------------------------------------------------------------------*/
+
+/**
+ * Default delay in milliseconds before free system pages are returned to the
+ * system. Free pages are decommitted after one to two delay periods, unless
+ * they get reallocated in the meantime; address ranges that remain empty
+ * for a whole period are released. A value of 0 returns pages as soon as
+ * they are freed.
+ *
+ * @see Col_SetGcParam
+ * @see COL_GC_DECOMMIT_DELAY
+ * @see SysPageDecommit
+ */
+#define GC_DEFAULT_DECOMMIT_DELAY 1000
+
+/*---------------------------------------------------------------------------
+ * Control lazy sweeping.
+ *--------------------------------------------------------------------------*/
+
+/**
+ * Maximum number of system pages swept from older generation pools each
+ * time an eden pool allocates new pages.
+ *
+ * @see SweepPendingPages
+ * @see PoolSweepPages
+ */
+#define GC_SWEEP_STEP           16
+
+/*---------------------------------------------------------------------------
+ * Control handle scopes.
+ *--------------------------------------------------------------------------*/
+
+/**
+ * Number of handle slots per block. Handles created by Col_NewHandle() are
+ * stored in thread-local blocks of this size, so that their address remains
+ * constant as long as their scope is open.
+ *
+ * @see HandleBlock
+ * @see Col_NewHandle
+ */
+#define GC_HANDLE_BLOCK_SIZE    256
+
+/*---------------------------------------------------------------------------
+ * Control parent tracking.
+ *--------------------------------------------------------------------------*/
+
+/**
+ * \def COL_USE_SOFTWARE_BARRIER
+ *      Parent tracking method. When defined (CMake option
+ *      USE_SOFTWARE_BARRIER), mutation paths call WriteBarrier() on the
+ *      words they modify, and write protection of older generation pages is
+ *      only recorded in page flags. Else, pages are write-protected by the
+ *      system and the first write is caught by a signal or exception handler.
+ *
+ * @see WriteBarrier
+ * @see SysPageProtect
  */
-#define GC_THRESHOLD(threshold) \
-    ((threshold)<GC_MIN_PAGE_ALLOC ?    GC_MIN_PAGE_ALLOC \
-    :(threshold)>GC_MAX_PAGE_ALLOC ?    GC_MAX_PAGE_ALLOC \
-    :                                   (threshold))
 
 /* End of GC-Related Configuration Settings *//*!\}*/
 
@@ -194,6 +370,39 @@
  */
 #define LARGE_PAGE_SIZE         128 /* 512 KB on 64-bit */
 
+/**
+ * Maximum number of free system pages kept in per-thread page caches. Single
+ * system pages freed by a thread are kept in its cache for later reuse
+ * instead of being returned to the shared address ranges.
+ *
+ * @see SysPageAlloc
+ * @see SysPageFree
+ * @see PAGE_CACHE_REFILL
+ */
+#define PAGE_CACHE_SIZE         32
+
+/**
+ * Number of system pages allocated at once when refilling an empty
+ * per-thread page cache.
+ *
+ * @attention
+ *      Value must not exceed #PAGE_CACHE_SIZE.
+ *
+ * @see SysPageAlloc
+ * @see PAGE_CACHE_SIZE
+ */
+#define PAGE_CACHE_REFILL       8
+
+/**
+ * Number of system pages freed by a thread before they are returned at once,
+ * so that the address range protection is taken once per batch rather than
+ * once per page.
+ *
+ * @see SysPageFree
+ * @see SysPageFlush
+ */
+#define PAGE_FREE_BATCH         16
+
 /*---------------------------------------------------------------------------
  * Page and Cell Size Constants
  *--------------------------------------------------------------------------*/
@@ -218,6 +427,29 @@
 #   define CELLS_PER_PAGE       128 /* PAGE_SIZE/CELL_SIZE */
 #endif
 
+/*---------------------------------------------------------------------------
+ * Control system page mapping.
+ *--------------------------------------------------------------------------*/
+
+/**
+ * \def COL_USE_HUGE_PAGES
+ *      Transparent huge page support. When defined (CMake option
+ *      USE_HUGE_PAGES), large address ranges are advised for transparent
+ *      huge pages on systems that support them, which lowers TLB misses on
+ *      large heaps. Else, ranges use regular system pages.
+ *
+ * @see HUGE_PAGE_MIN_RANGE
+ * @see PlatReserveRange
+ */
+
+/**
+ * Minimum size in system pages of address ranges advised for transparent
+ * huge pages.
+ *
+ * @see COL_USE_HUGE_PAGES
+ */
+#define HUGE_PAGE_MIN_RANGE     512 /* 2 MB with 4 KB pages */
+
 /* End of Page and Cell Allocation-Related Configuration Settings *//*!\}*/
 
 /* End of Memory Allocation *//*!\}*/
@@ -35,24 +35,115 @@
 #include <memory.h>
 #include <limits.h>
 #include <malloc.h>
+#include <stdio.h>
 
 /*
  * Prototypes for functions used only in this file.
  */
 
 /*! \cond IGNORE */
+struct Marker;
+struct MarkEntry;
+struct MarkSegment;
+struct MarkTableEntry;
+static size_t           CountRoots(GroupData *data);
+static Col_GcEventProc  GcTraceProc;
+static void             StopGcTrace(GroupData *data);
 static size_t           GetNbCells(Col_Word word);
+static size_t           GetNbPageCells(Col_Word word);
+#ifdef COL_USE_THREADS
+static void             PerformLocalGC(ThreadData *data);
+#endif /* COL_USE_THREADS */
+static size_t           GcThreshold(GroupData *data, size_t threshold);
+static size_t           EdenThreshold(GroupData *data);
+static void             AdaptEdenThreshold(GroupData *data, uint64_t pause,
+                            size_t survival);
+static int              IsEdenFull(GroupData *data);
+static unsigned int     SelectGenerations(GroupData *data);
+static void             CollectGenerations(GroupData *data,
+                            unsigned int maxCollectedGeneration,
+                            struct GcCycle *cycle);
 static void             ClearPoolBitmasks(MemoryPool *pool);
-static void             MarkReachableCellsFromRoots(GroupData *data);
-static void             MarkReachableCellsFromParents(GroupData *data);
+static void             MarkReachableCells(GroupData *data,
+                            struct GcCycle *cycle);
+static void             MarkReachableCellsFromRoots(struct Marker *marker);
+static void             MarkReachableCellsFromParents(struct Marker *marker);
+static void             MarkParentPage(struct Marker *marker,
+                            ParentEntry *entry);
+static void             MarkPageChildren(struct Marker *marker, Page *page,
+                            Page *cards);
+#ifdef COL_USE_THREADS
+static void             MarkReachableCellsParallel(GroupData *data,
+                            size_t nbMarkers, struct GcCycle *cycle);
+static PlatParallelProc MarkerProc;
+static int              WaitForWork(struct Marker *marker);
+static int              PushEntry(struct Marker *marker, Col_Word *wordPtr,
+                            Page *parentPage);
+static int              PopEntry(struct Marker *marker,
+                            struct MarkEntry *entry);
+static int              StealEntry(struct Marker *marker,
+                            struct MarkEntry *entry);
+#endif /* COL_USE_THREADS */
+static void             PushStack(struct Marker *marker, Col_Word *wordPtr,
+                            Page *parentPage);
+static int              PopStack(struct Marker *marker,
+                            struct MarkEntry *entry);
+static void             ReleaseMarkStack(struct Marker *marker);
+static void             FreeMarkSegments(struct MarkSegment *segments);
+static void             MarkPending(struct Marker *marker);
+static int              StartCycle(GroupData *data, unsigned int generation);
+static int              MarkSlice(GroupData *data);
+static void             MarkWordIncremental(struct Marker *marker,
+                            Col_Word word);
+static struct MarkTableEntry * FindMarkTableEntry(struct GcCycle *cycle,
+                            Page *page);
+static void             InstallMarks(GroupData *data, struct GcCycle *cycle);
+static void             FinishCycle(GroupData *data);
+static void             FreeCycle(struct GcCycle *cycle);
+static void *           GrowArray(void *array, size_t *sizePtr,
+                            size_t length, size_t elemSize);
+#ifdef PROMOTE_COMPACT
+static int              IsHeapSparse(GroupData *data);
+static void             SelectEvacuatedPages(GroupData *data, int all);
+static int              IsEvacuated(GroupData *data, Page *page);
+static void             MergeEvacuatePools(GroupData *data);
+#endif /* PROMOTE_COMPACT */
 static void             PurgeParents(GroupData *data);
-static void             MarkWord(GroupData *data, Col_Word *wordPtr,
+static int              IsUntrackedParent(GroupData *data, Page *page);
+static int              RememberCard(struct Marker *marker,
+                            Col_Word *wordPtr, Page *parentPage);
+static void             MarkChild(struct Marker *marker, Col_Word *wordPtr,
                             Page *parentPage);
+static void             MarkWord(struct Marker *marker, Col_Word *wordPtr,
+                            Page *parentPage);
+static Col_Word *       MarkChildren(struct Marker *marker, Col_Word word,
+                            Page *page, int weak);
+static void             MarkBuckets(struct Marker *marker, Col_Word map,
+                            Page *page);
+static void             RememberWeakWord(struct Marker *marker,
+                            Col_Word word);
+static void             MarkWeakWords(struct Marker *marker);
+static int              MarkEphemerons(struct Marker *marker, Col_Word map);
+static void             PruneWeakHashMap(GroupData *data, Col_Word map);
+static Col_Word *       GetWeakBuckets(Col_Word map, size_t *nbBucketsPtr,
+                            Page **pagePtr);
+static Col_Word         FollowRedirect(Col_Word *wordPtr);
+static int              IsReachable(GroupData *data, Col_Word word);
+static void             KeepQueuedWords(GroupData *data);
 static void             SweepUnreachableCells(GroupData *data,
                             MemoryPool *pool);
 static void             PromotePages(GroupData *data, MemoryPool *pool);
 static void             ResetPool(MemoryPool *pool);
 static Col_CustomWordChildEnumProc MarkWordChild;
+static Col_Word         RootSource(Col_Word word);
+static Cell *           RootSearchStart(GroupData *data, Col_Word word,
+                            Cell *finger, Col_Word fingerKey);
+static Cell *           PreserveRoot(GroupData *data, Col_Word word,
+                            Cell *finger, Col_Word fingerKey);
+static Cell *           ReleaseRoot(GroupData *data, Col_Word word,
+                            Cell *finger, Col_Word fingerKey);
+static Col_Word *       SortRootSources(size_t nbWords, const Col_Word *words,
+                            size_t *nbSourcesPtr);
 /*! \endcond *//* IGNORE */
 
 
@@ -93,6 +184,20 @@ static Col_CustomWordChildEnumProc MarkWordChild;
     if (0) \
 PRECONDITION_GCPROTECTED_FAILED:
 
+/**
+ * Value checking macro for GC parameters.
+ *
+ * May be followed by a return block.
+ *
+ * @param param     Checked parameter.
+ *
+ * @valuecheck{COL_ERROR_GCPARAM,param}
+ * @hideinitializer
+ */
+#define VALUECHECK_GCPARAM(param) \
+    VALUECHECK(((unsigned int) (param) <= COL_GC_LOCAL_COLLECT), \
+            COL_ERROR_GCPARAM, (param))
+
 /** @endcond @endprivate */
 
 /* End of GC Exceptions *//*!\}*/
@@ -117,6 +222,10 @@ GcInitThread(
     ThreadData *data)   /*!< Thread-specific data. */
 {
     PoolInit(&data->eden, 1);
+    data->published = 0;
+    data->handles = NULL;
+    data->nbHandles = 0;
+    data->freeHandles = NULL;
 }
 
 /**
@@ -136,13 +245,83 @@ GcInitGroup(
     for (generation = 2; generation < GC_MAX_GENERATIONS; generation++) {
         PoolInit(&data->pools[generation-2], generation);
     }
+    data->parents = NULL;
+    data->parentsSize = 0;
+    data->nbParents = 0;
+    data->nbMarkers = GC_DEFAULT_MARKERS;
+    data->markSegments = NULL;
+    data->incremental = 0;
+    data->sliceBudget = GC_DEFAULT_SLICE_BUDGET;
+    data->genFactor = GC_GEN_FACTOR;
+    data->minPageAlloc = GC_MIN_PAGE_ALLOC;
+    data->maxPageAlloc = GC_MAX_PAGE_ALLOC;
+    data->promoteFillRatio = PROMOTE_PAGE_FILL_RATIO;
+    data->adaptive = 0;
+    data->pauseTarget = GC_DEFAULT_PAUSE_TARGET;
+    data->edenThreshold = GC_MIN_PAGE_ALLOC;
+    data->softLimit = 0;
+    data->hardLimit = 0;
+    data->nbPages = 0;
+    data->overSoftLimit = 0;
+    data->fullGC = 0;
+    data->compactHeap = 0;
+#ifdef PROMOTE_COMPACT
+    data->evacuated = NULL;
+    data->evacuatedSize = 0;
+    data->evacuatePools = NULL;
+#endif
+    data->cycle = NULL;
+    data->sweepPending = 0;
+    data->localCollect = 0;
+    data->asyncFinalize = 0;
+    data->finalizables = WORD_NIL;
+    memset(&data->stats, 0, sizeof(data->stats));
+    data->eventProc = NULL;
+    data->eventClientData = NULL;
+}
+
+#ifdef COL_USE_THREADS
+/**
+ * Detach thread from its #COL_SHARED group before leaving it. Other threads
+ * of the group may still reach words in the thread's eden, so live eden
+ * words must be promoted out of it before the eden pool gets freed: this
+ * performs group-wide collections until the eden is empty, unless local
+ * collections are enabled and its words were not published since the last
+ * GC, in which case the eden is simply collected locally.
+ *
+ * @sideeffect
+ *      May block until the group's GC completes.
+ *
+ * @see PerformLocalGC
+ * @see GcCleanupThread
+ */
+void
+GcDetachThread(
+    ThreadData *data)   /*!< Thread-specific data. */
+{
+    GroupData *groupData = data->groupData;
+    ASSERT(groupData->model >= COL_SHARED);
+    ASSERT(!data->pauseGC);
+
+    SyncPauseGC(groupData);
+    if (groupData->localCollect && data->eden.pages && !data->published
+            && !groupData->cycle) {
+        PerformLocalGC(data);
+    }
+    while (data->eden.pages) {
+        SyncResumeGC(groupData, 1);
+        SyncPauseGC(groupData);
+    }
+    SyncResumeGC(groupData, 0);
 }
+#endif /* COL_USE_THREADS */
 
 /**
  * Per-thread GC-related cleanup.
  *
  * @sideeffect
- *      Cleanup the eden pool (which is always thread-specific).
+ *      Cleanup the eden pool (which is always thread-specific), the page
+ *      cache and handle blocks.
  *
  * @see ThreadData
  */
@@ -150,7 +329,16 @@ void
 GcCleanupThread(
     ThreadData *data)   /*!< Thread-specific data. */
 {
+    HandleBlock *block;
+
     PoolCleanup(&data->eden);
+    SysPageCacheCleanup(data);
+    while (data->handles) {
+        block = data->handles;
+        data->handles = block->prev;
+        free(block);
+    }
+    free(data->freeHandles);
 }
 
 /**
@@ -166,6 +354,15 @@ GcCleanupGroup(
     GroupData *data)    /*!< Group-specific data. */
 {
     unsigned int generation;
+    StopGcTrace(data);
+    FinalizeWords(data);
+    if (data->cycle) {
+        FreeCycle(data->cycle);
+        data->cycle = NULL;
+    }
+    free(data->parents);
+    data->parents = NULL;
+    data->parentsSize = data->nbParents = 0;
     PoolCleanup(&data->rootPool);
     for (generation = 2; generation < GC_MAX_GENERATIONS; generation++) {
         PoolCleanup(&data->pools[generation-2]);
@@ -261,294 +458,431 @@ Col_ResumeGC()
     } else {
         /*
          * Leaving protected section.
-         */
-
-        size_t threshold = data->groupData->pools[0].nbPages / GC_GEN_FACTOR;
-
-        /*
+         *
          * GC is needed when the number of pages allocated since the last GC
-         * exceed a given threshold.
+         * exceed a given threshold, to run a slice of the incremental GC
+         * cycle underway, or when a heap limit was crossed.
          */
 
-        int performGc = (data->eden.nbAlloc >= GC_THRESHOLD(threshold));
+        int performGc = (data->eden.nbAlloc >= EdenThreshold(data->groupData)
+                || data->groupData->cycle
+                || PlatAtomicLoad(&data->groupData->fullGC));
         ASSERT(data->pauseGC == 1);
+#ifdef COL_USE_THREADS
+        if (performGc && data->groupData->model >= COL_SHARED
+                && data->groupData->localCollect
+                && !data->published && !data->nbHandles
+                && !data->groupData->cycle
+                && !PlatAtomicLoad(&data->groupData->fullGC)) {
+            /*
+             * No eden word was published since the last GC, so the whole
+             * eden is unreachable past this point. Collect it locally
+             * instead of stopping all threads of the group.
+             */
+
+            PerformLocalGC(data);
+            performGc = 0;
+        }
+#endif /* COL_USE_THREADS */
         SyncResumeGC(data->groupData, performGc);
         data->pauseGC = 0;
     }
 }
 
-/* End of GC-Protected Sections *//*!\}*/
+/**
+ * Compact the heap of the calling thread's group. The next GC collects all
+ * generations in a single pass and evacuates unpinned words of older
+ * generations into fresh pages, so that the heap size gets back close to the
+ * size of live data. This pass marks serially regardless of
+ * #COL_GC_MARKERS.
+ *
+ * When called outside of a GC-protected section, the GC is performed at
+ * once, else it is performed when leaving the outermost section.
+ *
+ * @sideeffect
+ *      Triggers the garbage collection. Unpinned words may be moved.
+ *
+ * @see GC_EVACUATE_FILL_RATIO
+ * @see Col_PauseGC
+ * @see Col_ResumeGC
+ */
+void
+Col_CompactHeap()
+{
+    ThreadData *data = PlatGetThreadData();
 
+    Col_PauseGC();
+    data->groupData->compactHeap = 1;
+    PlatAtomicStore(&data->groupData->fullGC, 1);
+    Col_ResumeGC();
+}
 
-/*******************************************************************************
- * Mark & Sweep Algorithm
- ******************************************************************************/
+/* End of GC-Protected Sections *//*!\}*/
 
-/** @beginprivate @cond PRIVATE */
+
+/***************************************************************************//*!
+ * \name GC Parameters
+ ***************************************************************************\{*/
 
 /**
- * Get the number of cells taken by a word.
+ * Get the current value of a GC parameter for the calling thread's group.
  *
- * @return The number of cells.
+ * @return The parameter value, or 0 if invalid.
+ *
+ * @see Col_SetGcParam
  */
-static size_t
-GetNbCells(
-    Col_Word word)  /*!< The word. */
+size_t
+Col_GetGcParam(
+    Col_GcParam param)  /*!< Parameter identifier. */
 {
+    GroupData *data = PlatGetThreadData()->groupData;
+
     /*
-     * Get number of cells taken by word.
-     * @note word is not immediate.
+     * Check preconditions.
      */
 
-    switch (WORD_TYPE(word)) {
-    case WORD_TYPE_UCSSTR:
-        return UCSSTR_SIZE(WORD_UCSSTR_LENGTH(word)
-                * CHAR_WIDTH(WORD_UCSSTR_FORMAT(word)));
+    /*! @valuecheck{COL_ERROR_GCPARAM,param} */
+    VALUECHECK_GCPARAM(param) return 0;
 
-    case WORD_TYPE_UTFSTR:
-        return UTFSTR_SIZE(WORD_UTFSTR_BYTELENGTH(word));
+    switch (param) {
+    case COL_GC_MARKERS:
+        return data->nbMarkers;
 
-    case WORD_TYPE_VECTOR:
-        return VECTOR_SIZE(WORD_VECTOR_LENGTH(word));
+    case COL_GC_INCREMENTAL:
+        return data->incremental;
 
-    case WORD_TYPE_MVECTOR:
-        return WORD_MVECTOR_SIZE(word);
+    case COL_GC_SLICE_BUDGET:
+        return data->sliceBudget;
 
-    case WORD_TYPE_CUSTOM: {
-        Col_CustomWordType *typeInfo = WORD_TYPEINFO(word);
-        size_t headerSize;
-        switch (typeInfo->type) {
-        case COL_HASHMAP: headerSize = CUSTOMHASHMAP_HEADER_SIZE;
-        case COL_TRIEMAP: headerSize = CUSTOMTRIEMAP_HEADER_SIZE;
-        default:          headerSize = CUSTOM_HEADER_SIZE;
-        }
-        return WORD_CUSTOM_SIZE(typeInfo, headerSize,
-                typeInfo->sizeProc(word));
-        }
+    case COL_GC_DECOMMIT_DELAY:
+        return PlatAtomicLoad(&decommitDelay);
 
-    case WORD_TYPE_STRHASHMAP:
-    case WORD_TYPE_INTHASHMAP:
-        return HASHMAP_NBCELLS;
+    case COL_GC_GEN_FACTOR:
+        return data->genFactor;
 
-    case WORD_TYPE_STRBUF:
-        return WORD_STRBUF_SIZE(word);
+    case COL_GC_MIN_PAGE_ALLOC:
+        return data->minPageAlloc;
 
-    /* WORD_TYPE_UNKNOWN */
+    case COL_GC_MAX_PAGE_ALLOC:
+        return data->maxPageAlloc;
 
-    default:
-        return 1;
+    case COL_GC_PROMOTE_FILL_RATIO:
+        return data->promoteFillRatio;
+
+    case COL_GC_ADAPTIVE:
+        return data->adaptive;
+
+    case COL_GC_PAUSE_TARGET:
+        return data->pauseTarget;
+
+    case COL_GC_SOFT_LIMIT:
+        return data->softLimit;
+
+    case COL_GC_HARD_LIMIT:
+        return data->hardLimit;
+
+    case COL_GC_WORKERS:
+    case COL_GC_WORKER_AFFINITY:
+    case COL_GC_WORKER_PRIORITY:
+#ifdef COL_USE_THREADS
+        return PlatGetWorkerParam(param);
+#else
+        return 0;
+#endif /* COL_USE_THREADS */
+
+    case COL_GC_ASYNC_FINALIZE:
+        return data->asyncFinalize;
+
+    case COL_GC_LOCAL_COLLECT:
+        return data->localCollect;
     }
+
+    return 0;
 }
 
 /**
- * Perform a garbage collection.
+ * Set the value of a GC parameter for the calling thread's group. The new
+ * value is used from the next GC on. #COL_GC_DECOMMIT_DELAY and GC worker
+ * parameters are shared by all groups.
  *
- * @sideeffect
- *      May free cells or pages, promote words across pools, or allocate new
- *      pages during promotion.
+ * Out-of-range values are clamped:
  *
- * @see ClearPoolBitmasks
- * @see MarkReachableCellsFromRoots
- * @see MarkReachableCellsFromParents
- * @see SweepUnreachableCells
- * @see PromotePages
- * @see ResetPool
+ * - #COL_GC_MARKERS: 1 to #GC_MAX_MARKERS; always 1 without thread support.
+ * - #COL_GC_INCREMENTAL: 0 or 1.
+ * - #COL_GC_SLICE_BUDGET: at least 1.
+ * - #COL_GC_GEN_FACTOR: at least 2.
+ * - #COL_GC_MIN_PAGE_ALLOC, #COL_GC_MAX_PAGE_ALLOC: at least 1. Setting one
+ *   past the other moves both.
+ * - #COL_GC_PROMOTE_FILL_RATIO: 0 to 100.
+ * - #COL_GC_ADAPTIVE: 0 or 1.
+ * - #COL_GC_PAUSE_TARGET: at least 1.
+ * - #COL_GC_SOFT_LIMIT, #COL_GC_HARD_LIMIT: any value, 0 disables the limit.
+ * - #COL_GC_WORKERS: 1 to #GC_MAX_WORKERS.
+ * - #COL_GC_WORKER_AFFINITY: any value, 0 means all processors.
+ * - #COL_GC_WORKER_PRIORITY: 0 to 4.
+ * - #COL_GC_ASYNC_FINALIZE: 0 or 1.
+ *
+ * Worker parameters are ignored without thread support. Extra workers exit
+ * once idle when their maximum number is lowered; affinity and priority are
+ * only hints, applied by workers on their next wakeup.
+ *
+ * Disabling incremental mode lets the current incremental cycle, if any,
+ * run to completion. Enabling adaptive mode starts from the current eden
+ * threshold. Heap limits apply from the next page allocation on. Words
+ * already queued for finalization are finalized asynchronously regardless
+ * of #COL_GC_ASYNC_FINALIZE.
+ *
+ * @see Col_GetGcParam
  */
 void
-PerformGC(
-    GroupData *data)    /*!< Group-specific data. */
+Col_SetGcParam(
+    Col_GcParam param,  /*!< Parameter identifier. */
+    size_t value)       /*!< New value. */
 {
-    unsigned int generation;
-    ThreadData *threadData;
+    GroupData *data = PlatGetThreadData()->groupData;
 
     /*
-     * Traverse pools to check whether they must be collected. Eden pool is
-     * always collected. Root pool uses explicit lifetime management.
+     * Check preconditions.
      */
 
-    threadData = data->first;
-    do {
-        ClearPoolBitmasks(&threadData->eden);
-        threadData = threadData->next;
-    } while (threadData != data->first);
-    data->maxCollectedGeneration = 1;
-
-    for (generation = 2; generation < GC_MAX_GENERATIONS; generation++) {
-        MemoryPool *pool = &data->pools[generation-2];
-
-        if (generation+1 < GC_MAX_GENERATIONS) {
-            /*
-             * Intermediary generations.
-             */
-
-            size_t  threshold = data->pools[generation-1].nbPages
-                    / GC_GEN_FACTOR;
-            if (pool->nbAlloc < GC_THRESHOLD(threshold)) {
-                /*
-                 * Stop if number of allocations is less than the threshold.
-                 */
-
-                break;
-            }
-            if (++pool->gc < GC_GEN_FACTOR) {
-                /*
-                 * Collection frequency is logarithmic.
-                 */
-
-                break;
-            }
-        } else {
-            /*
-             * Ultimate generation.
-             */
-
-            if (pool->nbAlloc < GC_MAX_PAGE_ALLOC) {
-                break;
-            }
+    /*! @valuecheck{COL_ERROR_GCPARAM,param} */
+    VALUECHECK_GCPARAM(param) return;
+
+    switch (param) {
+    case COL_GC_MARKERS:
+#ifdef COL_USE_THREADS
+        if (value < 1) value = 1;
+        if (value > GC_MAX_MARKERS) value = GC_MAX_MARKERS;
+#else
+        value = 1;
+#endif /* COL_USE_THREADS */
+        data->nbMarkers = value;
+        break;
+
+    case COL_GC_INCREMENTAL:
+        data->incremental = (value ? 1 : 0);
+        break;
+
+    case COL_GC_SLICE_BUDGET:
+        if (value < 1) value = 1;
+        data->sliceBudget = value;
+        break;
+
+    case COL_GC_DECOMMIT_DELAY:
+        PlatAtomicStore(&decommitDelay, value);
+        break;
+
+    case COL_GC_GEN_FACTOR:
+        if (value < 2) value = 2;
+        data->genFactor = value;
+        break;
+
+    case COL_GC_MIN_PAGE_ALLOC:
+        if (value < 1) value = 1;
+        data->minPageAlloc = value;
+        if (data->maxPageAlloc < value) data->maxPageAlloc = value;
+        break;
+
+    case COL_GC_MAX_PAGE_ALLOC:
+        if (value < 1) value = 1;
+        data->maxPageAlloc = value;
+        if (data->minPageAlloc > value) data->minPageAlloc = value;
+        break;
+
+    case COL_GC_PROMOTE_FILL_RATIO:
+        if (value > 100) value = 100;
+        data->promoteFillRatio = value;
+        break;
+
+    case COL_GC_ADAPTIVE:
+        if (value && !data->adaptive) {
+            data->edenThreshold = EdenThreshold(data);
         }
-
-        data->maxCollectedGeneration = generation;
-
-        /*
-         * Clear bitmasks on pool. Reachable words will be marked again in the
-         * next step.
-         */
-
-        ClearPoolBitmasks(pool);
-    }
-
-#ifdef PROMOTE_COMPACT
-    if (data->maxCollectedGeneration+1 < GC_MAX_GENERATIONS
-            && data->pools[data->maxCollectedGeneration-1].nbPages > 0
-            && data->pools[data->maxCollectedGeneration-1].nbSetCells
-                    < (data->pools[data->maxCollectedGeneration-1].nbPages
-                            * CELLS_PER_PAGE)
-                    * PROMOTE_PAGE_FILL_RATIO) {
-        data->compactGeneration = data->maxCollectedGeneration;
-    } else {
-        data->compactGeneration = UINT_MAX;
+        data->adaptive = (value ? 1 : 0);
+        break;
+
+    case COL_GC_PAUSE_TARGET:
+        if (value < 1) value = 1;
+        data->pauseTarget = value;
+        break;
+
+    case COL_GC_SOFT_LIMIT:
+        EnterProtectRoots(data);
+        data->softLimit = value;
+        data->overSoftLimit = 0;
+        LeaveProtectRoots(data);
+        break;
+
+    case COL_GC_HARD_LIMIT:
+        data->hardLimit = value;
+        break;
+
+    case COL_GC_WORKERS:
+        if (value < 1) value = 1;
+        if (value > GC_MAX_WORKERS) value = GC_MAX_WORKERS;
+#ifdef COL_USE_THREADS
+        PlatSetWorkerParam(param, value);
+#endif /* COL_USE_THREADS */
+        break;
+
+    case COL_GC_WORKER_AFFINITY:
+#ifdef COL_USE_THREADS
+        PlatSetWorkerParam(param, value);
+#endif /* COL_USE_THREADS */
+        break;
+
+    case COL_GC_WORKER_PRIORITY:
+        if (value > 4) value = 4;
+#ifdef COL_USE_THREADS
+        PlatSetWorkerParam(param, value);
+#endif /* COL_USE_THREADS */
+        break;
+
+    case COL_GC_ASYNC_FINALIZE:
+        data->asyncFinalize = (value ? 1 : 0);
+        break;
+
+    case COL_GC_LOCAL_COLLECT:
+        data->localCollect = (value ? 1 : 0);
+        break;
     }
-#endif
+}
 
-    /*
-     * Refresh parent list by adding pages written since the last GC.
-     */
+/* End of GC Parameters *//*!\}*/
 
-    UpdateParents(data);
 
-    /*
-     * Mark all cells that are reachable from roots of collected pools, and from
-     * parent pages of uncollected pools. This also marks still valid roots and
-     * parents in the process.
-     */
+/***************************************************************************//*!
+ * \name GC Statistics
+ ***************************************************************************\{*/
 
-    MarkReachableCellsFromRoots(data);
-    MarkReachableCellsFromParents(data);
+/**
+ * Get memory statistics of a generation for the calling thread's group.
+ * Generation 0 holds roots and parent descriptors, generation 1 is the sum
+ * of the group threads' eden pools, and older generations follow. Pending
+ * lazy sweeping is completed first so that figures are accurate.
+ *
+ * @retval <>0  if generation exists.
+ * @retval 0    otherwise, **stats** is left untouched. Iterating over
+ *              generations until this value is returned covers the whole
+ *              heap.
+ *
+ * @pre
+ *      Must be called within a GC-protected section.
+ *
+ * @see Col_GetGcStats
+ */
+int
+Col_GetHeapStats(
+    unsigned int generation,    /*!< Generation number. */
+    Col_HeapStats *stats)       /*!< [out] Statistics. */
+{
+    ThreadData *data = PlatGetThreadData(), *threadData;
+    GroupData *groupData;
+    MemoryPool *pool;
+    size_t nbPages;
 
     /*
-     * Purge stale parents.
+     * Check preconditions.
      */
 
-    PurgeParents(data);
-
-    /*
-     * Perform cleanup on all custom words that need sweeping.
-     */
+    /*! @error{COL_ERROR_GCPROTECT} */
+    PRECONDITION_GCPROTECTED(data) return 0;
 
-    for (generation = data->maxCollectedGeneration; generation >= 2;
-            generation--) {
-        SweepUnreachableCells(data, &data->pools[generation-2]);
+    if (generation >= GC_MAX_GENERATIONS) {
+        return 0;
     }
-    threadData = data->first;
-    do {
-        SweepUnreachableCells(data, &threadData->eden);
-        threadData = threadData->next;
-    } while (threadData != data->first);
 
-    /*
-     * Free empty pages from collected pools before promoting them.
-     */
-
-    PoolFreeEmptyPages(&data->rootPool);
-    threadData = data->first;
-    do {
-        PoolFreeEmptyPages(&threadData->eden);
-        threadData = threadData->next;
-    } while (threadData != data->first);
-    for (generation = 2; generation <= data->maxCollectedGeneration;
-            generation++) {
-        PoolFreeEmptyPages(&data->pools[generation-2]);
-    }
+    groupData = data->groupData;
+    SweepPendingPages(groupData, 0);
 
     /*
-     * At this point all reachable cells are set, and unreachable cells are
-     * cleared. Now promote whole pages the next generation. Older pools are
-     * promoted first so that newer ones are correctly merged when promoted.
+     * Only read pool counters, never pages. Lazy sweeping updates counters
+     * of older generations with the root lock held, and eden counters are
+     * updated atomically by their owner thread (see POOL_ADD_COUNTER()).
      */
 
-    for (generation = data->maxCollectedGeneration; generation >= 2;
-            generation--) {
-        PromotePages(data, &data->pools[generation-2]);
+    EnterProtectRoots(groupData);
+    if (generation != 1) {
+        pool = (generation == 0 ? &groupData->rootPool
+                : &groupData->pools[generation-2]);
+        stats->pages = pool->nbPages;
+        stats->cells = pool->nbSetCells - RESERVED_CELLS*pool->nbPages;
+        stats->allocated = pool->nbAlloc;
+        stats->totalAllocated = pool->totalAlloc;
+        stats->collections = pool->nbCollections;
+        LeaveProtectRoots(groupData);
+        return 1;
     }
-    threadData = data->first;
-    do {
-        PromotePages(data, &threadData->eden);
-        threadData = threadData->next;
-    } while (threadData != data->first);
 
-    /*
-     * Finally, reset pools (GC counters, etc.).
-     */
-
-    ResetPool(&data->rootPool);
-    threadData = data->first;
+    memset(stats, 0, sizeof(*stats));
+    threadData = groupData->first;
     do {
-        ResetPool(&threadData->eden);
+        pool = &threadData->eden;
+        nbPages = PlatAtomicLoad(&pool->nbPages);
+        stats->pages += nbPages;
+        stats->cells += PlatAtomicLoad(&pool->nbSetCells)
+                - RESERVED_CELLS*nbPages;
+        stats->allocated += PlatAtomicLoad(&pool->nbAlloc);
+        stats->totalAllocated += PlatAtomicLoad(&pool->totalAlloc);
+        if (pool->nbCollections > stats->collections) {
+            stats->collections = pool->nbCollections;
+        }
         threadData = threadData->next;
-    } while (threadData != data->first);
-    for (generation = 2; generation <= data->maxCollectedGeneration;
-            generation++) {
-        ResetPool(&data->pools[generation-2]);
-    }
+    } while (threadData != groupData->first);
+    LeaveProtectRoots(groupData);
+    return 1;
 }
 
 /**
- * Unprotect and clear all bitmasks in the pool's pages.
+ * Get GC statistics for the calling thread's group.
+ *
+ * @pre
+ *      Must be called within a GC-protected section.
+ *
+ * @see Col_GetHeapStats
  */
-static void
-ClearPoolBitmasks(
-    MemoryPool *pool)   /*!< The pool to traverse. */
+void
+Col_GetGcStats(
+    Col_GcStats *stats) /*!< [out] Statistics. */
 {
-    void * page;
+    ThreadData *data = PlatGetThreadData();
+    GroupData *groupData;
 
-    for (page = pool->pages; page; page = PAGE_NEXT(page)) {
-        ASSERT(PAGE_GENERATION(page) == pool->generation);
-        if (pool->generation > 1 && PAGE_FLAG(page, PAGE_FLAG_FIRST)) {
-            SysPageProtect(page, 0);
-        }
-        ClearAllCells(page);
+    /*
+     * Check preconditions.
+     */
+
+    /*! @error{COL_ERROR_GCPROTECT} */
+    PRECONDITION_GCPROTECTED(data) return;
+
+    groupData = data->groupData;
+    EnterProtectRoots(groupData);
+    {
+        *stats = groupData->stats;
+        stats->roots = CountRoots(groupData);
+        stats->parents = groupData->nbParents;
     }
+    LeaveProtectRoots(groupData);
 }
 
+/** @beginprivate @cond PRIVATE */
+
 /**
- * Mark all cells reachable from the valid roots.
+ * Count roots in the group's root trie.
  *
- * Traversal will stop at cells from uncollected pools. Cells from these
- * pools having children in collected pools will be traversed in the
- * next phase (MarkReachableCellsFromParents()).
+ * @return The number of roots.
  *
- * @see MarkWord
+ * @see Col_GetGcStats
  */
-static void
-MarkReachableCellsFromRoots(
+static size_t
+CountRoots(
     GroupData *data)    /*!< Group-specific data. */
 {
     Cell *node, *leaf, *parent;
-    Col_Word source;
+    size_t count = 0;
 
     node = data->roots;
     while (node) {
-        ASSERT(TestCell(CELL_PAGE(node), CELL_INDEX(node)));
         if (!ROOT_IS_LEAF(node)) {
             /*
              * Descend into left subtrie.
@@ -559,24 +893,15 @@ MarkReachableCellsFromRoots(
         }
 
         leaf = ROOT_GET_NODE(node);
-        source = ROOT_LEAF_SOURCE(leaf);
-        if (ROOT_LEAF_GENERATION(leaf) <= data->maxCollectedGeneration) {
-            /*
-             * Follow root from collected generation.
-             */
-
-            MarkWord(data, &source, CELL_PAGE(source));
-            if (ROOT_LEAF_GENERATION(leaf)+1 < GC_MAX_GENERATIONS) {
-                ROOT_LEAF_GENERATION(leaf)++;
-            }
-        }
+        count++;
 
         /*
          * Find next branch.
          */
 
         parent = ROOT_PARENT(leaf);
-        while (parent && ((uintptr_t) source & ROOT_NODE_MASK(parent))) {
+        while (parent && ((uintptr_t) ROOT_LEAF_SOURCE(leaf)
+                & ROOT_NODE_MASK(parent))) {
             parent = ROOT_PARENT(parent);
         }
         if (!parent) {
@@ -588,168 +913,2760 @@ MarkReachableCellsFromRoots(
         }
         node = ROOT_NODE_RIGHT(parent);
     }
+    return count;
 }
 
+/** @endcond @endprivate */
+
+/* End of GC Statistics *//*!\}*/
+
+
+/***************************************************************************//*!
+ * \name GC Events
+ ***************************************************************************\{*/
+
+/** @beginprivate @cond PRIVATE */
+
 /**
- * Mark all cells reachable from cells in pages with potentially younger
- * children.
+ * Notify GC event to the group's event handler, if any. Costs a single test
+ * when no handler is set.
  *
- * @see MarkWord
+ * @param data          #GroupData
+ * @param event         #Col_GcEvent
+ * @param begin         Whether event begins or ends.
+ * @param time          Event timestamp.
+ * @param generation    Oldest generation collected.
+ *
+ * @see Col_SetGcEventProc
+ */
+#define GC_EVENT(data, event, begin, time, generation) \
+    if ((data)->eventProc) { \
+        (data)->eventProc((event), (begin), (time), (generation), \
+                (data)->eventClientData); \
+    }
+
+/**
+ * State of the built-in trace recorder.
+ *
+ * @see Col_StartGcTrace
+ * @see GcTraceProc
+ */
+typedef struct GcTrace {
+    FILE *file;     /*!< Trace file. */
+    int first;      /*!< Whether no event was written yet. */
+} GcTrace;
+
+/** @endcond @endprivate */
+
+/**
+ * Get the GC event handler of the calling thread's group.
+ *
+ * @return The current event proc (may be NULL).
+ *
+ * @see Col_SetGcEventProc
+ */
+Col_GcEventProc *
+Col_GetGcEventProc(
+    Col_ClientData *clientDataPtr)  /*!< [out] Opaque value passed to the
+                                         event proc, if non-NULL. */
+{
+    GroupData *data = PlatGetThreadData()->groupData;
+    if (clientDataPtr) *clientDataPtr = data->eventClientData;
+    return data->eventProc;
+}
+
+/**
+ * Set or reset the GC event handler of the calling thread's group. This
+ * replaces the trace recorder, if active.
+ *
+ * @return The old event proc (may be NULL).
+ *
+ * @pre
+ *      Must be called within a GC-protected section.
+ *
+ * @see Col_GetGcEventProc
+ */
+Col_GcEventProc *
+Col_SetGcEventProc(
+    Col_GcEventProc *proc,          /*!< The new event proc (may be NULL). */
+    Col_ClientData clientData)      /*!< Opaque value passed to **proc**. */
+{
+    ThreadData *data = PlatGetThreadData();
+    Col_GcEventProc *oldProc;
+
+    /*
+     * Check preconditions.
+     */
+
+    /*! @error{COL_ERROR_GCPROTECT} */
+    PRECONDITION_GCPROTECTED(data) return NULL;
+
+    StopGcTrace(data->groupData);
+    oldProc = data->groupData->eventProc;
+    data->groupData->eventProc = proc;
+    data->groupData->eventClientData = clientData;
+    return oldProc;
+}
+
+/**
+ * Record GC events of the calling thread's group to a file in the Chrome
+ * trace event format, which can be viewed with e.g. Perfetto or
+ * chrome://tracing. Recording uses the group's event handler until
+ * Col_StopGcTrace() is called or the group is cleaned up.
+ *
+ * @retval <>0  for success.
+ * @retval 0    if the file cannot be created or memory is exhausted.
+ *
+ * @pre
+ *      Must be called within a GC-protected section.
+ *
+ * @see Col_StopGcTrace
+ * @see Col_SetGcEventProc
+ */
+int
+Col_StartGcTrace(
+    const char *path)   /*!< Path of trace file to create. */
+{
+    ThreadData *data = PlatGetThreadData();
+    GcTrace *trace;
+    FILE *file;
+
+    /*
+     * Check preconditions.
+     */
+
+    /*! @error{COL_ERROR_GCPROTECT} */
+    PRECONDITION_GCPROTECTED(data) return 0;
+
+    trace = (GcTrace *) malloc(sizeof(*trace));
+    if (!trace) {
+        return 0;
+    }
+    file = fopen(path, "w");
+    if (!file) {
+        free(trace);
+        return 0;
+    }
+    fputs("{\"traceEvents\":[", file);
+
+    trace->file = file;
+    trace->first = 1;
+    StopGcTrace(data->groupData);
+    data->groupData->eventProc = GcTraceProc;
+    data->groupData->eventClientData = trace;
+    return 1;
+}
+
+/**
+ * Stop recording GC events and close the trace file. Does nothing if no
+ * recording is active.
+ *
+ * @pre
+ *      Must be called within a GC-protected section.
+ *
+ * @see Col_StartGcTrace
+ */
+void
+Col_StopGcTrace()
+{
+    ThreadData *data = PlatGetThreadData();
+
+    /*
+     * Check preconditions.
+     */
+
+    /*! @error{COL_ERROR_GCPROTECT} */
+    PRECONDITION_GCPROTECTED(data) return;
+
+    StopGcTrace(data->groupData);
+}
+
+/** @beginprivate @cond PRIVATE */
+
+/**
+ * GC event handler of the built-in trace recorder. Writes events as
+ * duration events of the Chrome trace event format.
+ *
+ * @see Col_StartGcTrace
  */
 static void
-MarkReachableCellsFromParents(
-    GroupData *data)    /*!< Group-specific data. */
+GcTraceProc(
+    Col_GcEvent event,          /*!< Event identifier. */
+    int begin,                  /*!< Whether event begins or ends. */
+    uint64_t time,              /*!< Event timestamp. */
+    unsigned int generation,    /*!< Oldest generation collected. */
+    Col_ClientData clientData)  /*!< #GcTrace. */
 {
-    Col_Word word;
-    Page *page;
-    Cell *cell;
-    size_t index, nbCells;
+    static const char * const names[] = {
+        "collect", "mark", "sweep", "free", "promote", "slice"
+    };
+    GcTrace *trace = (GcTrace *) clientData;
 
     /*
-     * Follow cells in parent pages from uncollected generations.
+     * Events are reported by the thread performing the GC, which may be a
+     * group thread or a GC worker.
      */
 
-    for (cell = data->parents; cell; cell = PARENT_NEXT(cell)) {
-        ASSERT(TestCell(CELL_PAGE(cell), CELL_INDEX(cell)));
+    fprintf(trace->file, "%s\n{\"name\":\"%s\",\"cat\":\"gc\","
+            "\"ph\":\"%c\",\"ts\":%llu,\"pid\":%lu,\"tid\":%lu,"
+            "\"args\":{\"generation\":%u}}", (trace->first ? "" : ","),
+            names[event], (begin ? 'B' : 'E'), (unsigned long long) time,
+            (unsigned long) PlatGetProcessId(),
+            (unsigned long) PlatGetThreadId(), generation);
+    trace->first = 0;
+}
 
-        page = PARENT_PAGE(cell);
-        if (PAGE_GENERATION(page) <= data->maxCollectedGeneration) {
-            continue;
-        }
+/**
+ * Stop the group's trace recorder, if active.
+ *
+ * @see Col_StopGcTrace
+ */
+static void
+StopGcTrace(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    GcTrace *trace;
 
-        /*
-         * Iterate over logical pages in page group.
-         */
+    if (data->eventProc != GcTraceProc) {
+        return;
+    }
 
-        ASSERT(PAGE_FLAG(page, PAGE_FLAG_FIRST));
-        for (; page; page = PAGE_NEXT(page)) {
-            /*
-             * Iterate over cells in page.
-             */
+    trace = (GcTrace *) data->eventClientData;
+    fputs("\n]}\n", trace->file);
+    fclose(trace->file);
+    free(trace);
+    data->eventProc = NULL;
+    data->eventClientData = NULL;
+}
 
-            for (index = RESERVED_CELLS; index < CELLS_PER_PAGE;
-                    index += nbCells) {
-                if (!TestCell(page, index)) {
-                    nbCells = 1;
-                    continue;
-                }
+/** @endcond @endprivate */
 
-                word = (Col_Word) PAGE_CELL(page, index);
-                nbCells = GetNbCells(word);
+/* End of GC Events *//*!\}*/
 
-                /*
-                 * Follow word. Clearing the first cell is sufficient, as it
-                 * will be set again during the mark phase.
-                 */
 
-                ClearCells(page, index, 1);
-                MarkWord(data, &word, page);
-            }
+/*******************************************************************************
+ * Mark & Sweep Algorithm
+ ******************************************************************************/
 
-            if (PAGE_FLAG(page, PAGE_FLAG_LAST)) break;
+/** @beginprivate @cond PRIVATE */
+
+/**
+ * Get the number of cells taken by a word.
+ *
+ * @return The number of cells.
+ */
+static size_t
+GetNbCells(
+    Col_Word word)  /*!< The word. */
+{
+    /*
+     * Get number of cells taken by word.
+     * @note word is not immediate.
+     */
+
+    switch (WORD_TYPE(word)) {
+    case WORD_TYPE_UCSSTR:
+        return UCSSTR_SIZE(WORD_UCSSTR_LENGTH(word)
+                * CHAR_WIDTH(WORD_UCSSTR_FORMAT(word)));
+
+    case WORD_TYPE_UTFSTR:
+        return UTFSTR_SIZE(WORD_UTFSTR_BYTELENGTH(word));
+
+    case WORD_TYPE_VECTOR:
+        return VECTOR_SIZE(WORD_VECTOR_LENGTH(word));
+
+    case WORD_TYPE_MVECTOR:
+        return WORD_MVECTOR_SIZE(word);
+
+    case WORD_TYPE_CUSTOM: {
+        Col_CustomWordType *typeInfo = WORD_TYPEINFO(word);
+        size_t headerSize;
+        headerSize = CustomHeaderSize(typeInfo);
+        return WORD_CUSTOM_SIZE(typeInfo, headerSize,
+                typeInfo->sizeProc(word));
         }
+
+    case WORD_TYPE_STRHASHMAP:
+    case WORD_TYPE_INTHASHMAP:
+        return HASHMAP_NBCELLS;
+
+    case WORD_TYPE_STRBUF:
+        return WORD_STRBUF_SIZE(word);
+
+    /* WORD_TYPE_UNKNOWN */
+
+    default:
+        return 1;
     }
 }
 
 /**
- * Purge all parent nodes whose page is not marked as parent.
+ * Get the number of cells taken by a word in its first page, i.e.\ the
+ * number of cells to set or clear in this page's bitmask.
+ *
+ * @return The number of cells.
  */
-static void
-PurgeParents(
+static size_t
+GetNbPageCells(
+    Col_Word word)  /*!< The word. */
+{
+    size_t index = CELL_INDEX(word), nbCells = GetNbCells(word);
+    return (index+nbCells > CELLS_PER_PAGE ? CELLS_PER_PAGE-index : nbCells);
+}
+
+/**
+ * Perform a garbage collection.
+ *
+ * When incremental mode is enabled (see #COL_GC_INCREMENTAL), collections of
+ * older generations are not performed at once: a minor collection is done
+ * instead, and an incremental cycle is started for the selected generations.
+ * Subsequent calls then run mark slices until the cycle completes, unless
+ * eden needs collecting. This holds for all threading models: slices are run
+ * by whichever thread performs the GC, whenever a GC-protected section is
+ * left during the cycle. If the cycle cannot be started for lack of memory,
+ * the selected generations are collected at once.
+ *
+ * Once the soft heap limit is crossed (see #COL_GC_SOFT_LIMIT), or upon
+ * Col_CompactHeap(), the next collection outside of incremental cycles is a
+ * full one with compaction.
+ *
+ * @sideeffect
+ *      May free cells or pages, promote words across pools, or allocate new
+ *      pages during promotion.
+ *
+ * @see SelectGenerations
+ * @see CollectGenerations
+ * @see StartCycle
+ * @see MarkSlice
+ * @see FinishCycle
+ * @see SweepPendingPages
+ * @see CheckHeapLimits
+ */
+void
+PerformGC(
     GroupData *data)    /*!< Group-specific data. */
 {
-    Page *page;
-    Cell *cell, *next, *stale;
-    int parent;
+    unsigned int generation;
+    uint64_t start = PlatGetMicroseconds(), pause;
+    ThreadData *threadData;
 
-    for (cell = data->parents, data->parents = NULL, stale = NULL; cell;
-            cell = next) {
-        ASSERT(TestCell(CELL_PAGE(cell), CELL_INDEX(cell)));
+    ASSERT(!data->finalizables);
 
-        next = PARENT_NEXT(cell);
-        parent = 0;
-        ASSERT(PAGE_FLAG(PARENT_PAGE(cell), PAGE_FLAG_FIRST));
-        for (page = PARENT_PAGE(cell); page; page = PAGE_NEXT(page)) {
-            parent |= PAGE_FLAG(page, PAGE_FLAG_PARENT);
-            if (PAGE_FLAG(page, PAGE_FLAG_LAST)) break;
-        }
-        if (parent) {
-            /*
-             * Keep parent.
-             */
+    /*
+     * Return free pages to the system if due. Pages left unused in the page
+     * caches of member threads since then are returned to their ranges, so
+     * that they get decommitted next time.
+     */
 
-            PARENT_NEXT(cell) = data->parents;
-            data->parents = cell;
-        } else {
+    if (SysPageDecommit()) {
+        threadData = data->first;
+        do {
+            SysPageCacheTrim(threadData);
+            threadData = threadData->next;
+        } while (threadData != data->first);
+    }
+
+    /*
+     * Complete lazy sweeping left over from the last GC, so that pool
+     * statistics are up to date.
+     */
+
+    SweepPendingPages(data, 0);
+    data->stats.sweepTime += PlatGetMicroseconds() - start;
+
+    if (data->cycle) {
+        /*
+         * Incremental cycle underway.
+         */
+
+        if (!IsEdenFull(data)) {
             /*
-             * Forget parent.
+             * Run mark slice, and finish cycle once marking is complete.
              */
 
-            PARENT_NEXT(cell) = stale;
-            stale = cell;
+            if (MarkSlice(data)) {
+                FinishCycle(data);
+            }
+            goto end;
         }
-    }
 
-    /*
-     * Now drop stale parents.
-     */
+        /*
+         * Only collect eden until the cycle completes.
+         */
 
-    for (cell = stale; cell; cell = PARENT_NEXT(cell)) {
-        ASSERT(TestCell(CELL_PAGE(cell), CELL_INDEX(cell)));
-        ClearCells(CELL_PAGE(cell), CELL_INDEX(cell), 1);
+        CollectGenerations(data, 1, NULL);
+        goto end;
+    }
 
+    if (data->fullGC) {
         /*
-         * Protect pages from uncollected generations. Those from collected
-         * generations will be protected when promoted.
+         * Heap limit crossed or compaction requested. Collect the whole heap
+         * in a single pass, evacuating sparse pages, or all pages upon
+         * compaction.
          */
 
-        page = PARENT_PAGE(cell);
-        ASSERT(PAGE_FLAG(page, PAGE_FLAG_FIRST));
-        if (PAGE_GENERATION(page) > data->maxCollectedGeneration) {
-            SysPageProtect(page, 1);
-        }
+        CollectGenerations(data, GC_MAX_GENERATIONS-1, NULL);
+        data->fullGC = 0;
+        goto end;
+    }
+
+    generation = SelectGenerations(data);
+    if (generation > 1 && data->incremental) {
+        /*
+         * Collect eden now and older generations incrementally.
+         */
+
+        CollectGenerations(data, 1, NULL);
+        if (StartCycle(data, generation)) goto end;
+
+        /*
+         * Cycle could not be started, collect older generations at once.
+         */
+    }
+
+    CollectGenerations(data, generation, NULL);
+
+end:
+    pause = PlatGetMicroseconds() - start;
+    data->stats.lastPause = pause;
+    if (pause > data->stats.maxPause) data->stats.maxPause = pause;
+    data->stats.totalPause += pause;
+}
+
+/**
+ * Sweep pages of older generation pools left pending by the last GC. Empty
+ * system pages are freed, and pool statistics are updated accordingly.
+ *
+ * Pages are swept lazily as eden pools grow, and remaining ones at the start
+ * of the next GC. This keeps the cost of sweeping older generations out of
+ * GC pauses.
+ *
+ * @see PoolSweepPages
+ * @see PromotePages
+ * @see GC_SWEEP_STEP
+ */
+void
+SweepPendingPages(
+    GroupData *data,    /*!< Group-specific data. */
+    size_t max)         /*!< Maximum number of system pages to sweep per pool,
+                             0 for no limit. */
+{
+    unsigned int generation;
+
+    if (!data->sweepPending) return;
+
+    /*
+     * Eden pools of shared groups grow concurrently.
+     */
+
+    EnterProtectRoots(data);
+    for (generation = 2; generation < GC_MAX_GENERATIONS; generation++) {
+        if (!PoolSweepPages(&data->pools[generation-2], max)) break;
+    }
+    data->sweepPending = (generation < GC_MAX_GENERATIONS);
+    LeaveProtectRoots(data);
+}
+
+#ifdef COL_USE_THREADS
+/**
+ * Perform a thread-local collection of the calling thread's eden in
+ * #COL_SHARED groups where #COL_GC_LOCAL_COLLECT is enabled. This is only
+ * valid once the thread leaves its outermost GC-protected section and when
+ * none of its eden words were published since the last GC: the whole eden
+ * is then unreachable, so it is swept and freed without marking nor stopping
+ * other threads.
+ *
+ * Words handed over to other threads without being stored into Colibri
+ * words are invisible to write tracking, hence the need for the opt-in
+ * parameter and Col_WordPublish().
+ *
+ * @sideeffect
+ *      Calls freeProcs of eden custom words, or queues them for the GC
+ *      workers when #COL_GC_ASYNC_FINALIZE is enabled. Frees all eden pages.
+ *
+ * @see Col_ResumeGC
+ * @see TrackWrite
+ * @see ThreadData
+ */
+static void
+PerformLocalGC(
+    ThreadData *data)   /*!< Thread-specific data. */
+{
+    GroupData *groupData = data->groupData;
+    Col_Word word, next;
+    Col_CustomWordType *type;
+    size_t headerSize;
+    int queued = 0;
+
+    ASSERT(!data->published);
+
+    if (!groupData->asyncFinalize) {
+        /*
+         * Call freeProcs outside of the root section, as they may use the
+         * API.
+         */
+
+        CleanupSweepables(&data->eden);
+        data->eden.sweepables = WORD_NIL;
+    }
+
+    /*
+     * Statistics walk eden pages of all threads in the group.
+     */
+
+    EnterProtectRoots(groupData);
+    {
+        ClearPoolBitmasks(&data->eden);
+
+        /*
+         * Queue custom words for finalization, keeping their cells
+         * allocated.
+         */
+
+        for (word = data->eden.sweepables; word; word = next) {
+            ASSERT(WORD_TYPE(word) == WORD_TYPE_CUSTOM);
+            type = WORD_TYPEINFO(word);
+            headerSize = CustomHeaderSize(type);
+            next = WORD_CUSTOM_NEXT(word, type, headerSize);
+            SetCells(CELL_PAGE(word), CELL_INDEX(word), GetNbPageCells(word));
+            WORD_CUSTOM_NEXT(word, type, headerSize) = groupData->finalizables;
+            groupData->finalizables = word;
+            queued = 1;
+        }
+        data->eden.sweepables = WORD_NIL;
+
+        PoolFreeEmptyPages(&data->eden);
+        if (data->eden.pages) {
+            /*
+             * Move pages with queued words out of eden, like promotion does
+             * for those queued by other collections.
+             */
+
+            PromotePages(groupData, &data->eden);
+        }
+        ASSERT(!data->eden.pages);
+        data->eden.lastPage = NULL;
+        ResetPool(&data->eden);
+        groupData->stats.localCollections++;
+    }
+    LeaveProtectRoots(groupData);
+
+    if (queued) {
+        PlatScheduleFinalize(groupData);
+    }
+}
+#endif /* COL_USE_THREADS */
+
+/**
+ * Clamp collection threshold between the group's min and max page
+ * allocation numbers.
+ *
+ * @return Actual threshold value compared to number of allocations.
+ *
+ * @see COL_GC_MIN_PAGE_ALLOC
+ * @see COL_GC_MAX_PAGE_ALLOC
+ */
+static size_t
+GcThreshold(
+    GroupData *data,    /*!< Group-specific data. */
+    size_t threshold)   /*!< Threshold value. */
+{
+    return (threshold < data->minPageAlloc ?    data->minPageAlloc
+          : threshold > data->maxPageAlloc ?    data->maxPageAlloc
+          :                                     threshold);
+}
+
+/**
+ * Get the number of pages allocated in an eden pool since the last GC above
+ * which to trigger a new one. This is a fraction of the first older
+ * generation's size, unless adaptive mode is enabled.
+ *
+ * @return The eden threshold.
+ *
+ * @see Col_ResumeGC
+ * @see IsEdenFull
+ * @see AdaptEdenThreshold
+ */
+static size_t
+EdenThreshold(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    if (data->adaptive) {
+        return data->edenThreshold;
+    }
+    return GcThreshold(data, data->pools[0].nbPages / data->genFactor);
+}
+
+/**
+ * Adapt eden threshold after an eden collection in adaptive mode. Eden
+ * shrinks when pauses exceed the target, and grows when few cells survive
+ * and pauses are well below the target.
+ *
+ * @see COL_GC_ADAPTIVE
+ * @see COL_GC_PAUSE_TARGET
+ * @see GC_ADAPTIVE_SURVIVAL
+ */
+static void
+AdaptEdenThreshold(
+    GroupData *data,    /*!< Group-specific data. */
+    uint64_t pause,     /*!< Duration of collection in microseconds. */
+    size_t survival)    /*!< Percentage of eden pages that survived. */
+{
+    size_t threshold = data->edenThreshold;
+
+    if (pause > data->pauseTarget) {
+        threshold /= 2;
+    } else if (survival < GC_ADAPTIVE_SURVIVAL
+            && pause < data->pauseTarget / 2) {
+        threshold *= 2;
+    }
+    data->edenThreshold = GcThreshold(data, threshold);
+}
+
+/**
+ * Check whether eden pools need collecting.
+ *
+ * @retval <>0  if the number of pages allocated in any eden pool since the
+ *              last GC exceeds the threshold.
+ * @retval 0    otherwise.
+ *
+ * @see Col_ResumeGC
+ */
+static int
+IsEdenFull(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    size_t threshold = EdenThreshold(data);
+    ThreadData *threadData;
+
+    threadData = data->first;
+    do {
+        if (threadData->eden.nbAlloc >= threshold) return 1;
+        threadData = threadData->next;
+    } while (threadData != data->first);
+    return 0;
+}
+
+/**
+ * Check the group's heap size against its limits before eden pages get
+ * allocated, and reserve the pages in the group's page count if allowed.
+ * This is done with the root lock held so that concurrent allocations of
+ * #COL_SHARED group threads cannot exceed the limits together.
+ *
+ * Crossing the soft limit requests a full collection with compaction, once
+ * until the heap size goes back below it, which is only checked once lazy
+ * sweeping is complete. Crossing the hard limit requests a full collection
+ * as well, and makes the allocation fail with a #COL_ERROR_HEAPLIMIT error
+ * for as long as the heap would exceed the limit. Pending lazy sweeping is
+ * completed beforehand, as it may bring the heap back within the limit.
+ *
+ * @retval <>0  if pages were reserved.
+ * @retval 0    if the hard limit would be exceeded.
+ *
+ * @error{COL_ERROR_HEAPLIMIT}
+ *
+ * @see COL_GC_SOFT_LIMIT
+ * @see COL_GC_HARD_LIMIT
+ * @see PoolAllocPages
+ */
+int
+CheckHeapLimits(
+    GroupData *data,    /*!< Group-specific data. */
+    size_t number)      /*!< Number of pages to allocate. */
+{
+    size_t size;
+
+    if (data->hardLimit && data->sweepPending
+            && (PlatAtomicLoad(&data->nbPages) + number) * PAGE_SIZE
+                    > data->hardLimit) {
+        SweepPendingPages(data, 0);
+    }
+
+    EnterProtectRoots(data);
+    size = (PlatAtomicLoad(&data->nbPages) + number) * PAGE_SIZE;
+    if (data->softLimit) {
+        if (size < data->softLimit) {
+            if (!data->sweepPending) data->overSoftLimit = 0;
+        } else if (!data->overSoftLimit) {
+            data->overSoftLimit = 1;
+            PlatAtomicStore(&data->fullGC, 1);
+        }
+    }
+    if (data->hardLimit && size > data->hardLimit) {
+        PlatAtomicStore(&data->fullGC, 1);
+        LeaveProtectRoots(data);
+        Col_Error(COL_ERROR, ColibriDomain, COL_ERROR_HEAPLIMIT, size,
+                data->hardLimit);
+        return 0;
+    }
+    PlatAtomicAdd(&data->nbPages, number);
+    LeaveProtectRoots(data);
+    return 1;
+}
+
+/**
+ * Select generations to collect. Eden pool is always collected. Root pool
+ * uses explicit lifetime management.
+ *
+ * @return The oldest generation to collect.
+ *
+ * @sideeffect
+ *      Updates GC counters of older pools.
+ */
+static unsigned int
+SelectGenerations(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    unsigned int generation, maxCollectedGeneration = 1;
+
+    for (generation = 2; generation < GC_MAX_GENERATIONS; generation++) {
+        MemoryPool *pool = &data->pools[generation-2];
+
+        if (generation+1 < GC_MAX_GENERATIONS) {
+            /*
+             * Intermediary generations.
+             */
+
+            size_t  threshold = data->pools[generation-1].nbPages
+                    / data->genFactor;
+            if (pool->nbAlloc < GcThreshold(data, threshold)) {
+                /*
+                 * Stop if number of allocations is less than the threshold.
+                 */
+
+                break;
+            }
+            if (++pool->gc < data->genFactor) {
+                /*
+                 * Collection frequency is logarithmic.
+                 */
+
+                break;
+            }
+        } else {
+            /*
+             * Ultimate generation.
+             */
+
+            if (pool->nbAlloc < data->maxPageAlloc) {
+                break;
+            }
+        }
+
+        maxCollectedGeneration = generation;
+    }
+
+    return maxCollectedGeneration;
+}
+
+/**
+ * Collect all generations up to the given one.
+ *
+ * When finishing an incremental cycle, marks gathered by mark slices are
+ * installed in place of cleared bitmasks, and only words that may have
+ * escaped these slices are traversed.
+ *
+ * @sideeffect
+ *      May free cells or pages, promote words across pools, or allocate new
+ *      pages during promotion.
+ *
+ * @see ClearPoolBitmasks
+ * @see InstallMarks
+ * @see MarkReachableCells
+ * @see SweepUnreachableCells
+ * @see PromotePages
+ * @see ResetPool
+ */
+static void
+CollectGenerations(
+    GroupData *data,                    /*!< Group-specific data. */
+    unsigned int maxCollectedGeneration,/*!< Oldest generation to collect. */
+    struct GcCycle *cycle)              /*!< Incremental cycle to finish, or
+                                             NULL. */
+{
+    unsigned int generation;
+    ThreadData *threadData;
+    uint64_t start = PlatGetMicroseconds(), time = start, now;
+    size_t edenPages = 0, survivors = 0;
+
+    GC_EVENT(data, COL_GC_EVENT_COLLECT, 1, time, maxCollectedGeneration);
+    GC_EVENT(data, COL_GC_EVENT_MARK, 1, time, maxCollectedGeneration);
+
+#ifdef PROMOTE_COMPACT
+    if (!cycle && !data->cycle
+            && maxCollectedGeneration == GC_MAX_GENERATIONS-1) {
+        /*
+         * Full collections evacuate all pages upon explicit compaction, and
+         * sparse pages when older generations are sparse. The latter is only
+         * done by forced full collections when marking is parallel, see
+         * MarkReachableCells(). Pages are selected before their bitmasks get
+         * cleared.
+         */
+
+        if (data->compactHeap) {
+            SelectEvacuatedPages(data, 1);
+        } else if ((data->fullGC || data->nbMarkers == 1)
+                && IsHeapSparse(data)) {
+            SelectEvacuatedPages(data, 0);
+        }
+        data->compactHeap = 0;
+    }
+#endif
+
+    /*
+     * Clear bitmasks on collected pools. Reachable words will be marked again
+     * in the next step.
+     */
+
+    threadData = data->first;
+    do {
+        edenPages += threadData->eden.nbPages;
+        ClearPoolBitmasks(&threadData->eden);
+        threadData = threadData->next;
+    } while (threadData != data->first);
+    data->maxCollectedGeneration = maxCollectedGeneration;
+    if (!cycle) {
+        for (generation = 2; generation <= maxCollectedGeneration;
+                generation++) {
+            ClearPoolBitmasks(&data->pools[generation-2]);
+        }
+    }
+
+#ifdef PROMOTE_COMPACT
+    if (!cycle && !data->cycle && data->nbMarkers == 1
+            && data->maxCollectedGeneration+1 < GC_MAX_GENERATIONS
+            && data->pools[data->maxCollectedGeneration-1].nbPages > 0
+            && data->pools[data->maxCollectedGeneration-1].nbSetCells * 100
+                    < (data->pools[data->maxCollectedGeneration-1].nbPages
+                            * CELLS_PER_PAGE)
+                    * data->promoteFillRatio) {
+        /*
+         * Compaction allocates cells in the next generation, so it is
+         * disabled while incremental cycles are involved, and with parallel
+         * marking, see MarkReachableCells().
+         */
+
+        data->compactGeneration = data->maxCollectedGeneration;
+    } else {
+        data->compactGeneration = UINT_MAX;
+    }
+#endif
+
+    /*
+     * Refresh remembered set by adding pages written since the last GC.
+     */
+
+    UpdateParents(data);
+
+    if (cycle) {
+        /*
+         * Install marks from the incremental cycle. Parent pages from
+         * collected generations, as well as pages promoted during the cycle,
+         * are traversed again during the mark phase.
+         */
+
+        InstallMarks(data, cycle);
+        UpdateParents(data);
+    }
+
+    /*
+     * Words queued for finalization by a previous collection of the current
+     * GC must stay in place until then.
+     */
+
+    KeepQueuedWords(data);
+
+    /*
+     * Mark all cells that are reachable from roots of collected pools, and from
+     * parent pages of uncollected pools. This also marks still valid roots and
+     * parents in the process.
+     */
+
+    MarkReachableCells(data, cycle);
+
+    /*
+     * Purge stale parents.
+     */
+
+    PurgeParents(data);
+
+    now = PlatGetMicroseconds();
+    data->stats.markTime += now - time;
+    time = now;
+    GC_EVENT(data, COL_GC_EVENT_MARK, 0, time, maxCollectedGeneration);
+    GC_EVENT(data, COL_GC_EVENT_SWEEP, 1, time, maxCollectedGeneration);
+
+    /*
+     * Perform cleanup on all custom words that need sweeping.
+     */
+
+    for (generation = data->maxCollectedGeneration; generation >= 2;
+            generation--) {
+        SweepUnreachableCells(data, &data->pools[generation-2]);
+    }
+    threadData = data->first;
+    do {
+        SweepUnreachableCells(data, &threadData->eden);
+        threadData = threadData->next;
+    } while (threadData != data->first);
+
+#ifdef PROMOTE_COMPACT
+    if (data->evacuated) {
+        /*
+         * Evacuated words now live in their own pages, which get promoted
+         * or swept along with the rest of their generation.
+         */
+
+        MergeEvacuatePools(data);
+    }
+#endif
+
+    now = PlatGetMicroseconds();
+    data->stats.sweepTime += now - time;
+    time = now;
+    GC_EVENT(data, COL_GC_EVENT_SWEEP, 0, time, maxCollectedGeneration);
+    GC_EVENT(data, COL_GC_EVENT_FREE, 1, time, maxCollectedGeneration);
+
+    /*
+     * Free empty pages from collected pools before promoting them. Pages from
+     * older generation pools are swept lazily once promoted.
+     */
+
+    PoolFreeEmptyPages(&data->rootPool);
+    threadData = data->first;
+    do {
+        PoolFreeEmptyPages(&threadData->eden);
+        survivors += threadData->eden.nbPages;
+        threadData = threadData->next;
+    } while (threadData != data->first);
+
+    now = PlatGetMicroseconds();
+    data->stats.freeTime += now - time;
+    time = now;
+    GC_EVENT(data, COL_GC_EVENT_FREE, 0, time, maxCollectedGeneration);
+    GC_EVENT(data, COL_GC_EVENT_PROMOTE, 1, time, maxCollectedGeneration);
+
+    /*
+     * At this point all reachable cells are set, and unreachable cells are
+     * cleared. Now promote whole pages the next generation. Older pools are
+     * promoted first so that newer ones are correctly merged when promoted.
+     */
+
+    for (generation = data->maxCollectedGeneration; generation >= 2;
+            generation--) {
+        PromotePages(data, &data->pools[generation-2]);
+    }
+    threadData = data->first;
+    do {
+        PromotePages(data, &threadData->eden);
+        threadData = threadData->next;
+    } while (threadData != data->first);
+
+    /*
+     * Finally, reset pools (GC counters, etc.).
+     */
+
+    ResetPool(&data->rootPool);
+    threadData = data->first;
+    do {
+        ResetPool(&threadData->eden);
+        threadData->published = 0;
+        threadData = threadData->next;
+    } while (threadData != data->first);
+    for (generation = 2; generation <= data->maxCollectedGeneration;
+            generation++) {
+        ResetPool(&data->pools[generation-2]);
+    }
+
+    now = PlatGetMicroseconds();
+    data->stats.promoteTime += now - time;
+    data->stats.collections++;
+    data->stats.lastGeneration = data->maxCollectedGeneration;
+    GC_EVENT(data, COL_GC_EVENT_PROMOTE, 0, now, maxCollectedGeneration);
+    GC_EVENT(data, COL_GC_EVENT_COLLECT, 0, now, maxCollectedGeneration);
+
+    if (data->adaptive && maxCollectedGeneration == 1 && edenPages) {
+        AdaptEdenThreshold(data, now - start, survivors * 100 / edenPages);
+    }
+}
+
+/**
+ * Unprotect and clear all bitmasks in the pool's pages.
+ */
+static void
+ClearPoolBitmasks(
+    MemoryPool *pool)   /*!< The pool to traverse. */
+{
+    void * page;
+
+    for (page = pool->pages; page; page = PAGE_NEXT(page)) {
+        ASSERT(PAGE_GENERATION(page) == pool->generation);
+        if (pool->generation > 1 && PAGE_FLAG(page, PAGE_FLAG_FIRST)) {
+            SysPageProtect(page, 0);
+        }
+        ClearAllCells(page);
+    }
+}
+
+/**
+ * Pending mark entry, i.e.\ a reference to a word to mark along with the page
+ * containing the reference.
+ *
+ * @see Marker
+ */
+typedef struct MarkEntry {
+    Col_Word *wordPtr;  /*!< Word to mark and follow. */
+    Page *parentPage;   /*!< Page containing wordPtr. */
+} MarkEntry;
+
+/**
+ * State shared by all markers during the mark phase.
+ *
+ * @see Marker
+ * @see MarkReachableCells
+ */
+typedef struct MarkContext {
+    GroupData *data;        /*!< Group-specific data. */
+    int parallel;           /*!< Whether several markers run concurrently. */
+    size_t nbMarkers;       /*!< Number of markers. */
+    struct Marker *markers; /*!< Array of markers. */
+    size_t nextParent;      /*!< Index of next remembered set entry to
+                                 follow. Claimed by markers in parallel
+                                 mode. */
+    size_t active;          /*!< Number of markers that are not idle. */
+    size_t done;            /*!< Set once all markers are idle. */
+    struct MarkSegment *segments;
+                            /*!< Mark stack segments kept from the last GC,
+                                 available for reuse. */
+    uintptr_t lock;         /*!< Spinlock around segment allocation in
+                                 parallel mode. */
+    int incremental;        /*!< Whether marks are recorded in the mark table
+                                 of an incremental cycle. */
+    struct GcCycle *cycle;  /*!< Incremental cycle being marked or finished,
+                                 or NULL. */
+} MarkContext;
+
+/**
+ * Number of entries in a mark stack segment.
+ *
+ * @see MarkSegment
+ */
+#define MARK_SEGMENT_ENTRIES \
+    ((GC_MARK_SEGMENT_CELLS*CELL_SIZE-sizeof(void *))/sizeof(MarkEntry))
+
+/**
+ * Mark stack segment. Segments are made of #GC_MARK_SEGMENT_CELLS cells
+ * allocated in the root pool, and are chained from the top of the stack
+ * downwards.
+ *
+ * @see Marker
+ * @see PushStack
+ * @see PopStack
+ */
+typedef struct MarkSegment {
+    struct MarkSegment *prev;               /*!< Previous segment in
+                                                 stack or free list. */
+    MarkEntry entries[MARK_SEGMENT_ENTRIES];/*!< Stack entries. */
+} MarkSegment;
+
+/**
+ * Marker state. Each marker owns a mark stack of pending entries, so that
+ * marking needs no recursion.
+ *
+ * In parallel mode, each marker also owns a work-stealing deque of pending
+ * entries: the owner pushes and pops entries at the bottom, while idle
+ * markers steal entries from the top (Chase-Lev algorithm). The mark stack
+ * then only receives entries that overflow the deque.
+ *
+ * @see MarkContext
+ * @see MarkWord
+ * @see GC_MARK_DEQUE_SIZE
+ */
+typedef struct Marker {
+    MarkContext *context;   /*!< Shared context. */
+    size_t top;             /*!< Index of oldest entry, modified by
+                                 thieves. */
+    size_t bottom;          /*!< Index past newest entry, modified by owner
+                                 only. */
+    MarkEntry *deque;       /*!< Circular array of #GC_MARK_DEQUE_SIZE
+                                 entries, NULL in serial mode. */
+    MarkSegment *stack;     /*!< Top segment of mark stack. */
+    size_t stackSize;       /*!< Number of entries in top segment. */
+    MarkSegment *free;      /*!< Free segments for reuse. */
+    Page *cardPage;         /*!< Last page whose cards were remembered. */
+    ParentEntry *cardEntry; /*!< Remembered set entry of cardPage. */
+    Col_Word *weakWords;    /*!< Newly marked weak words, to
+                                 follow once marking is complete (see
+                                 MarkWeakWords()). */
+    size_t nbWeakWords;     /*!< Number of weak words. */
+    size_t weakWordsSize;   /*!< Capacity of weakWords. */
+} Marker;
+
+/**
+ * Mark table entry. Entries mimic the layout of page headers so that cell
+ * bitmask procedures (TestCell(), SetCells()...) can be used on them.
+ *
+ * @see GcCycle
+ * @see PAGE_BITMASK
+ */
+typedef struct MarkTableEntry {
+    Page *page;                         /*!< Page whose cells are marked,
+                                             NULL for free entries. */
+    void *reserved;                     /*!< Matches #PAGE_GROUPDATA. */
+    uint8_t bitmask[CELLS_PER_PAGE>>3]; /*!< Cell marks. */
+} MarkTableEntry;
+
+/**
+ * Hash value of page in mark table.
+ *
+ * @param page  Page to hash.
+ *
+ * @see FindMarkTableEntry
+ */
+#define MARK_TABLE_HASH(page) \
+    (((uintptr_t)(page) / PAGE_SIZE) * 2654435761u)
+
+/**
+ * Incremental GC cycle. Older generations are marked in slices between
+ * regular minor collections, and the resulting marks are stored in a mark
+ * table aside from page bitmasks, as the latter keep track of allocated
+ * cells until the cycle completes.
+ *
+ * Writes to older pages made meanwhile are detected by the parent tracking
+ * mechanism: such pages are traversed again when the cycle completes.
+ *
+ * @see StartCycle
+ * @see MarkSlice
+ * @see FinishCycle
+ */
+typedef struct GcCycle {
+    unsigned int generation;    /*!< Oldest generation to collect. */
+    MarkTableEntry *table;      /*!< Open addressing hash table of marks for
+                                     all pages of collected generations. */
+    size_t tableSize;           /*!< Number of table entries, power of 2. */
+    Col_Word *roots;            /*!< Sources of roots from collected
+                                     generations. */
+    size_t nbRoots;             /*!< Number of roots. */
+    size_t nextRoot;            /*!< Index of next root to follow. */
+    Page **parents;             /*!< Parent pages from uncollected
+                                     generations. */
+    size_t nbParents;           /*!< Number of parent pages. */
+    size_t nextParent;          /*!< Index of next parent page to follow. */
+    Page **rescan;              /*!< Pages to traverse again when the cycle
+                                     completes. */
+    size_t nbRescan;            /*!< Number of pages to traverse again. */
+    MarkContext context;        /*!< Mark context for slices. */
+    Marker marker;              /*!< Marker for slices. */
+} GcCycle;
+
+/**
+ * Mark all cells that are reachable from roots of collected pools, and from
+ * parent pages of uncollected pools. This also marks still valid roots and
+ * parents in the process.
+ *
+ * Marking is spread over #COL_GC_MARKERS threads when possible.
+ *
+ * @see MarkReachableCellsFromRoots
+ * @see MarkReachableCellsFromParents
+ * @see MarkReachableCellsParallel
+ */
+static void
+MarkReachableCells(
+    GroupData *data,    /*!< Group-specific data. */
+    GcCycle *cycle)     /*!< Incremental cycle to finish, or NULL. */
+{
+    MarkContext context;
+    Marker marker;
+#ifdef COL_USE_THREADS
+    size_t nbMarkers = data->nbMarkers;
+
+#ifdef PROMOTE_COMPACT
+    if (data->compactGeneration != UINT_MAX || data->evacuated) {
+        /*
+         * Compaction and evacuation relocate words during the mark phase:
+         * the marker that claims a word would have to publish its new
+         * location before others may follow references to it, so these
+         * require serial marking. With parallel markers, compaction is
+         * disabled and evacuation is limited to explicit compaction and
+         * forced full collections (see CollectGenerations()), so this only
+         * happens then.
+         */
+
+        nbMarkers = 1;
+    }
+#endif
+
+    if (nbMarkers > 1) {
+        MarkReachableCellsParallel(data, nbMarkers, cycle);
+        return;
+    }
+#endif /* COL_USE_THREADS */
+
+    context.data = data;
+    context.parallel = 0;
+    context.nbMarkers = 1;
+    context.markers = &marker;
+    context.nextParent = 0;
+    context.incremental = 0;
+    context.cycle = cycle;
+    marker.context = &context;
+    marker.top = marker.bottom = 0;
+    marker.deque = NULL;
+    context.segments = (MarkSegment *) data->markSegments;
+    data->markSegments = NULL;
+    marker.stack = marker.free = NULL;
+    marker.stackSize = 0;
+    marker.cardPage = NULL;
+    marker.cardEntry = NULL;
+    marker.weakWords = NULL;
+    marker.nbWeakWords = marker.weakWordsSize = 0;
+
+    MarkReachableCellsFromRoots(&marker);
+    MarkReachableCellsFromParents(&marker);
+    MarkWeakWords(&marker);
+
+    ReleaseMarkStack(&marker);
+    FreeMarkSegments(context.segments);
+    free(marker.weakWords);
+}
+
+/**
+ * Mark all cells reachable from the valid roots and from the handles of the
+ * group's threads.
+ *
+ * Traversal will stop at cells from uncollected pools. Cells from these
+ * pools having children in collected pools will be traversed in the
+ * next phase (MarkReachableCellsFromParents()).
+ *
+ * @see MarkWord
+ */
+static void
+MarkReachableCellsFromRoots(
+    Marker *marker)     /*!< Marker. */
+{
+    GroupData *data = marker->context->data;
+    Cell *node, *leaf, *parent;
+    Col_Word source;
+    ThreadData *threadData;
+    HandleBlock *block;
+    size_t nbHandles, nbSlots, i;
+
+    node = data->roots;
+    while (node) {
+        ASSERT(TestCell(CELL_PAGE(node), CELL_INDEX(node)));
+        if (!ROOT_IS_LEAF(node)) {
+            /*
+             * Descend into left subtrie.
+             */
+
+            node = ROOT_NODE_LEFT(node);
+            continue;
+        }
+
+        leaf = ROOT_GET_NODE(node);
+        source = ROOT_LEAF_SOURCE(leaf);
+        if (ROOT_LEAF_GENERATION(leaf) <= data->maxCollectedGeneration) {
+            /*
+             * Follow root from collected generation.
+             */
+
+            MarkWord(marker, &source, CELL_PAGE(source));
+            MarkPending(marker);
+            if (ROOT_LEAF_GENERATION(leaf)+1 < GC_MAX_GENERATIONS) {
+                ROOT_LEAF_GENERATION(leaf)++;
+            }
+        }
+
+        /*
+         * Find next branch.
+         */
+
+        parent = ROOT_PARENT(leaf);
+        while (parent && ((uintptr_t) source & ROOT_NODE_MASK(parent))) {
+            parent = ROOT_PARENT(parent);
+        }
+        if (!parent) {
+            /*
+             * Reached end.
+             */
+
+            break;
+        }
+        node = ROOT_NODE_RIGHT(parent);
+    }
+
+    /*
+     * Follow handles of all threads. Handle slots are updated when words
+     * move.
+     */
+
+    threadData = data->first;
+    do {
+        block = threadData->handles;
+        for (nbHandles = threadData->nbHandles; nbHandles;
+                nbHandles -= nbSlots, block = block->prev) {
+            nbSlots = (nbHandles-1) % GC_HANDLE_BLOCK_SIZE + 1;
+            for (i = 0; i < nbSlots; i++) {
+                Col_Word *wordPtr = block->slots+i;
+                if (WORD_TYPE(*wordPtr) == WORD_TYPE_CIRCLIST) {
+                    /*
+                     * Mark core list, see MarkWord().
+                     */
+
+                    Col_Word core = WORD_CIRCLIST_CORE(*wordPtr);
+                    MarkWord(marker, &core, CELL_PAGE(core));
+                    *wordPtr = WORD_CIRCLIST_NEW(core);
+                } else {
+                    MarkWord(marker, wordPtr, CELL_PAGE(*wordPtr));
+                }
+                MarkPending(marker);
+            }
+        }
+        threadData = threadData->next;
+    } while (threadData != data->first);
+
+    if (marker->context->cycle) {
+        /*
+         * Traverse pages that may hold references unseen by the mark slices
+         * of the incremental cycle.
+         */
+
+        GcCycle *cycle = marker->context->cycle;
+        size_t i;
+        for (i = 0; i < cycle->nbRescan; i++) {
+            MarkPageChildren(marker, cycle->rescan[i], NULL);
+            MarkPending(marker);
+        }
+    }
+}
+
+/**
+ * Mark all cells reachable from cells in pages with potentially younger
+ * children.
+ *
+ * In parallel mode, remembered set entries are claimed one at a time by
+ * concurrent markers.
+ *
+ * @see MarkParentPage
+ */
+static void
+MarkReachableCellsFromParents(
+    Marker *marker)     /*!< Marker. */
+{
+    MarkContext *context = marker->context;
+    GroupData *data = context->data;
+    ParentEntry *entry;
+    size_t i;
+
+    for (;;) {
+        /*
+         * Get next parent.
+         */
+
+#ifdef COL_USE_THREADS
+        if (context->parallel) {
+            i = PlatAtomicAdd(&context->nextParent, 1) - 1;
+        } else
+#endif /* COL_USE_THREADS */
+        {
+            i = context->nextParent++;
+        }
+        if (i >= data->parentsSize) break;
+
+        entry = data->parents+i;
+        if (entry->page) {
+            MarkParentPage(marker, entry);
+        }
+    }
+}
+
+/**
+ * Follow cells in a parent page from an uncollected generation. Only words
+ * holding cards are followed, unless the page was written since the last GC.
+ * Cards are computed again in the process.
+ *
+ * @see MarkPageChildren
+ * @see RememberCard
+ */
+static void
+MarkParentPage(
+    Marker *marker,     /*!< Marker. */
+    ParentEntry *entry) /*!< Remembered set entry of parent page. */
+{
+    ParentEntry cards;
+
+    if (PAGE_GENERATION(entry->page)
+            <= marker->context->data->maxCollectedGeneration) {
+        return;
+    }
+
+    if (entry->written) {
+        ClearAllCells((Page *) entry);
+        MarkPageChildren(marker, entry->page, NULL);
+    } else {
+        cards = *entry;
+        ClearAllCells((Page *) entry);
+        MarkPageChildren(marker, entry->page, (Page *) &cards);
+    }
+    MarkPending(marker);
+}
+
+/**
+ * Mark children of set cells in a page. The caller is responsible for
+ * marking pending entries afterwards with MarkPending().
+ *
+ * @see MarkChildren
+ */
+static void
+MarkPageChildren(
+    Marker *marker,     /*!< Marker. */
+    Page *page,         /*!< Page to traverse. */
+    Page *cards)        /*!< If non-NULL, only follow words holding cells set
+                             in this bitmask (see #ParentEntry). */
+{
+    Col_Word word, *wordPtr;
+    size_t index, nbCells, next = 0;
+
+    /*
+     * Iterate over cells in page.
+     */
+
+    for (index = RESERVED_CELLS; index < CELLS_PER_PAGE; index += nbCells) {
+        if (!TestCell(page, index)) {
+            nbCells = 1;
+            continue;
+        }
+
+        word = (Col_Word) PAGE_CELL(page, index);
+        nbCells = GetNbCells(word);
+
+        if (cards) {
+            /*
+             * Skip words holding no card, and stop past the last card.
+             */
+
+            if (next < index) {
+                for (next = index; next < CELLS_PER_PAGE; next++) {
+                    if (!(next & 7) && !PAGE_BITMASK(cards)[next>>3]) {
+                        next += 7;
+                    } else if (TestCell(cards, next)) {
+                        break;
+                    }
+                }
+            }
+            if (next == CELLS_PER_PAGE) break;
+            if (next >= index+nbCells) continue;
+        }
+
+        /*
+         * Follow word. Its cells are already set, only its children need
+         * marking.
+         */
+
+        wordPtr = MarkChildren(marker, word, page, 0);
+        if (wordPtr) {
+            MarkChild(marker, wordPtr, page);
+        }
+    }
+}
+
+#ifdef COL_USE_THREADS
+
+/**
+ * Mark all reachable cells using several concurrent markers. The calling
+ * thread runs the first marker, which follows roots; other markers run on
+ * worker threads. All markers follow parents, then steal pending entries
+ * from each other until no work remains.
+ *
+ * @see MarkerProc
+ * @see PlatRunParallel
+ */
+static void
+MarkReachableCellsParallel(
+    GroupData *data,    /*!< Group-specific data. */
+    size_t nbMarkers,   /*!< Number of markers. */
+    GcCycle *cycle)     /*!< Incremental cycle to finish, or NULL. */
+{
+    MarkContext context;
+    size_t i;
+
+    context.data = data;
+    context.parallel = 1;
+    context.nbMarkers = nbMarkers;
+    context.markers = (Marker *) malloc(nbMarkers * sizeof(Marker));
+    context.nextParent = 0;
+    context.incremental = 0;
+    context.cycle = cycle;
+    context.active = 1; /* First marker. */
+    context.done = 0;
+    context.segments = (MarkSegment *) data->markSegments;
+    data->markSegments = NULL;
+    context.lock = 0;
+    for (i = 0; i < nbMarkers; i++) {
+        context.markers[i].context = &context;
+        context.markers[i].top = context.markers[i].bottom = 0;
+        context.markers[i].deque = (MarkEntry *) malloc(GC_MARK_DEQUE_SIZE
+                * sizeof(MarkEntry));
+        context.markers[i].stack = context.markers[i].free = NULL;
+        context.markers[i].stackSize = 0;
+        context.markers[i].cardPage = NULL;
+        context.markers[i].cardEntry = NULL;
+        context.markers[i].weakWords = NULL;
+        context.markers[i].nbWeakWords = 0;
+        context.markers[i].weakWordsSize = 0;
+    }
+
+    PlatRunParallel(data, nbMarkers, MarkerProc, &context);
+
+    /*
+     * Weak words are followed by the first marker alone.
+     */
+
+    context.parallel = 0;
+    MarkWeakWords(context.markers);
+
+    for (i = 0; i < nbMarkers; i++) {
+        ASSERT(context.markers[i].top == context.markers[i].bottom);
+        free(context.markers[i].deque);
+        ReleaseMarkStack(context.markers+i);
+        free(context.markers[i].weakWords);
+    }
+    FreeMarkSegments(context.segments);
+    free(context.markers);
+}
+
+/**
+ * Marker task. Follows PlatParallelProc() signature.
+ *
+ * @see MarkReachableCellsParallel
+ */
+static void
+MarkerProc(
+    size_t index,       /*!< Marker index. */
+    void *clientData)   /*!< Points to #MarkContext. */
+{
+    MarkContext *context = (MarkContext *) clientData;
+    Marker *marker = context->markers+index;
+    MarkEntry entry;
+
+    if (index == 0) {
+        /*
+         * First marker is already active and follows roots.
+         */
+
+        MarkReachableCellsFromRoots(marker);
+    } else {
+        PlatAtomicAdd(&context->active, 1);
+    }
+
+    do {
+        MarkReachableCellsFromParents(marker);
+        while (StealEntry(marker, &entry)) {
+            MarkWord(marker, entry.wordPtr, entry.parentPage);
+            MarkPending(marker);
+        }
+    } while (WaitForWork(marker));
+}
+
+/**
+ * Wait for work to steal once the marker is idle.
+ *
+ * Marking is complete once all markers are idle: idle markers have empty
+ * deques and no parents remain, so no new entry can appear.
+ *
+ * @retval <>0  if there may be work to steal.
+ * @retval 0    if marking is complete.
+ */
+static int
+WaitForWork(
+    Marker *marker)     /*!< Idle marker. */
+{
+    MarkContext *context = marker->context;
+    Marker *victim;
+    size_t i;
+
+    PlatAtomicAdd(&context->active, (size_t) -1);
+    for (;;) {
+        if (PlatAtomicLoad(&context->done)) {
+            return 0;
+        }
+        if (!PlatAtomicLoad(&context->active)) {
+            PlatAtomicStore(&context->done, 1);
+            return 0;
+        }
+
+        /*
+         * Look for pending parents or entries.
+         */
+
+        if (PlatAtomicLoad(&context->nextParent)
+                < context->data->parentsSize) {
+            break;
+        }
+        for (i = 0; i < context->nbMarkers; i++) {
+            victim = context->markers+i;
+            if ((ptrdiff_t) (PlatAtomicLoad(&victim->bottom)
+                    - PlatAtomicLoad(&victim->top)) > 0) {
+                break;
+            }
+        }
+        if (i < context->nbMarkers) {
+            break;
+        }
+
+        PlatYield();
+    }
+
+    PlatAtomicAdd(&context->active, 1);
+    return 1;
+}
+
+/**
+ * Push entry at the bottom of the marker's deque.
+ *
+ * @retval <>0  if successful.
+ * @retval 0    if the deque is full.
+ */
+static int
+PushEntry(
+    Marker *marker,     /*!< Deque owner. */
+    Col_Word *wordPtr,  /*!< Word to mark and follow. */
+    Page *parentPage)   /*!< Page containing wordPtr. */
+{
+    size_t bottom = marker->bottom;
+    MarkEntry *entry;
+
+    if (bottom - PlatAtomicLoad(&marker->top) >= GC_MARK_DEQUE_SIZE) {
+        return 0;
+    }
+    entry = marker->deque + (bottom & (GC_MARK_DEQUE_SIZE-1));
+    entry->wordPtr = wordPtr;
+    entry->parentPage = parentPage;
+    PlatAtomicStore(&marker->bottom, bottom+1);
+    return 1;
+}
+
+/**
+ * Pop entry from the bottom of the marker's deque.
+ *
+ * @retval <>0  if successful.
+ * @retval 0    if the deque is empty.
+ */
+static int
+PopEntry(
+    Marker *marker,     /*!< Deque owner. */
+    MarkEntry *entry)   /*!< Popped entry. */
+{
+    size_t bottom = marker->bottom - 1, top;
+    int found;
+
+    PlatAtomicStore(&marker->bottom, bottom);
+    PlatMemoryBarrier();
+    top = PlatAtomicLoad(&marker->top);
+    if ((ptrdiff_t) (bottom - top) < 0) {
+        /*
+         * Empty.
+         */
+
+        PlatAtomicStore(&marker->bottom, top);
+        return 0;
+    }
+
+    *entry = marker->deque[bottom & (GC_MARK_DEQUE_SIZE-1)];
+    if (bottom != top) {
+        return 1;
+    }
+
+    /*
+     * Last entry, race against thieves.
+     */
+
+    found = PlatAtomicCas(&marker->top, top, top+1);
+    PlatAtomicStore(&marker->bottom, top+1);
+    return found;
+}
+
+/**
+ * Steal entry from the top of another marker's deque.
+ *
+ * @retval <>0  if successful.
+ * @retval 0    if no entry was found.
+ */
+static int
+StealEntry(
+    Marker *marker,     /*!< Thief. */
+    MarkEntry *entry)   /*!< Stolen entry. */
+{
+    MarkContext *context = marker->context;
+    Marker *victim;
+    size_t i, top, bottom;
+
+    for (i = 1; i < context->nbMarkers; i++) {
+        victim = context->markers
+                + (marker - context->markers + i) % context->nbMarkers;
+        top = PlatAtomicLoad(&victim->top);
+        PlatMemoryBarrier();
+        bottom = PlatAtomicLoad(&victim->bottom);
+        if ((ptrdiff_t) (bottom - top) <= 0) {
+            continue;
+        }
+
+        *entry = victim->deque[top & (GC_MARK_DEQUE_SIZE-1)];
+        if (PlatAtomicCas(&victim->top, top, top+1)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#endif /* COL_USE_THREADS */
+
+/**
+ * Push entry on top of the marker's mark stack, getting a new segment if
+ * needed. Segments are reused from the marker's free list, then from those
+ * kept from the last GC, else allocated in the root pool.
+ *
+ * @sideeffect
+ *      May allocate cells in the root pool.
+ *
+ * @see PopStack
+ */
+static void
+PushStack(
+    Marker *marker,     /*!< Stack owner. */
+    Col_Word *wordPtr,  /*!< Word to mark and follow. */
+    Page *parentPage)   /*!< Page containing wordPtr. */
+{
+    MarkSegment *segment;
+    MarkEntry *entry;
+
+    if (!marker->stack || marker->stackSize == MARK_SEGMENT_ENTRIES) {
+        /*
+         * Top segment is full, get a new one.
+         */
+
+        segment = marker->free;
+        if (segment) {
+            marker->free = segment->prev;
+        } else {
+            MarkContext *context = marker->context;
+#ifdef COL_USE_THREADS
+            if (context->parallel) {
+                while (!PlatAtomicCas(&context->lock, 0, 1)) {
+                    PlatYield();
+                }
+            }
+#endif /* COL_USE_THREADS */
+            segment = context->segments;
+            if (segment) {
+                context->segments = segment->prev;
+            } else {
+                ASSERT(sizeof(MarkSegment)
+                        <= GC_MARK_SEGMENT_CELLS*CELL_SIZE);
+                segment = (MarkSegment *) PoolAllocCells(
+                        &context->data->rootPool, GC_MARK_SEGMENT_CELLS);
+            }
+#ifdef COL_USE_THREADS
+            if (context->parallel) {
+                PlatAtomicStore(&context->lock, 0);
+            }
+#endif /* COL_USE_THREADS */
+        }
+        segment->prev = marker->stack;
+        marker->stack = segment;
+        marker->stackSize = 0;
+    }
+
+    entry = marker->stack->entries + marker->stackSize++;
+    entry->wordPtr = wordPtr;
+    entry->parentPage = parentPage;
+}
+
+/**
+ * Pop entry from the top of the marker's mark stack. Cells of the entries
+ * that will be popped next are prefetched meanwhile.
+ *
+ * @retval <>0  if successful.
+ * @retval 0    if the stack is empty.
+ *
+ * @see PushStack
+ * @see GC_MARK_PREFETCH_DISTANCE
+ */
+static int
+PopStack(
+    Marker *marker,     /*!< Stack owner. */
+    MarkEntry *entry)   /*!< Popped entry. */
+{
+    MarkSegment *segment;
+
+    if (marker->stackSize == 0) {
+        segment = marker->stack;
+        if (!segment || !segment->prev) {
+            /*
+             * Empty.
+             */
+
+            return 0;
+        }
+
+        /*
+         * Top segment is empty, move it to the free list.
+         */
+
+        marker->stack = segment->prev;
+        marker->stackSize = MARK_SEGMENT_ENTRIES;
+        segment->prev = marker->free;
+        marker->free = segment;
+    }
+
+    *entry = marker->stack->entries[--marker->stackSize];
+    if (marker->stackSize >= GC_MARK_PREFETCH_DISTANCE) {
+        PlatPrefetch((void *) *marker->stack->entries[marker->stackSize
+                - GC_MARK_PREFETCH_DISTANCE].wordPtr);
+    }
+    return 1;
+}
+
+/**
+ * Release all segments of the marker's mark stack once marking is complete.
+ * They are kept in the group data for reuse by the next GC.
+ *
+ * @see PushStack
+ * @see FreeMarkSegments
+ */
+static void
+ReleaseMarkStack(
+    Marker *marker)     /*!< Stack owner. */
+{
+    GroupData *data = marker->context->data;
+    MarkSegment *segment, *prev;
+
+    ASSERT(marker->stackSize == 0);
+    ASSERT(!marker->stack || !marker->stack->prev);
+    for (segment = marker->free; segment; segment = prev) {
+        prev = segment->prev;
+        segment->prev = (MarkSegment *) data->markSegments;
+        data->markSegments = (Cell *) segment;
+    }
+    if (marker->stack) {
+        marker->stack->prev = (MarkSegment *) data->markSegments;
+        data->markSegments = (Cell *) marker->stack;
+    }
+    marker->stack = marker->free = NULL;
+}
+
+/**
+ * Free mark stack segments that were not needed during the last GC. This
+ * gives back memory once the mark stack shrinks.
+ *
+ * @see ReleaseMarkStack
+ */
+static void
+FreeMarkSegments(
+    MarkSegment *segments)  /*!< List of segments to free. */
+{
+    MarkSegment *segment, *prev;
+
+    for (segment = segments; segment; segment = prev) {
+        prev = segment->prev;
+        ClearCells(CELL_PAGE(segment), CELL_INDEX(segment),
+                GC_MARK_SEGMENT_CELLS);
+    }
+}
+
+/**
+ * Mark all entries pending in the marker's deque and mark stack.
+ *
+ * @see MarkWord
+ */
+static void
+MarkPending(
+    Marker *marker)     /*!< Marker. */
+{
+    MarkEntry entry;
+
+    for (;;) {
+#ifdef COL_USE_THREADS
+        if (marker->deque && PopEntry(marker, &entry)) {
+            MarkWord(marker, entry.wordPtr, entry.parentPage);
+            continue;
+        }
+#endif /* COL_USE_THREADS */
+        if (!PopStack(marker, &entry)) break;
+        MarkWord(marker, entry.wordPtr, entry.parentPage);
+    }
+}
+
+/**
+ * Start an incremental GC cycle. Marking will be performed by subsequent
+ * calls to MarkSlice().
+ *
+ * This builds the cycle's mark table and takes a snapshot of roots and
+ * parents to follow. New roots and parents will be followed when the cycle
+ * completes.
+ *
+ * @retval <>0  if the cycle was started.
+ * @retval 0    if memory for the cycle could not be allocated.
+ *
+ * @see GcCycle
+ * @see FinishCycle
+ */
+static int
+StartCycle(
+    GroupData *data,            /*!< Group-specific data. */
+    unsigned int generation)    /*!< Oldest generation to collect. */
+{
+    GcCycle *cycle;
+    unsigned int g;
+    Page *page;
+    MarkTableEntry *entry;
+    Cell *node, *leaf, *parent;
+    Col_Word source;
+    size_t nbPages, i, size;
+
+    ASSERT(!data->cycle);
+    cycle = (GcCycle *) malloc(sizeof(GcCycle));
+    if (!cycle) return 0;
+    cycle->generation = generation;
+
+    /*
+     * Build mark table with an entry for each page of collected generations.
+     * Load factor is kept under 1/2.
+     */
+
+    nbPages = 0;
+    for (g = 2; g <= generation; g++) {
+        for (page = data->pools[g-2].pages; page; page = PAGE_NEXT(page)) {
+            nbPages++;
+        }
+    }
+    for (cycle->tableSize = 16; cycle->tableSize < nbPages*2;
+            cycle->tableSize *= 2);
+    cycle->table = (MarkTableEntry *) calloc(cycle->tableSize,
+            sizeof(MarkTableEntry));
+    if (!cycle->table) {
+        free(cycle);
+        return 0;
+    }
+    for (g = 2; g <= generation; g++) {
+        for (page = data->pools[g-2].pages; page; page = PAGE_NEXT(page)) {
+            for (i = MARK_TABLE_HASH(page) & (cycle->tableSize-1);
+                    cycle->table[i].page; i = (i+1) & (cycle->tableSize-1));
+            entry = cycle->table+i;
+            entry->page = page;
+            ClearAllCells((Page *) entry);
+        }
+    }
+
+    /*
+     * Snapshot root sources from collected generations. Other roots cannot
+     * reference collected cells without a parent in between.
+     */
+
+    cycle->roots = NULL;
+    cycle->nbRoots = cycle->nextRoot = size = 0;
+    node = data->roots;
+    while (node) {
+        if (!ROOT_IS_LEAF(node)) {
+            node = ROOT_NODE_LEFT(node);
+            continue;
+        }
+
+        leaf = ROOT_GET_NODE(node);
+        source = ROOT_LEAF_SOURCE(leaf);
+        page = CELL_PAGE(source);
+        if (PAGE_GENERATION(page) >= 2
+                && PAGE_GENERATION(page) <= generation) {
+            cycle->roots = (Col_Word *) GrowArray(cycle->roots, &size,
+                    cycle->nbRoots, sizeof(Col_Word));
+            cycle->roots[cycle->nbRoots++] = source;
+        }
+
+        parent = ROOT_PARENT(leaf);
+        while (parent && ((uintptr_t) source & ROOT_NODE_MASK(parent))) {
+            parent = ROOT_PARENT(parent);
+        }
+        if (!parent) break;
+        node = ROOT_NODE_RIGHT(parent);
+    }
+
+    /*
+     * Snapshot parent pages from uncollected generations.
+     */
+
+    cycle->parents = NULL;
+    cycle->nbParents = cycle->nextParent = size = 0;
+    for (i = 0; i < data->parentsSize; i++) {
+        page = data->parents[i].page;
+        if (page && PAGE_GENERATION(page) > generation) {
+            cycle->parents = (Page **) GrowArray(cycle->parents, &size,
+                    cycle->nbParents, sizeof(Page *));
+            cycle->parents[cycle->nbParents++] = page;
+        }
+    }
+
+    cycle->rescan = NULL;
+    cycle->nbRescan = 0;
+
+    /*
+     * Initialize serial marker.
+     */
+
+    cycle->context.data = data;
+    cycle->context.parallel = 0;
+    cycle->context.nbMarkers = 1;
+    cycle->context.markers = &cycle->marker;
+    cycle->context.nextParent = 0;
+    cycle->context.segments = NULL;
+    cycle->context.lock = 0;
+    cycle->context.incremental = 1;
+    cycle->context.cycle = cycle;
+    cycle->marker.context = &cycle->context;
+    cycle->marker.top = cycle->marker.bottom = 0;
+    cycle->marker.deque = NULL;
+    cycle->marker.stack = cycle->marker.free = NULL;
+    cycle->marker.stackSize = 0;
+    cycle->marker.cardPage = NULL;
+    cycle->marker.cardEntry = NULL;
+    cycle->marker.weakWords = NULL;
+    cycle->marker.nbWeakWords = cycle->marker.weakWordsSize = 0;
+
+    data->cycle = cycle;
+    return 1;
+}
+
+/**
+ * Run a mark slice of the incremental cycle underway. The slice stops once
+ * its time budget (see #COL_GC_SLICE_BUDGET) is exhausted.
+ *
+ * @retval <>0  if marking is complete.
+ * @retval 0    if the time budget was exhausted.
+ *
+ * @see MarkWordIncremental
+ * @see GC_SLICE_CHECK_INTERVAL
+ */
+static int
+MarkSlice(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    GcCycle *cycle = data->cycle;
+    Marker *marker = &cycle->marker;
+    MarkEntry entry;
+    uint64_t start = PlatGetMicroseconds(),
+            deadline = start + data->sliceBudget, now;
+    size_t count;
+    int done = 0;
+
+    GC_EVENT(data, COL_GC_EVENT_SLICE, 1, start, cycle->generation);
+    for (count = 1; ; count++) {
+        if (count % GC_SLICE_CHECK_INTERVAL == 0
+                && PlatGetMicroseconds() >= deadline) {
+            break;
+        }
+
+        if (PopStack(marker, &entry)) {
+            MarkWordIncremental(marker, *entry.wordPtr);
+        } else if (cycle->nextRoot < cycle->nbRoots) {
+            MarkWordIncremental(marker, cycle->roots[cycle->nextRoot++]);
+        } else if (cycle->nextParent < cycle->nbParents) {
+            MarkPageChildren(marker, cycle->parents[cycle->nextParent++],
+                    NULL);
+        } else {
+            /*
+             * No more work.
+             */
+
+            done = 1;
+            break;
+        }
+    }
+
+    now = PlatGetMicroseconds();
+    data->stats.slices++;
+    data->stats.markTime += now - start;
+    GC_EVENT(data, COL_GC_EVENT_SLICE, 0, now, cycle->generation);
+    return done;
+}
+
+/**
+ * Mark word from collected generations in the mark table of the incremental
+ * cycle underway, and push its children onto the marker's mark stack.
+ *
+ * Contrary to MarkWord(), pages are left untouched. Words from pages
+ * promoted since the cycle started have no mark table entry; they are
+ * traversed again when the cycle completes.
+ *
+ * @see MarkSlice
+ * @see MarkChildren
+ */
+static void
+MarkWordIncremental(
+    Marker *marker,     /*!< Marker. */
+    Col_Word word)      /*!< Word to mark and follow. */
+{
+    GcCycle *cycle = marker->context->cycle;
+    MarkTableEntry *entry;
+    Page *page;
+    size_t index, nbCells;
+    Col_Word *wordPtr;
+
+    if (!word || ((uintptr_t) word & 15)) {
+        /*
+         * Immediate word (see #WORD_TYPE). Only circular lists have a
+         * cell-based core to follow.
+         */
+
+        if (WORD_TYPE(word) != WORD_TYPE_CIRCLIST) return;
+        word = WORD_CIRCLIST_CORE(word);
+    }
+
+    page = CELL_PAGE(word);
+    if (PAGE_GENERATION(page) < 2
+            || PAGE_GENERATION(page) > cycle->generation) {
+        /*
+         * Uncollected generation.
+         */
+
+        return;
+    }
+
+    entry = FindMarkTableEntry(cycle, page);
+    if (!entry) {
+        /*
+         * Promoted during the cycle.
+         */
+
+        return;
+    }
+
+    /*
+     * Stop if cell is already marked.
+     */
+
+    index = CELL_INDEX(word);
+    if (TestCell((Page *) entry, index)) {
+        return;
+    }
+
+    nbCells = GetNbCells(word);
+    if (index+nbCells > CELLS_PER_PAGE) {
+        nbCells = CELLS_PER_PAGE-index;
+    }
+    SetCells((Page *) entry, index, nbCells);
+
+    /*
+     * Follow children. Mark slices only check their time budget between
+     * words, so the last child is pushed as well.
+     */
+
+    wordPtr = MarkChildren(marker, word, page, 1);
+    if (wordPtr) {
+        MarkChild(marker, wordPtr, page);
+    }
+}
+
+/**
+ * Find mark table entry for page.
+ *
+ * @return The entry, or NULL if the page has none.
+ *
+ * @see MARK_TABLE_HASH
+ */
+static MarkTableEntry *
+FindMarkTableEntry(
+    GcCycle *cycle,     /*!< Incremental cycle. */
+    Page *page)         /*!< Page to find entry for. */
+{
+    size_t mask = cycle->tableSize-1, i;
+
+    for (i = MARK_TABLE_HASH(page) & mask; cycle->table[i].page;
+            i = (i+1) & mask) {
+        if (cycle->table[i].page == page) return cycle->table+i;
+    }
+    return NULL;
+}
+
+/**
+ * Install marks from the incremental cycle in the page bitmasks of collected
+ * generations, in place of ClearPoolBitmasks().
+ *
+ * Marked words whose pages were written since the cycle started may have
+ * unmarked children. Such pages are parents, and are remembered along with
+ * pages promoted during the cycle in order to be traversed again during the
+ * mark phase. Pages promoted during the cycle keep their bitmask, i.e. all
+ * their words are considered reachable.
+ *
+ * @see MarkReachableCellsFromRoots
+ */
+static void
+InstallMarks(
+    GroupData *data,    /*!< Group-specific data. */
+    GcCycle *cycle)     /*!< Incremental cycle to finish. */
+{
+    unsigned int generation;
+    Page *page;
+    MarkTableEntry *entry;
+    size_t size = 0, i;
+
+    /*
+     * Remember parents from collected generations.
+     */
+
+    for (i = 0; i < data->parentsSize; i++) {
+        page = data->parents[i].page;
+        if (page && PAGE_GENERATION(page) >= 2
+                && PAGE_GENERATION(page) <= cycle->generation) {
+            cycle->rescan = (Page **) GrowArray(cycle->rescan, &size,
+                    cycle->nbRescan, sizeof(Page *));
+            cycle->rescan[cycle->nbRescan++] = page;
+        }
+    }
+
+    /*
+     * Install marks.
+     */
+
+    for (generation = 2; generation <= cycle->generation; generation++) {
+        for (page = data->pools[generation-2].pages; page;
+                page = PAGE_NEXT(page)) {
+            if (PAGE_FLAG(page, PAGE_FLAG_FIRST)) {
+                SysPageProtect(page, 0);
+            }
+            entry = FindMarkTableEntry(cycle, page);
+            if (entry) {
+                memcpy(PAGE_BITMASK(page), entry->bitmask,
+                        sizeof(entry->bitmask));
+            } else {
+                /*
+                 * Promoted during the cycle.
+                 */
+
+                cycle->rescan = (Page **) GrowArray(cycle->rescan, &size,
+                        cycle->nbRescan, sizeof(Page *));
+                cycle->rescan[cycle->nbRescan++] = page;
+            }
+        }
+    }
+}
+
+/**
+ * Complete the incremental cycle underway: collect all generations it
+ * covers using its marks.
+ *
+ * @see CollectGenerations
+ */
+static void
+FinishCycle(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    GcCycle *cycle = data->cycle;
+
+    data->cycle = NULL;
+    CollectGenerations(data, cycle->generation, cycle);
+
+    /*
+     * Keep mark stack segments for reuse by the next GC.
+     */
+
+    ReleaseMarkStack(&cycle->marker);
+    FreeCycle(cycle);
+}
+
+/**
+ * Free memory used by an incremental cycle. Mark stack segments are left
+ * in the root pool.
+ *
+ * @see StartCycle
+ */
+static void
+FreeCycle(
+    GcCycle *cycle)     /*!< Incremental cycle to free. */
+{
+    free(cycle->table);
+    free(cycle->roots);
+    free(cycle->parents);
+    free(cycle->rescan);
+    free(cycle->marker.weakWords);
+    free(cycle);
+}
+
+/**
+ * Ensure that a growable array can hold one more element.
+ *
+ * @return The (possibly reallocated) array.
+ *
+ * @sideeffect
+ *      Raises a fatal error if the array cannot be reallocated.
+ */
+static void *
+GrowArray(
+    void *array,        /*!< Array to grow, may be NULL. */
+    size_t *sizePtr,    /*!< Array capacity, updated on reallocation. */
+    size_t length,      /*!< Number of elements in array. */
+    size_t elemSize)    /*!< Element size. */
+{
+    void *newArray;
+
+    if (length < *sizePtr) return array;
+    newArray = realloc(array, (*sizePtr ? *sizePtr*2 : 16) * elemSize);
+    if (!newArray) {
+        /*
+         * Fatal error!
+         */
+
+        /*! @fatal{COL_ERROR_MEMORY,GC array allocation failed} */
+        Col_Error(COL_FATAL, ColibriDomain, COL_ERROR_MEMORY,
+                "GC array allocation failed");
+        return array;
+    }
+    *sizePtr = (*sizePtr ? *sizePtr*2 : 16);
+    return newArray;
+}
+
+#ifdef PROMOTE_COMPACT
+/**
+ * Tell whether older generations are sparse enough for full collections to
+ * evacuate sparse pages.
+ *
+ * @retval 1    if the fill ratio of older generations is below
+ *              #COL_GC_PROMOTE_FILL_RATIO.
+ * @retval 0    otherwise.
+ *
+ * @see SelectEvacuatedPages
+ */
+static int
+IsHeapSparse(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    unsigned int generation;
+    size_t nbPages = 0, nbSetCells = 0;
+
+    for (generation = 2; generation < GC_MAX_GENERATIONS; generation++) {
+        nbPages += data->pools[generation-2].nbPages;
+        nbSetCells += data->pools[generation-2].nbSetCells;
+    }
+    return (nbPages > 0 && nbSetCells * 100
+            < nbPages * CELLS_PER_PAGE * data->promoteFillRatio);
+}
+
+/**
+ * Select sparse system pages from older generation pools, whose unpinned
+ * words get evacuated during the mark phase. Must be called before clearing
+ * bitmasks. Bitmasks still account for unreachable words at this point, so
+ * selecting all pages is the only way to compact the heap in a single pass.
+ *
+ * Selected pages are stored in an open addressing hash table, and words are
+ * evacuated into separate pools so that they never land on pages that are
+ * not marked yet.
+ *
+ * @see GC_EVACUATE_FILL_RATIO
+ * @see IsEvacuated
+ * @see MergeEvacuatePools
+ */
+static void
+SelectEvacuatedPages(
+    GroupData *data,    /*!< Group-specific data. */
+    int all)            /*!< Whether to select all pages regardless of their
+                             fill ratio. */
+{
+    unsigned int generation;
+    Page *base, *page;
+    size_t nbSparse, nbPages, nbSetCells, mask, i;
+    int pass;
+
+    /*
+     * First pass counts sparse pages to size the table, second pass fills
+     * it.
+     */
+
+    for (pass = 0, nbSparse = 0; pass < 2; pass++) {
+        for (generation = 2; generation < GC_MAX_GENERATIONS; generation++) {
+            for (base = data->pools[generation-2].pages; base;
+                    base = PAGE_NEXT(page)) {
+                /*
+                 * Compute fill ratio of system page.
+                 */
+
+                ASSERT(PAGE_FLAG(base, PAGE_FLAG_FIRST));
+                nbPages = 0;
+                nbSetCells = 0;
+                for (page = base; ; page = PAGE_NEXT(page)) {
+                    nbPages++;
+                    nbSetCells += NbSetCells(page) - RESERVED_CELLS;
+                    if (PAGE_FLAG(page, PAGE_FLAG_LAST)) break;
+                }
+                if (!all && nbSetCells * 100
+                        >= nbPages * AVAILABLE_CELLS * GC_EVACUATE_FILL_RATIO) {
+                    continue;
+                }
+
+                if (pass == 0) {
+                    nbSparse += nbPages;
+                    continue;
+                }
+                mask = data->evacuatedSize-1;
+                for (page = base; ; page = PAGE_NEXT(page)) {
+                    for (i = MARK_TABLE_HASH(page) & mask; data->evacuated[i];
+                            i = (i+1) & mask);
+                    data->evacuated[i] = page;
+                    if (PAGE_FLAG(page, PAGE_FLAG_LAST)) break;
+                }
+            }
+        }
+
+        if (pass == 0) {
+            if (!nbSparse) {
+                /*
+                 * Nothing to evacuate.
+                 */
+
+                return;
+            }
+
+            /*
+             * Keep the table at most half full.
+             */
+
+            for (data->evacuatedSize = 16;
+                    data->evacuatedSize < nbSparse*2;
+                    data->evacuatedSize *= 2);
+            data->evacuated = (Page **) calloc(data->evacuatedSize,
+                    sizeof(Page *));
+            if (!data->evacuated) {
+                /*
+                 * Evacuation is optional.
+                 */
+
+                data->evacuatedSize = 0;
+                return;
+            }
+        }
+    }
+
+    data->evacuatePools = (MemoryPool *) malloc((GC_MAX_GENERATIONS-2)
+            * sizeof(MemoryPool));
+    if (!data->evacuatePools) {
+        free(data->evacuated);
+        data->evacuated = NULL;
+        data->evacuatedSize = 0;
+        return;
+    }
+    for (generation = 2; generation < GC_MAX_GENERATIONS; generation++) {
+        PoolInit(&data->evacuatePools[generation-2], generation);
+    }
+}
+
+/**
+ * Tell whether page was selected for evacuation.
+ *
+ * @retval 1    if page is sparse.
+ * @retval 0    otherwise.
+ *
+ * @see SelectEvacuatedPages
+ */
+static int
+IsEvacuated(
+    GroupData *data,    /*!< Group-specific data. */
+    Page *page)         /*!< Page to check. */
+{
+    size_t mask = data->evacuatedSize-1, i;
+
+    for (i = MARK_TABLE_HASH(page) & mask; data->evacuated[i];
+            i = (i+1) & mask) {
+        if (data->evacuated[i] == page) return 1;
+    }
+    return 0;
+}
+
+/**
+ * Merge pages that received evacuated words into their generation pool,
+ * and forget about evacuated pages. Left empty, the latter get freed when
+ * the pool is swept.
+ *
+ * @see SelectEvacuatedPages
+ */
+static void
+MergeEvacuatePools(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    unsigned int generation;
+    MemoryPool *pool, *evacuatePool;
+
+    for (generation = 2; generation < GC_MAX_GENERATIONS; generation++) {
+        pool = &data->pools[generation-2];
+        evacuatePool = &data->evacuatePools[generation-2];
+        if (!evacuatePool->pages) continue;
+
+        ASSERT(!evacuatePool->sweepables);
+        PAGE_SET_NEXT(evacuatePool->lastPage, pool->pages);
+        pool->pages = evacuatePool->pages;
+        if (!pool->lastPage) {
+            pool->lastPage = evacuatePool->lastPage;
+        }
+        pool->nbPages += evacuatePool->nbPages;
+        pool->nbSetCells += evacuatePool->nbSetCells;
+        pool->nbAlloc += evacuatePool->nbAlloc;
+        pool->totalAlloc += evacuatePool->totalAlloc;
+    }
+
+    free(data->evacuated);
+    free(data->evacuatePools);
+    data->evacuated = NULL;
+    data->evacuatedSize = 0;
+    data->evacuatePools = NULL;
+}
+#endif /* PROMOTE_COMPACT */
+
+/**
+ * Purge all remembered pages that have no card left. Remaining pages keep
+ * their cards, and page groups written since the last GC are write-protected
+ * again.
+ *
+ * @see UpdateParents
+ */
+static void
+PurgeParents(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    ParentEntry *entries = data->parents;
+    size_t size = data->parentsSize, i;
+    Page *page;
+    int parent;
+
+    /*
+     * Rebuild table from remaining pages. The new table is sized after the
+     * current number of parents, which bounds the remaining ones.
+     */
+
+    if (data->nbParents) {
+        for (data->parentsSize = 16; data->parentsSize < data->nbParents*2;
+                data->parentsSize *= 2);
+        data->parents = (ParentEntry *) calloc(data->parentsSize,
+                sizeof(ParentEntry));
+    } else {
+        data->parents = NULL;
+        data->parentsSize = 0;
+    }
+    data->nbParents = 0;
+    for (i = 0; i < size; i++) {
+        page = entries[i].page;
+        if (!page) continue;
+
+        /*
+         * Remembered pages are parents as long as they have cards.
+         */
+
+        parent = (NbSetCells((Page *) (entries+i)) > RESERVED_CELLS);
+        if (!parent && data->cycle) {
+            /*
+             * Keep parents from generations marked by the incremental cycle
+             * underway, so that they get traversed again when the cycle
+             * completes (see InstallMarks()).
+             */
+
+            parent = (PAGE_GENERATION(page) >= 2
+                    && PAGE_GENERATION(page) <= data->cycle->generation);
+        }
+        if (parent) {
+            /*
+             * Keep parent along with its cards.
+             */
+
+            *AddParent(data, page) = entries[i];
+        }
+
+        /*
+         * Protect written page groups from uncollected generations, their
+         * references to younger generations are now tracked by cards. Those
+         * from collected generations will be protected when promoted.
+         */
+
+        if (entries[i].written && PAGE_FLAG(page, PAGE_FLAG_FIRST)
+                && PAGE_GENERATION(page) > data->maxCollectedGeneration) {
+            SysPageProtect(page, 1);
+        }
+    }
+    free(entries);
+}
+
+/**
+ * Tell whether page holds references to younger generations that are not
+ * tracked by cards, i.e.\ it is marked as parent but not remembered. Such
+ * pages must stay unprotected so that they are traversed entirely at next
+ * GC.
+ *
+ * @retval 1    if page is an untracked parent.
+ * @retval 0    otherwise.
+ *
+ * @see PromotePages
+ */
+static int
+IsUntrackedParent(
+    GroupData *data,    /*!< Group-specific data. */
+    Page *page)         /*!< Page to check. */
+{
+    return (PAGE_FLAG(page, PAGE_FLAG_PARENT) && !FindParent(data, page));
+}
+
+/**
+ * Remember card holding a reference to a younger generation, so that the
+ * next GC only follows the words holding such cards.
+ *
+ * References from outside the parent page, e.g.\ from the trailing cells of
+ * large words, cannot be tied to a given cell, so all cards of the page are
+ * set instead.
+ *
+ * @retval 1    if page is remembered.
+ * @retval 0    if page is untracked and must be marked as parent instead.
+ *
+ * @see ParentEntry
+ * @see MarkParentPage
+ */
+static int
+RememberCard(
+    Marker *marker,     /*!< Marker. */
+    Col_Word *wordPtr,  /*!< Reference to younger word. */
+    Page *parentPage)   /*!< Page containing wordPtr. */
+{
+    ParentEntry *entry;
+    uintptr_t offset = (uintptr_t) wordPtr - (uintptr_t) parentPage;
+    size_t i;
+
+    if (marker->cardPage != parentPage) {
+        marker->cardPage = parentPage;
+        marker->cardEntry = FindParent(marker->context->data, parentPage);
+    }
+    entry = marker->cardEntry;
+    if (!entry) {
+        /*
+         * Page was allocated or written during GC, so it will be traversed
+         * entirely at next GC. Software barriers don't catch writes from the
+         * GC, so record the write here.
+         */
+
+#ifdef COL_USE_SOFTWARE_BARRIER
+        if (PAGE_FLAG(parentPage, PAGE_FLAG_PROTECTED)) {
+            SysPageProtect(parentPage, 0);
+        }
+#endif /* COL_USE_SOFTWARE_BARRIER */
+        return 0;
+    }
+
+    if (offset < PAGE_SIZE) {
+        i = offset / CELL_SIZE;
+        if (TestCell((Page *) entry, i)) return 1;
+#ifdef COL_USE_THREADS
+        if (marker->context->parallel) {
+            SetCellsAtomic((Page *) entry, i, 1);
+        } else
+#endif /* COL_USE_THREADS */
+        SetCells((Page *) entry, i, 1);
+        return 1;
+    }
+
+    for (i = 0; i < (CELLS_PER_PAGE>>3); i++) {
+        if (entry->cards[i] == 0xFF) continue;
+#ifdef COL_USE_THREADS
+        if (marker->context->parallel) {
+            PlatAtomicOrByte(entry->cards+i, 0xFF);
+        } else
+#endif /* COL_USE_THREADS */
+        entry->cards[i] = 0xFF;
+    }
+    return 1;
+}
+
+/**
+ * Word children enumeration function used to follow all children of a
+ * reachable word during GC. Follows Col_CustomWordChildEnumProc()
+ * signature.
+ *
+ * @see Col_CustomWordType
+ * @see Col_CustomWordChildrenProc
+ * @see MarkChild
+ */
+static void
+MarkWordChild(
+    Col_Word word,              /*!< Custom word whose child is being
+                                     followed. */
+    Col_Word *childPtr,         /*!< Pointer to child, may be overwritten if
+                                     moved. */
+    Col_ClientData clientData)  /*!< Points to #Marker */
+{
+    MarkChild((Marker *) clientData, childPtr, CELL_PAGE(word));
+}
+
+/**
+ * Mark child word. Cell-based words are pushed onto the marker's deque in
+ * parallel mode so that idle markers can steal them, else onto its mark
+ * stack. Immediate words are marked at once.
+ *
+ * @see MarkWord
+ * @see MarkPending
+ */
+static void
+MarkChild(
+    Marker *marker,     /*!< Marker. */
+    Col_Word *wordPtr,  /*!< Word to mark and follow, overwritten if
+                             promoted. */
+    Page *parentPage)   /*!< Page containing wordPtr, will be set as modified
+                             if overwritten. */
+{
+    if (!*wordPtr || ((uintptr_t) *wordPtr & 15)) {
+        /*
+         * Immediate word (see #WORD_TYPE). Only circular lists have a
+         * cell-based core to follow; its children are pushed in turn, so this
+         * never recurses deeper.
+         */
+
+        if (WORD_TYPE(*wordPtr) == WORD_TYPE_CIRCLIST) {
+            if (marker->context->incremental) {
+                MarkWordIncremental(marker, *wordPtr);
+            } else {
+                MarkWord(marker, wordPtr, parentPage);
+            }
+        }
+        return;
+    }
+
+#ifdef COL_USE_THREADS
+    if (marker->deque && PushEntry(marker, wordPtr, parentPage)) {
+        return;
     }
-}
+#endif /* COL_USE_THREADS */
 
-/**
- * Word children enumeration function used to follow all children of a
- * reachable word during GC. Follows Col_CustomWordChildEnumProc()
- * signature.
- *
- * @see Col_CustomWordType
- * @see Col_CustomWordChildrenProc
- * @see MarkWord
- */
-static void
-MarkWordChild(
-    Col_Word word,              /*!< Custom word whose child is being
-                                     followed. */
-    Col_Word *childPtr,         /*!< Pointer to child, may be overwritten if
-                                     moved. */
-    Col_ClientData clientData)  /*!< Points to #GroupData */
-{
-    MarkWord((GroupData *) clientData, childPtr, CELL_PAGE(word));
+    PushStack(marker, wordPtr, parentPage);
 }
 
 /**
- * Mark word and all its children as reachable.
+ * Mark word as reachable and follow its children.
  *
- * The algorithm is recursive and stops when it reaches an already set
- * cell. This handles loops and references to older pools, where cells are
- * already set.
+ * Traversal stops when it reaches an already set cell. This handles loops
+ * and references to older pools, where cells are already set.
  *
- * To limit stack growth, tail recurses when possible using an infinite
- * loop with conditional return.
+ * Children are pushed on the marker's deque or mark stack (see MarkChild()),
+ * except the last one on which we iterate using an infinite loop with
+ * conditional return. The caller is responsible for marking pending
+ * entries afterwards with MarkPending().
+ *
+ * In parallel mode, cells are claimed atomically so that each word is
+ * followed by exactly one marker.
+ *
+ * @see MarkChildren
  */
 static void
 MarkWord(
-    GroupData *data,    /*!< Group-specific data. */
+    Marker *marker,     /*!< Marker. */
     Col_Word *wordPtr,  /*!< Word to mark and follow, overwritten if
                              promoted. */
     Page *parentPage)   /*!< Page containing wordPtr, will be set as modified
                              if overwritten. */
 {
 /*! \cond IGNORE */
+    MarkContext *context = marker->context;
+#ifdef PROMOTE_COMPACT
+    GroupData *data = context->data;
+#endif
     int type;
     size_t nbCells, index;
     Page *page;
@@ -783,8 +3700,15 @@ start:
          */
 
         Col_Word core = WORD_CIRCLIST_CORE(*wordPtr);
-        MarkWord(data, &core, parentPage);
-        *wordPtr = WORD_CIRCLIST_NEW(core);
+        MarkWord(marker, &core, parentPage);
+        if (core != WORD_CIRCLIST_CORE(*wordPtr)) {
+            /*
+             * Only write back moved cores, as parent pages may be
+             * write-protected.
+             */
+
+            *wordPtr = WORD_CIRCLIST_NEW(core);
+        }
         return;
     }
 
@@ -802,13 +3726,21 @@ start:
     }
 
     page = CELL_PAGE(*wordPtr);
-    if (PAGE_GENERATION(page) < PAGE_GENERATION(parentPage)
-            && !PAGE_FLAG(parentPage, PAGE_FLAG_PARENT)) {
+    if (PAGE_GENERATION(page) < PAGE_GENERATION(parentPage)) {
         /*
-         * Mark page as parent.
+         * Remember card, or mark page as parent if untracked. Tracked pages
+         * may be write-protected, so their header is left untouched.
          */
 
-        PAGE_SET_FLAG(parentPage, PAGE_FLAG_PARENT);
+        if (!RememberCard(marker, wordPtr, parentPage)
+                && !PAGE_FLAG(parentPage, PAGE_FLAG_PARENT)) {
+#ifdef COL_USE_THREADS
+            if (context->parallel) {
+                PlatAtomicOr((uintptr_t *) parentPage, PAGE_FLAG_PARENT);
+            } else
+#endif /* COL_USE_THREADS */
+            PAGE_SET_FLAG(parentPage, PAGE_FLAG_PARENT);
+        }
     }
 
     /*
@@ -849,51 +3781,111 @@ start:
         *wordPtr = promoted;
         TAIL_RECURSE(wordPtr, parentPage);
     }
+
+    if (data->evacuated && nbCells <= AVAILABLE_CELLS
+            && !WORD_PINNED(*wordPtr) && IsEvacuated(data, page)) {
+        /*
+         * Unpinned words from sparse pages are moved to fresh pages of the
+         * same generation, leaving a redirect as above. Words spanning
+         * several pages stay in place.
+         */
+
+        Col_Word evacuated = (Col_Word) PoolAllocCells(
+                &data->evacuatePools[PAGE_GENERATION(page)-2], nbCells);
+        memcpy((void *) evacuated, (const void *) *wordPtr,
+                nbCells * CELL_SIZE);
+        WORD_REDIRECT_INIT(*wordPtr, evacuated);
+        ClearCells(CELL_PAGE(evacuated), CELL_INDEX(evacuated), 1);
+        *wordPtr = evacuated;
+        TAIL_RECURSE(wordPtr, parentPage);
+    }
 #endif
 
-    ASSERT(!TestCell(page, index));
-    SetCells(page, index, (index+nbCells < CELLS_PER_PAGE ? nbCells
-            : CELLS_PER_PAGE-index));
+    if (index+nbCells > CELLS_PER_PAGE) {
+        nbCells = CELLS_PER_PAGE-index;
+    }
+#ifdef COL_USE_THREADS
+    if (context->parallel) {
+        /*
+         * Another marker may claim the word concurrently.
+         */
+
+        if (!SetCellsAtomic(page, index, nbCells)) {
+            return;
+        }
+    } else
+#endif /* COL_USE_THREADS */
+    {
+        ASSERT(!TestCell(page, index));
+        SetCells(page, index, nbCells);
+    }
     ASSERT(TestCell(page, index));
 
     /*
-     * Follow children.
+     * Follow children and tail recurse on the last one.
      */
 
-    switch (type) {
+    wordPtr = MarkChildren(marker, *wordPtr, page, 1);
+    if (wordPtr) {
+        TAIL_RECURSE(wordPtr, page);
+    }
+
+#undef TAIL_RECURSE
+/*! \endcond *//* IGNORE */
+}
+
+/**
+ * Mark children of a marked word. Children of weak words are only followed
+ * once marking is complete, when they belong to the collected generations:
+ * words from parent or rescanned pages hold them strongly.
+ *
+ * @return Pointer to the last child, on which the caller tail recurses, or
+ *         NULL.
+ *
+ * @see MarkWord
+ */
+static Col_Word *
+MarkChildren(
+    Marker *marker,     /*!< Marker. */
+    Col_Word word,      /*!< Word whose children to follow. */
+    Page *page,         /*!< Page containing word. */
+    int weak)           /*!< Whether word is newly marked, in which case weak
+                             words are remembered (see MarkWeakWords()). */
+{
+    switch (WORD_TYPE(word)) {
     case WORD_TYPE_WRAP:
-        if (!(WORD_WRAP_TYPE(*wordPtr) & (COL_INT | COL_FLOAT))) {
+        if (!(WORD_WRAP_TYPE(word) & (COL_INT | COL_FLOAT))) {
             /*
              * Follow source word.
              */
 
-            MarkWord(data, &WORD_WRAP_SOURCE(*wordPtr), page);
+            MarkChild(marker, &WORD_WRAP_SOURCE(word), page);
         }
 
         /*
          * Tail recurse on synonym.
          */
 
-        TAIL_RECURSE(&WORD_SYNONYM(*wordPtr), page);
+        return &WORD_SYNONYM(word);
 
     case WORD_TYPE_UCSSTR:
     case WORD_TYPE_UTFSTR:
-        return;
+        return NULL;
 
     case WORD_TYPE_SUBROPE:
         /*
          * Tail recurse on source.
          */
 
-        TAIL_RECURSE(&WORD_SUBROPE_SOURCE(*wordPtr), page);
+        return &WORD_SUBROPE_SOURCE(word);
 
     case WORD_TYPE_CONCATROPE:
         /*
          * Follow left arm and tail recurse on right.
          */
 
-        MarkWord(data, &WORD_CONCATROPE_LEFT(*wordPtr), page);
-        TAIL_RECURSE(&WORD_CONCATROPE_RIGHT(*wordPtr), page);
+        MarkChild(marker, &WORD_CONCATROPE_LEFT(word), page);
+        return &WORD_CONCATROPE_RIGHT(word);
 
     case WORD_TYPE_VECTOR:
     case WORD_TYPE_MVECTOR: {
@@ -901,12 +3893,12 @@ start:
          * Follow elements.
          */
 
-        size_t i, length = WORD_VECTOR_LENGTH(*wordPtr);
-        Col_Word *elements = WORD_VECTOR_ELEMENTS(*wordPtr);
+        size_t i, length = WORD_VECTOR_LENGTH(word);
+        Col_Word *elements = WORD_VECTOR_ELEMENTS(word);
         for (i = 0; i < length; i++) {
-            MarkWord(data, elements+i, page);
+            MarkChild(marker, elements+i, page);
         }
-        return;
+        return NULL;
         }
 
     case WORD_TYPE_SUBLIST:
@@ -914,7 +3906,7 @@ start:
          * Tail recurse on source.
          */
 
-        TAIL_RECURSE(&WORD_SUBLIST_SOURCE(*wordPtr), page);
+        return &WORD_SUBLIST_SOURCE(word);
 
     case WORD_TYPE_CONCATLIST:
     case WORD_TYPE_MCONCATLIST:
@@ -922,34 +3914,26 @@ start:
          * Follow left arm and tail recurse on right.
          */
 
-        MarkWord(data, &WORD_CONCATLIST_LEFT(*wordPtr), page);
-        TAIL_RECURSE(&WORD_CONCATLIST_RIGHT(*wordPtr), page);
+        MarkChild(marker, &WORD_CONCATLIST_LEFT(word), page);
+        return &WORD_CONCATLIST_RIGHT(word);
 
     case WORD_TYPE_STRHASHMAP:
     case WORD_TYPE_INTHASHMAP:
-        if (WORD_HASHMAP_BUCKETS(*wordPtr)) {
+        if (weak && WORD_HASHMAP_WEAKNESS(word)) {
             /*
-             * Buckets are stored in a separate word.
+             * Entries of weak maps are followed once marking is complete.
              */
 
-            MarkWord(data, &WORD_HASHMAP_BUCKETS(*wordPtr), page);
+            RememberWeakWord(marker, word);
         } else {
-            /*
-             * Buckets are stored inline.
-             */
-
-            size_t i;
-            Col_Word *buckets = WORD_HASHMAP_STATICBUCKETS(*wordPtr);
-            for (i = 0; i < HASHMAP_STATICBUCKETS_SIZE; i++) {
-                MarkWord(data, buckets+i, page);
-            }
+            MarkBuckets(marker, word, page);
         }
 
         /*
          * Tail recurse on synonym.
          */
 
-        TAIL_RECURSE(&WORD_SYNONYM(*wordPtr), page);
+        return &WORD_SYNONYM(word);
 
     case WORD_TYPE_HASHENTRY:
     case WORD_TYPE_MHASHENTRY:
@@ -957,7 +3941,7 @@ start:
          * Follow key.
          */
 
-        MarkWord(data, &WORD_MAPENTRY_KEY(*wordPtr), page);
+        MarkChild(marker, &WORD_MAPENTRY_KEY(word), page);
         /* continued. */
     case WORD_TYPE_INTHASHENTRY:
     case WORD_TYPE_MINTHASHENTRY:
@@ -965,8 +3949,8 @@ start:
          * Follow value and tail recurse on next.
          */
 
-        MarkWord(data, &WORD_MAPENTRY_VALUE(*wordPtr), page);
-        TAIL_RECURSE(&WORD_HASHENTRY_NEXT(*wordPtr), page);
+        MarkChild(marker, &WORD_MAPENTRY_VALUE(word), page);
+        return &WORD_HASHENTRY_NEXT(word);
 
     case WORD_TYPE_STRTRIEMAP:
     case WORD_TYPE_INTTRIEMAP:
@@ -974,8 +3958,8 @@ start:
          * Follow trie root and tail recurse on synonym.
          */
 
-        MarkWord(data, &WORD_TRIEMAP_ROOT(*wordPtr), page);
-        TAIL_RECURSE(&WORD_SYNONYM(*wordPtr), page);
+        MarkChild(marker, &WORD_TRIEMAP_ROOT(word), page);
+        return &WORD_SYNONYM(word);
 
     case WORD_TYPE_STRTRIENODE:
     case WORD_TYPE_MSTRTRIENODE:
@@ -987,8 +3971,8 @@ start:
          * Follow left arm and tail recurse on right.
          */
 
-        MarkWord(data, &WORD_TRIENODE_LEFT(*wordPtr), page);
-        TAIL_RECURSE(&WORD_TRIENODE_RIGHT(*wordPtr), page);
+        MarkChild(marker, &WORD_TRIENODE_LEFT(word), page);
+        return &WORD_TRIENODE_RIGHT(word);
 
     case WORD_TYPE_TRIELEAF:
     case WORD_TYPE_MTRIELEAF:
@@ -996,7 +3980,7 @@ start:
          * Follow key.
          */
 
-        MarkWord(data, &WORD_MAPENTRY_KEY(*wordPtr), page);
+        MarkChild(marker, &WORD_MAPENTRY_KEY(word), page);
         /* continued. */
     case WORD_TYPE_INTTRIELEAF:
     case WORD_TYPE_MINTTRIELEAF:
@@ -1004,17 +3988,33 @@ start:
          * Tail recurse on value.
          */
 
-        TAIL_RECURSE(&WORD_MAPENTRY_VALUE(*wordPtr), page);
+        return &WORD_MAPENTRY_VALUE(word);
 
     case WORD_TYPE_STRBUF:
         /*
          * Tail recurse on rope.
          */
 
-        TAIL_RECURSE(&WORD_STRBUF_ROPE(*wordPtr), page);
+        return &WORD_STRBUF_ROPE(word);
+
+    case WORD_TYPE_WEAKREF:
+        if (weak) {
+            /*
+             * Value is followed once marking is complete.
+             */
+
+            RememberWeakWord(marker, word);
+            return NULL;
+        }
+
+        /*
+         * Tail recurse on value.
+         */
+
+        return &WORD_WEAKREF_VALUE(word);
 
     case WORD_TYPE_CUSTOM: {
-        Col_CustomWordType *typeInfo = WORD_TYPEINFO(*wordPtr);
+        Col_CustomWordType *typeInfo = WORD_TYPEINFO(word);
 
         /*
          * Handle type-specific children.
@@ -1022,23 +4022,7 @@ start:
 
         switch (typeInfo->type) {
         case COL_HASHMAP:
-            if (WORD_HASHMAP_BUCKETS(*wordPtr)) {
-                /*
-                 * Buckets are stored in a separate word.
-                 */
-
-                MarkWord(data, &WORD_HASHMAP_BUCKETS(*wordPtr), page);
-            } else {
-                /*
-                 * Buckets are stored inline.
-                 */
-
-                size_t i;
-                Col_Word *buckets = WORD_HASHMAP_STATICBUCKETS(*wordPtr);
-                for (i = 0; i < HASHMAP_STATICBUCKETS_SIZE; i++) {
-                    MarkWord(data, buckets+i, page);
-                }
-            }
+            MarkBuckets(marker, word, page);
             break;
 
         case COL_TRIEMAP:
@@ -1046,7 +4030,7 @@ start:
              * Follow trie root.
              */
 
-            MarkWord(data, &WORD_TRIEMAP_ROOT(*wordPtr), page);
+            MarkChild(marker, &WORD_TRIEMAP_ROOT(word), page);
             break;
         }
 
@@ -1055,14 +4039,14 @@ start:
              * Follow children.
              */
 
-            typeInfo->childrenProc(*wordPtr, MarkWordChild, data);
+            typeInfo->childrenProc(word, MarkWordChild, marker);
         }
 
         /*
          * Tail recurse on synonym.
          */
 
-        TAIL_RECURSE(&WORD_SYNONYM(*wordPtr), page);
+        return &WORD_SYNONYM(word);
         }
 
     /* WORD_TYPE_UNKNOWN */
@@ -1070,11 +4054,364 @@ start:
     default:
         /* CANTHAPPEN */
         ASSERT(0);
-        return;
+        return NULL;
     }
+}
 
-#undef TAIL_RECURSE
-/*! \endcond *//* IGNORE */
+/**
+ * Mark buckets of a hash map, and the entries they hold.
+ *
+ * @see MarkChildren
+ */
+static void
+MarkBuckets(
+    Marker *marker,     /*!< Marker. */
+    Col_Word map,       /*!< Hash map whose buckets to follow. */
+    Page *page)         /*!< Page containing map. */
+{
+    if (WORD_HASHMAP_BUCKETS(map)) {
+        /*
+         * Buckets are stored in a separate word.
+         */
+
+        MarkChild(marker, &WORD_HASHMAP_BUCKETS(map), page);
+    } else {
+        /*
+         * Buckets are stored inline.
+         */
+
+        size_t i;
+        Col_Word *buckets = WORD_HASHMAP_STATICBUCKETS(map);
+        for (i = 0; i < HASHMAP_STATICBUCKETS_SIZE; i++) {
+            MarkChild(marker, buckets+i, page);
+        }
+    }
+}
+
+/**
+ * Remember weak word whose children are followed once marking is complete.
+ *
+ * @see MarkWeakWords
+ */
+static void
+RememberWeakWord(
+    Marker *marker,     /*!< Marker. */
+    Col_Word word)      /*!< Weak reference or weak hash map. */
+{
+    marker->weakWords = (Col_Word *) GrowArray(marker->weakWords,
+            &marker->weakWordsSize, marker->nbWeakWords, sizeof(Col_Word));
+    marker->weakWords[marker->nbWeakWords++] = word;
+}
+
+/**
+ * Follow weak words remembered by all markers once all other reachable
+ * cells are marked.
+ *
+ * Entries of weak hash maps whose weak parts are reachable get their other
+ * parts marked, which may in turn make entries of other maps reachable: this
+ * is repeated until no more entry gets marked (ephemerons). Remaining
+ * entries are then removed, and weak references to unreachable words are
+ * cleared. Reachable parts and values are followed as regular children so
+ * that moved words get updated and cards get remembered.
+ *
+ * @see RememberWeakWord
+ * @see MarkEphemerons
+ * @see PruneWeakHashMap
+ */
+static void
+MarkWeakWords(
+    Marker *marker)     /*!< Marker, run serially. */
+{
+    MarkContext *context = marker->context;
+    GroupData *data = context->data;
+    Marker *other;
+    Col_Word word;
+    size_t m, i;
+    int marked;
+
+    /*
+     * Gather weak words from all markers, including the mark slices of the
+     * incremental cycle being finished.
+     */
+
+    for (m = 0; m <= context->nbMarkers; m++) {
+        if (m < context->nbMarkers) {
+            other = context->markers+m;
+        } else if (context->cycle) {
+            other = &context->cycle->marker;
+        } else {
+            break;
+        }
+        if (other == marker) continue;
+
+        for (i = 0; i < other->nbWeakWords; i++) {
+            RememberWeakWord(marker, other->weakWords[i]);
+        }
+    }
+
+    /*
+     * Mark entries of weak hash maps until no more entry gets marked. Weak
+     * words found in the process are appended to the list.
+     */
+
+    do {
+        marked = 0;
+        for (i = 0; i < marker->nbWeakWords; i++) {
+            word = marker->weakWords[i];
+            if (WORD_TYPE(word) != WORD_TYPE_WEAKREF
+                    && MarkEphemerons(marker, word)) {
+                MarkPending(marker);
+                marked = 1;
+            }
+        }
+    } while (marked);
+
+    /*
+     * Remove unreachable entries and follow remaining ones, then clear weak
+     * references to unreachable words.
+     */
+
+    for (i = 0; i < marker->nbWeakWords; i++) {
+        word = marker->weakWords[i];
+        if (WORD_TYPE(word) != WORD_TYPE_WEAKREF) {
+            PruneWeakHashMap(data, word);
+            MarkBuckets(marker, word, CELL_PAGE(word));
+            MarkPending(marker);
+        }
+    }
+    for (i = 0; i < marker->nbWeakWords; i++) {
+        word = marker->weakWords[i];
+        if (WORD_TYPE(word) == WORD_TYPE_WEAKREF) {
+            if (IsReachable(data, WORD_WEAKREF_VALUE(word))) {
+                MarkChild(marker, &WORD_WEAKREF_VALUE(word), CELL_PAGE(word));
+                MarkPending(marker);
+            } else {
+                WORD_WEAKREF_VALUE(word) = WORD_NIL;
+            }
+        }
+    }
+}
+
+/**
+ * Mark parts of weak hash map entries whose weak parts are reachable.
+ *
+ * @retval <>0  if words were marked.
+ * @retval 0    otherwise.
+ *
+ * @see MarkWeakWords
+ */
+static int
+MarkEphemerons(
+    Marker *marker,     /*!< Marker. */
+    Col_Word map)       /*!< Weak hash map. */
+{
+    GroupData *data = marker->context->data;
+    int weakness = WORD_HASHMAP_WEAKNESS(map), marked = 0;
+    int keyReachable, valueReachable;
+    Col_Word *buckets, *entryPtr, entry;
+    Page *bucketsPage, *page;
+    size_t nbBuckets, i;
+
+    buckets = GetWeakBuckets(map, &nbBuckets, &bucketsPage);
+    for (i = 0; i < nbBuckets; i++) {
+        for (entryPtr = buckets+i, page = bucketsPage;
+                FollowRedirect(entryPtr);
+                entryPtr = &WORD_HASHENTRY_NEXT(entry),
+                page = CELL_PAGE(entry)) {
+            entry = *entryPtr;
+            if (WORD_TYPE(entry) == WORD_TYPE_HASHENTRY
+                    || WORD_TYPE(entry) == WORD_TYPE_INTHASHENTRY) {
+                /*
+                 * Frozen entries are shared with copies of the map and hold
+                 * their parts strongly, along with the remaining ones.
+                 */
+
+                if (!IsReachable(data, entry)) {
+                    MarkChild(marker, entryPtr, page);
+                    marked = 1;
+                }
+                break;
+            }
+
+            keyReachable = (WORD_TYPE(map) == WORD_TYPE_INTHASHMAP
+                    || IsReachable(data, WORD_MAPENTRY_KEY(entry)));
+            valueReachable = IsReachable(data, WORD_MAPENTRY_VALUE(entry));
+            if ((!keyReachable && (weakness & COL_WEAK_KEYS))
+                    || (!valueReachable && (weakness & COL_WEAK_VALUES))) {
+                /*
+                 * Entry is not reachable, at least not yet.
+                 */
+
+                continue;
+            }
+
+            if (!keyReachable) {
+                MarkChild(marker, &WORD_MAPENTRY_KEY(entry), CELL_PAGE(entry));
+                marked = 1;
+            }
+            if (!valueReachable) {
+                MarkChild(marker, &WORD_MAPENTRY_VALUE(entry),
+                        CELL_PAGE(entry));
+                marked = 1;
+            }
+        }
+    }
+    return marked;
+}
+
+/**
+ * Remove entries whose weak parts are unreachable from weak hash map.
+ *
+ * Only mutable entries get removed, as frozen ones are shared with copies
+ * of the map (see Col_CopyHashMap()). Weak maps are only remembered when
+ * newly marked, so the words holding these entries were either collected
+ * or moved by the current GC.
+ *
+ * @see MarkWeakWords
+ */
+static void
+PruneWeakHashMap(
+    GroupData *data,    /*!< Group-specific data. */
+    Col_Word map)       /*!< Weak hash map. */
+{
+    int weakness = WORD_HASHMAP_WEAKNESS(map);
+    Col_Word *buckets, *entryPtr, entry;
+    Page *bucketsPage;
+    size_t nbBuckets, i;
+
+    buckets = GetWeakBuckets(map, &nbBuckets, &bucketsPage);
+    for (i = 0; i < nbBuckets; i++) {
+        entryPtr = buckets+i;
+        while (FollowRedirect(entryPtr)) {
+            entry = *entryPtr;
+            if (WORD_TYPE(entry) == WORD_TYPE_HASHENTRY
+                    || WORD_TYPE(entry) == WORD_TYPE_INTHASHENTRY) {
+                /*
+                 * Frozen entries are shared, stop there.
+                 */
+
+                break;
+            }
+            if (((weakness & COL_WEAK_KEYS)
+                    && !IsReachable(data, WORD_MAPENTRY_KEY(entry)))
+                    || ((weakness & COL_WEAK_VALUES)
+                    && !IsReachable(data, WORD_MAPENTRY_VALUE(entry)))) {
+                /*
+                 * Unlink entry.
+                 */
+
+                *entryPtr = WORD_HASHENTRY_NEXT(entry);
+                WORD_HASHMAP_SIZE(map)--;
+            } else {
+                entryPtr = &WORD_HASHENTRY_NEXT(entry);
+            }
+        }
+    }
+}
+
+/**
+ * Get bucket array of weak hash map.
+ *
+ * @return The bucket array.
+ */
+static Col_Word *
+GetWeakBuckets(
+    Col_Word map,           /*!< Weak hash map. */
+
+    /*! [out] Number of buckets. */
+    size_t *nbBucketsPtr,
+
+    /*! [out] Page containing the bucket array. */
+    Page **pagePtr)
+{
+    Col_Word buckets;
+
+    if (!WORD_HASHMAP_BUCKETS(map)) {
+        *nbBucketsPtr = HASHMAP_STATICBUCKETS_SIZE;
+        *pagePtr = CELL_PAGE(map);
+        return WORD_HASHMAP_STATICBUCKETS(map);
+    }
+
+    buckets = FollowRedirect(&WORD_HASHMAP_BUCKETS(map));
+    *pagePtr = CELL_PAGE(buckets);
+    *nbBucketsPtr = WORD_VECTOR_LENGTH(buckets);
+    return WORD_VECTOR_ELEMENTS(buckets);
+}
+
+/**
+ * Update reference to a word moved during the mark phase, if any. Words
+ * are moved when marked from another reference.
+ *
+ * @return The updated reference.
+ */
+static Col_Word
+FollowRedirect(
+    Col_Word *wordPtr)  /*!< Reference to update. */
+{
+#ifdef PROMOTE_COMPACT
+    if (WORD_TYPE(*wordPtr) == WORD_TYPE_REDIRECT) {
+        *wordPtr = WORD_REDIRECT_SOURCE(*wordPtr);
+    }
+#endif
+    return *wordPtr;
+}
+
+/**
+ * Test whether a word is reachable once marking is complete, i.e.\ whether
+ * it is immediate, from an uncollected generation, marked, or moved.
+ *
+ * @retval <>0  if word is reachable.
+ * @retval 0    otherwise.
+ */
+static int
+IsReachable(
+    GroupData *data,    /*!< Group-specific data. */
+    Col_Word word)      /*!< Word to test. */
+{
+    Page *page;
+
+    if (!word || ((uintptr_t) word & 15)) {
+        /*
+         * Immediate word (see #WORD_TYPE). Only circular lists have a
+         * cell-based core.
+         */
+
+        if (WORD_TYPE(word) != WORD_TYPE_CIRCLIST) return 1;
+        return IsReachable(data, WORD_CIRCLIST_CORE(word));
+    }
+
+#ifdef PROMOTE_COMPACT
+    if (WORD_TYPE(word) == WORD_TYPE_REDIRECT) return 1;
+#endif
+
+    page = CELL_PAGE(word);
+    return (PAGE_GENERATION(page) > data->maxCollectedGeneration
+            || TestCell(page, CELL_INDEX(word)));
+}
+
+/**
+ * Get the header size of custom words, which depends on their type.
+ *
+ * @return The header size in bytes.
+ *
+ * @see WORD_CUSTOM_NEXT
+ * @see WORD_CUSTOM_DATA
+ * @see WORD_CUSTOM_SIZE
+ */
+size_t
+CustomHeaderSize(
+    Col_CustomWordType *type)   /*!< The word type. */
+{
+    switch (type->type) {
+    case COL_HASHMAP:
+        return CUSTOMHASHMAP_HEADER_SIZE;
+
+    case COL_TRIEMAP:
+        return CUSTOMTRIEMAP_HEADER_SIZE;
+
+    default:
+        return CUSTOM_HEADER_SIZE;
+    }
 }
 
 /**
@@ -1098,20 +4435,46 @@ RememberSweepable(
     ASSERT(PAGE_GENERATION(CELL_PAGE(word)) == 1);
     ASSERT(WORD_TYPE(word) == WORD_TYPE_CUSTOM);
     ASSERT(type->freeProc);
-    switch (type->type) {
-    case COL_HASHMAP: headerSize = CUSTOMHASHMAP_HEADER_SIZE;
-    case COL_TRIEMAP: headerSize = CUSTOMTRIEMAP_HEADER_SIZE;
-    default:          headerSize = CUSTOM_HEADER_SIZE;
+    headerSize = CustomHeaderSize(type);
+    WORD_CUSTOM_NEXT(word, type, headerSize) = data->eden.sweepables;
+    data->eden.sweepables = word;
+}
+
+/**
+ * Keep cells of words queued for finalization by a previous collection of
+ * the current GC allocated, as bitmasks of collected pools were reset since.
+ *
+ * @see SweepUnreachableCells
+ * @see FinalizeWords
+ */
+static void
+KeepQueuedWords(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    Col_Word word;
+    Col_CustomWordType *type;
+    size_t headerSize;
+
+    for (word = data->finalizables; word;
+            word = WORD_CUSTOM_NEXT(word, type, headerSize)) {
+        type = WORD_TYPEINFO(word);
+        headerSize = CustomHeaderSize(type);
+        if (PAGE_GENERATION(CELL_PAGE(word)) <= data->maxCollectedGeneration) {
+            SetCells(CELL_PAGE(word), CELL_INDEX(word),
+                    GetNbPageCells(word));
+        }
     }
-    WORD_CUSTOM_NEXT(word, type, headerSize) = data->eden.sweepables;
-    data->eden.sweepables = word;
 }
 
 /**
  * Perform cleanup for all collected custom words that need sweeping.
  *
+ * When #COL_GC_ASYNC_FINALIZE is enabled, collected words are queued for
+ * FinalizeWords() instead. Their cells are kept allocated until then, so
+ * they stay in place.
+ *
  * @sideeffect
- *      Calls each cleaned word's freeProc.
+ *      Calls each cleaned word's freeProc, or queues the word.
  *
  * @see Col_CustomWordType
  * @see Col_CustomWordFreeProc
@@ -1135,10 +4498,11 @@ SweepUnreachableCells(
          */
 
 #ifdef PROMOTE_COMPACT
-        if (pool->generation == data->compactGeneration
+        if ((pool->generation == data->compactGeneration
+                || data->evacuated)
                 && WORD_TYPE(word) == WORD_TYPE_REDIRECT) {
             /*
-             * Word was redirected.
+             * Word was redirected, either promoted or evacuated.
              */
 
             word = WORD_REDIRECT_SOURCE(word);
@@ -1147,24 +4511,31 @@ SweepUnreachableCells(
         ASSERT(WORD_TYPE(word) == WORD_TYPE_CUSTOM);
         type = WORD_TYPEINFO(word);
         ASSERT(type->freeProc);
-        switch (type->type) {
-        case COL_HASHMAP: headerSize = CUSTOMHASHMAP_HEADER_SIZE;
-        case COL_TRIEMAP: headerSize = CUSTOMTRIEMAP_HEADER_SIZE;
-        default:          headerSize = CUSTOM_HEADER_SIZE;
-        }
+        headerSize = CustomHeaderSize(type);
 
         if (!TestCell(CELL_PAGE(word), CELL_INDEX(word))) {
-            /*
-             * Cleanup.
-             */
-
-            type->freeProc(word);
-
             /*
              * Remove from list.
              */
 
             *previousPtr = WORD_CUSTOM_NEXT(word, type, headerSize);
+
+            if (data->asyncFinalize) {
+                /*
+                 * Queue for finalization, keeping cells allocated.
+                 */
+
+                SetCells(CELL_PAGE(word), CELL_INDEX(word),
+                        GetNbPageCells(word));
+                WORD_CUSTOM_NEXT(word, type, headerSize) = data->finalizables;
+                data->finalizables = word;
+            } else {
+                /*
+                 * Cleanup.
+                 */
+
+                type->freeProc(word);
+            }
         } else {
             /*
              * Keep, updating reference in case of redirection.
@@ -1217,35 +4588,139 @@ CleanupSweepables(
         ASSERT(WORD_TYPE(word) == WORD_TYPE_CUSTOM);
         type = WORD_TYPEINFO(word);
         ASSERT(type->freeProc);
-        switch (type->type) {
-        case COL_HASHMAP: headerSize = CUSTOMHASHMAP_HEADER_SIZE;
-        case COL_TRIEMAP: headerSize = CUSTOMTRIEMAP_HEADER_SIZE;
-        default:          headerSize = CUSTOM_HEADER_SIZE;
-        }
+        headerSize = CustomHeaderSize(type);
         type->freeProc(word);
     }
 }
 
+/**
+ * Call freeProcs of custom words queued by the last GC, then free their
+ * cells. This runs outside of GC pauses: upon leaving the GC-protected
+ * section with #COL_SINGLE, else on the GC worker while other threads run.
+ * The caller counts as a thread within a GC-protected section, so that no
+ * GC starts before queued words are finalized.
+ *
+ * @sideeffect
+ *      Calls each queued word's freeProc. Pools holding queued words get
+ *      swept again.
+ *
+ * @see COL_GC_ASYNC_FINALIZE
+ * @see SweepUnreachableCells
+ * @see SyncResumeGC
+ */
+void
+FinalizeWords(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    Col_Word word, next;
+    Col_CustomWordType *type;
+    MemoryPool *pool;
+    size_t headerSize, nbCells;
+    unsigned int generation, generations = 0;
+
+    for (;;) {
+        /*
+         * Take the whole queue at once, as thread-local collections may
+         * queue more words meanwhile (see PerformLocalGC()).
+         */
+
+        EnterProtectRoots(data);
+        word = data->finalizables;
+        data->finalizables = WORD_NIL;
+        LeaveProtectRoots(data);
+        if (!word) break;
+
+        for (; word; word = next) {
+            ASSERT(WORD_TYPE(word) == WORD_TYPE_CUSTOM);
+            type = WORD_TYPEINFO(word);
+            ASSERT(type->freeProc);
+            headerSize = CustomHeaderSize(type);
+            next = WORD_CUSTOM_NEXT(word, type, headerSize);
+            nbCells = GetNbPageCells(word);
+            generation = PAGE_GENERATION(CELL_PAGE(word));
+            ASSERT(generation >= 2);
+
+            type->freeProc(word);
+
+            /*
+             * Free cells. Pages of older generations may be swept lazily by
+             * other threads meanwhile (see SweepPendingPages()).
+             */
+
+            EnterProtectRoots(data);
+            ClearCells(CELL_PAGE(word), CELL_INDEX(word), nbCells);
+            LeaveProtectRoots(data);
+            generations |= (1 << generation);
+        }
+    }
+
+    if (!generations) return;
+
+    /*
+     * Pool counters still include freed cells. Sweep pools again so that
+     * counters get updated and empty pages freed, as after collections.
+     */
+
+    EnterProtectRoots(data);
+    for (generation = 2; generation < GC_MAX_GENERATIONS; generation++) {
+        if (!(generations & (1 << generation))) continue;
+
+        pool = &data->pools[generation-2];
+        PoolSweepPages(pool, 0);
+        pool->nbPages = 0;
+        pool->nbSetCells = 0;
+        PoolStartSweep(pool, NULL);
+        data->sweepPending = 1;
+    }
+    LeaveProtectRoots(data);
+}
+
 /**
  * Promote non-empty pages to the next pool. This simply move the pool's
  * pages to the target pool.
+ *
+ * Pages from older generation pools have not been swept yet: they are
+ * promoted as is, and swept lazily in the target pool, where they get
+ * accounted once swept.
+ *
+ * @see PoolStartSweep
+ * @see SweepPendingPages
  */
 static void
 PromotePages(
     GroupData *data,    /*!< Group-specific data. */
     MemoryPool *pool)   /*!< The pool to promote page for. */
 {
-    Page *page;
+    Page *page, *end = NULL;
     size_t i;
     MemoryPool *nextPool;
-    int parent;
+    int untracked;
 
-    ASSERT(pool->generation <= data->maxCollectedGeneration);
+    ASSERT(pool->generation == 1
+            || pool->generation <= data->maxCollectedGeneration);
     if (pool->generation+1 >= GC_MAX_GENERATIONS) {
         /*
-         * Can't promote past the last possible generation.
+         * Can't promote past the last possible generation. Sweep pages in
+         * place. Pages were unprotected when clearing bitmasks, so protect
+         * pages without untracked parents again for proper parent
+         * tracking.
          */
 
+        if (pool->generation >= 2) {
+            untracked = 0;
+            for (page = pool->pages; page; page = PAGE_NEXT(page)) {
+                untracked |= IsUntrackedParent(data, page);
+                if (PAGE_FLAG(page, PAGE_FLAG_LAST)) {
+                    if (!untracked) SysPageProtect(page, 1);
+                    untracked = 0;
+                }
+            }
+
+            pool->nbPages = 0;
+            pool->nbSetCells = 0;
+            PoolStartSweep(pool, NULL);
+            data->sweepPending = 1;
+        }
         return;
     }
 
@@ -1258,14 +4733,22 @@ PromotePages(
     }
 
     /*
-     * Update promoted pages' generation, and protect pages without parents.
+     * Update promoted pages' generation, and protect pages without untracked
+     * parents.
      */
 
-    parent = 0;
+    untracked = 0;
     for (page = pool->pages; page; page = PAGE_NEXT(page)) {
         ASSERT(PAGE_GENERATION(page) == pool->generation);
         PAGE_SET_GENERATION(page, pool->generation+1);
-        parent |= PAGE_FLAG(page, PAGE_FLAG_PARENT);
+        if (pool->generation == 1) {
+            /*
+             * Eden pages no longer belong to their owner thread.
+             */
+
+            PAGE_GROUPDATA(page) = data;
+        }
+        untracked |= IsUntrackedParent(data, page);
         if (PAGE_FLAG(page, PAGE_FLAG_LAST)) {
             if (!PAGE_NEXT(page)) {
                 /*
@@ -1276,27 +4759,42 @@ PromotePages(
                 ASSERT(page == pool->lastPage);
                 break;
             }
-            if (!parent) SysPageProtect(page, 1);
-            parent = 0;
+            if (!untracked) SysPageProtect(page, 1);
+            untracked = 0;
         }
     }
 
     /*
      * Move the promoted pages to the head of the target pool's page list.
-     * Note that root & parent lists are already updated at this point.
+     * Note that root list & remembered set are already updated at this point.
      */
 
     ASSERT(pool->lastPage);
     nextPool = &data->pools[pool->generation-1];
+    if (pool->generation >= 2) {
+        /*
+         * Target pool may already be pending sweep from this GC, in which
+         * case no page was swept yet and the range is extended.
+         */
+
+        end = (nextPool->sweepPage ? nextPool->sweepEnd : nextPool->pages);
+        nextPool->sweepPage = NULL;
+    }
     PAGE_SET_NEXT(pool->lastPage, nextPool->pages);
-    if (!parent) SysPageProtect(pool->lastPage, 1);
+    if (!untracked) SysPageProtect(pool->lastPage, 1);
     nextPool->pages = pool->pages;
     if (!nextPool->lastPage) {
         nextPool->lastPage = pool->lastPage;
     }
-    nextPool->nbPages += pool->nbPages;
     nextPool->nbAlloc += pool->nbPages;
-    nextPool->nbSetCells += pool->nbSetCells;
+    nextPool->totalAlloc += pool->nbPages;
+    if (pool->generation >= 2) {
+        PoolStartSweep(nextPool, end);
+        data->sweepPending = 1;
+    } else {
+        nextPool->nbPages += pool->nbPages;
+        nextPool->nbSetCells += pool->nbSetCells;
+    }
     for (i = 0; i < AVAILABLE_CELLS; i++) {
         nextPool->lastFreeCell[i] = PAGE_CELL(nextPool->pages, 0);
     }
@@ -1319,9 +4817,11 @@ ResetPool(
 
     pool->nbAlloc = 0;
     pool->gc = 0;
+    pool->nbCollections++;
     for (i = 0; i < AVAILABLE_CELLS; i++) {
         pool->lastFreeCell[i] = PAGE_CELL(pool->pages, 0);
     }
+    pool->cursor = pool->limit = NULL;
 }
 
 /** @endcond @endprivate */
@@ -1341,44 +4841,21 @@ ResetPool(
  * Word Lifetime Management
  ******************************************************************************/
 
+/** @beginprivate @cond PRIVATE */
+
 /**
- * Preserve a persistent reference to a word, making it a root. This allows
- * words to be safely stored in external structures regardless of memory
- * management cycles. More specifically, they can't be collected and their
- * address remains constant.
+ * Get the source of the root to create or remove for a word.
  *
- * Calls can be nested. A reference count is updated accordingly.
- *
- * Roots are stored in a trie indexed by the root source addresses.
- *
- * @pre
- *      Must be called within a GC-protected section.
- *
- * @sideeffect
- *      May allocate memory cells. Marks word as pinned.
+ * @return The cell-based word to use as root source, or nil for immediate
+ *         values that need no root.
  *
+ * @see Col_WordPreserve
  * @see Col_WordRelease
  */
-void
-Col_WordPreserve(
-    Col_Word word)  /*!< The word to preserve. */
+static Col_Word
+RootSource(
+    Col_Word word)  /*!< The word to get source for. */
 {
-    ThreadData *data = PlatGetThreadData();
-    Cell *node, *leaf, *parent, *newParent;
-    Col_Word leafSource;
-    uintptr_t mask;
-
-    /*
-     * Check preconditions.
-     */
-
-    /*! @error{COL_ERROR_GCPROTECT} */
-    PRECONDITION_GCPROTECTED(data) return;
-
-    /*
-     * Rule out immediate values.
-     */
-
     switch (WORD_TYPE(word)) {
     case WORD_TYPE_NIL:
     case WORD_TYPE_SMALLINT:
@@ -1390,159 +4867,467 @@ Col_WordPreserve(
          * Immediate values.
          */
 
-        return;
+        return WORD_NIL;
 
     case WORD_TYPE_CIRCLIST:
         /*
-         * Preserve core list.
+         * Use core list.
          */
 
-        Col_WordPreserve(WORD_CIRCLIST_CORE(word));
-        return;
+        return RootSource(WORD_CIRCLIST_CORE(word));
 
         /* WORD_TYPE_UNKNOWN */
     }
 
+    return word;
+}
+
+/**
+ * Get the node from which to search the root trie for a given source. Keys
+ * in the subtrie of an internal node share all bits above its critical bit,
+ * so the search can start from the lowest ancestor of the finger node whose
+ * critical bit is above the highest bit that differs between the source and
+ * the finger key. Searching sorted sources this way only visits the part of
+ * the trie that differs between consecutive sources.
+ *
+ * @return The node to start searching from.
+ *
+ * @see PreserveRoot
+ * @see ReleaseRoot
+ */
+static Cell *
+RootSearchStart(
+    GroupData *data,    /*!< Group-specific data. */
+    Col_Word word,      /*!< Searched source. */
+    Cell *finger,       /*!< Internal node to start from, NULL for trie
+                             root. */
+    Col_Word fingerKey) /*!< Key sharing the prefix of **finger**'s
+                             subtrie. */
+{
+    uintptr_t diff = (uintptr_t) word ^ (uintptr_t) fingerKey;
+    while (finger && ROOT_NODE_MASK(finger) <= diff) {
+        finger = ROOT_PARENT(finger);
+    }
+    return (finger ? finger : data->roots);
+}
+
+/**
+ * Insert root into trie or increment its reference count. Must be called
+ * with root management structures protected.
+ *
+ * @return The finger node for the next search.
+ *
+ * @sideeffect
+ *      May allocate memory cells. Marks word as pinned.
+ *
+ * @see RootSearchStart
+ * @see Col_WordPreserve
+ * @see Col_WordPreserveA
+ */
+static Cell *
+PreserveRoot(
+    GroupData *data,    /*!< Group-specific data. */
+    Col_Word word,      /*!< Root source, see RootSource(). */
+    Cell *finger,       /*!< Finger node, see RootSearchStart(). */
+    Col_Word fingerKey) /*!< Finger key, see RootSearchStart(). */
+{
+    Cell *start, *node, *leaf, *parent, *newParent;
+    Col_Word leafSource;
+    uintptr_t mask;
+
+#ifdef COL_USE_THREADS
+    if (PAGE_GENERATION(CELL_PAGE(word)) == 1) {
+        /*
+         * Preserved eden words are published: their thread can no longer
+         * collect its eden locally.
+         */
+
+        PAGE_THREADDATA(CELL_PAGE(word))->published = 1;
+    }
+#endif /* COL_USE_THREADS */
+
     /*
      * Search for matching entry in root trie.
      */
 
-    EnterProtectRoots(data->groupData);
-    {
-        node = data->groupData->roots;
-        while (node) {
-            if (!ROOT_IS_LEAF(node)) {
-                if ((uintptr_t) word & ROOT_NODE_MASK(node)) {
-                    /*
-                     * Recurse on right.
-                     */
+    start = node = RootSearchStart(data, word, finger, fingerKey);
+    while (node) {
+        if (!ROOT_IS_LEAF(node)) {
+            if ((uintptr_t) word & ROOT_NODE_MASK(node)) {
+                /*
+                 * Recurse on right.
+                 */
 
-                    node = ROOT_NODE_RIGHT(node);
-                } else {
-                    /*
-                     * Recurse on left.
-                     */
+                node = ROOT_NODE_RIGHT(node);
+            } else {
+                /*
+                 * Recurse on left.
+                 */
 
-                    node = ROOT_NODE_LEFT(node);
-                }
-                continue;
+                node = ROOT_NODE_LEFT(node);
             }
+            continue;
+        }
 
+        /*
+         * Leaf node.
+         */
+
+        ASSERT(ROOT_IS_LEAF(node));
+        node = ROOT_GET_NODE(node);
+        leafSource = ROOT_LEAF_SOURCE(node);
+        if (word == leafSource) {
             /*
-             * Leaf node.
+             * Found! Increment reference count.
              */
 
-            ASSERT(ROOT_IS_LEAF(node));
-            node = ROOT_GET_NODE(node);
-            leafSource = ROOT_LEAF_SOURCE(node);
-            if (word == leafSource) {
+            ASSERT(WORD_PINNED(word));
+            ROOT_LEAF_REFCOUNT(node)++;
+            return ROOT_PARENT(node);
+        }
+        break;
+    }
+
+    /*
+     * Not found, insert. Pin the word so that its address doesn't change
+     * during compaction.
+     */
+
+    WORD_SET_PINNED(word);
+
+    leaf = PoolAllocCells(&data->rootPool, 1);
+    ROOT_LEAF_INIT(leaf, NULL, PAGE_GENERATION(CELL_PAGE(word)), 1, word);
+
+    if (!data->roots) {
+        /*
+         * First leaf.
+         */
+
+        data->roots = ROOT_GET_LEAF(leaf);
+        return NULL;
+    }
+
+    /*
+     * Get diff mask between inserted key and existing leaf key, i.e. only
+     * keep the highest bit set.
+     * See: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
+     */
+
+    mask = (uintptr_t) word ^ (uintptr_t) leafSource;
+    ASSERT(mask);
+    mask |= mask >> 1;
+    mask |= mask >> 2;
+    mask |= mask >> 4;
+    mask |= mask >> 8;
+    mask |= mask >> 16;
+#if SIZE_BIT > 32
+    mask |= mask >> 32;
+#endif
+    mask >>= 1;
+    mask++;
+    ASSERT(mask);
+
+    /*
+     * Find insertion point. The inserted key shares the prefix of the start
+     * node's subtrie, so the insertion point lies below.
+     */
+
+    node = start;
+    while (node) {
+        if (!ROOT_IS_LEAF(node) && mask < ROOT_NODE_MASK(node)) {
+            if ((uintptr_t) word & ROOT_NODE_MASK(node)) {
+                /*
+                 * Recurse on right.
+                 */
+
+                node = ROOT_NODE_RIGHT(node);
+            } else {
                 /*
-                 * Found! Increment reference count.
+                 * Recurse on left.
                  */
 
-                ASSERT(WORD_PINNED(word));
-                ROOT_LEAF_REFCOUNT(node)++;
-                goto end;
+                node = ROOT_NODE_LEFT(node);
             }
-            break;
+            continue;
         }
+        break;
+    }
+    ASSERT(node);
+
+    /*
+     * Insert leaf here.
+     */
+
+    parent = ROOT_PARENT(ROOT_GET_NODE(node));
+    newParent = PoolAllocCells(&data->rootPool, 1);
+    if ((uintptr_t) word & mask) {
+        /*
+         * Leaf is right.
+         */
+
+        ROOT_NODE_INIT(newParent, parent, mask, node, ROOT_GET_LEAF(leaf));
+    } else {
+        /*
+         * Leaf is left.
+         */
+
+        ROOT_NODE_INIT(newParent, parent, mask, ROOT_GET_LEAF(leaf), node);
+    }
+    ROOT_PARENT(leaf) = newParent;
+    ROOT_PARENT(ROOT_GET_NODE(node)) = newParent;
+    if (!parent) {
+        /*
+         * Leaf was trie root.
+         */
+
+        data->roots = newParent;
+    } else if ((uintptr_t) word & ROOT_NODE_MASK(parent)) {
+        ROOT_NODE_RIGHT(parent) = newParent;
+    } else {
+        ROOT_NODE_LEFT(parent) = newParent;
+    }
+    return newParent;
+}
+
+/**
+ * Decrement reference count of root and remove it from trie once it drops
+ * below 1. Must be called with root management structures protected.
+ *
+ * @return The finger node for the next search.
+ *
+ * @sideeffect
+ *      May release memory cells. Unpin word.
+ *
+ * @see RootSearchStart
+ * @see Col_WordRelease
+ * @see Col_WordReleaseA
+ */
+static Cell *
+ReleaseRoot(
+    GroupData *data,    /*!< Group-specific data. */
+    Col_Word word,      /*!< Root source, see RootSource(). */
+    Cell *finger,       /*!< Finger node, see RootSearchStart(). */
+    Col_Word fingerKey) /*!< Finger key, see RootSearchStart(). */
+{
+    Cell *node, *sibling, *parent, *grandParent;
 
+    if (!WORD_PINNED(word)) {
         /*
-         * Not found, insert. Pin the word so that its address doesn't change
-         * during compaction.
+         * Roots are always pinned.
          */
 
-        WORD_SET_PINNED(word);
+        return NULL;
+    }
+
+    /*
+     * Search for matching entry.
+     */
+
+    node = RootSearchStart(data, word, finger, fingerKey);
+    while (node) {
+        if (!ROOT_IS_LEAF(node)) {
+            if ((uintptr_t) word & ROOT_NODE_MASK(node)) {
+                /*
+                 * Recurse on right.
+                 */
+
+                node = ROOT_NODE_RIGHT(node);
+            } else {
+                /*
+                 * Recurse on left.
+                 */
+
+                node = ROOT_NODE_LEFT(node);
+            }
+            continue;
+        }
 
-        leaf = PoolAllocCells(&data->groupData->rootPool, 1);
-        ROOT_LEAF_INIT(leaf, NULL, PAGE_GENERATION(CELL_PAGE(word)), 1, word);
+        /*
+         * Leaf node.
+         */
 
-        if (!data->groupData->roots) {
+        ASSERT(ROOT_IS_LEAF(node));
+        node = ROOT_GET_NODE(node);
+        if (word != ROOT_LEAF_SOURCE(node)) {
             /*
-             * First leaf.
+             * Source doesn't match.
              */
 
-            data->groupData->roots = ROOT_GET_LEAF(leaf);
-            goto end;
+            return NULL;
         }
+        break;
+    }
+    if (!node) {
+        return NULL;
+    }
 
+    /*
+     * Decrement reference count.
+     */
+
+    parent = ROOT_PARENT(node);
+    if (--ROOT_LEAF_REFCOUNT(node)) {
         /*
-         * Get diff mask between inserted key and existing leaf key, i.e. only
-         * keep the highest bit set.
-         * See: http://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
+         * Root is still valid.
          */
 
-        mask = (uintptr_t) word ^ (uintptr_t) leafSource;
-        ASSERT(mask);
-        mask |= mask >> 1;
-        mask |= mask >> 2;
-        mask |= mask >> 4;
-        mask |= mask >> 8;
-        mask |= mask >> 16;
-        mask >>= 1;
-        mask++;
-        ASSERT(mask);
+        return parent;
+    }
+
+    /*
+     * Remove leaf. Unpin word as well.
+     */
+
+    ASSERT(TestCell(CELL_PAGE(node), CELL_INDEX(node)));
+    ClearCells(CELL_PAGE(node), CELL_INDEX(node), 1);
+    WORD_CLEAR_PINNED(word);
 
+    if (!parent) {
         /*
-         * Find insertion point.
+         * Leaf was trie root.
          */
 
-        node = data->groupData->roots;
-        while (node) {
-            if (!ROOT_IS_LEAF(node) && mask < ROOT_NODE_MASK(node)) {
-                if ((uintptr_t) word & ROOT_NODE_MASK(node)) {
-                    /*
-                     * Recurse on right.
-                     */
+        data->roots = NULL;
+        return NULL;
+    }
 
-                    node = ROOT_NODE_RIGHT(node);
-                } else {
-                    /*
-                     * Recurse on left.
-                     */
+    /*
+     * Remove parent and replace by sibling.
+     */
 
-                    node = ROOT_NODE_LEFT(node);
-                }
-                continue;
-            }
-            break;
-        }
-        ASSERT(node);
+    ASSERT(TestCell(CELL_PAGE(parent), CELL_INDEX(parent)));
+    ClearCells(CELL_PAGE(parent), CELL_INDEX(parent), 1);
+    if ((uintptr_t) word & ROOT_NODE_MASK(parent)) {
+        sibling = ROOT_NODE_LEFT(parent);
+    } else {
+        sibling = ROOT_NODE_RIGHT(parent);
+    }
 
+    grandParent = ROOT_PARENT(parent);
+    if (!grandParent) {
         /*
-         * Insert leaf here.
+         * Parent was trie root.
          */
 
-        parent = ROOT_PARENT(ROOT_GET_NODE(node));
-        newParent = PoolAllocCells(&data->groupData->rootPool, 1);
-        if ((uintptr_t) word & mask) {
-            /*
-             * Leaf is right.
-             */
+        data->roots = sibling;
+    } else if ((uintptr_t) word & ROOT_NODE_MASK(grandParent)) {
+        ROOT_NODE_RIGHT(grandParent) = sibling;
+    } else {
+        ROOT_NODE_LEFT(grandParent) = sibling;
+    }
+    ROOT_PARENT(ROOT_GET_NODE(sibling)) = grandParent;
+    return grandParent;
+}
 
-            ROOT_NODE_INIT(newParent, parent, mask, node, ROOT_GET_LEAF(leaf));
-        } else {
-            /*
-             * Leaf is left.
-             */
+/**
+ * Get sorted root sources of an array of words. Sources are sorted by
+ * address using a LSD radix sort on bytes; bytes common to all sources, such
+ * as the high bytes of addresses from the same heap region, are skipped.
+ *
+ * @return Newly allocated array of root sources in address order, to be
+ *         freed by the caller; immediate values are skipped.
+ *
+ * @see RootSource
+ * @see Col_WordPreserveA
+ * @see Col_WordReleaseA
+ */
+static Col_Word *
+SortRootSources(
+    size_t nbWords,         /*!< Size of **words** array. */
+    const Col_Word *words,  /*!< Words to get sources for. */
+    size_t *nbSourcesPtr)   /*!< [out] Number of sources. */
+{
+    uintptr_t *sources, *from, *to, *tmp;
+    size_t counts[256], i, nbSources = 0;
+    unsigned int shift;
 
-            ROOT_NODE_INIT(newParent, parent, mask, ROOT_GET_LEAF(leaf), node);
+    /*
+     * Allocate room for sources and a scratch buffer in one block.
+     */
+
+    sources = (uintptr_t *) malloc(nbWords * 2 * sizeof(*sources));
+    for (i = 0; i < nbWords; i++) {
+        Col_Word source = RootSource(words[i]);
+        if (source != WORD_NIL) {
+            sources[nbSources++] = (uintptr_t) source;
         }
-        ROOT_PARENT(leaf) = newParent;
-        ROOT_PARENT(ROOT_GET_NODE(node)) = newParent;
-        if (!parent) {
+    }
+
+    from = sources;
+    to = sources + nbSources;
+    for (shift = 0; shift < sizeof(uintptr_t) * CHAR_BIT; shift += 8) {
+        size_t offset, count;
+
+        memset(counts, 0, sizeof(counts));
+        for (i = 0; i < nbSources; i++) {
+            counts[(from[i] >> shift) & 0xFF]++;
+        }
+        if (nbSources == 0 || counts[(from[0] >> shift) & 0xFF] == nbSources) {
             /*
-             * Leaf was trie root.
+             * Byte is the same for all sources.
              */
 
-            data->groupData->roots = newParent;
-        } else if ((uintptr_t) word & ROOT_NODE_MASK(parent)) {
-            ROOT_NODE_RIGHT(parent) = newParent;
-        } else {
-            ROOT_NODE_LEFT(parent) = newParent;
+            continue;
+        }
+        for (i = 0, offset = 0; i < 256; i++) {
+            count = counts[i];
+            counts[i] = offset;
+            offset += count;
+        }
+        for (i = 0; i < nbSources; i++) {
+            to[counts[(from[i] >> shift) & 0xFF]++] = from[i];
         }
+        tmp = from; from = to; to = tmp;
     }
-end:
+    if (from != sources) {
+        memcpy(sources, from, nbSources * sizeof(*sources));
+    }
+
+    *nbSourcesPtr = nbSources;
+    return (Col_Word *) sources;
+}
+
+/** @endcond @endprivate */
+
+/**
+ * Preserve a persistent reference to a word, making it a root. This allows
+ * words to be safely stored in external structures regardless of memory
+ * management cycles. More specifically, they can't be collected and their
+ * address remains constant.
+ *
+ * Calls can be nested. A reference count is updated accordingly.
+ *
+ * Roots are stored in a trie indexed by the root source addresses.
+ *
+ * @pre
+ *      Must be called within a GC-protected section.
+ *
+ * @sideeffect
+ *      May allocate memory cells. Marks word as pinned.
+ *
+ * @see Col_WordRelease
+ * @see Col_WordPreserveA
+ */
+void
+Col_WordPreserve(
+    Col_Word word)  /*!< The word to preserve. */
+{
+    ThreadData *data = PlatGetThreadData();
+
+    /*
+     * Check preconditions.
+     */
+
+    /*! @error{COL_ERROR_GCPROTECT} */
+    PRECONDITION_GCPROTECTED(data) return;
+
+    word = RootSource(word);
+    if (word == WORD_NIL) {
+        return;
+    }
+
+    EnterProtectRoots(data->groupData);
+    PreserveRoot(data->groupData, word, NULL, WORD_NIL);
     LeaveProtectRoots(data->groupData);
 }
 
@@ -1559,13 +5344,13 @@ end:
  *      May release memory cells. Unpin word.
  *
  * @see Col_WordPreserve
+ * @see Col_WordReleaseA
  */
 void
 Col_WordRelease(
     Col_Word word)  /*!< The root word to release. */
 {
     ThreadData *data = PlatGetThreadData();
-    Cell *node, *sibling, *parent, *grandParent;
 
     /*
      * Check preconditions.
@@ -1574,145 +5359,266 @@ Col_WordRelease(
     /*! @error{COL_ERROR_GCPROTECT} */
     PRECONDITION_GCPROTECTED(data) return;
 
-    /*
-     * Rule out immediate values.
-     */
+    word = RootSource(word);
+    if (word == WORD_NIL) {
+        return;
+    }
 
-    switch (WORD_TYPE(word)) {
-    case WORD_TYPE_NIL:
-    case WORD_TYPE_SMALLINT:
-    case WORD_TYPE_SMALLFP:
-    case WORD_TYPE_CHARBOOL:
-    case WORD_TYPE_SMALLSTR:
-    case WORD_TYPE_VOIDLIST:
-        /*
-         * Immediate values.
-         */
+    EnterProtectRoots(data->groupData);
+    ReleaseRoot(data->groupData, word, NULL, WORD_NIL);
+    LeaveProtectRoots(data->groupData);
+}
 
-        return;
+/**
+ * Preserve an array of words at once. This is equivalent to calling
+ * Col_WordPreserve() on each word, but words are sorted by address first so
+ * that consecutive insertions only walk the part of the root trie that
+ * differs between them, and root management structures are protected only
+ * once.
+ *
+ * @pre
+ *      Must be called within a GC-protected section.
+ *
+ * @sideeffect
+ *      May allocate memory cells. Marks words as pinned.
+ *
+ * @see Col_WordPreserve
+ * @see Col_WordReleaseA
+ */
+void
+Col_WordPreserveA(
+    size_t nbWords,         /*!< Size of **words** array. */
+    const Col_Word *words)  /*!< Array of words to preserve. */
+{
+    ThreadData *data = PlatGetThreadData();
+    Col_Word *sources;
+    size_t nbSources, i;
+    Cell *finger = NULL;
 
-    case WORD_TYPE_CIRCLIST:
-        /*
-         * Release core list.
-         */
+    /*
+     * Check preconditions.
+     */
 
-        Col_WordRelease(WORD_CIRCLIST_CORE(word));
-        return;
+    /*! @error{COL_ERROR_GCPROTECT} */
+    PRECONDITION_GCPROTECTED(data) return;
 
-        /* WORD_TYPE_UNKNOWN */
+    if (nbWords == 0) {
+        return;
     }
+    sources = SortRootSources(nbWords, words, &nbSources);
 
     EnterProtectRoots(data->groupData);
-    {
-        if (!WORD_PINNED(word)) {
-            /*
-             * Roots are always pinned.
-             */
+    for (i = 0; i < nbSources; i++) {
+        finger = PreserveRoot(data->groupData, sources[i], finger,
+                (i ? sources[i-1] : WORD_NIL));
+    }
+    LeaveProtectRoots(data->groupData);
 
-            goto end;
-        }
+    free(sources);
+}
 
-        /*
-         * Search for matching entry.
-         */
+/**
+ * Release an array of root words previously made by Col_WordPreserve() or
+ * Col_WordPreserveA(). This is equivalent to calling Col_WordRelease() on
+ * each word, with the same benefits as Col_WordPreserveA().
+ *
+ * @pre
+ *      Must be called within a GC-protected section.
+ *
+ * @sideeffect
+ *      May release memory cells. Unpin words.
+ *
+ * @see Col_WordRelease
+ * @see Col_WordPreserveA
+ */
+void
+Col_WordReleaseA(
+    size_t nbWords,         /*!< Size of **words** array. */
+    const Col_Word *words)  /*!< Array of root words to release. */
+{
+    ThreadData *data = PlatGetThreadData();
+    Col_Word *sources;
+    size_t nbSources, i;
+    Cell *finger = NULL;
 
-        if (!data->groupData->roots) {
-            goto end;
-        }
-        node = data->groupData->roots;
-        while (node) {
-            if (!ROOT_IS_LEAF(node)) {
-                if ((uintptr_t) word & ROOT_NODE_MASK(node)) {
-                    /*
-                     * Recurse on right.
-                     */
+    /*
+     * Check preconditions.
+     */
 
-                    node = ROOT_NODE_RIGHT(node);
-                } else {
-                    /*
-                     * Recurse on left.
-                     */
+    /*! @error{COL_ERROR_GCPROTECT} */
+    PRECONDITION_GCPROTECTED(data) return;
 
-                    node = ROOT_NODE_LEFT(node);
-                }
-                continue;
-            }
+    if (nbWords == 0) {
+        return;
+    }
+    sources = SortRootSources(nbWords, words, &nbSources);
 
-            /*
-             * Leaf node.
-             */
+    EnterProtectRoots(data->groupData);
+    for (i = 0; i < nbSources; i++) {
+        finger = ReleaseRoot(data->groupData, sources[i], finger,
+                (i ? sources[i-1] : WORD_NIL));
+    }
+    LeaveProtectRoots(data->groupData);
 
-            ASSERT(ROOT_IS_LEAF(node));
-            node = ROOT_GET_NODE(node);
-            if (word != ROOT_LEAF_SOURCE(node)) {
-                /*
-                 * Source doesn't match.
-                 */
+    free(sources);
+}
 
-                goto end;
-            }
-            break;
-        }
-        ASSERT(node);
+/**
+ * Publish a word to other threads of the calling thread's group. Words
+ * stored into other words or preserved are published implicitly, this is
+ * only needed for words handed over by other means, e.g.\ C variables, when
+ * #COL_GC_LOCAL_COLLECT is enabled. The word remains valid in the receiving
+ * thread until all threads of the group leave their GC-protected sections,
+ * as usual.
+ *
+ * @pre
+ *      Must be called within a GC-protected section.
+ *
+ * @sideeffect
+ *      The eden of the thread that created the word can no longer be
+ *      collected locally until the next group-wide GC.
+ *
+ * @see COL_SHARED
+ * @see COL_GC_LOCAL_COLLECT
+ */
+void
+Col_WordPublish(
+    Col_Word word)  /*!< The word to publish. */
+{
+    ThreadData *data = PlatGetThreadData();
 
-        /*
-         * Decrement reference count.
-         */
+    /*
+     * Check preconditions.
+     */
 
-        if (--ROOT_LEAF_REFCOUNT(node)) {
-            /*
-             * Root is still valid.
-             */
+    /*! @error{COL_ERROR_GCPROTECT} */
+    PRECONDITION_GCPROTECTED(data) return;
 
-            goto end;
-        }
+#ifdef COL_USE_THREADS
+    word = RootSource(word);
+    if (word != WORD_NIL && PAGE_GENERATION(CELL_PAGE(word)) == 1) {
+        PAGE_THREADDATA(CELL_PAGE(word))->published = 1;
+    }
+#endif /* COL_USE_THREADS */
+}
 
-        /*
-         * Remove leaf. Unpin word as well.
-         */
+/**
+ * Open a handle scope. Handles created by Col_NewHandle() afterwards live
+ * until the scope is closed by Col_CloseHandleScope(). Scopes can be nested.
+ *
+ * Handles are a cheap alternative to Col_WordPreserve() for words that only
+ * need to survive a few GC-protected sections of the calling thread: opening
+ * and closing scopes take constant time and no lock, as handles are stored
+ * in thread-local slots.
+ *
+ * @return The scope marker to pass to Col_CloseHandleScope().
+ *
+ * @see Col_NewHandle
+ * @see Col_CloseHandleScope
+ */
+Col_HandleScope
+Col_OpenHandleScope()
+{
+    ThreadData *data = PlatGetThreadData();
+    return data->nbHandles;
+}
 
-        ASSERT(TestCell(CELL_PAGE(node), CELL_INDEX(node)));
-        ClearCells(CELL_PAGE(node), CELL_INDEX(node), 1);
-        WORD_CLEAR_PINNED(word);
+/**
+ * Create a handle to a word in the current handle scope. The word is kept
+ * alive until the scope is closed, even outside of GC-protected sections.
+ *
+ * Contrary to preserved words, words referenced by handles are not pinned:
+ * the GC updates the handle slot when it moves the word, so the word must be
+ * read back from the handle after each GC-protected section.
+ *
+ * @pre
+ *      Must be called within a GC-protected section.
+ *
+ * @return Pointer to the handle slot, whose address remains constant until
+ *         the scope is closed.
+ *
+ * @see Col_OpenHandleScope
+ * @see Col_CloseHandleScope
+ */
+Col_Word *
+Col_NewHandle(
+    Col_Word word)  /*!< The word to reference. */
+{
+    ThreadData *data = PlatGetThreadData();
+    HandleBlock *block;
+    size_t index;
 
-        parent = ROOT_PARENT(node);
-        if (!parent) {
-            /*
-             * Leaf was trie root.
-             */
+    /*
+     * Check preconditions.
+     */
 
-            data->groupData->roots = NULL;
-            goto end;
-        }
+    /*! @error{COL_ERROR_GCPROTECT} */
+    PRECONDITION_GCPROTECTED(data) return NULL;
 
+    index = data->nbHandles % GC_HANDLE_BLOCK_SIZE;
+    if (index == 0) {
         /*
-         * Remove parent and replace by sibling.
+         * Push new block.
          */
 
-        ASSERT(TestCell(CELL_PAGE(parent), CELL_INDEX(parent)));
-        ClearCells(CELL_PAGE(parent), CELL_INDEX(parent), 1);
-        if ((uintptr_t) word & ROOT_NODE_MASK(parent)) {
-            sibling = ROOT_NODE_LEFT(parent);
+        block = data->freeHandles;
+        if (block) {
+            data->freeHandles = NULL;
         } else {
-            sibling = ROOT_NODE_RIGHT(parent);
+            block = (HandleBlock *) malloc(sizeof(HandleBlock));
         }
+        block->prev = data->handles;
+        data->handles = block;
+    }
+    data->handles->slots[index] = word;
+    data->nbHandles++;
+    return data->handles->slots+index;
+}
 
-        grandParent = ROOT_PARENT(parent);
-        if (!grandParent) {
-            /*
-             * Parent was trie root.
-             */
+/**
+ * Close a handle scope, releasing all handles created since the matching
+ * Col_OpenHandleScope() call, including those of nested scopes.
+ *
+ * @pre
+ *      Must be called within a GC-protected section.
+ *
+ * @see Col_OpenHandleScope
+ * @see Col_NewHandle
+ */
+void
+Col_CloseHandleScope(
+    Col_HandleScope scope)  /*!< Scope marker returned by
+                                 Col_OpenHandleScope(). */
+{
+    ThreadData *data = PlatGetThreadData();
+    HandleBlock *block;
+    size_t nbBlocks;
 
-            data->groupData->roots = sibling;
-        } else if ((uintptr_t) word & ROOT_NODE_MASK(grandParent)) {
-            ROOT_NODE_RIGHT(grandParent) = sibling;
-        } else {
-            ROOT_NODE_LEFT(grandParent) = sibling;
-        }
-        ROOT_PARENT(ROOT_GET_NODE(sibling)) = grandParent;
+    /*
+     * Check preconditions.
+     */
+
+    /*! @error{COL_ERROR_GCPROTECT} */
+    PRECONDITION_GCPROTECTED(data) return;
+
+    /*! @valuecheck{COL_ERROR_HANDLESCOPE,scope} */
+    VALUECHECK(scope <= data->nbHandles, COL_ERROR_HANDLESCOPE, scope)
+        return;
+
+    /*
+     * Pop blocks past the scope. Keep one for reuse.
+     */
+
+    nbBlocks = (data->nbHandles + GC_HANDLE_BLOCK_SIZE-1)
+            / GC_HANDLE_BLOCK_SIZE;
+    data->nbHandles = scope;
+    for (; nbBlocks > (scope + GC_HANDLE_BLOCK_SIZE-1) / GC_HANDLE_BLOCK_SIZE;
+            nbBlocks--) {
+        block = data->handles;
+        data->handles = block->prev;
+        free(data->freeHandles);
+        data->freeHandles = block;
     }
-end:
-    LeaveProtectRoots(data->groupData);
 }
 
 /* End of Word Lifetime Management */
@@ -1735,19 +5641,23 @@ end:
 /**
  * Allocate cells in the eden pool.
  *
+ * @error{COL_ERROR_HEAPLIMIT}
+ *
  * @pre
  *      Must be called within a GC-protected section.
  *
  * @retval pointer  to the first allocated cell if successful.
  * @retval NULL     otherwise.
  *
- * @see PoolAllocCells
+ * @see PoolBumpAllocCells
  */
 Cell *
 AllocCells(
     size_t number)  /*!< Number of cells to allocate. */
 {
     ThreadData *data = PlatGetThreadData();
+    MemoryPool *eden;
+    Cell *cells;
 
     /*
      * Check preconditions.
@@ -1757,10 +5667,21 @@ AllocCells(
     PRECONDITION_GCPROTECTED(data) return NULL;
 
     /*
-     * Alloc cells; alloc pages if needed.
+     * Fast path: advance cursor within the current run of free cells.
+     */
+
+    eden = &data->eden;
+    if (number <= (size_t) (eden->limit - eden->cursor)) {
+        cells = eden->cursor;
+        eden->cursor += number;
+        return cells;
+    }
+
+    /*
+     * Alloc cells and start a new run; alloc pages if needed.
      */
 
-    return PoolAllocCells(&data->eden, number);
+    return PoolBumpAllocCells(eden, number);
 }
 
 /* End of Cell Allocation */
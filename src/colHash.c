@@ -247,7 +247,8 @@ CompareStrings(
  * static space or in a separate vector word.
  *
  * @param map               Hash map to get bucket array for.
- * @param mutable           If true, ensure that entry is mutable.
+ * @param mutable           If true, ensure that bucket array is mutable and
+ *                          record its modification with WriteBarrier().
  *
  * @param[out] nbBuckets    Size of bucket array.
  * @param[out] buckets      Bucket array.
@@ -258,18 +259,21 @@ CompareStrings(
     switch (WORD_TYPE(WORD_HASHMAP_BUCKETS(map))) { \
     case WORD_TYPE_VECTOR: \
         if (mutable) { \
+            WriteBarrier(map); \
             WORD_HASHMAP_BUCKETS(map) = Col_NewMVector(0, \
                 WORD_VECTOR_LENGTH(WORD_HASHMAP_BUCKETS(map)), \
                 WORD_VECTOR_ELEMENTS(WORD_HASHMAP_BUCKETS(map))); \
         }; \
         /* continued. */ \
     case WORD_TYPE_MVECTOR: \
+        if (mutable) {WriteBarrier(WORD_HASHMAP_BUCKETS(map));} \
         (nbBuckets) = WORD_VECTOR_LENGTH(WORD_HASHMAP_BUCKETS(map)); \
         (buckets) = WORD_VECTOR_ELEMENTS(WORD_HASHMAP_BUCKETS(map)); \
         break; \
     \
     default: \
         ASSERT(!WORD_HASHMAP_BUCKETS(map)); \
+        if (mutable) {WriteBarrier(map);} \
         (nbBuckets) = HASHMAP_STATICBUCKETS_SIZE; \
         (buckets) = WORD_HASHMAP_STATICBUCKETS(map); \
     }
@@ -367,6 +371,7 @@ GrowHashMap(
                      */
 
                     next = WORD_HASHENTRY_NEXT(entry);
+                    WriteBarrier(entry);
                     WORD_HASHENTRY_NEXT(entry) = newBuckets[newIndex];
                     newBuckets[newIndex] = entry;
             }
@@ -375,6 +380,7 @@ GrowHashMap(
         }
     }
 
+    WriteBarrier(map);
     WORD_HASHMAP_BUCKETS(map) = newBucketContainer;
 
     return 1;
@@ -463,6 +469,7 @@ GrowIntHashMap(
                      */
 
                     next = WORD_HASHENTRY_NEXT(entry);
+                    WriteBarrier(entry);
                     WORD_HASHENTRY_NEXT(entry) = newBuckets[newIndex];
                     newBuckets[newIndex] = entry;
             }
@@ -471,6 +478,7 @@ GrowIntHashMap(
         }
     }
 
+    WriteBarrier(map);
     WORD_HASHMAP_BUCKETS(map) = newBucketContainer;
 
     return 1;
@@ -873,12 +881,62 @@ Col_NewIntHashMap(
     return map;
 }
 
+/**
+ * Create a new weak string hash map word.
+ *
+ * @return The new word.
+ */
+Col_Word
+Col_NewWeakStringHashMap(
+    size_t capacity,    /*!< Initial bucket size. Rounded up to the next power
+                             of 2. */
+    int weakness)       /*!< Combination of #COL_WEAK_KEYS and
+                             #COL_WEAK_VALUES. */
+{
+    Col_Word map;
+
+    map = Col_NewStringHashMap(capacity);
+    WORD_HASHMAP_WEAKNESS(map) = weakness & (COL_WEAK_KEYS | COL_WEAK_VALUES);
+
+    return map;
+}
+
+/**
+ * Create a new weak integer hash map word. Integer keys are never
+ * collected, so only values can be weak.
+ *
+ * @return The new word.
+ */
+Col_Word
+Col_NewWeakIntHashMap(
+    size_t capacity,    /*!< Initial bucket size. Rounded up to the next power
+                             of 2. */
+    int weakness)       /*!< Either 0 or #COL_WEAK_VALUES. */
+{
+    Col_Word map;
+
+    /*
+     * Check preconditions.
+     */
+
+    /*! @valuecheck{COL_ERROR_WEAKNESS,weakness} */
+    VALUECHECK(!(weakness & COL_WEAK_KEYS), COL_ERROR_WEAKNESS, weakness)
+            return WORD_NIL;
+
+    map = Col_NewIntHashMap(capacity);
+    WORD_HASHMAP_WEAKNESS(map) = weakness & COL_WEAK_VALUES;
+
+    return map;
+}
+
 /**
  * Create a new hash map word from an existing one.
  *
  * @note
  *      Only the hash map structure is copied, the contained words are not
- *      (i.e. this is not a deep copy).
+ *      (i.e. this is not a deep copy). Copies of weak hash maps are regular
+ *      hash maps. Shared entries are held strongly by both maps, as the GC
+ *      cannot remove them.
  *
  * @return The new word.
  *
@@ -927,6 +985,9 @@ Col_CopyHashMap(
     memcpy((void *) newMap, (void *) map, sizeof(Cell) * HASHMAP_NBCELLS);
     WORD_SYNONYM(newMap) = WORD_NIL;
     WORD_CLEAR_PINNED(newMap);
+    if (WORD_TYPE(newMap) != WORD_TYPE_CUSTOM) {
+        WORD_HASHMAP_WEAKNESS(newMap) = 0;
+    }
 
     if (WORD_HASHMAP_BUCKETS(map)) {
         if (WORD_TYPE(WORD_HASHMAP_BUCKETS(map)) == WORD_TYPE_VECTOR) {
@@ -1135,6 +1196,7 @@ Col_HashMapSet(
             NULL);
     ASSERT(entry);
     ASSERT(WORD_TYPE(entry) == WORD_TYPE_MHASHENTRY);
+    WriteBarrier(entry);
     WORD_MAPENTRY_VALUE(entry) = value;
     return create;
 }
@@ -1166,6 +1228,7 @@ Col_IntHashMapSet(
     entry = IntHashMapFindEntry(map, key, 1, &create, NULL);
     ASSERT(entry);
     ASSERT(WORD_TYPE(entry) == WORD_TYPE_MINTHASHENTRY);
+    WriteBarrier(entry);
     WORD_MAPENTRY_VALUE(entry) = value;
     return create;
 }
@@ -1265,6 +1328,7 @@ Col_HashMapUnset(
                  * Skip removed entry.
                  */
 
+                WriteBarrier(prev);
                 WORD_HASHENTRY_NEXT(prev) = WORD_HASHENTRY_NEXT(entry);
             }
             WORD_HASHMAP_SIZE(map)--;
@@ -1349,6 +1413,7 @@ Col_IntHashMapUnset(
                  * Skip removed entry.
                  */
 
+                WriteBarrier(prev);
                 WORD_HASHENTRY_NEXT(prev) = WORD_HASHENTRY_NEXT(entry);
             }
             WORD_HASHMAP_SIZE(map)--;
@@ -1553,6 +1618,7 @@ Col_HashMapIterSetValue(
          */
 
         ASSERT(WORD_TYPE(it->entry) == WORD_TYPE_MHASHENTRY);
+        WriteBarrier(it->entry);
         WORD_MAPENTRY_VALUE(it->entry) = value;
         break;
 
@@ -1573,6 +1639,7 @@ Col_HashMapIterSetValue(
          */
 
         ASSERT(WORD_TYPE(it->entry) == WORD_TYPE_MINTHASHENTRY);
+        WriteBarrier(it->entry);
         WORD_MAPENTRY_VALUE(it->entry) = value;
         break;
 
@@ -41,6 +41,10 @@
     - Hash map words use one cell for the header plus several extra cells for
       static buckets (see #HASHMAP_STATICBUCKETS_NBCELLS).
 
+    - String and integer hash maps can be weak (see #COL_WEAK_KEYS and
+      #COL_WEAK_VALUES). Their weakness flags are stored next to the type ID;
+      custom hash maps have none.
+
     @param Type             Type descriptor.
     @param Synonym          [Generic word synonym field](@ref WORD_SYNONYM).
     @param Size             Number of elements in map.
@@ -139,6 +143,21 @@
  */
 #define WORD_HASHMAP_SIZE(word)         (((size_t *)(word))[2])
 
+/**
+ * Get/set weakness flags of string and integer hash maps.
+ *
+ * @param word  Word to access.
+ *
+ * @note
+ *      Macro is L-Value and suitable for both read/write operations.
+ *
+ * @see WORD_STRHASHMAP_INIT
+ * @see WORD_INTHASHMAP_INIT
+ * @see COL_WEAK_KEYS
+ * @see COL_WEAK_VALUES
+ */
+#define WORD_HASHMAP_WEAKNESS(word)     (((uint8_t *)(word))[1])
+
 /**
  * Get/set bucket container.
  *
@@ -224,6 +243,7 @@ String hash maps are @ref hashmap_words with string keys.
  */
 #define WORD_STRHASHMAP_INIT(word) \
     WORD_SET_TYPEID((word), WORD_TYPE_STRHASHMAP); \
+    WORD_HASHMAP_WEAKNESS(word) = 0; \
     WORD_SYNONYM(word) = WORD_NIL; \
     WORD_HASHMAP_SIZE(word) = 0; \
     WORD_HASHMAP_BUCKETS(word) = WORD_NIL;
@@ -264,6 +284,7 @@ Integer hash maps are @ref hashmap_words with integer keys.
  */
 #define WORD_INTHASHMAP_INIT(word) \
     WORD_SET_TYPEID((word), WORD_TYPE_INTHASHMAP); \
+    WORD_HASHMAP_WEAKNESS(word) = 0; \
     WORD_SYNONYM(word) = WORD_NIL; \
     WORD_HASHMAP_SIZE(word) = 0; \
     WORD_HASHMAP_BUCKETS(word) = WORD_NIL;
@@ -191,6 +191,9 @@ remaining cells store word info.
           +---------------------------------------------------------------+
     @enddiagram
 
+    Eden pages store the thread data of their owner in place of the group
+    data (see #PAGE_THREADDATA).
+
 \{*//*==========================================================================
 */
 
@@ -262,7 +265,8 @@ typedef char Cell[CELL_SIZE];
 #define PAGE_FLAG_LAST          0x20
 
 /**
- * Marks pages having parent cells.
+ * Marks pages having cells that refer to younger generations, when not
+ * tracked by the remembered set (see #ParentEntry).
  *
  * @see PAGE_FLAG
  * @see PAGE_SET_FLAG
@@ -270,6 +274,16 @@ typedef char Cell[CELL_SIZE];
  */
 #define PAGE_FLAG_PARENT        0x40
 
+/**
+ * Marks write-protected pages when parent tracking uses software write
+ * barriers.
+ *
+ * @see PAGE_FLAG
+ * @see WriteBarrier
+ * @see COL_USE_SOFTWARE_BARRIER
+ */
+#define PAGE_FLAG_PROTECTED     0x80
+
 /* End of Page and Cell Types & Constants *//*!\}*/
 
 
@@ -369,15 +383,31 @@ typedef char Cell[CELL_SIZE];
 #define PAGE_CLEAR_FLAG(page, flag)     ((*(uintptr_t *)(page)) &= ~(flag))
 
 /**
- * Get/set data for the thread group the page belongs to.
+ * Get/set data for the thread group the page belongs to. Only valid for
+ * pages of generations older than eden.
  *
  * @param page  #Page to access.
  *
  * @note
  *      Macro is L-Value and suitable for both read/write operations.
+ *
+ * @see PAGE_THREADDATA
  */
 #define PAGE_GROUPDATA(page)            (*((GroupData **)(page)+1))
 
+/**
+ * Get/set data for the thread whose eden the page belongs to. Only valid for
+ * eden pages, shares its storage with #PAGE_GROUPDATA.
+ *
+ * @param page  #Page to access.
+ *
+ * @note
+ *      Macro is L-Value and suitable for both read/write operations.
+ *
+ * @see WriteBarrier
+ */
+#define PAGE_THREADDATA(page)           (*((struct ThreadData **)(page)+1))
+
 /**
  * Get/set bitmask for allocated cells in page.
  *
@@ -461,10 +491,37 @@ typedef struct MemoryPool {
     size_t nbSetCells;                  /*!< Number of set cells in pool. */
     size_t gc;                          /*!< GC counter. Used for generational
                                              GC. */
+    size_t nbCollections;               /*!< Number of collections of pool. */
+    size_t totalAlloc;                  /*!< Number of pages alloc'd since
+                                             pool creation. */
     Col_Word sweepables;                /*!< List of cells that need sweeping
                                              when unreachable after a GC. */
+    Page *sweepPage;                    /*!< Next page to sweep lazily, NULL
+                                             if none. */
+    Page *sweepPrev;                    /*!< Last page kept by lazy sweeping
+                                             before **sweepPage**. */
+    Page *sweepEnd;                     /*!< First page past the range to
+                                             sweep lazily. */
+    Cell *cursor;                       /*!< Next cell to allocate in the
+                                             current bump allocation run (eden
+                                             only). */
+    Cell *limit;                        /*!< End of the current bump
+                                             allocation run. */
 } MemoryPool;
 
+/**
+ * Add to a pool counter. Outside of GCs, counters of eden pools are only
+ * modified by their owner thread but read by Col_GetHeapStats() from other
+ * threads of the group, so the new value is stored atomically.
+ *
+ * @param counter   Counter to update.
+ * @param value     Value to add, may be negative.
+ *
+ * @see Col_GetHeapStats
+ */
+#define POOL_ADD_COUNTER(counter, value) \
+    PlatAtomicStore(&(counter), (counter) + (value))
+
 /*
  * Remaining declarations.
  */
@@ -479,7 +536,11 @@ void                    PoolCleanup(MemoryPool *pool);
  * \name System Page Allocation
  ***************************************************************************\{*/
 
+extern size_t decommitDelay;
+
 void                    SysPageProtect(void *page, int protect);
+int                     SysPageReserve(size_t number, int prefault);
+int                     SysPageDecommit(void);
 
 /* End of System Page Allocation *//*!\}*/
 
@@ -488,8 +549,10 @@ void                    SysPageProtect(void *page, int protect);
  * \name Page Allocation
  ***************************************************************************\{*/
 
-void                    PoolAllocPages(MemoryPool *pool, size_t number);
+int                     PoolAllocPages(MemoryPool *pool, size_t number);
 void                    PoolFreeEmptyPages(MemoryPool *pool);
+void                    PoolStartSweep(MemoryPool *pool, Page *end);
+int                     PoolSweepPages(MemoryPool *pool, size_t max);
 
 /* End of Page Allocation *//*!\}*/
 
@@ -499,7 +562,10 @@ void                    PoolFreeEmptyPages(MemoryPool *pool);
  ***************************************************************************\{*/
 
 Cell *                  PoolAllocCells(MemoryPool *pool, size_t number);
+Cell *                  PoolBumpAllocCells(MemoryPool *pool, size_t number);
 void                    SetCells(Page *page, size_t first, size_t number);
+int                     SetCellsAtomic(Page *page, size_t first,
+                            size_t number);
 void                    ClearCells(Page *page, size_t first, size_t number);
 void                    ClearAllCells(Page *page);
 int                     TestCell(Page *page, size_t index);
@@ -534,12 +600,16 @@ Cell *                  AllocCells(size_t number);
  */
 typedef struct GroupData {
     unsigned int model;             /*!< Threading model. */
-    MemoryPool rootPool;            /*!< Memory pool used to store root and
-                                         parent page descriptor cells. */
+    MemoryPool rootPool;            /*!< Memory pool used to store root
+                                         descriptor cells. */
     Cell *roots;                    /*!< Root descriptors are stored in a trie
                                          indexed by the root cell address. */
-    Cell *parents;                  /*!< Parent descriptors are stored in a
-                                         linked list. */
+    struct ParentEntry *parents;    /*!< Remembered set of parent pages, open
+                                         addressing hash table indexed by
+                                         page address (see #PARENT_HASH). */
+    size_t parentsSize;             /*!< Number of table entries, power of 2,
+                                         0 if none. */
+    size_t nbParents;               /*!< Number of parent pages in table. */
     MemoryPool
         pools[GC_MAX_GENERATIONS-2];/*!< Memory pools used to store words for
                                          generations older than eden (1 <
@@ -551,11 +621,88 @@ typedef struct GroupData {
     unsigned int compactGeneration; /*!< Generation on which to perform
                                          compaction during promotion (see
                                          #PROMOTE_COMPACT). */
+    Page **evacuated;               /*!< Open addressing hash table of sparse
+                                         pages whose words are evacuated
+                                         during the current GC, NULL if
+                                         none (see #GC_EVACUATE_FILL_RATIO). */
+    size_t evacuatedSize;           /*!< Number of table entries, power of
+                                         2. */
+    MemoryPool *evacuatePools;      /*!< Pools receiving evacuated words, one
+                                         per generation older than eden. */
 #endif
+    size_t nbMarkers;               /*!< Number of marker threads (see
+                                         #COL_GC_MARKERS). */
+    Cell *markSegments;             /*!< Mark stack segments kept from the
+                                         last GC for reuse. */
+    int incremental;                /*!< Whether incremental GC is enabled
+                                         (see #COL_GC_INCREMENTAL). */
+    size_t sliceBudget;             /*!< Incremental mark slice budget (see
+                                         #COL_GC_SLICE_BUDGET). */
+    size_t genFactor;               /*!< Generational factor (see
+                                         #COL_GC_GEN_FACTOR). */
+    size_t minPageAlloc;            /*!< Minimum collection threshold (see
+                                         #COL_GC_MIN_PAGE_ALLOC). */
+    size_t maxPageAlloc;            /*!< Maximum collection threshold (see
+                                         #COL_GC_MAX_PAGE_ALLOC). */
+    size_t promoteFillRatio;        /*!< Compaction fill ratio in percent (see
+                                         #COL_GC_PROMOTE_FILL_RATIO). */
+    int adaptive;                   /*!< Whether adaptive mode is enabled (see
+                                         #COL_GC_ADAPTIVE). */
+    size_t pauseTarget;             /*!< Eden pause time target (see
+                                         #COL_GC_PAUSE_TARGET). */
+    size_t edenThreshold;           /*!< Eden collection threshold in
+                                         adaptive mode. */
+    size_t softLimit;               /*!< Soft heap size limit (see
+                                         #COL_GC_SOFT_LIMIT). */
+    size_t hardLimit;               /*!< Hard heap size limit (see
+                                         #COL_GC_HARD_LIMIT). */
+    size_t nbPages;                 /*!< Number of pages in all pools of the
+                                         group, updated atomically. */
+    size_t overSoftLimit;           /*!< Whether heap size crossed the soft
+                                         limit. */
+    size_t fullGC;                  /*!< Whether the next GC must be a full
+                                         collection with compaction. Set
+                                         atomically by group threads. */
+    int compactHeap;                /*!< Whether the next GC must evacuate
+                                         sparse pages of all generations (see
+                                         Col_CompactHeap()). */
+    struct GcCycle *cycle;          /*!< Incremental GC cycle underway, NULL
+                                         if none. */
+    int sweepPending;               /*!< Whether older generation pools have
+                                         pages left to sweep lazily. */
+    int localCollect;               /*!< Whether threads may collect their eden
+                                         on their own (see
+                                         #COL_GC_LOCAL_COLLECT). */
+    int asyncFinalize;              /*!< Whether freeProcs are called outside
+                                         of GC pauses (see
+                                         #COL_GC_ASYNC_FINALIZE). */
+    Col_Word finalizables;          /*!< Collected custom words awaiting
+                                         their freeProc, chained like pool
+                                         sweepables (see FinalizeWords()). */
+    Col_GcStats stats;              /*!< GC statistics (see
+                                         Col_GetGcStats()). */
+    Col_GcEventProc *eventProc;     /*!< GC event handler (see
+                                         Col_SetGcEventProc()). */
+    Col_ClientData eventClientData; /*!< Opaque value passed to
+                                         **eventProc**. */
     struct ThreadData *first;       /*!< Group member threads form a circular
                                          list. */
 } GroupData;
 
+/**
+ * Block of handle slots. Blocks form a stack, the topmost one holding the
+ * most recent handles.
+ *
+ * @see ThreadData
+ * @see Col_NewHandle
+ * @see GC_HANDLE_BLOCK_SIZE
+ */
+typedef struct HandleBlock {
+    struct HandleBlock *prev;   /*!< Previous block in stack. */
+    Col_Word
+        slots[GC_HANDLE_BLOCK_SIZE];/*!< Handle slots. */
+} HandleBlock;
+
 /**
  * Thread-local data.
  *
@@ -579,6 +726,26 @@ typedef struct ThreadData {
                                      New cells are always created in
                                      thread-local eden pools for minimum
                                      contention. */
+    void *
+        pageCache[PAGE_CACHE_SIZE];/*!< Free system pages kept for reuse by
+                                     this thread (see #PAGE_CACHE_SIZE). */
+    size_t nbCachedPages;       /*!< Number of pages in cache. */
+    size_t minCachedPages;      /*!< Lowest number of pages in cache since
+                                     the last trim (see
+                                     SysPageCacheTrim()). */
+    void *
+        freedPages[PAGE_FREE_BATCH];/*!< System pages freed by this thread
+                                     but not yet returned (see
+                                     #PAGE_FREE_BATCH). */
+    size_t nbFreedPages;        /*!< Number of freed pages. */
+    int published;              /*!< Whether eden words may be reachable from
+                                     outside of eden since its last
+                                     collection (see #COL_SHARED). */
+    HandleBlock *handles;       /*!< Topmost block of handle slots. */
+    size_t nbHandles;           /*!< Number of handles in use (see
+                                     Col_NewHandle()). */
+    HandleBlock *freeHandles;   /*!< Block kept for reuse once its scope is
+                                     closed. */
 } ThreadData;
 
 /*
@@ -587,8 +754,14 @@ typedef struct ThreadData {
 
 void                    GcInitThread(ThreadData *data);
 void                    GcInitGroup(GroupData *data);
+#ifdef COL_USE_THREADS
+void                    GcDetachThread(ThreadData *data);
+#endif /* COL_USE_THREADS */
 void                    GcCleanupThread(ThreadData *data);
 void                    GcCleanupGroup(GroupData *data);
+void                    SysPageFlush(ThreadData *data);
+void                    SysPageCacheCleanup(ThreadData *data);
+void                    SysPageCacheTrim(ThreadData *data);
 
 /* End of Process & Threads *//*!\}*/
 
@@ -598,9 +771,13 @@ void                    GcCleanupGroup(GroupData *data);
  ***************************************************************************\{*/
 
 void                    PerformGC(GroupData *data);
+void                    SweepPendingPages(GroupData *data, size_t max);
+int                     CheckHeapLimits(GroupData *data, size_t number);
+size_t                  CustomHeaderSize(Col_CustomWordType *type);
 void                    RememberSweepable(Col_Word word,
                             Col_CustomWordType *type);
 void                    CleanupSweepables(MemoryPool *pool);
+void                    FinalizeWords(GroupData *data);
 
 /* End of Mark & Sweep Algorithm *//*!\}*/
 
@@ -927,120 +1104,120 @@ terminal cells pointing to the preserved word.
 
 Parents are cells pointing to other cells of a newer generation. During
 GC, parents from uncollected generations are traversed in addition to
-roots from collected generations, and the parent list is updated.
+roots from collected generations, and the parent set is updated.
 
 When a page of an older generation is written, this means that it may
-contain parents. Such "dirty" pages are added to the parent list at each
+contain parents. Such "dirty" pages are added to the remembered set at each
 GC, and each page is checked for potential parents.
 
-@par Requirements
-    - Parent cells use one single cell.
-  
-    - Parent cells are linked together for traversal.
-  
-    - Parent cells don't point to parent words directly but instead point to the
-      parent's page.
-  
-    @param Next     Parent nodes are linked together in a singly-linked list for
-                    traversal during GC.
-    @param Page     Pointer to source page.
+Writes are detected by write-protecting the pages of older generations,
+or, when #COL_USE_SOFTWARE_BARRIER is defined, by explicit calls to
+WriteBarrier() on the mutation paths.
 
-@par Cell Layout
-    On all architectures the single-cell layout is as follows:
-
-    @dot
-    digraph {
-        node [fontname="Lucida Console,Courier" fontsize=14];
-        parent_cell [shape=none, label=<
-            <table border="0" cellborder="1" cellspacing="0">
-            <tr><td border="0"></td>
-                <td sides="B" width="160" align="left">0</td><td sides="B" width="160" align="right">n</td>
-            </tr>
-            <tr><td sides="R">0</td>
-                <td href="@ref PARENT_NEXT" title="PARENT_NEXT" colspan="2">Next</td>
-            </tr>
-            <tr><td sides="R">1</td>
-                <td href="@ref PARENT_PAGE" title="PARENT_PAGE" colspan="2">Page</td>
-            </tr>
-            <tr><td sides="R">2</td>
-                <td colspan="2" rowspan="2" bgcolor="grey75">Unused</td>
-            </tr>
-            <tr><td sides="R">3</td></tr>
-            </table>
-        >]
-    }
-    @enddot
-
-    @begindiagram
-           0                                                             n
-          +---------------------------------------------------------------+
-        0 |                             Next                              |
-          +---------------------------------------------------------------+
-        1 |                             Page                              |
-          +---------------------------------------------------------------+
-        2 |                                                               |
-          +                            Unused                             +
-        3 |                                                               |
-          +---------------------------------------------------------------+
-    @enddiagram
+Parent pages are remembered in a per-group open addressing hash table
+indexed by page address, so that each page is remembered once. Along with
+the page, each entry holds a card bitmask with one bit per cell: the mark
+phase sets the bits of cells holding references to younger generations.
+Parent pages are then write-protected again, so that the next GC only
+traverses the words holding such cards. Pages written in between are
+traversed entirely.
 
+@see ParentEntry
 \{*//*==========================================================================
 */
 
 /***************************************************************************//*!
- * \name Parent Cell Creation
+ * \name Remembered Set
  ***************************************************************************\{*/
 
 /**
- * Parent cell initializer.
+ * Remembered set entry. Entries mimic the layout of page headers so that
+ * cell bitmask procedures (TestCell(), SetCells()...) can be used on their
+ * cards.
  *
- * @param cell  Cell to initialize.
- * @param next  #PARENT_NEXT.
- * @param page  #PARENT_PAGE.
+ * @see GroupData
+ * @see PAGE_BITMASK
+ */
+typedef struct ParentEntry {
+    Page *page;                         /*!< Parent page, NULL for free
+                                             entries. */
+    uintptr_t written;                  /*!< Matches #PAGE_GROUPDATA. Whether
+                                             the page was written since the
+                                             last GC, in which case all its
+                                             words are traversed. */
+    uint8_t cards[CELLS_PER_PAGE>>3];   /*!< Cells holding references to
+                                             younger generations. */
+} ParentEntry;
+
+/**
+ * Hash value of page in remembered set. Pages are hashed by index so that
+ * table order follows address order, which keeps the traversal of parent
+ * pages local.
  *
- * @warning
- *      Argument **cell** is referenced several times by the macro. Make sure to
- *      avoid any side effect.
+ * @param page  Page to hash.
  *
- * @see MarkReachableCellsFromParents
+ * @see FindParent
  */
-#define PARENT_INIT(cell, next, page) \
-    PARENT_NEXT(cell) = next; \
-    PARENT_PAGE(cell) = page;
+#define PARENT_HASH(page) \
+    ((uintptr_t)(page) / PAGE_SIZE)
 
-/* End of Parent Cell Creation *//*!\}*/
+/* End of Remembered Set *//*!\}*/
 
 
 /***************************************************************************//*!
- * \name Parent Cell Accessors
+ * \name Write Barrier
  ***************************************************************************\{*/
 
 /**
- * Parent nodes are linked together in a singly-linked list for traversal
- * during GC.
+ * Record modification of a word for parent tracking. When software write
+ * barriers are enabled, write-protected page groups only carry the
+ * #PAGE_FLAG_PROTECTED flag, so mutation paths must call this macro on
+ * each cell-based word they modify in place. This performs the same
+ * bookkeeping as the system protection handler, i.e. marking the page group
+ * as written so that UpdateParents() visits it at the next GC.
  *
- * @param cell  Cell to access.
+ * In #COL_SHARED groups, modifying a word outside of the calling thread's
+ * eden may also publish eden words to other threads, which rules out
+ * thread-local collections of that eden (see TrackWrite()).
  *
- * @see PARENT_INIT
- */
-#define PARENT_NEXT(cell)   (((Cell **)(cell))[1])
-
-/**
- * Pointer to source page.
+ * @param word  Cell-based word that is about to be modified.
  *
- * @param cell  Cell to access.
+ * @warning
+ *      Argument **word** is referenced several times by the macro. Make sure to
+ *      avoid any side effect.
+ *
+ * @sideeffect
+ *      When #COL_USE_SOFTWARE_BARRIER is defined and the word belongs to a
+ *      protected page, calls SysPageProtect().
  *
- * @see PARENT_INIT
+ * @see COL_USE_SOFTWARE_BARRIER
  */
-#define PARENT_PAGE(cell)   (((Page **)(cell))[2])
+#ifdef COL_USE_THREADS
+#   define WriteBarrier(word) \
+        if (PAGE_GENERATION(CELL_PAGE(word)) != 1 \
+                || PAGE_THREADDATA(CELL_PAGE(word))->groupData->model \
+                        >= COL_SHARED) \
+            {TrackWrite(CELL_PAGE(word));}
+#elif defined(COL_USE_SOFTWARE_BARRIER)
+#   define WriteBarrier(word) \
+        if (PAGE_FLAG(CELL_PAGE(word), PAGE_FLAG_PROTECTED)) \
+            {SysPageProtect(CELL_PAGE(word), 0);}
+#else
+#   define WriteBarrier(word) /* NOOP */
+#endif /* COL_USE_THREADS */
 
-/* End of Parent Cell Accessors *//*!\}*/
+/* End of Write Barrier *//*!\}*/
 
 /*
  * Remaining declarations.
  */
 
+ParentEntry *           FindParent(GroupData *data, Page *page);
+ParentEntry *           AddParent(GroupData *data, Page *page);
 void                    UpdateParents(GroupData *data);
+#ifdef COL_USE_THREADS
+void                    TrackWrite(Page *page);
+#endif /* COL_USE_THREADS */
 
 /* End of Parents *//*!\}*/
 
@@ -2934,6 +2934,7 @@ Col_MListSetLength(
     TYPECHECK_MLIST(mlist) return;
 
     ASSERT(WORD_TYPE(mlist) == WORD_TYPE_WRAP);
+    WriteBarrier(mlist);
     root = WORD_WRAP_SOURCE(mlist);
 
     if (length == 0) {
@@ -3073,6 +3074,7 @@ Col_MListLoop(
      */
 
     ASSERT(WORD_TYPE(mlist) == WORD_TYPE_WRAP);
+    WriteBarrier(mlist);
     WORD_WRAP_SOURCE(mlist) = WORD_CIRCLIST_NEW(WORD_WRAP_SOURCE(mlist));
 }
 
@@ -3108,6 +3110,7 @@ Col_MListSetAt(
     }
 
     ASSERT(WORD_TYPE(mlist) == WORD_TYPE_WRAP);
+    WriteBarrier(mlist);
     MListSetAt(&WORD_WRAP_SOURCE(mlist), index, element);
 }
 
@@ -3181,6 +3184,7 @@ start:
          * Set element.
          */
 
+        WriteBarrier(*nodePtr);
         WORD_VECTOR_ELEMENTS(*nodePtr)[index] = element;
         return;
 
@@ -3464,6 +3468,7 @@ UpdateMConcatNode(
     int pinned;
 
     ASSERT(WORD_TYPE(node) == WORD_TYPE_MCONCATLIST);
+    WriteBarrier(node);
 
     left = WORD_CONCATLIST_LEFT(node);
     leftDepth = GetDepth(left);
@@ -3520,6 +3525,7 @@ UpdateMConcatNode(
                     leftLength = Col_ListLength(left1);
                     leftDepth = (left1Depth>left21Depth?left1Depth:left21Depth)
                             + 1;
+                    WriteBarrier(left);
                     WORD_MCONCATLIST_INIT(left, leftDepth,
                             leftLength+Col_ListLength(left21), leftLength,
                             left1, left21);
@@ -3531,6 +3537,7 @@ UpdateMConcatNode(
                     leftLength = Col_ListLength(left22);
                     rightDepth = (left22Depth>rightDepth?left22Depth:rightDepth)
                             + 1;
+                    WriteBarrier(left2);
                     WORD_MCONCATLIST_INIT(left2, rightDepth,
                         leftLength+Col_ListLength(right), leftLength, left22,
                         right);
@@ -3552,6 +3559,7 @@ UpdateMConcatNode(
                     left2Depth = GetDepth(left2);
                     rightDepth = (left2Depth>rightDepth?left2Depth:rightDepth)
                             + 1;
+                    WriteBarrier(left);
                     WORD_MCONCATLIST_INIT(left, rightDepth,
                             leftLength+Col_ListLength(right), leftLength, left2,
                             right);
@@ -3607,6 +3615,7 @@ UpdateMConcatNode(
                     leftLength = Col_ListLength(left);
                     leftDepth = (leftDepth>right11Depth?leftDepth:right11Depth)
                             + 1;
+                    WriteBarrier(right1);
                     WORD_MCONCATLIST_INIT(right1, leftDepth,
                             leftLength+Col_ListLength(right11), leftLength,
                             left, right11);
@@ -3619,6 +3628,7 @@ UpdateMConcatNode(
                     leftLength = Col_ListLength(right12);
                     rightDepth = (right12Depth>right2Depth?right12Depth:right2Depth)
                             + 1;
+                    WriteBarrier(right);
                     WORD_MCONCATLIST_INIT(right, rightDepth,
                             leftLength+Col_ListLength(right2), leftLength,
                             right12, right2);
@@ -3639,6 +3649,7 @@ UpdateMConcatNode(
                     right1Depth = GetDepth(right1);
                     leftDepth = (leftDepth>right1Depth?leftDepth:right1Depth)
                             + 1;
+                    WriteBarrier(right);
                     WORD_MCONCATLIST_INIT(right, rightDepth,
                             leftLength+Col_ListLength(right1), leftLength, left,
                             right1);
@@ -3714,6 +3725,7 @@ Col_MListInsert(
     VALUECHECK_LISTLENGTH_CONCAT(length, listLength) return;
 
     ASSERT(WORD_TYPE(into) == WORD_TYPE_WRAP);
+    WriteBarrier(into);
 
     if (listLength == 0) {
         /*
@@ -3964,6 +3976,7 @@ start:
 
             MergeListChunksInfo info;
 
+            WriteBarrier(*nodePtr);
             Col_MVectorSetLength(*nodePtr, length+listLength);
 
             /*
@@ -4212,6 +4225,7 @@ Col_MListRemove(
     }
 
     ASSERT(WORD_TYPE(mlist) == WORD_TYPE_WRAP);
+    WriteBarrier(mlist);
     root = WORD_WRAP_SOURCE(mlist);
 
     length = Col_ListLength(mlist);
@@ -4432,6 +4446,7 @@ start:
             leftLength = Col_ListLength(WORD_CONCATLIST_LEFT(*nodePtr));
         }
 
+        WriteBarrier(*nodePtr);
         if (last >= leftLength) {
             /*
              * Remove part on right arm.
@@ -69,6 +69,49 @@ Generic primitives needing platform-specific implementations.
 #   define LeaveProtectRoots(data) /* NOOP */
 #endif /* COL_USE_THREADS */
 
+/**
+ * Flag set in the GC synchronization state of a group while a GC is
+ * scheduled or underway.
+ *
+ * Groups whose model isn't #COL_SINGLE keep this state in a single
+ * pointer-sized word: the number of threads within a GC-protected section
+ * times #GC_SYNC_ACTIVE, plus this flag. Entering and leaving GC-protected
+ * sections is thus a single atomic operation when no GC is pending; only
+ * threads that find the flag set fall back to the blocking primitives.
+ *
+ * @see PlatSyncPauseGC
+ * @see PlatTrySyncPauseGC
+ * @see PlatSyncResumeGC
+ */
+#define GC_SYNC_PENDING         1
+
+/**
+ * Increment of the GC synchronization state for each thread within a
+ * GC-protected section.
+ *
+ * @see GC_SYNC_PENDING
+ */
+#define GC_SYNC_ACTIVE          2
+
+/**
+ * Finalization state of a group once PlatScheduleFinalize() has queued it
+ * for a GC worker, to finalize custom words collected by thread-local
+ * collections. The worker counts as a thread within a GC-protected section
+ * until they are finalized, so that no GC starts meanwhile.
+ *
+ * @see PlatScheduleFinalize
+ * @see GC_FINALIZE_CLAIMED
+ */
+#define GC_FINALIZE_QUEUED      1
+
+/**
+ * Finalization state of a group while a GC worker finalizes words queued by
+ * thread-local collections.
+ *
+ * @see GC_FINALIZE_QUEUED
+ */
+#define GC_FINALIZE_CLAIMED     2
+
 /**
  * Synchronize calls to Col_PauseGC().
  *
@@ -120,7 +163,8 @@ Generic primitives needing platform-specific implementations.
  *
  * @sideeffect
  *      If **performGC** is nonzero, calls PerformGC() eventually: synchronously
- *      if model is #COL_SINGLE, else asynchronously.
+ *      if model is #COL_SINGLE, else asynchronously. Queued freeProcs are then
+ *      called outside of the GC pause (see FinalizeWords()).
  *
  * @see Col_ResumeGC
  * @see PlatSyncResumeGC
@@ -131,10 +175,10 @@ Generic primitives needing platform-specific implementations.
 #ifdef COL_USE_THREADS
 #   define SyncResumeGC(data, performGc) \
         if ((data)->model != COL_SINGLE) {PlatSyncResumeGC((data), (performGc));} \
-        else if (performGc) {PerformGC(data);}
+        else if (performGc) {PerformGC(data); FinalizeWords(data);}
 #else
 #   define SyncResumeGC(data, performGc) \
-        if (performGc) {PerformGC(data);}
+        if (performGc) {PerformGC(data); FinalizeWords(data);}
 #endif /* COL_USE_THREADS */
 
 /*
@@ -143,17 +187,59 @@ Generic primitives needing platform-specific implementations.
 
 int                     PlatEnter(unsigned int model);
 int                     PlatLeave(void);
+size_t                  PlatGetProcessId(void);
+size_t                  PlatGetThreadId(void);
 #ifdef COL_USE_THREADS
 void                    PlatEnterProtectRoots(GroupData *data);
 void                    PlatLeaveProtectRoots(GroupData *data);
 void                    PlatSyncPauseGC(GroupData *data);
 int                     PlatTrySyncPauseGC(GroupData *data);
 void                    PlatSyncResumeGC(GroupData *data, int schedule);
+void                    PlatScheduleFinalize(GroupData *data);
 #endif /* COL_USE_THREADS */
 
 /* End of Process & Threads *//*!\}*/
 
 
+#ifdef COL_USE_THREADS
+
+/***************************************************************************//*!
+ * \name Parallel Processing
+ ***************************************************************************\{*/
+
+/**
+ * Function signature of tasks run by PlatRunParallel().
+ *
+ * @param index         Task index, from 0 to the number of tasks minus one.
+ * @param clientData    Opaque data passed as is to PlatRunParallel().
+ *
+ * @see PlatRunParallel
+ */
+typedef void (PlatParallelProc) (size_t index, void *clientData);
+
+/*
+ * Remaining declarations.
+ */
+
+void                    PlatRunParallel(GroupData *data, size_t number,
+                                PlatParallelProc *proc, void *clientData);
+size_t                  PlatGetWorkerParam(Col_GcParam param);
+void                    PlatSetWorkerParam(Col_GcParam param, size_t value);
+
+/* End of Parallel Processing *//*!\}*/
+
+#endif /* COL_USE_THREADS */
+
+
+/***************************************************************************//*!
+ * \name Time
+ ***************************************************************************\{*/
+
+uint64_t                PlatGetMicroseconds(void);
+
+/* End of Time *//*!\}*/
+
+
 /***************************************************************************//*!
  * \name System Page Allocation
  ***************************************************************************\{*/
@@ -163,9 +249,11 @@ extern size_t allocGranularity;
 extern size_t shiftPage;
 
 void *                  PlatReserveRange(size_t size, int alloc);
+int                     PlatPrefaultRange(void *base, size_t size);
 int                     PlatReleaseRange(void *base, size_t size);
 int                     PlatAllocPages(void *addr, size_t number);
 int                     PlatFreePages(void *addr, size_t number);
+int                     PlatDecommitPages(void *addr, size_t number);
 int                     PlatProtectPages(void *addr, size_t number,
                                 int protect);
 
@@ -268,6 +268,7 @@ CommitBuffer(
     format = (Col_StringFormat) WORD_STRBUF_FORMAT(strbuf);
     rope = Col_NewRope(format, WORD_STRBUF_BUFFER(strbuf),
             length * CHAR_WIDTH(format));
+    WriteBarrier(strbuf);
     WORD_STRBUF_ROPE(strbuf) = Col_ConcatRopes(WORD_STRBUF_ROPE(strbuf), rope);
     WORD_STRBUF_LENGTH(strbuf) = 0;
 }
@@ -442,6 +443,7 @@ Col_StringBufferAppendRope(
 
     ASSERT(WORD_STRBUF_LENGTH(strbuf) == 0);
     rope2 = Col_NormalizeRope(rope, format, COL_CHAR_INVALID, 0);
+    WriteBarrier(strbuf);
     WORD_STRBUF_ROPE(strbuf) = Col_ConcatRopes(WORD_STRBUF_ROPE(strbuf), rope2);
     return (Col_RopeLength(rope2) == ropeLength);
 }
@@ -801,6 +801,7 @@ TrieMapFindEntry(
         ASSERT(WORD_TRIEMAP_SIZE(map) == 1);
         ASSERT(!leftPtr || !*leftPtr);
         ASSERT(!rightPtr || !*rightPtr);
+        WriteBarrier(map);
         WORD_TRIEMAP_ROOT(map) = entry;
 
         return entry;
@@ -815,6 +816,7 @@ TrieMapFindEntry(
         ASSERT(node == WORD_TRIEMAP_ROOT(map));
         ASSERT(!leftPtr || !*leftPtr);
         ASSERT(!rightPtr || !*rightPtr);
+        WriteBarrier(map);
         nodePtr = &WORD_TRIEMAP_ROOT(map);
     } else {
         if (WORD_TYPE(parent) != WORD_TYPE_MTRIENODE) {
@@ -826,6 +828,7 @@ TrieMapFindEntry(
             parent = ConvertStringNodeToMutable(parent, map, key);
         }
         ASSERT(WORD_TYPE(parent) == WORD_TYPE_MTRIENODE);
+        WriteBarrier(parent);
         if (node == WORD_TRIENODE_LEFT(parent)) {
             if (rightPtr) *rightPtr = WORD_TRIENODE_RIGHT(parent);
             nodePtr = &WORD_TRIENODE_LEFT(parent);
@@ -929,6 +932,7 @@ StringTrieMapFindEntry(
         ASSERT(WORD_TRIEMAP_SIZE(map) == 1);
         ASSERT(!leftPtr || !*leftPtr);
         ASSERT(!rightPtr || !*rightPtr);
+        WriteBarrier(map);
         WORD_TRIEMAP_ROOT(map) = entry;
 
         return entry;
@@ -943,6 +947,7 @@ StringTrieMapFindEntry(
         ASSERT(node == WORD_TRIEMAP_ROOT(map));
         ASSERT(!leftPtr || !*leftPtr);
         ASSERT(!rightPtr || !*rightPtr);
+        WriteBarrier(map);
         nodePtr = &WORD_TRIEMAP_ROOT(map);
     } else {
         if (WORD_TYPE(parent) != WORD_TYPE_MSTRTRIENODE) {
@@ -954,6 +959,7 @@ StringTrieMapFindEntry(
             parent = ConvertStringNodeToMutable(parent, map, key);
         }
         ASSERT(WORD_TYPE(parent) == WORD_TYPE_MSTRTRIENODE);
+        WriteBarrier(parent);
         if (node == WORD_TRIENODE_LEFT(parent)) {
             if (rightPtr) *rightPtr = WORD_TRIENODE_RIGHT(parent);
             nodePtr = &WORD_TRIENODE_LEFT(parent);
@@ -1056,6 +1062,7 @@ IntTrieMapFindEntry(
         ASSERT(WORD_TRIEMAP_SIZE(map) == 1);
         ASSERT(!leftPtr || !*leftPtr);
         ASSERT(!rightPtr || !*rightPtr);
+        WriteBarrier(map);
         WORD_TRIEMAP_ROOT(map) = entry;
 
         return entry;
@@ -1069,6 +1076,7 @@ IntTrieMapFindEntry(
         ASSERT(node == WORD_TRIEMAP_ROOT(map));
         ASSERT(!leftPtr || !*leftPtr);
         ASSERT(!rightPtr || !*rightPtr);
+        WriteBarrier(map);
         nodePtr = &WORD_TRIEMAP_ROOT(map);
     } else {
         if (WORD_TYPE(parent) != WORD_TYPE_MINTTRIENODE) {
@@ -1080,6 +1088,7 @@ IntTrieMapFindEntry(
             parent = ConvertIntNodeToMutable(parent, map, key);
         }
         ASSERT(WORD_TYPE(parent) == WORD_TYPE_MINTTRIENODE);
+        WriteBarrier(parent);
         if (node == WORD_TRIENODE_LEFT(parent)) {
             if (rightPtr) *rightPtr = WORD_TRIENODE_RIGHT(parent);
             nodePtr = &WORD_TRIENODE_LEFT(parent);
@@ -1245,6 +1254,7 @@ ConvertNodeToMutable(
     ASSERT(WORD_TYPE(map) == WORD_TYPE_CUSTOM);
 
     ASSERT(WORD_TYPE(node) == WORD_TYPE_TRIENODE || WORD_TYPE(node) == WORD_TYPE_TRIELEAF);
+    WriteBarrier(map);
     nodePtr = &WORD_TRIEMAP_ROOT(map);
     for (;;) {
         existing = *nodePtr;
@@ -1266,6 +1276,7 @@ ConvertNodeToMutable(
             /* continued */
         case WORD_TYPE_MTRIENODE:
             ASSERT(existing != node);
+            WriteBarrier(existing);
 
             /*
              * Descend.
@@ -1312,6 +1323,7 @@ ConvertStringNodeToMutable(
     Col_Char cKey;
 
     ASSERT(WORD_TYPE(node) == WORD_TYPE_STRTRIENODE || WORD_TYPE(node) == WORD_TYPE_TRIELEAF);
+    WriteBarrier(map);
     nodePtr = &WORD_TRIEMAP_ROOT(map);
     Col_RopeIterFirst(itKey, prefix);
     for (;;) {
@@ -1334,6 +1346,7 @@ ConvertStringNodeToMutable(
             /* continued */
         case WORD_TYPE_MSTRTRIENODE:
             ASSERT(existing != node);
+            WriteBarrier(existing);
             mask = WORD_STRTRIENODE_MASK(existing);
             cKey = COL_CHAR_INVALID;
             if (!Col_RopeIterEnd(itKey)) {
@@ -1385,6 +1398,7 @@ ConvertIntNodeToMutable(
     intptr_t mask;
 
     ASSERT(WORD_TYPE(node) == WORD_TYPE_INTTRIENODE || WORD_TYPE(node) == WORD_TYPE_INTTRIELEAF);
+    WriteBarrier(map);
     nodePtr = &WORD_TRIEMAP_ROOT(map);
     for (;;) {
         existing = *nodePtr;
@@ -1406,6 +1420,7 @@ ConvertIntNodeToMutable(
             /* continued */
         case WORD_TYPE_MINTTRIENODE:
             ASSERT(existing != node);
+            WriteBarrier(existing);
             mask = WORD_INTTRIENODE_MASK(existing);
 
             /*
@@ -1664,6 +1679,7 @@ Col_TrieMapSet(
 
     ASSERT(entry);
     ASSERT(WORD_TYPE(entry) == WORD_TYPE_MTRIELEAF);
+    WriteBarrier(entry);
     WORD_MAPENTRY_VALUE(entry) = value;
     return create;
 }
@@ -1695,6 +1711,7 @@ Col_IntTrieMapSet(
     entry = IntTrieMapFindEntry(map, key, 1, &create, NULL, NULL);
     ASSERT(entry);
     ASSERT(WORD_TYPE(entry) == WORD_TYPE_MINTTRIELEAF);
+    WriteBarrier(entry);
     WORD_MAPENTRY_VALUE(entry) = value;
     return create;
 }
@@ -1759,6 +1776,7 @@ Col_TrieMapUnset(
         ASSERT(parent == map);
         ASSERT(WORD_TRIEMAP_ROOT(map) == node);
         ASSERT(WORD_TRIEMAP_SIZE(map) == 0);
+        WriteBarrier(map);
         WORD_TRIEMAP_ROOT(map) = WORD_NIL;
 
         return 1;
@@ -1780,6 +1798,7 @@ Col_TrieMapUnset(
          */
 
         ASSERT(WORD_TRIEMAP_ROOT(map) == parent);
+        WriteBarrier(map);
         WORD_TRIEMAP_ROOT(map) = sibling;
     } else {
         if (WORD_TYPE(grandParent) != WORD_TYPE_MSTRTRIENODE) {
@@ -1791,6 +1810,7 @@ Col_TrieMapUnset(
             grandParent = ConvertStringNodeToMutable(grandParent, map, key);
         }
         ASSERT(WORD_TYPE(grandParent) == WORD_TYPE_MSTRTRIENODE);
+        WriteBarrier(grandParent);
         if (WORD_TRIENODE_LEFT(grandParent) == parent) {
             WORD_TRIENODE_LEFT(grandParent) = sibling;
         } else {
@@ -1843,6 +1863,7 @@ Col_IntTrieMapUnset(
         ASSERT(parent == map);
         ASSERT(WORD_TRIEMAP_ROOT(map) == node);
         ASSERT(WORD_TRIEMAP_SIZE(map) == 0);
+        WriteBarrier(map);
         WORD_TRIEMAP_ROOT(map) = WORD_NIL;
 
         return 1;
@@ -1864,6 +1885,7 @@ Col_IntTrieMapUnset(
          */
 
         ASSERT(WORD_TRIEMAP_ROOT(map) == parent);
+        WriteBarrier(map);
         WORD_TRIEMAP_ROOT(map) = sibling;
     } else {
         if (WORD_TYPE(grandParent) != WORD_TYPE_MINTTRIENODE) {
@@ -1875,6 +1897,7 @@ Col_IntTrieMapUnset(
             grandParent = ConvertIntNodeToMutable(grandParent, map, key);
         }
         ASSERT(WORD_TYPE(grandParent) == WORD_TYPE_MINTTRIENODE);
+        WriteBarrier(grandParent);
         if (WORD_TRIENODE_LEFT(grandParent) == parent) {
             WORD_TRIENODE_LEFT(grandParent) = sibling;
         } else {
@@ -2064,6 +2087,7 @@ Col_TrieMapIterSetValue(
          */
 
         ASSERT(WORD_TYPE(it->entry) == WORD_TYPE_MTRIELEAF);
+        WriteBarrier(it->entry);
         WORD_MAPENTRY_VALUE(it->entry) = value;
         break;
 
@@ -2083,6 +2107,7 @@ Col_TrieMapIterSetValue(
          */
 
         ASSERT(WORD_TYPE(it->entry) == WORD_TYPE_MINTTRIELEAF);
+        WriteBarrier(it->entry);
         WORD_MAPENTRY_VALUE(it->entry) = value;
         break;
 
@@ -2102,6 +2127,7 @@ Col_TrieMapIterSetValue(
          */
 
         ASSERT(WORD_TYPE(it->entry) == WORD_TYPE_MTRIELEAF);
+        WriteBarrier(it->entry);
         WORD_MAPENTRY_VALUE(it->entry) = value;
         break;
 
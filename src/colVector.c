@@ -355,6 +355,10 @@ Col_MVectorCapacity(
  *
  * @return The mutable vector element array.
  *
+ * @note
+ *      Elements must be modified before the next call to Col_ResumeGC(), as
+ *      the returned array may belong to an older generation.
+ *
  * @see Col_VectorLength
  */
 Col_Word *
@@ -370,6 +374,12 @@ Col_MVectorElements(
 
     WORD_UNWRAP(mvector);
 
+    /*
+     * Caller may store words into the returned array.
+     */
+
+    WriteBarrier(mvector);
+
     return WORD_VECTOR_ELEMENTS(mvector);
 }
 
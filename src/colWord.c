@@ -218,6 +218,9 @@ Col_WordType(
     case WORD_TYPE_STRBUF:
         return COL_STRBUF;
 
+    case WORD_TYPE_WEAKREF:
+        return COL_WEAKREF;
+
     /*
      * Mutable concat list nodes are only used internally, but handle them here
      * anyway for proper type checking in list procs.
@@ -468,6 +471,7 @@ Col_WordAddSynonym(
         } while (word != *wordPtr);
     }
     word = *wordPtr;
+    WriteBarrier(word);
 
     if (!HasSynonymField(synonym)) {
         if (!WORD_SYNONYM(word)) {
@@ -491,6 +495,7 @@ Col_WordAddSynonym(
 
     ASSERT(HasSynonymField(word));
     ASSERT(HasSynonymField(synonym));
+    WriteBarrier(synonym);
     if (!WORD_SYNONYM(word)) {
         WORD_SYNONYM(word) = word;
     } else if (!HasSynonymField(WORD_SYNONYM(word))) {
@@ -530,6 +535,7 @@ Col_WordClearSynonym(
         return;
     }
 
+    WriteBarrier(word);
     synonym = WORD_SYNONYM(word);
     if (!HasSynonymField(synonym)) {
         /*
@@ -549,6 +555,7 @@ Col_WordClearSynonym(
         synonym = WORD_SYNONYM(synonym);
         ASSERT(HasSynonymField(synonym));
     }
+    WriteBarrier(synonym);
     WORD_SYNONYM(synonym) = WORD_SYNONYM(word);
     WORD_SYNONYM(word) = WORD_NIL;
 }
@@ -556,6 +563,54 @@ Col_WordClearSynonym(
 /* End of Word Synonyms */
 
 
+/*******************************************************************************
+ * Weak References
+ ******************************************************************************/
+
+/**
+ * Create a new weak reference word.
+ *
+ * @note
+ *      Allocates memory cells.
+ *
+ * @return The new weak reference word.
+ *
+ * @see Col_WeakRefValue
+ */
+Col_Word
+Col_NewWeakRef(
+    Col_Word word)  /*!< Word to reference. */
+{
+    Col_Word ref;
+
+    ref = (Col_Word) AllocCells(1);
+    WORD_WEAKREF_INIT(ref, word);
+
+    return ref;
+}
+
+/**
+ * Get word held by a weak reference.
+ *
+ * @return The referenced word, or nil if it was collected.
+ *
+ * @see Col_NewWeakRef
+ */
+Col_Word
+Col_WeakRefValue(
+    Col_Word ref)   /*!< Weak reference word to get value for. */
+{
+    /*! @typecheck{COL_ERROR_WEAKREF,ref} */
+    TYPECHECK(WORD_TYPE(ref) == WORD_TYPE_WEAKREF, COL_ERROR_WEAKREF, ref) {
+        return WORD_NIL;
+    }
+
+    return WORD_WEAKREF_VALUE(ref);
+}
+
+/* End of Weak References */
+
+
 /*******************************************************************************
  * Word Operations
  ******************************************************************************/
@@ -760,15 +815,42 @@ Col_CustomWordInfo(
     }
 
     type = WORD_TYPEINFO(word);
-    switch (type->type) {
-    case COL_HASHMAP: headerSize = CUSTOMHASHMAP_HEADER_SIZE;
-    case COL_TRIEMAP: headerSize = CUSTOMTRIEMAP_HEADER_SIZE;
-    default:          headerSize = CUSTOM_HEADER_SIZE;
-    }
+    headerSize = CustomHeaderSize(type);
     *dataPtr = WORD_CUSTOM_DATA(word, type, headerSize);
     return type;
 }
 
 /* End of Custom Word Accessors */
 
+
+/*******************************************************************************
+ * Custom Word Operations
+ ******************************************************************************/
+
+/**
+ * Declare that a custom word's data is about to be modified in place, e.g.
+ * when storing a new child word. Must be called within the same GC-protected
+ * section as the modification.
+ *
+ * Parent tracking normally catches such writes through page protection.
+ * Builds using software write barriers need this call to keep older words
+ * from pointing to collected children, and #COL_SHARED groups to know when
+ * the caller's eden words get published to other threads.
+ *
+ * @see Col_CustomWordChildrenProc
+ */
+void
+Col_CustomWordModified(
+    Col_Word word)  /*!< The custom word being modified. */
+{
+    /*! @typecheck{COL_ERROR_CUSTOMWORD,word} */
+    TYPECHECK(WORD_TYPE(word) == WORD_TYPE_CUSTOM, COL_ERROR_CUSTOMWORD, word) {
+        return;
+    }
+
+    WriteBarrier(word);
+}
+
+/* End of Custom Word Operations */
+
 /* End of Words *//*!\}*/
@@ -79,6 +79,8 @@
 
 #define WORD_TYPE_STRBUF        114 /*!< @ref strbuf_words. */
 
+#define WORD_TYPE_WEAKREF       118 /*!< @ref weakref_words. */
+
 #ifdef PROMOTE_COMPACT
 #   define WORD_TYPE_REDIRECT   254 /*!< @ref redirect_words. */
 #endif
@@ -1838,6 +1840,111 @@ need a synonym field.
 /* End of Floating Point Wrappers *//*!\}*/
 
 
+/*
+===========================================================================*//*!
+\internal \defgroup weakref_words Weak Reference Words
+\ingroup predefined_words
+
+Weak reference words hold a word without keeping it alive.
+
+The GC does not follow the value of weak references from collected
+generations. Once marking is complete, the value is cleared if unreachable
+(see MarkWeakWords()).
+
+@par Requirements
+    - Weak reference words must store their value.
+
+    @param Value    Referenced word, nil once collected.
+
+@par Cell Layout
+    On all architectures the single-cell layout is as follows:
+
+    @dot
+    digraph {
+        node [fontname="Lucida Console,Courier" fontsize=14];
+        weakref_word [shape=none, label=<
+            <table border="0" cellborder="1" cellspacing="0">
+            <tr><td border="0"></td>
+                <td sides="B" width="40" align="left">0</td><td sides="B" width="40" align="right">7</td>
+                <td sides="B" width="120" align="left">8</td><td sides="B" width="120" align="right">n</td>
+            </tr>
+            <tr><td sides="R">0</td>
+                <td href="@ref WORD_TYPEID" title="WORD_TYPEID" colspan="2">Type</td>
+                <td colspan="2" bgcolor="grey75">Unused</td>
+            </tr>
+            <tr><td sides="R">1</td>
+                <td href="@ref WORD_WEAKREF_VALUE" title="WORD_WEAKREF_VALUE" colspan="4">Value</td>
+            </tr>
+            <tr><td sides="R">2</td>
+                <td colspan="4" rowspan="2" bgcolor="grey75">Unused</td>
+            </tr>
+            <tr><td sides="R">3</td></tr>
+            </table>
+        >]
+    }
+    @enddot
+
+    @begindiagram
+           0     7                                                       n
+          +-------+-------------------------------------------------------+
+        0 | Type  |                        Unused                         |
+          +-------+-------------------------------------------------------+
+        1 |                             Value                             |
+          +---------------------------------------------------------------+
+        2 |                                                               |
+          +                            Unused                             +
+        3 |                                                               |
+          +---------------------------------------------------------------+
+    @enddiagram
+
+@see WORD_TYPE_WEAKREF
+\{*//*==========================================================================
+*/
+
+/***************************************************************************//*!
+ * \name Weak Reference Word Creation
+ ***************************************************************************\{*/
+
+/**
+ * Weak reference word initializer.
+ *
+ * @param word      Word to initialize.
+ * @param value     #WORD_WEAKREF_VALUE.
+ *
+ * @warning
+ *      Argument **word** is referenced several times by the macro. Make sure to
+ *      avoid any side effect.
+ *
+ * @see WORD_TYPE_WEAKREF
+ */
+#define WORD_WEAKREF_INIT(word, value) \
+    WORD_SET_TYPEID((word), WORD_TYPE_WEAKREF); \
+    WORD_WEAKREF_VALUE(word) = (value);
+
+/* End of Weak Reference Word Creation *//*!\}*/
+
+
+/***************************************************************************//*!
+ * \name Weak Reference Word Accessors
+ ***************************************************************************\{*/
+
+/**
+ * Get/set referenced word.
+ *
+ * @param word  Word to access.
+ *
+ * @note
+ *      Macro is L-Value and suitable for both read/write operations.
+ *
+ * @see WORD_WEAKREF_INIT
+ */
+#define WORD_WEAKREF_VALUE(word)    (((Col_Word *)(word))[1])
+
+/* End of Weak Reference Word Accessors *//*!\}*/
+
+/* End of Weak Reference Words *//*!\}*/
+
+
 #ifdef PROMOTE_COMPACT
 /*
 ===========================================================================*//*!
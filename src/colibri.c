@@ -364,6 +364,28 @@ Col_Cleanup()
     PlatLeave();
 }
 
+/**
+ * Reserve address space for the heap ahead of time, e.g. at startup, so that
+ * the heap can grow up to the given size without reserving new address
+ * ranges. Reserved memory is shared by all threads and is only released on
+ * process exit. Must be called after Col_Init().
+ *
+ * When prefaulting, reserved pages are populated right away. First-touch
+ * page faults then occur here rather than when cells get allocated.
+ *
+ * @retval <>0  for success.
+ * @retval 0    for failure.
+ *
+ * @see Col_Init
+ */
+int
+Col_ReserveMemory(
+    size_t size,    /*!< Size to reserve in bytes. */
+    int prefault)   /*!< Whether to prefault reserved pages. */
+{
+    return SysPageReserve((size + systemPageSize - 1) >> shiftPage, prefault);
+}
+
 /* End of Initialization/Cleanup Functions */
 
 /* End of Initialization/Cleanup *//*!\}*/
@@ -431,6 +453,11 @@ const char * const ColibriDomain[] = {
     "Map iterator %x is at end",                /* COL_ERROR_MAPITER_END (iterator) */
     "%x is not a string buffer",                /* COL_ERROR_STRBUF (word) */
     "String format %d is not supported",        /* COL_ERROR_STRBUF_FORMAT (format) */
+    "%d is not a valid GC parameter",           /* COL_ERROR_GCPARAM (param) */
+    "Heap size %u exceeds limit %u",            /* COL_ERROR_HEAPLIMIT (size, limit) */
+    "%u is not a valid handle scope",           /* COL_ERROR_HANDLESCOPE (scope) */
+    "%x is not a weak reference",               /* COL_ERROR_WEAKREF (word) */
+    "%d is not a valid weakness for this map",  /* COL_ERROR_WEAKNESS (weakness) */
 };
 
 /** @endcond @endprivate */
@@ -20,6 +20,14 @@
 #include <unistd.h>
 #include <pthread.h>
 #include <signal.h>
+#include <time.h>
+#include <errno.h>
+#ifdef COL_USE_THREADS
+#   include <sys/resource.h>
+#   ifdef __linux__
+#       include <sys/syscall.h>
+#   endif
+#endif /* COL_USE_THREADS */
 
 /*
  * Prototypes for functions used only in this file.
@@ -29,7 +37,13 @@
 static struct UnixGroupData * AllocGroupData(unsigned int model);
 static void             FreeGroupData(struct UnixGroupData *groupData);
 #ifdef COL_USE_THREADS
-static void *           GcThreadProc(void *arg);
+static ThreadData *     InitInternalThreadData(GroupData *groupData);
+static void             ScheduleGC(struct UnixGroupData *groupData);
+static void             UnscheduleGC(struct UnixGroupData *groupData);
+static void             CollectGroup(struct UnixGroupData *groupData);
+static int              StartWorker(void);
+static void             ApplyWorkerConfig(size_t affinity, size_t priority);
+static void *           WorkerThreadProc(void *arg);
 #endif /* COL_USE_THREADS */
 static void             Init(void);
 /*! \endcond *//* IGNORE */
@@ -66,13 +80,23 @@ static const int MultiplyDeBruijnBitPosition2[32] =
 
 /** @beginprivate @cond PRIVATE */
 
+#ifdef PLAT_THREAD_LOCAL
+/**
+ * Thread-specific data.
+ *
+ * @see ThreadData
+ * @see PlatGetThreadData
+ */
+PLAT_HIDDEN PLAT_THREAD_LOCAL ThreadData *platThreadData;
+#else
 /**
  * Thread-speficic data identifier. Used to get thread-specific data.
  *
  * @see ThreadData
  * @see Init
  */
-pthread_key_t tsdKey;
+PLAT_HIDDEN pthread_key_t tsdKey;
+#endif /* PLAT_THREAD_LOCAL */
 
 /**
  * Platform-specific group data.
@@ -91,12 +115,18 @@ typedef struct UnixGroupData {
 
     pthread_mutex_t mutexGc;        /*!< Mutex protecting GC from worker
                                          threads. */
-    pthread_cond_t condGcScheduled; /*!< Triggers GC thread. */
     pthread_cond_t condGcDone;      /*!< Barrier for worker threads. */
-    int scheduled;                  /*!< Flag for when a GC is scheduled. */
-    int terminated;                 /*!< Flag for thread group destruction. */
-    int nbActive;                   /*!< Active worker thread counter. */
-    pthread_t threadGc;             /*!< GC thread. */
+    uintptr_t syncState;            /*!< GC synchronization state, see
+                                         #GC_SYNC_PENDING. */
+    uintptr_t finalizeState;        /*!< Finalization state of words queued by
+                                         thread-local collections, see
+                                         #GC_FINALIZE_QUEUED. */
+    struct UnixGroupData *nextQueued;
+                                    /*!< Next group in the GC queue of
+                                         #workers. */
+    int queued;                     /*!< Whether group is in the GC queue. */
+    int collecting;                 /*!< Number of GC workers handling the
+                                         group. */
 #endif /* COL_USE_THREADS */
 } UnixGroupData;
 
@@ -152,13 +182,6 @@ AllocGroupData(
 
         pthread_mutex_init(&groupData->mutexGc, NULL);
         pthread_cond_init(&groupData->condGcDone, NULL);
-        pthread_cond_init(&groupData->condGcScheduled, NULL);
-
-        /*
-         * Create GC thread.
-         */
-
-        pthread_create(&groupData->threadGc, NULL, GcThreadProc, groupData);
     }
 #endif /* COL_USE_THREADS */
 
@@ -181,23 +204,15 @@ FreeGroupData(
 #ifdef COL_USE_THREADS
     if (groupData->data.model != COL_SINGLE) {
         /*
-         * Signal and wait for termination of GC thread.
+         * Cancel pending GC and wait for GC workers to release the group.
          */
 
-        //TODO error handling.
-        groupData->terminated = 1;
-        pthread_mutex_lock(&groupData->mutexGc);
-        {
-            pthread_cond_signal(&groupData->condGcScheduled);
-        }
-        pthread_mutex_unlock(&groupData->mutexGc);
-        pthread_join(groupData->threadGc, NULL);
+        UnscheduleGC(groupData);
 
         /*
          * Destroy synchronization objects.
          */
 
-        pthread_cond_destroy(&groupData->condGcScheduled);
         pthread_cond_destroy(&groupData->condGcDone);
         pthread_mutex_destroy(&groupData->mutexGc);
 
@@ -248,7 +263,7 @@ PlatEnter(
     ThreadData *data;
 
     /*
-     * Ensures that the TSD key is created once.
+     * Ensures that the process is initialized once.
      */
 
     pthread_once(&once, Init);
@@ -272,7 +287,7 @@ PlatEnter(
     data->nestCount = 1;
     UNIX_PROTECT_ADDRESS_RANGES_RECURSE(data) = 0;
     GcInitThread(data);
-    pthread_setspecific(tsdKey, data);
+    PlatSetThreadData(data);
 
 #ifdef COL_USE_THREADS
     if (model == COL_SINGLE || model == COL_ASYNC) {
@@ -371,16 +386,24 @@ PlatLeave()
 #ifdef COL_USE_THREADS
     } else {
         /*
-         * Remove from shared group.
+         * Remove from shared group. Live words of the thread's eden must
+         * first be handed over to the group.
          */
 
+        GcDetachThread(data);
+
         pthread_mutex_lock(&mutexSharedGroups);
         {
             if (data->next == data) {
                 /*
-                 * Free group as well.
+                 * Unlink and free group as well.
                  */
 
+                UnixGroupData **groupPtr = &sharedGroups;
+                while (*groupPtr != (UnixGroupData *) data->groupData) {
+                    groupPtr = &(*groupPtr)->next;
+                }
+                *groupPtr = (*groupPtr)->next;
                 FreeGroupData((UnixGroupData *) data->groupData);
             } else {
                 /*
@@ -401,54 +424,136 @@ PlatLeave()
 
     GcCleanupThread(data);
     free(data);
-    pthread_setspecific(tsdKey, 0);
+    PlatSetThreadData(NULL);
 
     return 1;
 }
 
+/**
+ * Get the identifier of the current process.
+ *
+ * @return The process ID.
+ *
+ * @see PlatGetThreadId
+ */
+size_t
+PlatGetProcessId()
+{
+    return (size_t) getpid();
+}
+
+/**
+ * Get the identifier of the calling thread. On Linux this is the kernel
+ * thread ID, as displayed by system tools.
+ *
+ * @return The thread ID.
+ *
+ * @see PlatGetProcessId
+ */
+size_t
+PlatGetThreadId()
+{
+#if defined(COL_USE_THREADS) && defined(__linux__)
+    return (size_t) syscall(SYS_gettid);
+#elif defined(COL_USE_THREADS)
+    return (size_t) pthread_self();
+#else
+    return (size_t) getpid();
+#endif
+}
+
 #ifdef COL_USE_THREADS
 
 /**
- * Thread dedicated to the GC process. Activated when one of the worker threads
- * in the group triggers the GC.
+ * Initialize thread data for internal threads, i.e. GC workers. Such threads
+ * are not group members, they only need thread data for page allocation and
+ * address range protection on behalf of the group they serve.
  *
- * @return Always zero.
+ * @return The newly allocated structure.
  *
  * @sideeffect
- *      Calls #PerformGC.
+ *      Memory allocated and thread-specific data set.
  *
- * @see AllocGroupData
+ * @see WorkerThreadProc
+ */
+static ThreadData *
+InitInternalThreadData(
+    GroupData *groupData)   /*!< Group-specific data. */
+{
+    ThreadData *data = (ThreadData *) malloc(sizeof(*data)
+            + sizeof(UNIX_PROTECT_ADDRESS_RANGES_RECURSE(data)));
+    memset(data, 0, sizeof(*data));
+    data->groupData = groupData;
+    UNIX_PROTECT_ADDRESS_RANGES_RECURSE(data) = 0;
+    PlatSetThreadData(data);
+    return data;
+}
+
+/**
+ * Perform the GC of a group on behalf of a GC worker, once all worker threads
+ * in the group have left their GC-protected section. Clears the
+ * #GC_SYNC_PENDING flag and wakes threads blocked in PlatSyncPauseGC().
+ *
+ * Custom words queued for finalization are then finalized while other
+ * threads run. The worker stays registered as active meanwhile, so that the
+ * next GC waits for it. The same goes for words queued by thread-local
+ * collections (see PlatScheduleFinalize()).
+ *
+ * @sideeffect
+ *      Calls #PerformGC and #FinalizeWords.
+ *
+ * @see WorkerThreadProc
  * @see PerformGC
+ * @see FinalizeWords
  */
-static void *
-GcThreadProc(
-    void *arg)  /*!< #UnixGroupData. */
+static void
+CollectGroup(
+    UnixGroupData *groupData)   /*!< Group to collect. */
 {
-    UnixGroupData *groupData = (UnixGroupData *) arg;
-    for (;;) {
-        pthread_mutex_lock(&groupData->mutexGc);
-        {
-            pthread_cond_wait(&groupData->condGcScheduled, &groupData->mutexGc);
-            if (groupData->scheduled) {
-                groupData->scheduled = 0;
-                PerformGC((GroupData *) groupData);
-                pthread_cond_broadcast(&groupData->condGcDone);
-            }
-        }
-        pthread_mutex_unlock(&groupData->mutexGc);
-        if (groupData->terminated) {
-            pthread_exit(NULL);
+    int finalize = 0;
+
+    pthread_mutex_lock(&groupData->mutexGc);
+    {
+        if (PlatAtomicLoad(&groupData->syncState) == GC_SYNC_PENDING) {
+            PerformGC((GroupData *) groupData);
+            finalize = (groupData->data.finalizables != WORD_NIL);
+            PlatAtomicStore(&groupData->syncState,
+                    finalize ? GC_SYNC_ACTIVE : 0);
+            pthread_cond_broadcast(&groupData->condGcDone);
         }
     }
+    pthread_mutex_unlock(&groupData->mutexGc);
+
+    if (finalize) {
+        FinalizeWords((GroupData *) groupData);
+        PlatSyncResumeGC((GroupData *) groupData, 0);
+    }
+
+    if (PlatAtomicCas(&groupData->finalizeState, GC_FINALIZE_QUEUED,
+            GC_FINALIZE_CLAIMED)) {
+        /*
+         * Finalize words queued by thread-local collections, including
+         * those queued meanwhile.
+         */
+
+        do {
+            FinalizeWords((GroupData *) groupData);
+            PlatAtomicStore(&groupData->finalizeState, 0);
+        } while (PlatAtomicLoad(&groupData->data.finalizables) != WORD_NIL
+                && PlatAtomicCas(&groupData->finalizeState, 0,
+                GC_FINALIZE_CLAIMED));
+        PlatSyncResumeGC((GroupData *) groupData, 0);
+    }
 }
 
 /**
- * Called when a worker thread calls the outermost Col_PauseGC().
+ * Called when a worker thread calls the outermost Col_PauseGC(). Takes the
+ * group's **mutexGc** only when a GC is pending.
  *
  * @sideeffect
  *      May block as long as a GC is underway.
  *
- * @see GcThreadProc
+ * @see CollectGroup
  * @see SyncPauseGC
  * @see Col_PauseGC
  */
@@ -457,14 +562,32 @@ PlatSyncPauseGC(
     GroupData *data)    /*!< Group-specific data. */
 {
     UnixGroupData *groupData = (UnixGroupData *) data;
-    pthread_mutex_lock(&groupData->mutexGc);
-    {
-        if (groupData->scheduled) {
+    uintptr_t state;
+
+    for (;;) {
+        state = PlatAtomicLoad(&groupData->syncState);
+        if (!(state & GC_SYNC_PENDING)) {
+            /*
+             * Fast path: no GC pending, register as active.
+             */
+
+            if (PlatAtomicCas(&groupData->syncState, state,
+                    state + GC_SYNC_ACTIVE)) {
+                return;
+            }
+            continue;
+        }
+
+        /*
+         * Slow path: wait for the GC to complete and try again.
+         */
+
+        pthread_mutex_lock(&groupData->mutexGc);
+        while (PlatAtomicLoad(&groupData->syncState) & GC_SYNC_PENDING) {
             pthread_cond_wait(&groupData->condGcDone, &groupData->mutexGc);
         }
-        groupData->nbActive++;
+        pthread_mutex_unlock(&groupData->mutexGc);
     }
-    pthread_mutex_unlock(&groupData->mutexGc);
 }
 
 /**
@@ -473,7 +596,7 @@ PlatSyncPauseGC(
  * @retval <>0  if successful.
  * @retval 0    if call would block.
  *
- * @see GcThreadProc
+ * @see CollectGroup
  * @see TrySyncPauseGC
  * @see Col_TryPauseGC
  */
@@ -482,15 +605,15 @@ PlatTrySyncPauseGC(
     GroupData *data)    /*!< Group-specific data. */
 {
     UnixGroupData *groupData = (UnixGroupData *) data;
-    if (!pthread_mutex_trylock(&groupData->mutexGc)) {
-        return 0;
-    } else {
-        if (groupData->scheduled) {
-            pthread_cond_wait(&groupData->condGcDone, &groupData->mutexGc);
+    uintptr_t state;
+
+    do {
+        state = PlatAtomicLoad(&groupData->syncState);
+        if (state & GC_SYNC_PENDING) {
+            return 0;
         }
-        groupData->nbActive++;
-    }
-    pthread_mutex_unlock(&groupData->mutexGc);
+    } while (!PlatAtomicCas(&groupData->syncState, state,
+            state + GC_SYNC_ACTIVE));
     return 1;
 }
 
@@ -498,11 +621,11 @@ PlatTrySyncPauseGC(
  * Called when a worker thread calls the outermost Col_ResumeGC().
  *
  * @sideeffect
- *      If last thread in group, may trigger the GC in the dedicated thread if
+ *      If last thread in group, may queue the GC for the GC workers if
  *      previously scheduled. This will block further calls to
  *      Col_PauseGC() / PlatSyncPauseGC().
  *
- * @see GcThreadProc
+ * @see ScheduleGC
  * @see SyncResumeGC
  * @see Col_ResumeGC
  */
@@ -512,17 +635,50 @@ PlatSyncResumeGC(
     int performGc)      /*!< Whether to perform GC. */
 {
     UnixGroupData *groupData = (UnixGroupData *) data;
-    pthread_mutex_lock(&groupData->mutexGc);
-    {
-        if (performGc) {
-            groupData->scheduled = 1;
-        }
-        --groupData->nbActive;
-        if (!groupData->nbActive && groupData->scheduled) {
-            pthread_cond_signal(&groupData->condGcScheduled);
-        }
+
+    if (performGc && !(PlatAtomicLoad(&groupData->syncState)
+            & GC_SYNC_PENDING)) {
+        /*
+         * Schedule GC. This blocks further pause calls, so the thread that
+         * brings the active count down to zero is the only one to queue it.
+         */
+
+        PlatAtomicOr(&groupData->syncState, GC_SYNC_PENDING);
+    }
+    if (PlatAtomicAdd(&groupData->syncState, (uintptr_t) -GC_SYNC_ACTIVE)
+            == GC_SYNC_PENDING) {
+        ScheduleGC(groupData);
+    }
+}
+
+/**
+ * Called when a thread-local collection has queued custom words for
+ * finalization. Queues the group for the GC workers unless one of them is
+ * already due to finalize queued words.
+ *
+ * @pre
+ *      Caller must be within a GC-protected section.
+ *
+ * @see CollectGroup
+ * @see PerformLocalGC
+ */
+void
+PlatScheduleFinalize(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    UnixGroupData *groupData = (UnixGroupData *) data;
+
+    /*
+     * Register the worker as active beforehand, as it may resume as soon as
+     * the group is queued.
+     */
+
+    PlatAtomicAdd(&groupData->syncState, GC_SYNC_ACTIVE);
+    if (PlatAtomicCas(&groupData->finalizeState, 0, GC_FINALIZE_QUEUED)) {
+        ScheduleGC(groupData);
+    } else {
+        PlatAtomicAdd(&groupData->syncState, (uintptr_t) -GC_SYNC_ACTIVE);
     }
-    pthread_mutex_unlock(&groupData->mutexGc);
 }
 
 /**
@@ -566,6 +722,497 @@ PlatLeaveProtectRoots(
 /* End of Process & Threads *//*!\}*/
 
 
+#ifdef COL_USE_THREADS
+
+/***************************************************************************//*!
+ * \name Parallel Processing
+ ***************************************************************************\{*/
+
+/** @beginprivate @cond PRIVATE */
+
+/**
+ * Process-wide pool of GC workers. GC workers perform the collections that
+ * groups schedule (see ScheduleGC()), and run the tasks started by
+ * PlatRunParallel(). Threads are created lazily, up to #COL_GC_WORKERS, and
+ * live until the process exits or their maximum number is lowered.
+ *
+ * @see PlatRunParallel
+ * @see ScheduleGC
+ * @see WorkerThreadProc
+ */
+static struct {
+    pthread_mutex_t mutex;      /*!< Mutex protecting the structure. */
+    pthread_cond_t condStart;   /*!< Triggers GC workers. */
+    pthread_cond_t condDone;    /*!< Signaled when the last running task
+                                     completes. */
+    pthread_cond_t condCollected;
+                                /*!< Signaled when GC workers release a
+                                     group. */
+    size_t nbThreads;           /*!< Number of GC workers. */
+    size_t nbIdle;              /*!< Number of idle GC workers. */
+    size_t maxThreads;          /*!< Maximum number of GC workers. */
+    size_t affinity;            /*!< Processor mask of GC workers, 0 for
+                                     all. */
+    size_t priority;            /*!< Priority of GC workers. */
+    size_t config;              /*!< Incremented when affinity or priority
+                                     change. */
+    UnixGroupData *firstQueued; /*!< First group in GC queue. */
+    UnixGroupData *lastQueued;  /*!< Last group in GC queue. */
+    GroupData *groupData;       /*!< Group on behalf of which tasks run. */
+    PlatParallelProc *proc;     /*!< Task proc. */
+    void *clientData;           /*!< Opaque data passed to task proc. */
+    size_t number;              /*!< Number of tasks. */
+    size_t next;                /*!< Index of next task to start. */
+    size_t running;             /*!< Number of tasks running on workers. */
+} workers = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+    PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+    0, 0, 1, 0, GC_DEFAULT_WORKER_PRIORITY
+};
+
+#ifdef __linux__
+/**
+ * Processor mask inherited by GC workers when no affinity is set. Sized for
+ * 1024 processors like the system's **cpu_set_t**.
+ *
+ * @see Init
+ * @see ApplyWorkerConfig
+ */
+static unsigned long defaultAffinity[1024/(sizeof(unsigned long)*8)];
+#endif /* __linux__ */
+
+/**
+ * Mutex serializing calls to PlatRunParallel().
+ *
+ * @see PlatRunParallel
+ */
+static pthread_mutex_t mutexParallel = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Run tasks in parallel. Task 0 runs on the calling thread, other tasks run
+ * on the GC workers. Tasks that haven't started when task 0 completes are
+ * cancelled, so task 0 must be able to complete the whole job alone. This
+ * also happens when the workers are busy serving another group.
+ *
+ * @sideeffect
+ *      GC workers may be created. Blocks until all started tasks are
+ *      complete.
+ *
+ * @see PlatParallelProc
+ * @see WorkerThreadProc
+ */
+void
+PlatRunParallel(
+    GroupData *data,            /*!< Group-specific data. */
+    size_t number,              /*!< Number of tasks. */
+    PlatParallelProc *proc,     /*!< Task proc. */
+    void *clientData)           /*!< Opaque data passed as is to **proc**. */
+{
+    if (number > 1 && pthread_mutex_trylock(&mutexParallel)) {
+        /*
+         * Workers are busy, run alone.
+         */
+
+        number = 1;
+    }
+    if (number <= 1) {
+        proc(0, clientData);
+        return;
+    }
+
+    pthread_mutex_lock(&workers.mutex);
+    {
+        /*
+         * Create missing GC workers.
+         */
+
+        while (workers.nbThreads < number-1
+                && workers.nbThreads < workers.maxThreads) {
+            if (!StartWorker()) break;
+        }
+
+        /*
+         * Start tasks.
+         */
+
+        workers.groupData = data;
+        workers.proc = proc;
+        workers.clientData = clientData;
+        workers.number = number;
+        workers.next = 1;
+        pthread_cond_broadcast(&workers.condStart);
+    }
+    pthread_mutex_unlock(&workers.mutex);
+
+    proc(0, clientData);
+
+    pthread_mutex_lock(&workers.mutex);
+    {
+        /*
+         * Cancel pending tasks and wait for running ones.
+         */
+
+        workers.next = workers.number;
+        while (workers.running) {
+            pthread_cond_wait(&workers.condDone, &workers.mutex);
+        }
+    }
+    pthread_mutex_unlock(&workers.mutex);
+
+    pthread_mutex_unlock(&mutexParallel);
+}
+
+/**
+ * Queue the GC of a group for the GC workers. Called once all of its worker
+ * threads have left their GC-protected section.
+ *
+ * @sideeffect
+ *      May create a GC worker or wake an idle one.
+ *
+ * @see PlatSyncResumeGC
+ * @see CollectGroup
+ */
+static void
+ScheduleGC(
+    UnixGroupData *groupData)   /*!< Group to collect. */
+{
+    pthread_mutex_lock(&workers.mutex);
+    if (!groupData->queued) {
+        groupData->queued = 1;
+        groupData->nextQueued = NULL;
+        if (workers.lastQueued) {
+            workers.lastQueued->nextQueued = groupData;
+        } else {
+            workers.firstQueued = groupData;
+        }
+        workers.lastQueued = groupData;
+
+        if (workers.nbIdle || workers.nbThreads >= workers.maxThreads
+                || !StartWorker()) {
+            pthread_cond_signal(&workers.condStart);
+        }
+    }
+    pthread_mutex_unlock(&workers.mutex);
+}
+
+/**
+ * Remove a group from the GC queue, and wait until no GC worker handles it.
+ *
+ * @see FreeGroupData
+ */
+static void
+UnscheduleGC(
+    UnixGroupData *groupData)   /*!< Group to remove. */
+{
+    UnixGroupData *prev;
+
+    pthread_mutex_lock(&workers.mutex);
+    if (groupData->queued) {
+        if (workers.firstQueued == groupData) {
+            prev = NULL;
+            workers.firstQueued = groupData->nextQueued;
+        } else {
+            for (prev = workers.firstQueued; prev->nextQueued != groupData;
+                    prev = prev->nextQueued);
+            prev->nextQueued = groupData->nextQueued;
+        }
+        if (workers.lastQueued == groupData) {
+            workers.lastQueued = prev;
+        }
+        groupData->queued = 0;
+    }
+    while (groupData->collecting) {
+        pthread_cond_wait(&workers.condCollected, &workers.mutex);
+    }
+    pthread_mutex_unlock(&workers.mutex);
+}
+
+/**
+ * Create a GC worker. Must be called with the **workers** mutex held.
+ *
+ * @retval <>0  if successful.
+ * @retval 0    otherwise.
+ *
+ * @see WorkerThreadProc
+ */
+static int
+StartWorker()
+{
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, WorkerThreadProc, NULL)) {
+        return 0;
+    }
+    pthread_detach(thread);
+    workers.nbThreads++;
+    return 1;
+}
+
+/**
+ * Apply processor affinity and priority to the calling GC worker. Both are
+ * hints, so failures are ignored. Only supported on Linux, where both are
+ * per-thread attributes; system calls are used directly so as not to depend
+ * on GNU extensions.
+ *
+ * @see COL_GC_WORKER_AFFINITY
+ * @see COL_GC_WORKER_PRIORITY
+ */
+static void
+ApplyWorkerConfig(
+    size_t affinity,    /*!< Processor mask, 0 for default. */
+    size_t priority)    /*!< Priority from 0 (lowest) to 4 (highest). */
+{
+#ifdef __linux__
+    unsigned long cpus[sizeof(defaultAffinity)/sizeof(*defaultAffinity)];
+
+    if (affinity) {
+        memset(cpus, 0, sizeof(cpus));
+        cpus[0] = (unsigned long) affinity;
+    } else {
+        memcpy(cpus, defaultAffinity, sizeof(cpus));
+    }
+
+    /*
+     * Zero ids apply to the calling thread. Nice values range from 10
+     * (lowest) to -10 (highest) in steps of 5.
+     */
+
+    syscall(SYS_sched_setaffinity, 0, sizeof(cpus), cpus);
+
+    setpriority(PRIO_PROCESS, 0, ((int) GC_DEFAULT_WORKER_PRIORITY
+            - (int) priority) * 5);
+#endif /* __linux__ */
+}
+
+/**
+ * GC worker thread. Performs the collections queued by ScheduleGC(), and runs
+ * the tasks started by PlatRunParallel(), which take precedence as they are
+ * part of a collection underway.
+ *
+ * @return Always NULL.
+ *
+ * @see ScheduleGC
+ * @see PlatRunParallel
+ */
+static void *
+WorkerThreadProc(
+    void *arg)  /*!< Unused. */
+{
+    ThreadData *data = InitInternalThreadData(NULL);
+    UnixGroupData *groupData;
+    PlatParallelProc *proc;
+    void *clientData;
+    size_t index, config = 0, affinity, priority, delay;
+    struct timespec deadline;
+    int timeout;
+
+    pthread_mutex_lock(&workers.mutex);
+    for (;;) {
+        if (config != workers.config) {
+            /*
+             * Apply new affinity and priority.
+             */
+
+            config = workers.config;
+            affinity = workers.affinity;
+            priority = workers.priority;
+            pthread_mutex_unlock(&workers.mutex);
+
+            ApplyWorkerConfig(affinity, priority);
+
+            pthread_mutex_lock(&workers.mutex);
+            continue;
+        }
+
+        if (workers.next < workers.number) {
+            /*
+             * Start next task.
+             */
+
+            index = workers.next++;
+            workers.running++;
+            data->groupData = workers.groupData;
+            proc = workers.proc;
+            clientData = workers.clientData;
+            pthread_mutex_unlock(&workers.mutex);
+
+            proc(index, clientData);
+
+            pthread_mutex_lock(&workers.mutex);
+            if (!--workers.running) {
+                pthread_cond_broadcast(&workers.condDone);
+            }
+            continue;
+        }
+
+        if (workers.firstQueued) {
+            /*
+             * Collect next group in queue.
+             */
+
+            groupData = workers.firstQueued;
+            workers.firstQueued = groupData->nextQueued;
+            if (!workers.firstQueued) {
+                workers.lastQueued = NULL;
+            }
+            groupData->queued = 0;
+            groupData->collecting++;
+            data->groupData = (GroupData *) groupData;
+            pthread_mutex_unlock(&workers.mutex);
+
+            CollectGroup(groupData);
+
+            /*
+             * Mutators never allocate from the worker's page cache, so
+             * return freed pages to their address ranges right away.
+             */
+
+            SysPageCacheCleanup(data);
+
+            pthread_mutex_lock(&workers.mutex);
+            if (!--groupData->collecting) {
+                pthread_cond_broadcast(&workers.condCollected);
+            }
+            continue;
+        }
+
+        if (workers.nbThreads > workers.maxThreads) {
+            /*
+             * Maximum number was lowered, exit.
+             */
+
+            workers.nbThreads--;
+            break;
+        }
+
+        /*
+         * Wait for work. Meanwhile, return free pages to the system
+         * periodically, as the next GC may be far away.
+         */
+
+        workers.nbIdle++;
+        delay = PlatAtomicLoad(&decommitDelay);
+        timeout = 0;
+        if (delay) {
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += delay / 1000;
+            deadline.tv_nsec += (delay % 1000) * 1000000;
+            if (deadline.tv_nsec >= 1000000000) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000;
+            }
+            timeout = (pthread_cond_timedwait(&workers.condStart,
+                    &workers.mutex, &deadline) == ETIMEDOUT);
+        } else {
+            pthread_cond_wait(&workers.condStart, &workers.mutex);
+        }
+        workers.nbIdle--;
+        if (timeout) {
+            pthread_mutex_unlock(&workers.mutex);
+            SysPageDecommit();
+            pthread_mutex_lock(&workers.mutex);
+        }
+    }
+    pthread_mutex_unlock(&workers.mutex);
+
+    SysPageCacheCleanup(data);
+    PlatSetThreadData(NULL);
+    free(data);
+    return NULL;
+}
+
+/**
+ * Get the value of a GC worker parameter.
+ *
+ * @return The parameter value.
+ *
+ * @see Col_GetGcParam
+ */
+size_t
+PlatGetWorkerParam(
+    Col_GcParam param)  /*!< #COL_GC_WORKERS, #COL_GC_WORKER_AFFINITY or
+                             #COL_GC_WORKER_PRIORITY. */
+{
+    size_t value;
+
+    pthread_mutex_lock(&workers.mutex);
+    switch (param) {
+    case COL_GC_WORKERS:         value = workers.maxThreads; break;
+    case COL_GC_WORKER_AFFINITY: value = workers.affinity; break;
+    case COL_GC_WORKER_PRIORITY: value = workers.priority; break;
+    default:                     value = 0;
+    }
+    pthread_mutex_unlock(&workers.mutex);
+    return value;
+}
+
+/**
+ * Set the value of a GC worker parameter.
+ *
+ * @sideeffect
+ *      Wakes idle GC workers so that they apply the new value.
+ *
+ * @see Col_SetGcParam
+ */
+void
+PlatSetWorkerParam(
+    Col_GcParam param,  /*!< #COL_GC_WORKERS, #COL_GC_WORKER_AFFINITY or
+                             #COL_GC_WORKER_PRIORITY. */
+    size_t value)       /*!< New value, already clamped. */
+{
+    pthread_mutex_lock(&workers.mutex);
+    switch (param) {
+    case COL_GC_WORKERS:
+        workers.maxThreads = value;
+        break;
+
+    case COL_GC_WORKER_AFFINITY:
+        workers.affinity = value;
+        workers.config++;
+        break;
+
+    case COL_GC_WORKER_PRIORITY:
+        workers.priority = value;
+        workers.config++;
+        break;
+
+    default:
+        break;
+    }
+    pthread_cond_broadcast(&workers.condStart);
+    pthread_mutex_unlock(&workers.mutex);
+}
+
+/** @endcond @endprivate */
+
+/* End of Parallel Processing *//*!\}*/
+
+#endif /* COL_USE_THREADS */
+
+
+/***************************************************************************//*!
+ * \name Time
+ ***************************************************************************\{*/
+
+/** @beginprivate @cond PRIVATE */
+
+/**
+ * Get the value of a monotonic clock.
+ *
+ * @return Elapsed time in microseconds since an arbitrary origin.
+ */
+uint64_t
+PlatGetMicroseconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/** @endcond @endprivate */
+
+/* End of Time *//*!\}*/
+
+
 /***************************************************************************//*!
  * \name System Page Allocation
  ***************************************************************************\{*/
@@ -576,7 +1223,8 @@ PlatLeaveProtectRoots(
  * Mutex protecting address range management.
  *
  * - #ranges:          Reserved address ranges for general purpose.
- * - #dedicatedRanges: Dedicated address ranges for large pages.
+ * - #rangeIndex:      Index of all address ranges, including dedicated
+ *                     ranges for large pages.
  *
  * @see PlatEnterProtectAddressRanges
  * @see PlatLeaveProtectAddressRanges
@@ -584,7 +1232,9 @@ PlatLeaveProtectRoots(
 pthread_mutex_t mutexRange = PTHREAD_MUTEX_INITIALIZER;
 
 /**
- * Reserve an address range.
+ * Reserve an address range. When #COL_USE_HUGE_PAGES is defined, ranges of
+ * at least #HUGE_PAGE_MIN_RANGE pages are advised for transparent huge
+ * pages.
  *
  * @return The reserved range's base address, or NULL if failure.
  */
@@ -596,7 +1246,66 @@ PlatReserveRange(
     void *addr = mmap(NULL, size << shiftPage,
             (alloc ? PROT_READ | PROT_WRITE : PROT_NONE),
             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    return (addr == MAP_FAILED ? NULL : addr);
+    if (addr == MAP_FAILED) {
+        return NULL;
+    }
+#if defined(COL_USE_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+    if (size >= HUGE_PAGE_MIN_RANGE) {
+        /*
+         * Only a hint, ignore failures.
+         */
+
+        madvise(addr, size << shiftPage, MADV_HUGEPAGE);
+    }
+#endif /* COL_USE_HUGE_PAGES */
+    return addr;
+}
+
+/**
+ * Prefault pages of a reserved address range, so that first-touch page
+ * faults don't occur when pages get allocated. Pages remain inaccessible
+ * until allocated.
+ *
+ * @attention
+ *      Range must not be in use yet, as its content is replaced.
+ *
+ * @retval <>0  for success.
+ * @retval 0    for failure.
+ */
+int
+PlatPrefaultRange(
+    void *base,     /*!< Base address of range to prefault. */
+    size_t size)    /*!< Number of pages in range. */
+{
+#ifdef MAP_POPULATE
+    /*
+     * Replace reservation with a populated mapping.
+     */
+
+    if (mmap(base, size << shiftPage, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_POPULATE, -1, 0)
+            == MAP_FAILED) {
+        return 0;
+    }
+#else
+    /*
+     * Touch every page.
+     */
+
+    size_t i;
+    if (mprotect(base, size << shiftPage, PROT_READ | PROT_WRITE)) {
+        return 0;
+    }
+    for (i = 0; i < size; i++) {
+        *((volatile char *) base + (i << shiftPage)) = 0;
+    }
+#endif /* MAP_POPULATE */
+#if defined(COL_USE_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+    if (size >= HUGE_PAGE_MIN_RANGE) {
+        madvise(base, size << shiftPage, MADV_HUGEPAGE);
+    }
+#endif /* COL_USE_HUGE_PAGES */
+    return !mprotect(base, size << shiftPage, PROT_NONE);
 }
 
 /**
@@ -641,6 +1350,22 @@ PlatFreePages(
     return !mprotect(addr, number << shiftPage, PROT_NONE);
 }
 
+/**
+ * Return physical memory of free pages to the system. Pages must have been
+ * freed with PlatFreePages() beforehand; they are zero-filled on next
+ * access.
+ *
+ * @retval <>0  for success.
+ * @retval 0    for failure.
+ */
+int
+PlatDecommitPages(
+    void *addr,     /*!< Address of first page to decommit. */
+    size_t number)  /*!< Number of pages to decommit. */
+{
+    return !madvise(addr, number << shiftPage, MADV_DONTNEED);
+}
+
 /**
  * Protect/unprotect pages in reserved range.
  *
@@ -657,6 +1382,7 @@ PlatProtectPages(
             PROT_READ | (protect ? 0 : PROT_WRITE));
 }
 
+#ifndef COL_USE_SOFTWARE_BARRIER
 /**
  * Called upon memory protection signal (SIGSEGV).
  *
@@ -682,6 +1408,7 @@ PageProtectSigAction(
 
     SysPageProtect(info->si_addr, 0);
 }
+#endif /* !COL_USE_SOFTWARE_BARRIER */
 
 /** @endcond @endprivate */
 
@@ -698,21 +1425,28 @@ PageProtectSigAction(
  * Initialization routine. Called through pthread_once().
  *
  * @sideeffect
- *      - Create thread-specific data key #tsdKey (never freed).
+ *      - Create thread-specific data key #tsdKey (never freed) when
+ *        thread-local storage is not supported (see #PLAT_THREAD_LOCAL).
+ *      - Size the pool of GC workers after the number of processors.
  *      - Install memory protection signal handler PageProtectSigAction() for
- *        parent tracking.
+ *        parent tracking, unless software write barriers are used instead
+ *        (see #COL_USE_SOFTWARE_BARRIER).
  *
  * @see PlatEnter
  */
 static void
 Init()
 {
+#ifndef COL_USE_SOFTWARE_BARRIER
     struct sigaction sa;
-    
+#endif /* !COL_USE_SOFTWARE_BARRIER */
+
+#ifndef PLAT_THREAD_LOCAL
     if (pthread_key_create(&tsdKey, NULL)) {
         /* TODO: exception */
         return;
     }
+#endif /* !PLAT_THREAD_LOCAL */
 
     systemPageSize = sysconf(_SC_PAGESIZE);
     allocGranularity = systemPageSize * 16;
@@ -720,12 +1454,30 @@ Init()
 
 #ifdef COL_USE_THREADS
     sharedGroups = NULL;
+
+    /*
+     * Default to one GC worker per processor.
+     */
+
+    workers.maxThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers.maxThreads < 1) workers.maxThreads = 1;
+    if (workers.maxThreads > GC_MAX_WORKERS) {
+        workers.maxThreads = GC_MAX_WORKERS;
+    }
+#ifdef __linux__
+    if (syscall(SYS_sched_getaffinity, 0, sizeof(defaultAffinity),
+            defaultAffinity) < 0) {
+        memset(defaultAffinity, 0xFF, sizeof(defaultAffinity));
+    }
+#endif /* __linux__ */
 #endif /* COL_USE_THREADS */
 
+#ifndef COL_USE_SOFTWARE_BARRIER
     memset(&sa, 0, sizeof(sa));
     sa.sa_sigaction = PageProtectSigAction;
     sa.sa_flags = SA_SIGINFO | SA_RESTART;
     sigaction(SIGSEGV, &sa, NULL);
+#endif /* !COL_USE_SOFTWARE_BARRIER */
 }
 
 /** @endcond @endprivate */
@@ -12,6 +12,7 @@
 #define _COLIBRI_UNIXPLATFORM
 
 #include <pthread.h>
+#include <sched.h>
 
 
 /*
@@ -27,24 +28,208 @@ Unix-specific implementation of generic primitives.
  * \name Thread-Local Storage
  ***************************************************************************\{*/
 
+/**
+ * \def PLAT_THREAD_LOCAL
+ *      Storage class for thread-local variables, when supported by the
+ *      compiler. Thread-specific data is then read directly from thread-local
+ *      storage, else it goes through the #tsdKey pthread key.
+ *
+ * @see PlatGetThreadData
+ */
+#ifndef PLAT_THREAD_LOCAL
+#   if defined(__GNUC__) || defined(__clang__)
+#       define PLAT_THREAD_LOCAL __thread
+#   elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#       define PLAT_THREAD_LOCAL _Thread_local
+#   endif
+#endif /* PLAT_THREAD_LOCAL */
+
+/**
+ * \def PLAT_HIDDEN
+ *      Keeps internal global symbols such as #platThreadData out of the
+ *      shared library's exported symbol table, so that they can't clash
+ *      with client symbols.
+ */
+#ifndef PLAT_HIDDEN
+#   if defined(__GNUC__) && __GNUC__ > 3
+#       define PLAT_HIDDEN __attribute__ ((visibility("hidden")))
+#   else
+#       define PLAT_HIDDEN
+#   endif
+#endif /* PLAT_HIDDEN */
+
 /**
  * Get pointer to thread-specific data.
  *
  * @see ThreadData
- * @see tlsToken
+ * @see PlatSetThreadData
+ */
+#ifdef PLAT_THREAD_LOCAL
+#   define PlatGetThreadData() \
+        (platThreadData)
+#else
+#   define PlatGetThreadData() \
+        ((ThreadData *) pthread_getspecific(tsdKey))
+#endif /* PLAT_THREAD_LOCAL */
+
+/**
+ * Set pointer to thread-specific data.
+ *
+ * @param data  Thread-specific data.
+ *
+ * @see ThreadData
+ * @see PlatGetThreadData
  */
-#define PlatGetThreadData() \
-    ((ThreadData *) pthread_getspecific(tsdKey))
+#ifdef PLAT_THREAD_LOCAL
+#   define PlatSetThreadData(data) \
+        (platThreadData = (data))
+#else
+#   define PlatSetThreadData(data) \
+        pthread_setspecific(tsdKey, (data))
+#endif /* PLAT_THREAD_LOCAL */
 
 /*
  * Remaining declarations.
  */
 
-extern pthread_key_t tsdKey;
+#ifdef PLAT_THREAD_LOCAL
+extern PLAT_HIDDEN PLAT_THREAD_LOCAL ThreadData *platThreadData;
+#else
+extern PLAT_HIDDEN pthread_key_t tsdKey;
+#endif /* PLAT_THREAD_LOCAL */
 
 /* End of Thread-Local Storage *//*!\}*/
 
 
+/***************************************************************************//*!
+ * \name Atomic Operations
+ *
+ * Atomic operations on pointer-sized integers (**uintptr_t** or **size_t**)
+ * and on bytes. Implemented with GCC builtins.
+ ***************************************************************************\{*/
+
+/**
+ * Atomically load pointer-sized integer with acquire semantics.
+ *
+ * @param ptr   Address of value to load.
+ *
+ * @return The loaded value.
+ */
+#define PlatAtomicLoad(ptr) \
+    __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+
+/**
+ * Atomically store pointer-sized integer with release semantics.
+ *
+ * @param ptr       Address of value to store.
+ * @param value     Value to store.
+ */
+#define PlatAtomicStore(ptr, value) \
+    __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+
+/**
+ * Atomically add to pointer-sized integer.
+ *
+ * @param ptr       Address of value to modify.
+ * @param value     Value to add.
+ *
+ * @return The new value.
+ */
+#define PlatAtomicAdd(ptr, value) \
+    __atomic_add_fetch((ptr), (value), __ATOMIC_ACQ_REL)
+
+/**
+ * Atomically compare and exchange pointer-sized integer.
+ *
+ * @param ptr       Address of value to modify.
+ * @param expected  Expected value.
+ * @param desired   New value.
+ *
+ * @return Whether the value was exchanged.
+ */
+#define PlatAtomicCas(ptr, expected, desired) \
+    __sync_bool_compare_and_swap((ptr), (expected), (desired))
+
+/**
+ * Atomically OR pointer-sized integer.
+ *
+ * @param ptr       Address of value to modify.
+ * @param value     Value to OR.
+ *
+ * @return The previous value.
+ */
+#define PlatAtomicOr(ptr, value) \
+    __atomic_fetch_or((ptr), (value), __ATOMIC_ACQ_REL)
+
+/**
+ * Atomically OR byte.
+ *
+ * @param ptr       Address of byte to modify.
+ * @param value     Value to OR.
+ *
+ * @return The previous value.
+ */
+#define PlatAtomicOrByte(ptr, value) \
+    __atomic_fetch_or((uint8_t *)(ptr), (uint8_t)(value), __ATOMIC_ACQ_REL)
+
+/**
+ * Full memory barrier.
+ */
+#define PlatMemoryBarrier() \
+    __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/**
+ * Yield the processor to other threads.
+ */
+#define PlatYield() \
+    sched_yield()
+
+/* End of Atomic Operations *//*!\}*/
+
+
+/***************************************************************************//*!
+ * \name Cache Control
+ ***************************************************************************\{*/
+
+/**
+ * Prefetch memory into the processor cache. This is only a hint, address
+ * needs not be valid.
+ *
+ * @param ptr   Address to prefetch.
+ */
+#define PlatPrefetch(ptr) \
+    __builtin_prefetch((ptr))
+
+/* End of Cache Control *//*!\}*/
+
+
+/***************************************************************************//*!
+ * \name Bit Operations
+ ***************************************************************************\{*/
+
+/**
+ * Count trailing zero bits in 64-bit integer.
+ *
+ * @param x     Value to examine, must be nonzero.
+ *
+ * @return Index of the least significant set bit.
+ */
+#define PlatCountTrailingZeros64(x) \
+    ((size_t) __builtin_ctzll((unsigned long long)(x)))
+
+/**
+ * Count set bits in 64-bit integer.
+ *
+ * @param x     Value to examine.
+ *
+ * @return Number of set bits.
+ */
+#define PlatPopCount64(x) \
+    ((size_t) __builtin_popcountll((unsigned long long)(x)))
+
+/* End of Bit Operations *//*!\}*/
+
+
 /***************************************************************************//*!
  * \name System Page Allocation
  ***************************************************************************\{*/
@@ -25,7 +25,13 @@
 static struct Win32GroupData * AllocGroupData(unsigned int model);
 static void             FreeGroupData(struct Win32GroupData *groupData);
 #ifdef COL_USE_THREADS
-static DWORD WINAPI     GcThreadProc(LPVOID lpParameter);
+static ThreadData *     InitInternalThreadData(GroupData *groupData);
+static void             ScheduleGC(struct Win32GroupData *groupData);
+static void             UnscheduleGC(struct Win32GroupData *groupData);
+static void             CollectGroup(struct Win32GroupData *groupData);
+static int              StartWorker(void);
+static void             ApplyWorkerConfig(size_t affinity, size_t priority);
+static DWORD WINAPI     WorkerThreadProc(LPVOID lpParameter);
 #endif /* COL_USE_THREADS */
 static BOOL             Init(void);
 /*! \endcond *//* IGNORE */
@@ -88,12 +94,18 @@ typedef struct Win32GroupData {
 
     CRITICAL_SECTION csGc;      /*!< Critical section protecting GC from worker
                                      threads. */
-    HANDLE eventGcScheduled;    /*!< Triggers GC thread. */
     HANDLE eventGcDone;         /*!< Barrier for worker threads. */
-    int scheduled;              /*!< Flag for when a GC is scheduled. */
-    int terminated;             /*!< Flag for thread group destruction. */
-    int nbActive;               /*!< Active worker thread counter. */
-    HANDLE threadGc;            /*!< GC thread. */
+    uintptr_t syncState;        /*!< GC synchronization state, see
+                                     #GC_SYNC_PENDING. */
+    uintptr_t finalizeState;    /*!< Finalization state of words queued by
+                                     thread-local collections, see
+                                     #GC_FINALIZE_QUEUED. */
+    struct Win32GroupData *nextQueued;
+                                /*!< Next group in the GC queue of
+                                     #workers. */
+    int queued;                 /*!< Whether group is in the GC queue. */
+    int collecting;             /*!< Number of GC workers handling the
+                                     group. */
 #endif /* COL_USE_THREADS */
 } Win32GroupData;
 
@@ -149,14 +161,6 @@ AllocGroupData(
 
         InitializeCriticalSection(&groupData->csGc);
         groupData->eventGcDone = CreateEvent(NULL, TRUE, TRUE, NULL);
-        groupData->eventGcScheduled = CreateEvent(NULL, FALSE, FALSE, NULL);
-
-        /*
-         * Create GC thread.
-         */
-
-        groupData->threadGc = CreateThread(NULL, 0, GcThreadProc, groupData,
-                0, NULL);
     }
 #endif /* COL_USE_THREADS */
 
@@ -179,19 +183,15 @@ FreeGroupData(
 #ifdef COL_USE_THREADS
     if (groupData->data.model != COL_SINGLE) {
         /*
-         * Signal and wait for termination of GC thread.
+         * Cancel pending GC and wait for GC workers to release the group.
          */
 
-        //TODO error handling.
-        groupData->terminated = 1;
-        SignalObjectAndWait(groupData->eventGcScheduled, groupData->threadGc,
-            INFINITE, FALSE);
+        UnscheduleGC(groupData);
 
         /*
          * Destroy synchronization objects.
          */
 
-        CloseHandle(groupData->eventGcScheduled);
         CloseHandle(groupData->eventGcDone);
         DeleteCriticalSection(&groupData->csGc);
 
@@ -367,16 +367,24 @@ PlatLeave()
 #ifdef COL_USE_THREADS
     } else {
         /*
-         * Remove from shared group.
+         * Remove from shared group. Live words of the thread's eden must
+         * first be handed over to the group.
          */
 
+        GcDetachThread(data);
+
         EnterCriticalSection(&csSharedGroups);
         {
             if (data->next == data) {
                 /*
-                 * Free group as well.
+                 * Unlink and free group as well.
                  */
 
+                Win32GroupData **groupPtr = &sharedGroups;
+                while (*groupPtr != (Win32GroupData *) data->groupData) {
+                    groupPtr = &(*groupPtr)->next;
+                }
+                *groupPtr = (*groupPtr)->next;
                 FreeGroupData((Win32GroupData *) data->groupData);
             } else {
                 /*
@@ -402,49 +410,127 @@ PlatLeave()
     return 1;
 }
 
+/**
+ * Get the identifier of the current process.
+ *
+ * @return The process ID.
+ *
+ * @see PlatGetThreadId
+ */
+size_t
+PlatGetProcessId()
+{
+    return (size_t) GetCurrentProcessId();
+}
+
+/**
+ * Get the identifier of the calling thread.
+ *
+ * @return The thread ID.
+ *
+ * @see PlatGetProcessId
+ */
+size_t
+PlatGetThreadId()
+{
+    return (size_t) GetCurrentThreadId();
+}
+
 #ifdef COL_USE_THREADS
 
 /**
- * Thread dedicated to the GC process. Activated when one of the worker threads
- * in the group triggers the GC.
+ * Initialize thread data for internal threads, i.e. GC workers. Such threads
+ * are not group members, they only need thread data for page allocation on
+ * behalf of the group they serve.
  *
- * @return Always zero.
+ * @return The newly allocated structure.
  *
  * @sideeffect
- *      Calls #PerformGC.
+ *      Memory allocated and thread-local data set.
  *
- * @see AllocGroupData
+ * @see WorkerThreadProc
+ */
+static ThreadData *
+InitInternalThreadData(
+    GroupData *groupData)   /*!< Group-specific data. */
+{
+    ThreadData *data = (ThreadData *) malloc(sizeof(ThreadData));
+    memset(data, 0, sizeof(*data));
+    data->groupData = groupData;
+    TlsSetValue(tlsToken, data);
+    return data;
+}
+
+/**
+ * Perform the GC of a group on behalf of a GC worker. Clears the
+ * #GC_SYNC_PENDING flag and wakes threads blocked in PlatSyncPauseGC().
+ *
+ * Custom words queued for finalization are then finalized while other
+ * threads run. The worker stays registered as active meanwhile, so that the
+ * next GC waits for it. The same goes for words queued by thread-local
+ * collections (see PlatScheduleFinalize()).
+ *
+ * @sideeffect
+ *      Calls #PerformGC and #FinalizeWords.
+ *
+ * @see WorkerThreadProc
  * @see PerformGC
+ * @see FinalizeWords
  */
-static DWORD WINAPI
-GcThreadProc(
-    LPVOID lpParameter) /*!< #Win32GroupData. */
+static void
+CollectGroup(
+    Win32GroupData *groupData)  /*!< Group to collect. */
 {
-    Win32GroupData *groupData = (Win32GroupData *) lpParameter;
-    for (;;) {
-        WaitForSingleObject(groupData->eventGcScheduled, INFINITE);
-        EnterCriticalSection(&groupData->csGc);
-        {
-            if (groupData->scheduled) {
-                groupData->scheduled = 0;
-                PerformGC((GroupData *) groupData);
-            }
+    int finalize = 0;
+
+    EnterCriticalSection(&groupData->csGc);
+    {
+        if (PlatAtomicLoad(&groupData->syncState) == GC_SYNC_PENDING) {
+            PerformGC((GroupData *) groupData);
+            finalize = (groupData->data.finalizables != WORD_NIL);
+
+            /*
+             * Signal event before clearing the flag, so that the thread
+             * scheduling the next GC resets it afterwards.
+             */
+
             SetEvent(groupData->eventGcDone);
+            PlatAtomicStore(&groupData->syncState,
+                    finalize ? GC_SYNC_ACTIVE : 0);
         }
-        LeaveCriticalSection(&groupData->csGc);
-        if (groupData->terminated) {
-            ExitThread(0);
-        }
+    }
+    LeaveCriticalSection(&groupData->csGc);
+
+    if (finalize) {
+        FinalizeWords((GroupData *) groupData);
+        PlatSyncResumeGC((GroupData *) groupData, 0);
+    }
+
+    if (PlatAtomicCas(&groupData->finalizeState, GC_FINALIZE_QUEUED,
+            GC_FINALIZE_CLAIMED)) {
+        /*
+         * Finalize words queued by thread-local collections, including
+         * those queued meanwhile.
+         */
+
+        do {
+            FinalizeWords((GroupData *) groupData);
+            PlatAtomicStore(&groupData->finalizeState, 0);
+        } while (PlatAtomicLoad(&groupData->data.finalizables) != WORD_NIL
+                && PlatAtomicCas(&groupData->finalizeState, 0,
+                GC_FINALIZE_CLAIMED));
+        PlatSyncResumeGC((GroupData *) groupData, 0);
     }
 }
 
 /**
- * Called when a worker thread calls the outermost Col_PauseGC().
+ * Called when a worker thread calls the outermost Col_PauseGC(). Waits for
+ * the group's **eventGcDone** only when a GC is pending.
  *
  * @sideeffect
  *      May block as long as a GC is underway.
  *
- * @see GcThreadProc
+ * @see CollectGroup
  * @see SyncPauseGC
  * @see Col_PauseGC
  */
@@ -453,13 +539,29 @@ PlatSyncPauseGC(
     GroupData *data)    /*!< Group-specific data. */
 {
     Win32GroupData *groupData = (Win32GroupData *) data;
+    uintptr_t state;
     ASSERT(groupData->data.model != COL_SINGLE);
-    WaitForSingleObject(groupData->eventGcDone, INFINITE);
-    EnterCriticalSection(&groupData->csGc);
-    {
-        groupData->nbActive++;
+
+    for (;;) {
+        state = PlatAtomicLoad(&groupData->syncState);
+        if (!(state & GC_SYNC_PENDING)) {
+            /*
+             * Fast path: no GC pending, register as active.
+             */
+
+            if (PlatAtomicCas(&groupData->syncState, state,
+                    state + GC_SYNC_ACTIVE)) {
+                return;
+            }
+            continue;
+        }
+
+        /*
+         * Slow path: wait for the GC to complete and try again.
+         */
+
+        WaitForSingleObject(groupData->eventGcDone, INFINITE);
     }
-    LeaveCriticalSection(&groupData->csGc);
 }
 
 /**
@@ -468,7 +570,7 @@ PlatSyncPauseGC(
  * @retval <>0  if successful.
  * @retval 0    if call would block.
  *
- * @see GcThreadProc
+ * @see CollectGroup
  * @see TrySyncPauseGC
  * @see Col_TryPauseGC
  */
@@ -477,16 +579,16 @@ PlatTrySyncPauseGC(
     GroupData *data)    /*!< Group-specific data. */
 {
     Win32GroupData *groupData = (Win32GroupData *) data;
+    uintptr_t state;
     ASSERT(groupData->data.model != COL_SINGLE);
-    if (WaitForSingleObject(groupData->eventGcDone, 0)
-            != WAIT_OBJECT_0) {
-        return 0;
-    }
-    EnterCriticalSection(&groupData->csGc);
-    {
-        groupData->nbActive++;
-    }
-    LeaveCriticalSection(&groupData->csGc);
+
+    do {
+        state = PlatAtomicLoad(&groupData->syncState);
+        if (state & GC_SYNC_PENDING) {
+            return 0;
+        }
+    } while (!PlatAtomicCas(&groupData->syncState, state,
+            state + GC_SYNC_ACTIVE));
     return 1;
 }
 
@@ -494,11 +596,11 @@ PlatTrySyncPauseGC(
  * Called when a worker thread calls the outermost Col_ResumeGC().
  *
  * @sideeffect
- *      If last thread in group, may trigger the GC in the dedicated thread if
+ *      If last thread in group, may queue the GC for the GC workers if
  *      previously scheduled. This will block further calls to
  *      Col_PauseGC() / PlatSyncPauseGC().
  *
- * @see GcThreadProc
+ * @see ScheduleGC
  * @see SyncResumeGC
  * @see Col_ResumeGC
  */
@@ -509,18 +611,53 @@ PlatSyncResumeGC(
 {
     Win32GroupData *groupData = (Win32GroupData *) data;
     ASSERT(groupData->data.model != COL_SINGLE);
-    EnterCriticalSection(&groupData->csGc);
-    {
-        if (performGc && !groupData->scheduled) {
-            ResetEvent(groupData->eventGcDone);
-            groupData->scheduled = 1;
-        }
-        --groupData->nbActive;
-        if (!groupData->nbActive && groupData->scheduled) {
-            SetEvent(groupData->eventGcScheduled);
-        }
+
+    if (performGc && !(PlatAtomicLoad(&groupData->syncState)
+            & GC_SYNC_PENDING)
+            && !(PlatAtomicOr(&groupData->syncState, GC_SYNC_PENDING)
+            & GC_SYNC_PENDING)) {
+        /*
+         * GC scheduled by this thread. This blocks further pause calls, so
+         * the thread that brings the active count down to zero is the only
+         * one to queue it.
+         */
+
+        ResetEvent(groupData->eventGcDone);
+    }
+    if (PlatAtomicAdd(&groupData->syncState, (uintptr_t) -GC_SYNC_ACTIVE)
+            == GC_SYNC_PENDING) {
+        ScheduleGC(groupData);
+    }
+}
+
+/**
+ * Called when a thread-local collection has queued custom words for
+ * finalization. Queues the group for the GC workers unless one of them is
+ * already due to finalize queued words.
+ *
+ * @pre
+ *      Caller must be within a GC-protected section.
+ *
+ * @see CollectGroup
+ * @see PerformLocalGC
+ */
+void
+PlatScheduleFinalize(
+    GroupData *data)    /*!< Group-specific data. */
+{
+    Win32GroupData *groupData = (Win32GroupData *) data;
+
+    /*
+     * Register the worker as active beforehand, as it may resume as soon as
+     * the group is queued.
+     */
+
+    PlatAtomicAdd(&groupData->syncState, GC_SYNC_ACTIVE);
+    if (PlatAtomicCas(&groupData->finalizeState, 0, GC_FINALIZE_QUEUED)) {
+        ScheduleGC(groupData);
+    } else {
+        PlatAtomicAdd(&groupData->syncState, (uintptr_t) -GC_SYNC_ACTIVE);
     }
-    LeaveCriticalSection(&groupData->csGc);
 }
 
 /**
@@ -566,6 +703,470 @@ PlatLeaveProtectRoots(
 /* End of Process & Threads *//*!\}*/
 
 
+#ifdef COL_USE_THREADS
+
+/***************************************************************************//*!
+ * \name Parallel Processing
+ ***************************************************************************\{*/
+
+/** @beginprivate @cond PRIVATE */
+
+/**
+ * Process-wide pool of GC workers. GC workers perform the collections that
+ * groups schedule (see ScheduleGC()), and run the tasks started by
+ * PlatRunParallel(). Threads are created lazily, up to #COL_GC_WORKERS, and
+ * live until the process exits or their maximum number is lowered.
+ *
+ * @see PlatRunParallel
+ * @see ScheduleGC
+ * @see WorkerThreadProc
+ */
+static struct {
+    CRITICAL_SECTION cs;        /*!< Critical section protecting the
+                                     structure. */
+    CONDITION_VARIABLE condStart;
+                                /*!< Triggers GC workers. */
+    CONDITION_VARIABLE condDone;/*!< Signaled when the last running task
+                                     completes. */
+    CONDITION_VARIABLE condCollected;
+                                /*!< Signaled when GC workers release a
+                                     group. */
+    size_t nbThreads;           /*!< Number of GC workers. */
+    size_t nbIdle;              /*!< Number of idle GC workers. */
+    size_t maxThreads;          /*!< Maximum number of GC workers. */
+    size_t affinity;            /*!< Processor mask of GC workers, 0 for
+                                     all. */
+    size_t priority;            /*!< Priority of GC workers. */
+    size_t config;              /*!< Incremented when affinity or priority
+                                     change. */
+    Win32GroupData *firstQueued;/*!< First group in GC queue. */
+    Win32GroupData *lastQueued; /*!< Last group in GC queue. */
+    GroupData *groupData;       /*!< Group on behalf of which tasks run. */
+    PlatParallelProc *proc;     /*!< Task proc. */
+    void *clientData;           /*!< Opaque data passed to task proc. */
+    size_t number;              /*!< Number of tasks. */
+    size_t next;                /*!< Index of next task to start. */
+    size_t running;             /*!< Number of tasks running on workers. */
+} workers;
+
+/**
+ * Critical section serializing calls to PlatRunParallel().
+ *
+ * @see PlatRunParallel
+ */
+static CRITICAL_SECTION csParallel;
+
+/**
+ * Run tasks in parallel. Task 0 runs on the calling thread, other tasks run
+ * on the GC workers. Tasks that haven't started when task 0 completes are
+ * cancelled, so task 0 must be able to complete the whole job alone. This
+ * also happens when the workers are busy serving another group.
+ *
+ * @sideeffect
+ *      GC workers may be created. Blocks until all started tasks are
+ *      complete.
+ *
+ * @see PlatParallelProc
+ * @see WorkerThreadProc
+ */
+void
+PlatRunParallel(
+    GroupData *data,            /*!< Group-specific data. */
+    size_t number,              /*!< Number of tasks. */
+    PlatParallelProc *proc,     /*!< Task proc. */
+    void *clientData)           /*!< Opaque data passed as is to **proc**. */
+{
+    if (number > 1 && !TryEnterCriticalSection(&csParallel)) {
+        /*
+         * Workers are busy, run alone.
+         */
+
+        number = 1;
+    }
+    if (number <= 1) {
+        proc(0, clientData);
+        return;
+    }
+
+    EnterCriticalSection(&workers.cs);
+    {
+        /*
+         * Create missing GC workers.
+         */
+
+        while (workers.nbThreads < number-1
+                && workers.nbThreads < workers.maxThreads) {
+            if (!StartWorker()) break;
+        }
+
+        /*
+         * Start tasks.
+         */
+
+        workers.groupData = data;
+        workers.proc = proc;
+        workers.clientData = clientData;
+        workers.number = number;
+        workers.next = 1;
+        WakeAllConditionVariable(&workers.condStart);
+    }
+    LeaveCriticalSection(&workers.cs);
+
+    proc(0, clientData);
+
+    EnterCriticalSection(&workers.cs);
+    {
+        /*
+         * Cancel pending tasks and wait for running ones.
+         */
+
+        workers.next = workers.number;
+        while (workers.running) {
+            SleepConditionVariableCS(&workers.condDone, &workers.cs, INFINITE);
+        }
+    }
+    LeaveCriticalSection(&workers.cs);
+
+    LeaveCriticalSection(&csParallel);
+}
+
+/**
+ * Queue the GC of a group for the GC workers. Called once all of its worker
+ * threads have left their GC-protected section.
+ *
+ * @sideeffect
+ *      May create a GC worker or wake an idle one.
+ *
+ * @see PlatSyncResumeGC
+ * @see CollectGroup
+ */
+static void
+ScheduleGC(
+    Win32GroupData *groupData)  /*!< Group to collect. */
+{
+    EnterCriticalSection(&workers.cs);
+    if (!groupData->queued) {
+        groupData->queued = 1;
+        groupData->nextQueued = NULL;
+        if (workers.lastQueued) {
+            workers.lastQueued->nextQueued = groupData;
+        } else {
+            workers.firstQueued = groupData;
+        }
+        workers.lastQueued = groupData;
+
+        if (workers.nbIdle || workers.nbThreads >= workers.maxThreads
+                || !StartWorker()) {
+            WakeConditionVariable(&workers.condStart);
+        }
+    }
+    LeaveCriticalSection(&workers.cs);
+}
+
+/**
+ * Remove a group from the GC queue, and wait until no GC worker handles it.
+ *
+ * @see FreeGroupData
+ */
+static void
+UnscheduleGC(
+    Win32GroupData *groupData)  /*!< Group to remove. */
+{
+    Win32GroupData *prev;
+
+    EnterCriticalSection(&workers.cs);
+    if (groupData->queued) {
+        if (workers.firstQueued == groupData) {
+            prev = NULL;
+            workers.firstQueued = groupData->nextQueued;
+        } else {
+            for (prev = workers.firstQueued; prev->nextQueued != groupData;
+                    prev = prev->nextQueued);
+            prev->nextQueued = groupData->nextQueued;
+        }
+        if (workers.lastQueued == groupData) {
+            workers.lastQueued = prev;
+        }
+        groupData->queued = 0;
+    }
+    while (groupData->collecting) {
+        SleepConditionVariableCS(&workers.condCollected, &workers.cs,
+                INFINITE);
+    }
+    LeaveCriticalSection(&workers.cs);
+}
+
+/**
+ * Create a GC worker. Must be called within the **workers** critical
+ * section.
+ *
+ * @retval <>0  if successful.
+ * @retval 0    otherwise.
+ *
+ * @see WorkerThreadProc
+ */
+static int
+StartWorker()
+{
+    HANDLE thread = CreateThread(NULL, 0, WorkerThreadProc, NULL, 0, NULL);
+    if (!thread) {
+        return 0;
+    }
+    CloseHandle(thread);
+    workers.nbThreads++;
+    return 1;
+}
+
+/**
+ * Apply processor affinity and priority to the calling GC worker. Both are
+ * hints, so failures are ignored.
+ *
+ * @see COL_GC_WORKER_AFFINITY
+ * @see COL_GC_WORKER_PRIORITY
+ */
+static void
+ApplyWorkerConfig(
+    size_t affinity,    /*!< Processor mask, 0 for default. */
+    size_t priority)    /*!< Priority from 0 (lowest) to 4 (highest). */
+{
+    DWORD_PTR processMask, systemMask;
+
+    if (!affinity && GetProcessAffinityMask(GetCurrentProcess(),
+            &processMask, &systemMask)) {
+        affinity = processMask;
+    }
+    if (affinity) {
+        SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) affinity);
+    }
+    SetThreadPriority(GetCurrentThread(),
+            THREAD_PRIORITY_LOWEST + (int) priority);
+}
+
+/**
+ * GC worker thread. Performs the collections queued by ScheduleGC(), and runs
+ * the tasks started by PlatRunParallel(), which take precedence as they are
+ * part of a collection underway.
+ *
+ * @return Always zero.
+ *
+ * @see ScheduleGC
+ * @see PlatRunParallel
+ */
+static DWORD WINAPI
+WorkerThreadProc(
+    LPVOID lpParameter) /*!< Unused. */
+{
+    ThreadData *data = InitInternalThreadData(NULL);
+    Win32GroupData *groupData;
+    PlatParallelProc *proc;
+    void *clientData;
+    size_t index, config = 0, affinity, priority, delay;
+    int timeout;
+
+    EnterCriticalSection(&workers.cs);
+    for (;;) {
+        if (config != workers.config) {
+            /*
+             * Apply new affinity and priority.
+             */
+
+            config = workers.config;
+            affinity = workers.affinity;
+            priority = workers.priority;
+            LeaveCriticalSection(&workers.cs);
+
+            ApplyWorkerConfig(affinity, priority);
+
+            EnterCriticalSection(&workers.cs);
+            continue;
+        }
+
+        if (workers.next < workers.number) {
+            /*
+             * Start next task.
+             */
+
+            index = workers.next++;
+            workers.running++;
+            data->groupData = workers.groupData;
+            proc = workers.proc;
+            clientData = workers.clientData;
+            LeaveCriticalSection(&workers.cs);
+
+            proc(index, clientData);
+
+            EnterCriticalSection(&workers.cs);
+            if (!--workers.running) {
+                WakeAllConditionVariable(&workers.condDone);
+            }
+            continue;
+        }
+
+        if (workers.firstQueued) {
+            /*
+             * Collect next group in queue.
+             */
+
+            groupData = workers.firstQueued;
+            workers.firstQueued = groupData->nextQueued;
+            if (!workers.firstQueued) {
+                workers.lastQueued = NULL;
+            }
+            groupData->queued = 0;
+            groupData->collecting++;
+            data->groupData = (GroupData *) groupData;
+            LeaveCriticalSection(&workers.cs);
+
+            CollectGroup(groupData);
+
+            /*
+             * Mutators never allocate from the worker's page cache, so
+             * return freed pages to their address ranges right away.
+             */
+
+            SysPageCacheCleanup(data);
+
+            EnterCriticalSection(&workers.cs);
+            if (!--groupData->collecting) {
+                WakeAllConditionVariable(&workers.condCollected);
+            }
+            continue;
+        }
+
+        if (workers.nbThreads > workers.maxThreads) {
+            /*
+             * Maximum number was lowered, exit.
+             */
+
+            workers.nbThreads--;
+            break;
+        }
+
+        /*
+         * Wait for work. Meanwhile, return free pages to the system
+         * periodically, as the next GC may be far away.
+         */
+
+        workers.nbIdle++;
+        delay = PlatAtomicLoad(&decommitDelay);
+        timeout = (!SleepConditionVariableCS(&workers.condStart, &workers.cs,
+                (delay && delay < INFINITE) ? (DWORD) delay : INFINITE)
+                && GetLastError() == ERROR_TIMEOUT);
+        workers.nbIdle--;
+        if (timeout) {
+            LeaveCriticalSection(&workers.cs);
+            SysPageDecommit();
+            EnterCriticalSection(&workers.cs);
+        }
+    }
+    LeaveCriticalSection(&workers.cs);
+
+    SysPageCacheCleanup(data);
+    TlsSetValue(tlsToken, 0);
+    free(data);
+    return 0;
+}
+
+/**
+ * Get the value of a GC worker parameter.
+ *
+ * @return The parameter value.
+ *
+ * @see Col_GetGcParam
+ */
+size_t
+PlatGetWorkerParam(
+    Col_GcParam param)  /*!< #COL_GC_WORKERS, #COL_GC_WORKER_AFFINITY or
+                             #COL_GC_WORKER_PRIORITY. */
+{
+    size_t value;
+
+    EnterCriticalSection(&workers.cs);
+    switch (param) {
+    case COL_GC_WORKERS:         value = workers.maxThreads; break;
+    case COL_GC_WORKER_AFFINITY: value = workers.affinity; break;
+    case COL_GC_WORKER_PRIORITY: value = workers.priority; break;
+    default:                     value = 0;
+    }
+    LeaveCriticalSection(&workers.cs);
+    return value;
+}
+
+/**
+ * Set the value of a GC worker parameter.
+ *
+ * @sideeffect
+ *      Wakes idle GC workers so that they apply the new value.
+ *
+ * @see Col_SetGcParam
+ */
+void
+PlatSetWorkerParam(
+    Col_GcParam param,  /*!< #COL_GC_WORKERS, #COL_GC_WORKER_AFFINITY or
+                             #COL_GC_WORKER_PRIORITY. */
+    size_t value)       /*!< New value, already clamped. */
+{
+    EnterCriticalSection(&workers.cs);
+    switch (param) {
+    case COL_GC_WORKERS:
+        workers.maxThreads = value;
+        break;
+
+    case COL_GC_WORKER_AFFINITY:
+        workers.affinity = value;
+        workers.config++;
+        break;
+
+    case COL_GC_WORKER_PRIORITY:
+        workers.priority = value;
+        workers.config++;
+        break;
+
+    default:
+        break;
+    }
+    WakeAllConditionVariable(&workers.condStart);
+    LeaveCriticalSection(&workers.cs);
+}
+
+/** @endcond @endprivate */
+
+/* End of Parallel Processing *//*!\}*/
+
+#endif /* COL_USE_THREADS */
+
+
+/***************************************************************************//*!
+ * \name Time
+ ***************************************************************************\{*/
+
+/** @beginprivate @cond PRIVATE */
+
+/**
+ * Get the value of a monotonic clock.
+ *
+ * @return Elapsed time in microseconds since an arbitrary origin.
+ */
+uint64_t
+PlatGetMicroseconds()
+{
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (!frequency.QuadPart) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t) (counter.QuadPart / frequency.QuadPart) * 1000000
+            + (uint64_t) (counter.QuadPart % frequency.QuadPart) * 1000000
+                    / frequency.QuadPart;
+}
+
+/** @endcond @endprivate */
+
+/* End of Time *//*!\}*/
+
+
 /***************************************************************************//*!
  * \name System Page Allocation
  ***************************************************************************\{*/
@@ -576,7 +1177,8 @@ PlatLeaveProtectRoots(
  * Critical section protecting address range management.
  *
  * - #ranges:          Reserved address ranges for general purpose.
- * - #dedicatedRanges: Dedicated address ranges for large pages.
+ * - #rangeIndex:      Index of all address ranges, including dedicated
+ *                     ranges for large pages.
  *
  * @see PlatEnterProtectAddressRanges
  * @see PlatLeaveProtectAddressRanges
@@ -597,6 +1199,21 @@ PlatReserveRange(
         MEM_RESERVE | (alloc ? MEM_COMMIT : 0), PAGE_READWRITE);
 }
 
+/**
+ * Prefault pages of a reserved address range. Pages get committed and
+ * decommitted individually, so there is nothing to prefault here.
+ *
+ * @retval <>0  for success.
+ * @retval 0    for failure.
+ */
+int
+PlatPrefaultRange(
+    void *base,     /*!< Base address of range to prefault. */
+    size_t size)    /*!< Number of pages in range. */
+{
+    return 1;
+}
+
 /**
  * Release an address range.
  *
@@ -640,6 +1257,21 @@ PlatFreePages(
     return VirtualFree(addr, number << shiftPage, MEM_DECOMMIT);
 }
 
+/**
+ * Return physical memory of free pages to the system. Nothing to do as
+ * PlatFreePages() already decommits pages.
+ *
+ * @retval <>0  for success.
+ * @retval 0    for failure.
+ */
+int
+PlatDecommitPages(
+    void *addr,     /*!< Address of first page to decommit. */
+    size_t number)  /*!< Number of pages to decommit. */
+{
+    return 1;
+}
+
 /**
  * Protect/unprotect pages in reserved range.
  *
@@ -657,6 +1289,7 @@ PlatProtectPages(
             (protect ? PAGE_READONLY : PAGE_READWRITE), &old);
 }
 
+#ifndef COL_USE_SOFTWARE_BARRIER
 /**
  * Called upon exception.
  *
@@ -690,6 +1323,7 @@ PageProtectVectoredHandler(
             0);
     return EXCEPTION_CONTINUE_EXECUTION;
 }
+#endif /* !COL_USE_SOFTWARE_BARRIER */
 
 /** @endcond @endprivate */
 
@@ -737,8 +1371,10 @@ DllMain(
  * @sideeffect
  *      - Create thread-local storage key #tlsToken (freed upon
  *        DLL_PROCESS_DETACH in #DllMain).
+ *      - Size the pool of GC workers after the number of processors.
  *      - Install memory protection exception handler
- *        PageProtectVectoredHandler()for parent tracking.
+ *        PageProtectVectoredHandler()for parent tracking, unless software
+ *        write barriers are used instead (see #COL_USE_SOFTWARE_BARRIER).
  *
  * @see DllMain
  * @see systemPageSize
@@ -765,9 +1401,28 @@ Init()
 #ifdef COL_USE_THREADS
     sharedGroups = NULL;
     InitializeCriticalSection(&csSharedGroups);
+
+    InitializeCriticalSection(&csParallel);
+    InitializeCriticalSection(&workers.cs);
+    InitializeConditionVariable(&workers.condStart);
+    InitializeConditionVariable(&workers.condDone);
+    InitializeConditionVariable(&workers.condCollected);
+
+    /*
+     * Default to one GC worker per processor.
+     */
+
+    workers.maxThreads = systemInfo.dwNumberOfProcessors;
+    if (workers.maxThreads < 1) workers.maxThreads = 1;
+    if (workers.maxThreads > GC_MAX_WORKERS) {
+        workers.maxThreads = GC_MAX_WORKERS;
+    }
+    workers.priority = GC_DEFAULT_WORKER_PRIORITY;
 #endif /* COL_USE_THREADS */
 
+#ifndef COL_USE_SOFTWARE_BARRIER
     AddVectoredExceptionHandler(1, PageProtectVectoredHandler);
+#endif /* !COL_USE_SOFTWARE_BARRIER */
 
     return TRUE;
 }
@@ -45,6 +45,170 @@ extern DWORD tlsToken;
 /* End of Thread-Local Storage *//*!\}*/
 
 
+/***************************************************************************//*!
+ * \name Atomic Operations
+ *
+ * Atomic operations on pointer-sized integers (**uintptr_t** or **size_t**)
+ * and on bytes. Implemented with Interlocked intrinsics.
+ ***************************************************************************\{*/
+
+/**
+ * Atomically load pointer-sized integer with acquire semantics.
+ *
+ * @param ptr   Address of value to load.
+ *
+ * @return The loaded value.
+ */
+#define PlatAtomicLoad(ptr) \
+    (*(volatile uintptr_t *)(ptr))
+
+/**
+ * Atomically store pointer-sized integer with release semantics.
+ *
+ * @param ptr       Address of value to store.
+ * @param value     Value to store.
+ */
+#define PlatAtomicStore(ptr, value) \
+    (*(volatile uintptr_t *)(ptr) = (uintptr_t)(value))
+
+/**
+ * Atomically add to pointer-sized integer.
+ *
+ * @param ptr       Address of value to modify.
+ * @param value     Value to add.
+ *
+ * @return The new value.
+ */
+#ifdef _WIN64
+#   define PlatAtomicAdd(ptr, value) \
+        ((uintptr_t) InterlockedExchangeAdd64((LONG64 volatile *)(ptr), \
+                (LONG64)(value)) + (uintptr_t)(value))
+#else
+#   define PlatAtomicAdd(ptr, value) \
+        ((uintptr_t) InterlockedExchangeAdd((LONG volatile *)(ptr), \
+                (LONG)(value)) + (uintptr_t)(value))
+#endif
+
+/**
+ * Atomically compare and exchange pointer-sized integer.
+ *
+ * @param ptr       Address of value to modify.
+ * @param expected  Expected value.
+ * @param desired   New value.
+ *
+ * @return Whether the value was exchanged.
+ */
+#define PlatAtomicCas(ptr, expected, desired) \
+    (InterlockedCompareExchangePointer((PVOID volatile *)(ptr), \
+            (PVOID)(desired), (PVOID)(expected)) == (PVOID)(expected))
+
+/**
+ * Atomically OR pointer-sized integer.
+ *
+ * @param ptr       Address of value to modify.
+ * @param value     Value to OR.
+ *
+ * @return The previous value.
+ */
+#ifdef _WIN64
+#   define PlatAtomicOr(ptr, value) \
+        ((uintptr_t) InterlockedOr64((LONG64 volatile *)(ptr), \
+                (LONG64)(value)))
+#else
+#   define PlatAtomicOr(ptr, value) \
+        ((uintptr_t) InterlockedOr((LONG volatile *)(ptr), (LONG)(value)))
+#endif
+
+/**
+ * Atomically OR byte.
+ *
+ * @param ptr       Address of byte to modify.
+ * @param value     Value to OR.
+ *
+ * @return The previous value.
+ */
+#define PlatAtomicOrByte(ptr, value) \
+    ((uint8_t) _InterlockedOr8((char volatile *)(ptr), (char)(value)))
+
+/**
+ * Full memory barrier.
+ */
+#define PlatMemoryBarrier() \
+    MemoryBarrier()
+
+/**
+ * Yield the processor to other threads.
+ */
+#define PlatYield() \
+    SwitchToThread()
+
+/* End of Atomic Operations *//*!\}*/
+
+
+/***************************************************************************//*!
+ * \name Cache Control
+ ***************************************************************************\{*/
+
+/**
+ * Prefetch memory into the processor cache. This is only a hint, address
+ * needs not be valid.
+ *
+ * @param ptr   Address to prefetch.
+ */
+#define PlatPrefetch(ptr) \
+    PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, (ptr))
+
+/* End of Cache Control *//*!\}*/
+
+
+/***************************************************************************//*!
+ * \name Bit Operations
+ ***************************************************************************\{*/
+
+/**
+ * Count trailing zero bits in 64-bit integer.
+ *
+ * @param x     Value to examine, must be nonzero.
+ *
+ * @return Index of the least significant set bit.
+ */
+static __inline size_t
+PlatCountTrailingZeros64(
+    uint64_t x)
+{
+    DWORD index;
+#ifdef _WIN64
+    BitScanForward64(&index, x);
+#else
+    if (!BitScanForward(&index, (DWORD) x)) {
+        BitScanForward(&index, (DWORD) (x >> 32));
+        index += 32;
+    }
+#endif
+    return index;
+}
+
+/**
+ * Count set bits in 64-bit integer. The POPCNT instruction is not available
+ * on all processors, so this uses the classic Hamming weight computation.
+ *
+ * @param x     Value to examine.
+ *
+ * @return Number of set bits.
+ */
+static __inline size_t
+PlatPopCount64(
+    uint64_t x)
+{
+    x -= (x >> 1) & 0x5555555555555555ULL;
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (size_t) ((x * 0x0101010101010101ULL) >> 56);
+}
+
+/* End of Bit Operations *//*!\}*/
+
+
 /***************************************************************************//*!
  * \name System Page Allocation
  ***************************************************************************\{*/
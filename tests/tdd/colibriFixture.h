@@ -20,4 +20,38 @@ PICOTEST_FIXTURE_TEARDOWN(colibriFixture) {
     Col_Cleanup();
 }
 
+#ifdef COL_USE_THREADS
+/*
+ * Asynchronous fixture, same as above with the COL_ASYNC model
+ */
+PICOTEST_FIXTURE_SETUP(asyncFixture) {
+    Col_Init(COL_ASYNC);
+    Col_SetErrorProc(ERROR_PROC);
+
+    Col_PauseGC();
+}
+PICOTEST_FIXTURE_TEARDOWN(asyncFixture) {
+    if (!PICOTEST_FAIL) {
+        Col_ResumeGC();
+    }
+    Col_Cleanup();
+}
+
+/*
+ * Shared fixture, same as above with the COL_SHARED model
+ */
+PICOTEST_FIXTURE_SETUP(sharedFixture) {
+    Col_Init(COL_SHARED);
+    Col_SetErrorProc(ERROR_PROC);
+
+    Col_PauseGC();
+}
+PICOTEST_FIXTURE_TEARDOWN(sharedFixture) {
+    if (!PICOTEST_FAIL) {
+        Col_ResumeGC();
+    }
+    Col_Cleanup();
+}
+#endif /* COL_USE_THREADS */
+
 #endif /* _COLIBRI_FIXTURE_H_ */
@@ -0,0 +1,413 @@
+#include <colibri.h>
+#include <picotest.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Internal allocator structures and functions. The latter are not exported
+ * from Windows DLLs, so these tests need a static build there.
+ */
+
+#if !defined(_WIN32) || defined(COL_STATIC_BUILD)
+#include "../../src/colInternal.h"
+#include "../../src/colPlatform.h"
+#define HAVE_ALLOC_INTERNALS
+#endif
+
+/*
+ * Memory allocator
+ */
+
+#include "hooks.h"
+#include "colibriFixture.h"
+
+#ifdef HAVE_ALLOC_INTERNALS
+
+PICOTEST_SUITE(testAlloc, testAllocBump, testAllocFind, testAllocFree,
+               testAllocRanges);
+
+PICOTEST_SUITE(testAllocBump, testAllocBumpPageBoundary, testAllocBumpUsedCell,
+               testAllocBumpLargerThanRun);
+PICOTEST_CASE(testAllocBumpPageBoundary, colibriFixture) {
+    MemoryPool pool;
+    Cell *cells;
+    Page *page;
+
+    PoolInit(&pool, 1);
+    cells = PoolBumpAllocCells(&pool, 1);
+    page = CELL_PAGE(cells);
+    PICOTEST_ASSERT(CELL_INDEX(cells) == RESERVED_CELLS);
+    PICOTEST_ASSERT(pool.cursor == cells + 1);
+    PICOTEST_ASSERT(pool.limit == PAGE_CELL(page, CELLS_PER_PAGE));
+    PICOTEST_ASSERT(NbSetCells(page) == CELLS_PER_PAGE);
+
+    /*
+     * Exhaust the run, whose limit is the first cell of the next page. No
+     * cell is given back to either page when starting a new run.
+     */
+
+    pool.cursor = pool.limit;
+    cells = PoolBumpAllocCells(&pool, 1);
+    PICOTEST_ASSERT(CELL_PAGE(cells) != page);
+    PICOTEST_ASSERT(CELL_INDEX(cells) == RESERVED_CELLS);
+    PICOTEST_ASSERT(NbSetCells(page) == CELLS_PER_PAGE);
+    PICOTEST_ASSERT(NbSetCells(CELL_PAGE(cells)) == CELLS_PER_PAGE);
+    PICOTEST_ASSERT(pool.limit == PAGE_CELL(CELL_PAGE(cells), CELLS_PER_PAGE));
+
+    PoolCleanup(&pool);
+}
+PICOTEST_CASE(testAllocBumpUsedCell, colibriFixture) {
+    const size_t used = CELLS_PER_PAGE/2 - 4;
+    MemoryPool pool;
+    Cell *cells;
+    Page *page;
+    size_t i;
+
+    PoolInit(&pool, 1);
+    PoolAllocPages(&pool, 1);
+    page = pool.pages;
+    SetCells(page, used, 1);
+
+    /*
+     * Run stops at the used cell.
+     */
+
+    cells = PoolBumpAllocCells(&pool, 2);
+    PICOTEST_ASSERT(cells == PAGE_CELL(page, RESERVED_CELLS));
+    PICOTEST_ASSERT(pool.cursor == cells + 2);
+    PICOTEST_ASSERT(pool.limit == PAGE_CELL(page, used));
+    for (i = 0; i <= used; i++) {
+        PICOTEST_ASSERT(TestCell(page, i));
+    }
+    for (; i < CELLS_PER_PAGE; i++) {
+        PICOTEST_ASSERT(!TestCell(page, i));
+    }
+
+    PoolCleanup(&pool);
+}
+PICOTEST_CASE(testAllocBumpLargerThanRun, colibriFixture) {
+    const size_t used = CELLS_PER_PAGE/2 - 4;
+    const size_t number = used - RESERVED_CELLS - 1;
+    MemoryPool pool;
+    Cell *cells;
+    Page *page;
+    size_t i;
+
+    PoolInit(&pool, 1);
+    PoolAllocPages(&pool, 1);
+    page = pool.pages;
+    SetCells(page, used, 1);
+    cells = PoolBumpAllocCells(&pool, 2);
+    PICOTEST_ASSERT((size_t)(pool.limit - pool.cursor) < number);
+
+    /*
+     * Remaining cells of the run are given back, and the request is served
+     * past the used cell where the new run extends to the end of the page.
+     */
+
+    cells = PoolBumpAllocCells(&pool, number);
+    PICOTEST_ASSERT(cells == PAGE_CELL(page, used + 1));
+    PICOTEST_ASSERT(pool.cursor == cells + number);
+    PICOTEST_ASSERT(pool.limit == PAGE_CELL(page, CELLS_PER_PAGE));
+    for (i = 0; i < RESERVED_CELLS + 2; i++) {
+        PICOTEST_ASSERT(TestCell(page, i));
+    }
+    for (; i < used; i++) {
+        PICOTEST_ASSERT(!TestCell(page, i));
+    }
+    for (; i < CELLS_PER_PAGE; i++) {
+        PICOTEST_ASSERT(TestCell(page, i));
+    }
+
+    PoolCleanup(&pool);
+}
+
+PICOTEST_SUITE(testAllocFind, testAllocFindFragmented,
+               testAllocFindFromIndex);
+PICOTEST_CASE(testAllocFindFragmented, colibriFixture) {
+    const size_t middle = CELLS_PER_PAGE/2 - 4, last = CELLS_PER_PAGE - 8;
+    MemoryPool pool;
+    Cell *cells;
+    Page *page;
+
+    /*
+     * Free runs of 10 cells in the middle of the page, straddling bitmask
+     * words on 128-cell pages, and of 8 cells at the end of the last word.
+     */
+
+    PoolInit(&pool, 2);
+    PoolAllocPages(&pool, 1);
+    page = pool.pages;
+    SetCells(page, 0, CELLS_PER_PAGE);
+    ClearCells(page, middle, 10);
+    ClearCells(page, last, 8);
+
+    /*
+     * Enough free cells but no long enough run.
+     */
+
+    cells = PoolAllocCells(&pool, 11);
+    PICOTEST_ASSERT(CELL_PAGE(cells) != page);
+    PICOTEST_ASSERT(NbSetCells(page) == CELLS_PER_PAGE - 18);
+
+    cells = PoolAllocCells(&pool, 9);
+    PICOTEST_ASSERT(cells == PAGE_CELL(page, middle));
+    cells = PoolAllocCells(&pool, 8);
+    PICOTEST_ASSERT(cells == PAGE_CELL(page, last));
+    cells = PoolAllocCells(&pool, 1);
+    PICOTEST_ASSERT(cells == PAGE_CELL(page, middle + 9));
+    PICOTEST_ASSERT(NbSetCells(page) == CELLS_PER_PAGE);
+
+    /*
+     * Full page is skipped.
+     */
+
+    cells = PoolAllocCells(&pool, 1);
+    PICOTEST_ASSERT(CELL_PAGE(cells) != page);
+
+    PoolCleanup(&pool);
+}
+PICOTEST_CASE(testAllocFindFromIndex, colibriFixture) {
+    const size_t early = 10, start = CELLS_PER_PAGE/2 + 6,
+            late = CELLS_PER_PAGE - 12;
+    MemoryPool pool;
+    Cell *cells;
+    Page *page;
+
+    PoolInit(&pool, 2);
+    PoolAllocPages(&pool, 1);
+    page = pool.pages;
+    SetCells(page, 0, CELLS_PER_PAGE);
+    ClearCells(page, early, 4);
+    ClearCells(page, late, 4);
+
+    /*
+     * Runs before the first cell to consider are ignored.
+     */
+
+    pool.lastFreeCell[3] = PAGE_CELL(page, start);
+    cells = PoolAllocCells(&pool, 4);
+    PICOTEST_ASSERT(cells == PAGE_CELL(page, late));
+    PICOTEST_ASSERT(!TestCell(page, early));
+
+    pool.lastFreeCell[3] = PAGE_CELL(page, 0);
+    cells = PoolAllocCells(&pool, 4);
+    PICOTEST_ASSERT(cells == PAGE_CELL(page, early));
+
+    PoolCleanup(&pool);
+}
+
+PICOTEST_SUITE(testAllocFree, testAllocFreeBatch, testAllocFreeTrim);
+static ThreadData * getThreadData() {
+    MemoryPool pool;
+    ThreadData *data;
+
+    /*
+     * Eden pages remember their owner thread.
+     */
+
+    PoolInit(&pool, 1);
+    PoolAllocPages(&pool, 1);
+    data = PAGE_THREADDATA(pool.pages);
+    PoolCleanup(&pool);
+    return data;
+}
+static void allocSysPages(MemoryPool *pool, size_t number, void **pages) {
+    Page *last;
+    size_t i;
+
+    for (i = 0; i < number; i++) {
+        last = pool->lastPage;
+        PoolAllocPages(pool, 1);
+        pages[i] = (last ? PAGE_NEXT(last) : pool->pages);
+    }
+}
+static int isCachedPage(ThreadData *data, void *page) {
+    size_t i;
+    for (i = 0; i < data->nbCachedPages; i++) {
+        if (data->pageCache[i] == page) return 1;
+    }
+    return 0;
+}
+PICOTEST_CASE(testAllocFreeBatch, colibriFixture) {
+    ThreadData *data = getThreadData();
+    MemoryPool pool1, pool2;
+    void *pages[PAGE_FREE_BATCH], *cached;
+    size_t i;
+
+    SysPageCacheCleanup(data);
+    PICOTEST_ASSERT(data->nbCachedPages == 0);
+    PICOTEST_ASSERT(data->nbFreedPages == 0);
+
+    PoolInit(&pool1, 2);
+    allocSysPages(&pool1, PAGE_FREE_BATCH - 1, pages);
+    PoolInit(&pool2, 2);
+    allocSysPages(&pool2, 1, pages + PAGE_FREE_BATCH - 1);
+
+    /*
+     * Freed pages are queued until the batch is full, then go to the cache.
+     */
+
+    PoolCleanup(&pool1);
+    PICOTEST_ASSERT(data->nbFreedPages == PAGE_FREE_BATCH - 1);
+    PICOTEST_ASSERT(data->nbCachedPages == 0);
+    PoolCleanup(&pool2);
+    PICOTEST_ASSERT(data->nbFreedPages == 0);
+    PICOTEST_ASSERT(data->nbCachedPages == PAGE_FREE_BATCH);
+    for (i = 0; i < PAGE_FREE_BATCH; i++) {
+        PICOTEST_ASSERT(isCachedPage(data, pages[i]));
+    }
+
+    /*
+     * Cached pages are reused first by eden pools.
+     */
+
+    cached = data->pageCache[data->nbCachedPages - 1];
+    PoolInit(&pool1, 1);
+    PoolAllocPages(&pool1, 1);
+    PICOTEST_ASSERT(pool1.pages == cached);
+    PICOTEST_ASSERT(data->nbCachedPages == PAGE_FREE_BATCH - 1);
+    PoolCleanup(&pool1);
+
+    SysPageCacheCleanup(data);
+    PICOTEST_ASSERT(data->nbCachedPages == 0);
+    PICOTEST_ASSERT(data->nbFreedPages == 0);
+}
+
+PICOTEST_CASE(testAllocFreeTrim, colibriFixture) {
+    ThreadData *data = getThreadData();
+    MemoryPool pool;
+    void *pages[PAGE_FREE_BATCH], *used;
+
+    SysPageCacheCleanup(data);
+    PoolInit(&pool, 2);
+    allocSysPages(&pool, PAGE_FREE_BATCH, pages);
+    PoolCleanup(&pool);
+    PICOTEST_ASSERT(data->nbCachedPages == PAGE_FREE_BATCH);
+
+    /*
+     * Only pages that remain unused between two trims are returned.
+     */
+
+    SysPageCacheTrim(data);
+    PICOTEST_ASSERT(data->nbCachedPages == PAGE_FREE_BATCH);
+    PoolInit(&pool, 1);
+    PoolAllocPages(&pool, 1);
+    used = pool.pages;
+    PoolCleanup(&pool);
+    SysPageFlush(data);
+    PICOTEST_ASSERT(data->nbCachedPages == PAGE_FREE_BATCH);
+    SysPageCacheTrim(data);
+    PICOTEST_ASSERT(data->nbCachedPages == 1);
+    PICOTEST_ASSERT(data->pageCache[0] == used);
+    SysPageCacheTrim(data);
+    PICOTEST_ASSERT(data->nbCachedPages == 0);
+}
+
+/* Spans several address ranges, the first ones being 256 and 512 pages. */
+#define NB_RANGE_PAGES 1000
+
+PICOTEST_SUITE(testAllocRanges, testAllocRangesLookup, testAllocRangesReuse,
+               testAllocRangesDedicated);
+static int comparePages(const void *p1, const void *p2) {
+    const char *page1 = *(const char **)p1, *page2 = *(const char **)p2;
+    return (page1 < page2 ? -1 : page1 > page2);
+}
+static void checkRangeLookup(void *base, size_t size) {
+    /*
+     * Page lookup fails with a fatal error.
+     */
+
+    SysPageProtect(base, 1);
+    SysPageProtect((char *)base + size*systemPageSize - 1, 0);
+}
+PICOTEST_CASE(testAllocRangesLookup, colibriFixture) {
+    MemoryPool pool;
+    void *pages[NB_RANGE_PAGES];
+    size_t i;
+
+    PoolInit(&pool, 2);
+    allocSysPages(&pool, NB_RANGE_PAGES, pages);
+    for (i = 0; i < NB_RANGE_PAGES; i++) {
+        checkRangeLookup(pages[i], 1);
+    }
+    PoolCleanup(&pool);
+}
+PICOTEST_CASE(testAllocRangesReuse, colibriFixture) {
+    ThreadData *data = getThreadData();
+    MemoryPool pool;
+    void *pages[NB_RANGE_PAGES], *reused[NB_RANGE_PAGES];
+    size_t i;
+
+    SysPageCacheCleanup(data);
+    PoolInit(&pool, 2);
+    allocSysPages(&pool, NB_RANGE_PAGES, pages);
+    PoolCleanup(&pool);
+    SysPageCacheCleanup(data);
+
+    /*
+     * Free pages are found first, so the same pages are allocated again.
+     */
+
+    PoolInit(&pool, 2);
+    allocSysPages(&pool, NB_RANGE_PAGES, reused);
+    qsort(pages, NB_RANGE_PAGES, sizeof(*pages), comparePages);
+    qsort(reused, NB_RANGE_PAGES, sizeof(*reused), comparePages);
+    for (i = 0; i < NB_RANGE_PAGES; i++) {
+        PICOTEST_ASSERT(reused[i] == pages[i]);
+    }
+    PoolCleanup(&pool);
+    SysPageCacheCleanup(data);
+}
+PICOTEST_CASE(testAllocRangesDedicated, colibriFixture) {
+    const size_t size = LARGE_PAGE_SIZE + 1,
+            number = size * (systemPageSize/PAGE_SIZE);
+    ThreadData *data = getThreadData();
+    MemoryPool pools[3], pool;
+    void *pages[NB_RANGE_PAGES];
+    size_t i;
+
+    /*
+     * Large page groups get their own range, interleaved with regular ones.
+     */
+
+    PoolInit(&pool, 2);
+    for (i = 0; i < 3; i++) {
+        PoolInit(pools+i, 2);
+        PoolAllocPages(pools+i, number);
+        allocSysPages(&pool, NB_RANGE_PAGES/3, pages + i*(NB_RANGE_PAGES/3));
+    }
+    for (i = 0; i < 3; i++) {
+        checkRangeLookup(pools[i].pages, size);
+    }
+
+    /*
+     * Released ranges leave the index, new ones get inserted.
+     */
+
+    PoolCleanup(pools+1);
+    SysPageCacheCleanup(data);
+    checkRangeLookup(pools[0].pages, size);
+    checkRangeLookup(pools[2].pages, size);
+    PoolInit(pools+1, 2);
+    PoolAllocPages(pools+1, number);
+    for (i = 0; i < 3; i++) {
+        checkRangeLookup(pools[i].pages, size);
+    }
+    for (i = 0; i < 3*(NB_RANGE_PAGES/3); i++) {
+        checkRangeLookup(pages[i], 1);
+    }
+
+    for (i = 0; i < 3; i++) {
+        PoolCleanup(pools+i);
+    }
+    PoolCleanup(&pool);
+    SysPageCacheCleanup(data);
+}
+
+#else /* HAVE_ALLOC_INTERNALS */
+
+PICOTEST_CASE(testAlloc, colibriFixture) {}
+
+#endif /* HAVE_ALLOC_INTERNALS */
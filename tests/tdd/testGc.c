@@ -0,0 +1,1507 @@
+#include <colibri.h>
+#include <picotest.h>
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Failure test cases (must be defined before test hooks)
+ */
+
+#include "failureFixture.h"
+
+/* Col_GetGcParam */
+PICOTEST_CASE(getGcParam_valueCheck, failureFixture, context) {
+    EXPECT_FAILURE(context, COL_VALUECHECK, Col_GetErrorDomain(),
+                   COL_ERROR_GCPARAM);
+    PICOTEST_ASSERT(Col_GetGcParam((Col_GcParam)-1) == 0);
+}
+
+/* Col_SetGcParam */
+PICOTEST_CASE(setGcParam_valueCheck, failureFixture, context) {
+    EXPECT_FAILURE(context, COL_VALUECHECK, Col_GetErrorDomain(),
+                   COL_ERROR_GCPARAM);
+    Col_SetGcParam((Col_GcParam)-1, 0);
+}
+
+/* Col_WeakRefValue */
+PICOTEST_CASE(weakRefValue_typeCheck, failureFixture, context) {
+    EXPECT_FAILURE(context, COL_TYPECHECK, Col_GetErrorDomain(),
+                   COL_ERROR_WEAKREF);
+    PICOTEST_ASSERT(Col_WeakRefValue(WORD_NIL) == WORD_NIL);
+}
+
+/* Col_NewWeakIntHashMap */
+PICOTEST_CASE(newWeakIntHashMap_valueCheck, failureFixture, context) {
+    EXPECT_FAILURE(context, COL_VALUECHECK, Col_GetErrorDomain(),
+                   COL_ERROR_WEAKNESS);
+    PICOTEST_ASSERT(Col_NewWeakIntHashMap(0, COL_WEAK_KEYS) == WORD_NIL);
+}
+
+/* Col_CloseHandleScope */
+PICOTEST_CASE(closeHandleScope_valueCheck, failureFixture, context) {
+    EXPECT_FAILURE(context, COL_VALUECHECK, Col_GetErrorDomain(),
+                   COL_ERROR_HANDLESCOPE);
+    Col_CloseHandleScope(Col_OpenHandleScope() + 1);
+}
+
+/*
+ * Garbage collector
+ */
+
+#include "hooks.h"
+#include "colibriFixture.h"
+#include "threads.h"
+
+#ifdef COL_USE_THREADS
+PICOTEST_SUITE(testGc, testGcParams, testGcMarking, testGcIncremental,
+               testGcSweep, testGcParents, testGcReserve, testGcDecommit,
+               testGcStats, testGcEvents, testGcThresholds, testGcLimits,
+               testGcCompact, testGcHandles, testGcBatchRoots,
+               testGcFinalize, testGcWeak, testGcLocal, testGcPause,
+               testGcThreadData);
+#else
+PICOTEST_SUITE(testGc, testGcParams, testGcMarking, testGcIncremental,
+               testGcSweep, testGcParents, testGcReserve, testGcDecommit,
+               testGcStats, testGcEvents, testGcThresholds, testGcLimits,
+               testGcCompact, testGcHandles, testGcBatchRoots,
+               testGcFinalize, testGcWeak);
+#endif /* COL_USE_THREADS */
+
+#ifdef COL_USE_THREADS
+PICOTEST_SUITE(testGcParams, testGcParamErrors, testGcMarkers, testGcWorkers);
+#else
+PICOTEST_SUITE(testGcParams, testGcParamErrors, testGcMarkers);
+#endif /* COL_USE_THREADS */
+
+PICOTEST_CASE(testGcParamErrors, colibriFixture) {
+    PICOTEST_VERIFY(getGcParam_valueCheck(NULL) == 1);
+    PICOTEST_VERIFY(setGcParam_valueCheck(NULL) == 1);
+}
+
+PICOTEST_SUITE(testGcMarkers, testGcMarkersDefault, testGcMarkersClamp,
+               testGcMarkersCollect);
+PICOTEST_CASE(testGcMarkersDefault, colibriFixture) {
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_MARKERS) == 1);
+}
+PICOTEST_CASE(testGcMarkersClamp, colibriFixture) {
+    Col_SetGcParam(COL_GC_MARKERS, 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_MARKERS) == 1);
+    Col_SetGcParam(COL_GC_MARKERS, (size_t)-1);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_MARKERS) >= 1);
+}
+PICOTEST_CASE(testGcMarkersCollect, colibriFixture) {
+    Col_GcStats stats;
+    Col_Word list, vector;
+    size_t i, length = 20000, collections;
+
+    /*
+     * Live data spans several mark deques so that all markers take part.
+     * Compaction would mark serially, so collect without it.
+     */
+
+    Col_SetGcParam(COL_GC_MARKERS, 4);
+#ifdef COL_USE_THREADS
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_MARKERS) == 4);
+#endif /* COL_USE_THREADS */
+    list = Col_NewMList();
+    Col_WordPreserve(list);
+    Col_MListSetLength(list, length);
+    for (i = 0; i < length; i++) {
+        Col_MListSetAt(list, i, Col_NewVectorV(Col_NewIntWord(i),
+                                               Col_NewCharWord('a'),
+                                               Col_EmptyRope()));
+        Col_NewVector(10, NULL);
+    }
+    Col_GetGcStats(&stats);
+    collections = stats.collections;
+    Col_ResumeGC();
+    Col_PauseGC();
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.collections > collections);
+
+    PICOTEST_ASSERT(Col_ListLength(list) == length);
+    for (i = 0; i < length; i++) {
+        vector = Col_ListAt(list, i);
+        PICOTEST_ASSERT(Col_VectorLength(vector) == 3);
+        PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(vector)[0]) ==
+                        (intptr_t)i);
+        PICOTEST_ASSERT(Col_CharWordValue(Col_VectorElements(vector)[1]) ==
+                        'a');
+    }
+    Col_WordRelease(list);
+}
+
+#ifdef COL_USE_THREADS
+PICOTEST_SUITE(testGcWorkers, testGcWorkersClamp);
+PICOTEST_CASE(testGcWorkersClamp, colibriFixture) {
+    size_t workers = Col_GetGcParam(COL_GC_WORKERS);
+
+    PICOTEST_ASSERT(workers >= 1);
+    Col_SetGcParam(COL_GC_WORKERS, 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_WORKERS) == 1);
+    Col_SetGcParam(COL_GC_WORKERS, workers);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_WORKERS) == workers);
+
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_WORKER_PRIORITY) == 2);
+    Col_SetGcParam(COL_GC_WORKER_PRIORITY, 10);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_WORKER_PRIORITY) == 4);
+    Col_SetGcParam(COL_GC_WORKER_PRIORITY, 2);
+
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_WORKER_AFFINITY) == 0);
+    Col_SetGcParam(COL_GC_WORKER_AFFINITY, 1);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_WORKER_AFFINITY) == 1);
+    Col_SetGcParam(COL_GC_WORKER_AFFINITY, 0);
+}
+#endif /* COL_USE_THREADS */
+
+PICOTEST_SUITE(testGcMarking, testGcMarkDeepChain);
+
+/* Custom word chain, each link is a child of the previous one */
+typedef struct ChainLink {
+    Col_Word next;
+    size_t depth;
+} ChainLink;
+static size_t chainLinkSize(Col_Word word) { return sizeof(ChainLink); }
+static void chainLinkChildren(Col_Word word, Col_CustomWordChildEnumProc *proc,
+                              Col_ClientData clientData) {
+    ChainLink *link;
+    Col_CustomWordInfo(word, (void **)&link);
+    proc(word, &link->next, clientData);
+}
+static Col_CustomWordType chainLinkType = {
+    COL_CUSTOM, "chainLink", chainLinkSize, NULL, chainLinkChildren};
+
+PICOTEST_CASE(testGcMarkDeepChain, colibriFixture) {
+    Col_Word chain = WORD_NIL, word;
+    ChainLink *link;
+    size_t depth = 1000000, i;
+
+    for (i = 0; i < depth; i++) {
+        word = Col_NewCustomWord(&chainLinkType, sizeof(ChainLink),
+                                 (void **)&link);
+        link->next = chain;
+        link->depth = i;
+        chain = word;
+    }
+    Col_WordPreserve(chain);
+    Col_ResumeGC();
+    Col_PauseGC();
+    for (i = depth, word = chain; i > 0; i--) {
+        PICOTEST_ASSERT(Col_CustomWordInfo(word, (void **)&link) ==
+                        &chainLinkType);
+        PICOTEST_ASSERT(link->depth == i - 1);
+        word = link->next;
+    }
+    PICOTEST_ASSERT(word == WORD_NIL);
+    Col_WordRelease(chain);
+}
+
+#ifdef COL_USE_THREADS
+PICOTEST_SUITE(testGcIncremental, testGcIncrementalParams,
+               testGcIncrementalCollect, testGcIncrementalAsync);
+#else
+PICOTEST_SUITE(testGcIncremental, testGcIncrementalParams,
+               testGcIncrementalCollect);
+#endif /* COL_USE_THREADS */
+PICOTEST_CASE(testGcIncrementalParams, colibriFixture) {
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_INCREMENTAL) == 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_SLICE_BUDGET) > 0);
+    Col_SetGcParam(COL_GC_INCREMENTAL, 2);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_INCREMENTAL) == 1);
+    Col_SetGcParam(COL_GC_INCREMENTAL, 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_INCREMENTAL) == 0);
+    Col_SetGcParam(COL_GC_SLICE_BUDGET, 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_SLICE_BUDGET) == 1);
+    Col_SetGcParam(COL_GC_SLICE_BUDGET, 500);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_SLICE_BUDGET) == 500);
+}
+PICOTEST_CASE(testGcIncrementalCollect, colibriFixture) {
+    Col_Word list, vector;
+    size_t i;
+
+    Col_SetGcParam(COL_GC_INCREMENTAL, 1);
+    Col_SetGcParam(COL_GC_SLICE_BUDGET, 1);
+    list = Col_NewMList();
+    Col_WordPreserve(list);
+    for (i = 0; i < 100000; i++) {
+        /*
+         * Mutate older data while cycles are underway.
+         */
+
+        vector = Col_NewVectorV(Col_NewIntWord(i), Col_EmptyRope());
+        Col_MListInsert(list, i / 2, Col_NewVectorV(vector));
+        Col_NewVector(10, NULL);
+        Col_ResumeGC();
+        Col_PauseGC();
+    }
+    PICOTEST_ASSERT(Col_ListLength(list) == 100000);
+    for (i = 0; i < 100000; i++) {
+        vector = Col_ListAt(list, i);
+        PICOTEST_ASSERT(Col_VectorLength(vector) == 2);
+    }
+    Col_WordRelease(list);
+}
+#ifdef COL_USE_THREADS
+typedef struct GcSliceTracker {
+    size_t iteration;
+    size_t lastSlice;
+    int interleaved;
+} GcSliceTracker;
+static void trackGcSlices(Col_GcEvent event, int begin, uint64_t time,
+                          unsigned int generation,
+                          Col_ClientData clientData) {
+    GcSliceTracker *tracker = (GcSliceTracker *)clientData;
+    if (event == COL_GC_EVENT_SLICE && begin) {
+        if (tracker->lastSlice != (size_t)-1
+                && tracker->lastSlice != tracker->iteration) {
+            tracker->interleaved = 1;
+        }
+        tracker->lastSlice = tracker->iteration;
+    } else if (event == COL_GC_EVENT_COLLECT && !begin && generation > 1) {
+        tracker->lastSlice = (size_t)-1;
+    }
+}
+PICOTEST_CASE(testGcIncrementalAsync, asyncFixture) {
+    GcSliceTracker tracker;
+    Col_Word list, vector;
+    size_t i;
+
+    tracker.iteration = 0;
+    tracker.lastSlice = (size_t)-1;
+    tracker.interleaved = 0;
+    Col_SetGcEventProc(trackGcSlices, &tracker);
+    Col_SetGcParam(COL_GC_INCREMENTAL, 1);
+    Col_SetGcParam(COL_GC_SLICE_BUDGET, 1);
+    list = Col_NewMList();
+    Col_WordPreserve(list);
+    for (i = 0; i < 100000; i++) {
+        /*
+         * Slices of a cycle must run across several GC-protected sections.
+         */
+
+        vector = Col_NewVectorV(Col_NewIntWord(i), Col_EmptyRope());
+        Col_MListInsert(list, i / 2, Col_NewVectorV(vector));
+        Col_NewVector(10, NULL);
+        Col_ResumeGC();
+        Col_PauseGC();
+        tracker.iteration = i + 1;
+    }
+    Col_SetGcEventProc(NULL, NULL);
+    PICOTEST_ASSERT(tracker.interleaved);
+    PICOTEST_ASSERT(Col_ListLength(list) == 100000);
+    for (i = 0; i < 100000; i++) {
+        vector = Col_ListAt(list, i);
+        PICOTEST_ASSERT(Col_VectorLength(vector) == 2);
+    }
+    Col_WordRelease(list);
+}
+#endif /* COL_USE_THREADS */
+
+PICOTEST_SUITE(testGcSweep, testGcSweepOlderGenerations);
+PICOTEST_CASE(testGcSweepOlderGenerations, colibriFixture) {
+    Col_Word words[1000];
+    size_t i, j;
+
+    /*
+     * Get words promoted to older generations, then release half of them so
+     * that their pages get swept lazily as new pages are allocated.
+     */
+
+    for (i = 0; i < 1000; i++) {
+        words[i] = Col_NewVectorV(Col_NewIntWord(i), Col_EmptyRope());
+        Col_WordPreserve(words[i]);
+    }
+    for (j = 0; j < 100; j++) {
+        for (i = 0; i < 1000; i++) {
+            Col_NewVector(10, NULL);
+        }
+        Col_ResumeGC();
+        Col_PauseGC();
+        if (j == 50) {
+            for (i = 0; i < 1000; i += 2) {
+                Col_WordRelease(words[i]);
+            }
+        }
+    }
+    for (i = 1; i < 1000; i += 2) {
+        PICOTEST_ASSERT(Col_VectorLength(words[i]) == 2);
+        PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(words[i])[0]) ==
+                        (intptr_t)i);
+        Col_WordRelease(words[i]);
+    }
+}
+
+PICOTEST_SUITE(testGcParents, testGcParentsMutateOlder,
+               testGcParentsRememberedSet);
+PICOTEST_CASE(testGcParentsMutateOlder, colibriFixture) {
+    Col_Word map, trie, chain, value;
+    ChainLink *link;
+    size_t i, j;
+
+    /*
+     * Store new words into containers that got promoted to older generations,
+     * so that they are only reachable through parent tracking.
+     */
+
+    map = Col_NewIntHashMap(0);
+    trie = Col_NewIntTrieMap();
+    chain = Col_NewCustomWord(&chainLinkType, sizeof(ChainLink),
+                              (void **)&link);
+    link->next = WORD_NIL;
+    Col_WordPreserve(map);
+    Col_WordPreserve(trie);
+    Col_WordPreserve(chain);
+    for (i = 0; i < 200; i++) {
+        for (j = 0; j < 1000; j++) {
+            Col_NewVector(10, NULL);
+        }
+        Col_IntHashMapSet(map, i % 20, Col_NewVectorV(Col_NewIntWord(i)));
+        Col_IntTrieMapSet(trie, i % 20, Col_NewVectorV(Col_NewIntWord(i)));
+        Col_CustomWordInfo(chain, (void **)&link);
+        Col_CustomWordModified(chain);
+        link->next = Col_NewVectorV(Col_NewIntWord(i));
+        Col_ResumeGC();
+        Col_PauseGC();
+        for (j = 0; j < 20 && j <= i; j++) {
+            PICOTEST_ASSERT(Col_IntHashMapGet(map, j, &value));
+            PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(value)[0]) % 20
+                            == (intptr_t)j);
+            PICOTEST_ASSERT(Col_IntTrieMapGet(trie, j, &value));
+            PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(value)[0]) % 20
+                            == (intptr_t)j);
+        }
+        Col_CustomWordInfo(chain, (void **)&link);
+        PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(link->next)[0]) ==
+                        (intptr_t)i);
+    }
+    Col_WordRelease(map);
+    Col_WordRelease(trie);
+    Col_WordRelease(chain);
+}
+PICOTEST_CASE(testGcParentsRememberedSet, colibriFixture) {
+    Col_Word mvector, *elements;
+    Col_GcStats stats;
+    size_t i, j;
+
+    /*
+     * Store new words into a few cells of an older mutable vector, then
+     * collect repeatedly without further writes: its page stays remembered
+     * through these cells only.
+     */
+
+    mvector = Col_NewMVector(100, 100, NULL);
+    Col_WordPreserve(mvector);
+    for (i = 0; i < 20; i++) {
+        for (j = 0; j < 1000; j++) {
+            Col_NewVector(10, NULL);
+        }
+        Col_ResumeGC();
+        Col_PauseGC();
+    }
+    elements = Col_MVectorElements(mvector);
+    for (j = 0; j < 100; j += 10) {
+        elements[j] = Col_NewVectorV(Col_NewIntWord(j));
+    }
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 1000; j++) {
+            Col_NewVector(10, NULL);
+        }
+        Col_ResumeGC();
+        Col_PauseGC();
+        elements = Col_MVectorElements(mvector);
+        for (j = 0; j < 100; j += 10) {
+            PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(elements[j])[0])
+                            == (intptr_t)j);
+        }
+        Col_GetGcStats(&stats);
+        PICOTEST_ASSERT(stats.parents == 1);
+    }
+
+    /*
+     * Parent page is forgotten once it no longer refers to younger words.
+     */
+
+    elements = Col_MVectorElements(mvector);
+    for (j = 0; j < 100; j += 10) {
+        elements[j] = Col_NewIntWord(j);
+    }
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 1000; j++) {
+            Col_NewVector(10, NULL);
+        }
+        Col_ResumeGC();
+        Col_PauseGC();
+    }
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.parents == 0);
+    Col_WordRelease(mvector);
+}
+
+PICOTEST_SUITE(testGcReserve, testGcReservePrefault);
+PICOTEST_CASE(testGcReservePrefault, colibriFixture) {
+    Col_Word vector, *elements;
+    size_t i;
+
+    PICOTEST_ASSERT(Col_ReserveMemory(16 << 20, 1));
+
+    /*
+     * Allocate enough to spill over into the reserved ranges.
+     */
+
+    vector = Col_NewMVector(100000, 100000, NULL);
+    Col_WordPreserve(vector);
+    for (i = 0; i < 100000; i++) {
+        Col_MVectorElements(vector)[i] =
+            Col_NewVectorV(Col_NewIntWord(i), Col_NewIntWord(i));
+        if (i % 1000 == 999) {
+            Col_ResumeGC();
+            Col_PauseGC();
+        }
+    }
+    elements = Col_MVectorElements(vector);
+    for (i = 0; i < 100000; i += 97) {
+        PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(elements[i])[0])
+                        == (intptr_t)i);
+    }
+    Col_WordRelease(vector);
+}
+
+PICOTEST_SUITE(testGcDecommit, testGcDecommitParams, testGcDecommitCollect);
+PICOTEST_CASE(testGcDecommitParams, colibriFixture) {
+    size_t delay = Col_GetGcParam(COL_GC_DECOMMIT_DELAY);
+    PICOTEST_ASSERT(delay > 0);
+    Col_SetGcParam(COL_GC_DECOMMIT_DELAY, 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_DECOMMIT_DELAY) == 0);
+    Col_SetGcParam(COL_GC_DECOMMIT_DELAY, delay);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_DECOMMIT_DELAY) == delay);
+}
+PICOTEST_CASE(testGcDecommitCollect, colibriFixture) {
+    Col_Word list, vector;
+    size_t delay = Col_GetGcParam(COL_GC_DECOMMIT_DELAY), i, j;
+
+    Col_SetGcParam(COL_GC_DECOMMIT_DELAY, 0);
+    list = Col_NewMList();
+    Col_WordPreserve(list);
+    for (j = 0; j < 3; j++) {
+        /*
+         * Grow then drop the heap, so that pages and whole ranges get
+         * returned to the system and reused.
+         */
+
+        for (i = 0; i < 50000; i++) {
+            vector = Col_NewVectorV(Col_NewIntWord(i), Col_NewIntWord(j));
+            Col_MListInsert(list, i, Col_NewVectorV(vector));
+            if (i % 1000 == 999) {
+                Col_ResumeGC();
+                Col_PauseGC();
+            }
+        }
+        PICOTEST_ASSERT(Col_ListLength(list) == 50000);
+        for (i = 0; i < 50000; i += 97) {
+            vector = Col_ListAt(list, i);
+            PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(vector)[0])
+                            == (intptr_t)i);
+            PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(vector)[1])
+                            == (intptr_t)j);
+        }
+        Col_MListRemove(list, 0, Col_ListLength(list)-1);
+        for (i = 0; i < 100; i++) {
+            Col_NewVector(10, NULL);
+            Col_ResumeGC();
+            Col_PauseGC();
+        }
+    }
+    Col_WordRelease(list);
+    Col_SetGcParam(COL_GC_DECOMMIT_DELAY, delay);
+}
+
+PICOTEST_SUITE(testGcStats, testGcStatsHeap, testGcStatsCollect);
+PICOTEST_CASE(testGcStatsHeap, colibriFixture) {
+    Col_HeapStats stats, stats2;
+    unsigned int generation;
+    size_t i;
+
+    for (i = 0; i < 100; i++) {
+        Col_NewVector(10, NULL);
+    }
+    PICOTEST_ASSERT(Col_GetHeapStats(1, &stats));
+    PICOTEST_ASSERT(stats.pages > 0);
+    PICOTEST_ASSERT(stats.cells >= 200);
+    PICOTEST_ASSERT(stats.totalAllocated >= stats.pages);
+    Col_NewVector(1000, NULL);
+    PICOTEST_ASSERT(Col_GetHeapStats(1, &stats2));
+    PICOTEST_ASSERT(stats2.pages > stats.pages);
+    PICOTEST_ASSERT(stats2.cells > stats.cells);
+    for (generation = 0; Col_GetHeapStats(generation, &stats); generation++);
+    PICOTEST_ASSERT(generation > 2);
+    PICOTEST_ASSERT(!Col_GetHeapStats(generation, &stats));
+}
+PICOTEST_CASE(testGcStatsCollect, colibriFixture) {
+    Col_GcStats stats;
+    Col_HeapStats heapStats;
+    Col_Word words[10];
+    size_t i;
+
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.collections == 0);
+    PICOTEST_ASSERT(stats.roots == 0);
+    for (i = 0; i < 10; i++) {
+        words[i] = Col_NewVectorV(Col_NewIntWord(i));
+        Col_WordPreserve(words[i]);
+    }
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.roots == 10);
+
+    for (i = 0; i < 10000; i++) {
+        Col_NewVector(100, NULL);
+        Col_ResumeGC();
+        Col_PauseGC();
+    }
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.collections > 0);
+    PICOTEST_ASSERT(stats.localCollections == 0);
+    PICOTEST_ASSERT(stats.lastGeneration >= 1);
+    PICOTEST_ASSERT(stats.totalPause >= stats.maxPause);
+    PICOTEST_ASSERT(stats.maxPause >= stats.lastPause);
+    PICOTEST_ASSERT(Col_GetHeapStats(1, &heapStats));
+    PICOTEST_ASSERT(heapStats.collections == stats.collections);
+    PICOTEST_ASSERT(Col_GetHeapStats(2, &heapStats));
+    PICOTEST_ASSERT(heapStats.totalAllocated > 0);
+
+    for (i = 0; i < 10; i++) {
+        Col_WordRelease(words[i]);
+    }
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.roots == 0);
+}
+
+PICOTEST_SUITE(testGcEvents, testGcEventProc, testGcEventTrace);
+typedef struct GcEventCounts {
+    size_t begin[COL_GC_EVENT_SLICE+1];
+    size_t end[COL_GC_EVENT_SLICE+1];
+    uint64_t time;
+    int invalid;
+} GcEventCounts;
+static void countGcEvents(Col_GcEvent event, int begin, uint64_t time,
+                          unsigned int generation, Col_ClientData clientData) {
+    GcEventCounts *counts = (GcEventCounts *)clientData;
+    if (time < counts->time || generation < 1) {
+        counts->invalid = 1;
+    }
+    counts->time = time;
+    if (begin) {
+        counts->begin[event]++;
+    } else {
+        counts->end[event]++;
+    }
+}
+PICOTEST_CASE(testGcEventProc, colibriFixture) {
+    GcEventCounts counts;
+    Col_ClientData clientData;
+    size_t i;
+
+    memset(&counts, 0, sizeof(counts));
+    PICOTEST_ASSERT(Col_GetGcEventProc(NULL) == NULL);
+    PICOTEST_ASSERT(Col_SetGcEventProc(countGcEvents, &counts) == NULL);
+    PICOTEST_ASSERT(Col_GetGcEventProc(&clientData) == countGcEvents);
+    PICOTEST_ASSERT(clientData == &counts);
+    for (i = 0; i < 10000; i++) {
+        Col_NewVector(100, NULL);
+        Col_ResumeGC();
+        Col_PauseGC();
+    }
+    PICOTEST_ASSERT(Col_SetGcEventProc(NULL, NULL) == countGcEvents);
+    PICOTEST_ASSERT(!counts.invalid);
+    PICOTEST_ASSERT(counts.begin[COL_GC_EVENT_COLLECT] > 0);
+    for (i = COL_GC_EVENT_COLLECT; i <= COL_GC_EVENT_PROMOTE; i++) {
+        PICOTEST_ASSERT(counts.begin[i] == counts.begin[COL_GC_EVENT_COLLECT]);
+        PICOTEST_ASSERT(counts.end[i] == counts.begin[i]);
+    }
+}
+PICOTEST_CASE(testGcEventTrace, colibriFixture) {
+    const char *path = "testGcEventTrace.json";
+    char buffer[32], event[256];
+    FILE *file;
+    size_t i;
+
+    PICOTEST_ASSERT(Col_StartGcTrace(path));
+    PICOTEST_ASSERT(Col_GetGcEventProc(NULL) != NULL);
+    for (i = 0; i < 10000; i++) {
+        Col_NewVector(100, NULL);
+        Col_ResumeGC();
+        Col_PauseGC();
+    }
+    Col_StopGcTrace();
+    PICOTEST_ASSERT(Col_GetGcEventProc(NULL) == NULL);
+
+    file = fopen(path, "r");
+    PICOTEST_ASSERT(file);
+    PICOTEST_ASSERT(fgets(buffer, sizeof(buffer), file));
+    PICOTEST_ASSERT(fgets(event, sizeof(event), file));
+    fclose(file);
+    remove(path);
+    PICOTEST_ASSERT(strncmp(buffer, "{\"traceEvents\":[", 16) == 0);
+    PICOTEST_ASSERT(strstr(event, "\"pid\":"));
+    PICOTEST_ASSERT(strstr(event, "\"tid\":"));
+}
+
+PICOTEST_SUITE(testGcThresholds, testGcThresholdParams,
+               testGcThresholdAdaptive);
+PICOTEST_CASE(testGcThresholdParams, colibriFixture) {
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_GEN_FACTOR) >= 2);
+    Col_SetGcParam(COL_GC_GEN_FACTOR, 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_GEN_FACTOR) == 2);
+
+    Col_SetGcParam(COL_GC_MIN_PAGE_ALLOC, 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_MIN_PAGE_ALLOC) == 1);
+    Col_SetGcParam(COL_GC_MAX_PAGE_ALLOC, 100);
+    Col_SetGcParam(COL_GC_MIN_PAGE_ALLOC, 200);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_MIN_PAGE_ALLOC) == 200);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_MAX_PAGE_ALLOC) == 200);
+    Col_SetGcParam(COL_GC_MAX_PAGE_ALLOC, 50);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_MIN_PAGE_ALLOC) == 50);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_MAX_PAGE_ALLOC) == 50);
+
+    Col_SetGcParam(COL_GC_PROMOTE_FILL_RATIO, 1000);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_PROMOTE_FILL_RATIO) == 100);
+
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_ADAPTIVE) == 0);
+    Col_SetGcParam(COL_GC_ADAPTIVE, 2);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_ADAPTIVE) == 1);
+    Col_SetGcParam(COL_GC_PAUSE_TARGET, 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_PAUSE_TARGET) == 1);
+}
+PICOTEST_CASE(testGcThresholdAdaptive, colibriFixture) {
+    Col_Word list, vector;
+    Col_GcStats stats;
+    size_t i;
+
+    Col_SetGcParam(COL_GC_ADAPTIVE, 1);
+    Col_SetGcParam(COL_GC_GEN_FACTOR, 4);
+    Col_SetGcParam(COL_GC_PROMOTE_FILL_RATIO, 50);
+    list = Col_NewMList();
+    Col_WordPreserve(list);
+    for (i = 0; i < 100000; i++) {
+        /*
+         * Mix of long-lived and short-lived data.
+         */
+
+        vector = Col_NewVectorV(Col_NewIntWord(i), Col_EmptyRope());
+        Col_MListInsert(list, i, Col_NewVectorV(vector));
+        Col_NewVector(100, NULL);
+        Col_ResumeGC();
+        Col_PauseGC();
+    }
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.collections > 0);
+    PICOTEST_ASSERT(Col_ListLength(list) == 100000);
+    for (i = 0; i < 100000; i += 97) {
+        vector = Col_ListAt(list, i);
+        PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(vector)[0])
+                        == (intptr_t)i);
+    }
+    Col_WordRelease(list);
+}
+
+PICOTEST_SUITE(testGcLimits, testGcLimitParams, testGcLimitSoft,
+               testGcLimitHard);
+PICOTEST_CASE(testGcLimitParams, colibriFixture) {
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_SOFT_LIMIT) == 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_HARD_LIMIT) == 0);
+    Col_SetGcParam(COL_GC_SOFT_LIMIT, 1000000);
+    Col_SetGcParam(COL_GC_HARD_LIMIT, 2000000);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_SOFT_LIMIT) == 1000000);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_HARD_LIMIT) == 2000000);
+}
+static void maxGcGeneration(Col_GcEvent event, int begin, uint64_t time,
+                            unsigned int generation,
+                            Col_ClientData clientData) {
+    unsigned int *maxGeneration = (unsigned int *)clientData;
+    if (event == COL_GC_EVENT_COLLECT && generation > *maxGeneration) {
+        *maxGeneration = generation;
+    }
+}
+PICOTEST_CASE(testGcLimitSoft, colibriFixture) {
+    Col_HeapStats stats;
+    Col_Word list;
+    unsigned int generation, maxGeneration = 0;
+    size_t i;
+
+    for (generation = 0; Col_GetHeapStats(generation, &stats); generation++);
+    Col_SetGcEventProc(maxGcGeneration, &maxGeneration);
+    Col_SetGcParam(COL_GC_SOFT_LIMIT, 1000000);
+    list = Col_NewMList();
+    Col_WordPreserve(list);
+    for (i = 0; i < 10000; i++) {
+        Col_MListInsert(list, i, Col_NewVectorV(Col_NewVector(10, NULL)));
+        Col_ResumeGC();
+        Col_PauseGC();
+    }
+    Col_SetGcEventProc(NULL, NULL);
+    PICOTEST_ASSERT(maxGeneration == generation - 1);
+    PICOTEST_ASSERT(Col_ListLength(list) == 10000);
+    Col_WordRelease(list);
+}
+static size_t nbHeapLimitErrors;
+static jmp_buf heapLimitJmp;
+static int heapLimitErrorProc(Col_ErrorLevel level, Col_ErrorDomain domain,
+                              int code, va_list args) {
+    if (level == COL_ERROR && domain == Col_GetErrorDomain()
+        && code == COL_ERROR_HEAPLIMIT) {
+        /*
+         * Allocation failed, unwind to test case.
+         */
+        nbHeapLimitErrors++;
+        longjmp(heapLimitJmp, 1);
+    }
+    return 0;
+}
+#define NB_LIMIT_WORDS 10000
+static Col_Word limitWords[NB_LIMIT_WORDS];
+PICOTEST_CASE(testGcLimitHard, colibriFixture) {
+    Col_ErrorProc *oldErrorProc;
+    volatile size_t nbWords = 0;
+    size_t i;
+
+    nbHeapLimitErrors = 0;
+    oldErrorProc = Col_SetErrorProc(heapLimitErrorProc);
+    Col_SetGcParam(COL_GC_HARD_LIMIT, 1000000);
+    if (!setjmp(heapLimitJmp)) {
+        for (; nbWords < NB_LIMIT_WORDS; nbWords++) {
+            limitWords[nbWords] = Col_NewVector(100, NULL);
+            Col_WordPreserve(limitWords[nbWords]);
+            Col_ResumeGC();
+            Col_PauseGC();
+        }
+    }
+    PICOTEST_ASSERT(nbHeapLimitErrors == 1);
+    PICOTEST_ASSERT(nbWords > 0 && nbWords < NB_LIMIT_WORDS);
+
+    /*
+     * Allocations keep failing while over the limit.
+     */
+
+    if (!setjmp(heapLimitJmp)) {
+        Col_NewVector(100, NULL);
+    }
+    PICOTEST_ASSERT(nbHeapLimitErrors == 2);
+
+    /*
+     * Allocations succeed again once collected.
+     */
+
+    for (i = 0; i < nbWords; i++) {
+        Col_WordRelease(limitWords[i]);
+    }
+    Col_ResumeGC();
+    Col_PauseGC();
+    if (!setjmp(heapLimitJmp)) {
+        for (i = 0; i < nbWords / 2; i++) {
+            Col_NewVector(100, NULL);
+        }
+    }
+    Col_SetErrorProc(oldErrorProc);
+    PICOTEST_ASSERT(nbHeapLimitErrors == 2);
+}
+
+PICOTEST_SUITE(testGcCompact, testGcCompactHeap, testGcCompactParallel);
+static size_t heapPages() {
+    Col_HeapStats stats;
+    unsigned int generation;
+    size_t pages = 0;
+
+    for (generation = 1; Col_GetHeapStats(generation, &stats); generation++) {
+        pages += stats.pages;
+    }
+    return pages;
+}
+static void checkCompactHeap() {
+    Col_Word vector;
+    GcEventCounts counts;
+    size_t i, pages;
+
+    vector = Col_NewMVector(10000, 10000, NULL);
+    Col_WordPreserve(vector);
+    for (i = 0; i < 10000; i++) {
+        Col_MVectorElements(vector)[i] =
+            Col_NewVectorNV(2, Col_NewIntWord(i), WORD_NIL);
+    }
+    Col_CompactHeap();
+    Col_ResumeGC();
+    Col_PauseGC();
+
+    /*
+     * Leave one element out of 16 on each page.
+     */
+
+    for (i = 0; i < 10000; i++) {
+        if (i % 16) Col_MVectorElements(vector)[i] = WORD_NIL;
+    }
+    pages = heapPages();
+    memset(&counts, 0, sizeof(counts));
+    Col_SetGcEventProc(countGcEvents, &counts);
+    Col_CompactHeap();
+    Col_ResumeGC();
+    Col_PauseGC();
+    Col_SetGcEventProc(NULL, NULL);
+    PICOTEST_ASSERT(counts.begin[COL_GC_EVENT_COLLECT] == 1);
+    PICOTEST_ASSERT(heapPages() < pages / 2);
+    for (i = 0; i < 10000; i += 16) {
+        PICOTEST_ASSERT(Col_IntWordValue(
+                            Col_VectorElements(Col_MVectorElements(vector)[i])[0])
+                        == (intptr_t)i);
+    }
+    Col_WordRelease(vector);
+}
+PICOTEST_CASE(testGcCompactHeap, colibriFixture) { checkCompactHeap(); }
+PICOTEST_CASE(testGcCompactParallel, colibriFixture) {
+    Col_SetGcParam(COL_GC_MARKERS, 4);
+    checkCompactHeap();
+}
+
+PICOTEST_SUITE(testGcHandles, testGcHandleErrors, testGcHandleScopes,
+               testGcHandleCollect);
+PICOTEST_CASE(testGcHandleErrors, colibriFixture) {
+    PICOTEST_VERIFY(closeHandleScope_valueCheck(NULL) == 1);
+}
+PICOTEST_CASE(testGcHandleScopes, colibriFixture) {
+    Col_HandleScope outer, inner;
+    Col_Word *handle;
+
+    outer = Col_OpenHandleScope();
+    handle = Col_NewHandle(Col_NewIntWord(1));
+    PICOTEST_ASSERT(Col_IntWordValue(*handle) == 1);
+    inner = Col_OpenHandleScope();
+    PICOTEST_ASSERT(inner == outer + 1);
+    Col_NewHandle(Col_NewIntWord(2));
+    Col_NewHandle(Col_NewIntWord(3));
+    Col_CloseHandleScope(inner);
+    PICOTEST_ASSERT(Col_OpenHandleScope() == inner);
+    PICOTEST_ASSERT(Col_IntWordValue(*handle) == 1);
+    Col_CloseHandleScope(outer);
+    PICOTEST_ASSERT(Col_OpenHandleScope() == outer);
+}
+PICOTEST_CASE(testGcHandleCollect, colibriFixture) {
+    Col_HandleScope scope;
+    Col_Word *handles[1000];
+    size_t i;
+
+    scope = Col_OpenHandleScope();
+    for (i = 0; i < 1000; i++) {
+        handles[i] = Col_NewHandle(
+            Col_NewVectorNV(2, Col_NewIntWord(i),
+                            Col_NewRopeFromString("handle scope test")));
+    }
+    Col_CompactHeap();
+    Col_ResumeGC();
+    Col_PauseGC();
+    for (i = 0; i < 1000; i++) {
+        PICOTEST_ASSERT(Col_WordType(*handles[i]) & COL_VECTOR);
+        PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(*handles[i])[0])
+                        == (intptr_t)i);
+        PICOTEST_ASSERT(Col_RopeLength(Col_VectorElements(*handles[i])[1])
+                        == 17);
+    }
+    Col_CloseHandleScope(scope);
+}
+
+PICOTEST_SUITE(testGcBatchRoots, testGcBatchRootsCollect);
+PICOTEST_CASE(testGcBatchRootsCollect, colibriFixture) {
+    Col_Word words[1000];
+    size_t i, j;
+
+    /*
+     * Mix cell-based words with duplicates and immediate values, preserve
+     * them twice, then release them in two passes.
+     */
+
+    for (i = 0; i < 1000; i++) {
+        words[i] = (i % 10 == 9 ? Col_NewIntWord(i)
+                    : i % 10 == 8 ? words[i - 1]
+                    : Col_NewVectorV(Col_NewIntWord(i), Col_EmptyRope()));
+    }
+    Col_WordPreserveA(1000, words);
+    Col_WordPreserveA(1000, words);
+    for (j = 0; j < 2; j++) {
+        Col_CompactHeap();
+        Col_ResumeGC();
+        Col_PauseGC();
+        for (i = 0; i < 1000; i++) {
+            if (i % 10 == 9) continue;
+            PICOTEST_ASSERT(Col_WordType(words[i]) & COL_VECTOR);
+            PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(words[i])[0])
+                            == (intptr_t)(i % 10 == 8 ? i - 1 : i));
+        }
+        Col_WordReleaseA(1000, words);
+    }
+}
+
+#ifdef COL_USE_THREADS
+PICOTEST_SUITE(testGcFinalize, testGcFinalizeParams, testGcFinalizeAsync,
+               testGcFinalizeAsyncLocal);
+#else
+PICOTEST_SUITE(testGcFinalize, testGcFinalizeParams, testGcFinalizeAsync);
+#endif /* COL_USE_THREADS */
+PICOTEST_CASE(testGcFinalizeParams, colibriFixture) {
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_ASYNC_FINALIZE) == 0);
+    Col_SetGcParam(COL_GC_ASYNC_FINALIZE, 2);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_ASYNC_FINALIZE) == 1);
+    Col_SetGcParam(COL_GC_ASYNC_FINALIZE, 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_ASYNC_FINALIZE) == 0);
+}
+
+/* Custom words checking that they get cleaned up outside of collections */
+#define FINALIZABLE_MAGIC 0x600DF00D
+typedef struct FinalizeState {
+    int collecting;
+    size_t finalized;
+    size_t invalid;
+    size_t inThread;
+} FinalizeState;
+static FinalizeState finalizeState;
+static size_t finalizableSize(Col_Word word) { return sizeof(size_t); }
+static void finalizableFree(Col_Word word) {
+    size_t *magic;
+    Col_CustomWordInfo(word, (void **)&magic);
+    if (finalizeState.collecting || *magic != FINALIZABLE_MAGIC) {
+        finalizeState.invalid++;
+    }
+    if (Col_GetErrorProc() == ERROR_PROC) {
+        /*
+         * Only the test thread has an error proc.
+         */
+
+        finalizeState.inThread++;
+    }
+    *magic = 0;
+    finalizeState.finalized++;
+}
+static Col_CustomWordType finalizableType = {
+    COL_CUSTOM, "finalizable", finalizableSize, finalizableFree, NULL};
+static void trackCollections(Col_GcEvent event, int begin, uint64_t time,
+                             unsigned int generation,
+                             Col_ClientData clientData) {
+    if (event == COL_GC_EVENT_COLLECT) {
+        ((FinalizeState *)clientData)->collecting = begin;
+    }
+}
+
+static void checkFinalizeAsync() {
+    size_t *magic;
+    size_t i, j;
+
+    memset(&finalizeState, 0, sizeof(finalizeState));
+    Col_SetGcParam(COL_GC_ASYNC_FINALIZE, 1);
+    Col_SetGcEventProc(trackCollections, &finalizeState);
+    for (i = 0; i < 100; i++) {
+        for (j = 0; j < 1000; j++) {
+            Col_NewCustomWord(&finalizableType, sizeof(size_t),
+                              (void **)&magic);
+            *magic = FINALIZABLE_MAGIC;
+            Col_NewVector(10, NULL);
+        }
+        Col_ResumeGC();
+        Col_PauseGC();
+    }
+
+    /*
+     * The next GC waits for pending finalizations.
+     */
+
+    Col_CompactHeap();
+    Col_ResumeGC();
+    Col_PauseGC();
+    Col_SetGcEventProc(NULL, NULL);
+    PICOTEST_ASSERT(finalizeState.finalized > 0);
+    PICOTEST_ASSERT(finalizeState.invalid == 0);
+}
+PICOTEST_CASE(testGcFinalizeAsync, colibriFixture) { checkFinalizeAsync(); }
+#ifdef COL_USE_THREADS
+PICOTEST_CASE(testGcFinalizeAsyncLocal, sharedFixture) {
+    Col_GcStats stats;
+
+    /*
+     * Words collected by local collections are finalized by GC workers.
+     */
+
+    Col_SetGcParam(COL_GC_LOCAL_COLLECT, 1);
+    checkFinalizeAsync();
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.localCollections > 0);
+    PICOTEST_ASSERT(finalizeState.inThread == 0);
+}
+#endif /* COL_USE_THREADS */
+
+PICOTEST_SUITE(testGcWeak, testGcWeakErrors, testGcWeakRefs,
+               testGcWeakValues, testGcWeakKeys, testGcWeakGenerations);
+static void fullGC() {
+    Col_CompactHeap();
+    Col_ResumeGC();
+    Col_PauseGC();
+}
+static Col_Word weakKey(size_t i) {
+    char buf[64];
+    sprintf(buf, "weak-key-%08u-padding", (unsigned int)i);
+    return Col_NewRopeFromString(buf);
+}
+PICOTEST_CASE(testGcWeakErrors, colibriFixture) {
+    PICOTEST_VERIFY(weakRefValue_typeCheck(NULL) == 1);
+    PICOTEST_VERIFY(newWeakIntHashMap_valueCheck(NULL) == 1);
+}
+PICOTEST_CASE(testGcWeakRefs, colibriFixture) {
+    Col_Word target, ref, immediate;
+
+    target = Col_NewVectorNV(1, Col_NewIntWord(1));
+    ref = Col_NewWeakRef(target);
+    immediate = Col_NewWeakRef(Col_NewIntWord(2));
+    PICOTEST_ASSERT(Col_WordType(ref) == COL_WEAKREF);
+    PICOTEST_ASSERT(Col_WeakRefValue(ref) == target);
+    Col_WordPreserve(ref);
+    Col_WordPreserve(immediate);
+    Col_WordPreserve(target);
+
+    fullGC();
+    target = Col_WeakRefValue(ref);
+    PICOTEST_ASSERT(Col_WordType(target) & COL_VECTOR);
+    PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(target)[0]) == 1);
+
+    Col_WordRelease(target);
+    fullGC();
+    PICOTEST_ASSERT(Col_WeakRefValue(ref) == WORD_NIL);
+    PICOTEST_ASSERT(Col_IntWordValue(Col_WeakRefValue(immediate)) == 2);
+    Col_WordRelease(ref);
+    Col_WordRelease(immediate);
+}
+PICOTEST_CASE(testGcWeakValues, colibriFixture) {
+    Col_Word map, intMap, kept, value;
+    size_t i;
+
+    map = Col_NewWeakStringHashMap(0, COL_WEAK_VALUES);
+    intMap = Col_NewWeakIntHashMap(0, COL_WEAK_VALUES);
+    Col_WordPreserve(map);
+    Col_WordPreserve(intMap);
+    kept = Col_NewVectorNV(1, Col_NewIntWord(0));
+    Col_WordPreserve(kept);
+    for (i = 0; i < 1000; i++) {
+        value = (i ? Col_NewVectorNV(1, Col_NewIntWord(i)) : kept);
+        Col_HashMapSet(map, weakKey(i), value);
+        Col_IntHashMapSet(intMap, i, value);
+    }
+    PICOTEST_ASSERT(Col_MapSize(map) == 1000);
+    PICOTEST_ASSERT(Col_MapSize(intMap) == 1000);
+
+    fullGC();
+    PICOTEST_ASSERT(Col_MapSize(map) == 1);
+    PICOTEST_ASSERT(Col_MapSize(intMap) == 1);
+    PICOTEST_ASSERT(Col_HashMapGet(map, weakKey(0), &value));
+    PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(value)[0]) == 0);
+    PICOTEST_ASSERT(Col_IntHashMapGet(intMap, 0, &value));
+    PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(value)[0]) == 0);
+    Col_WordRelease(kept);
+    Col_WordRelease(map);
+    Col_WordRelease(intMap);
+}
+PICOTEST_CASE(testGcWeakKeys, colibriFixture) {
+    Col_Word map, kept, key, value;
+    size_t i;
+
+    map = Col_NewWeakStringHashMap(0, COL_WEAK_KEYS);
+    Col_WordPreserve(map);
+    kept = weakKey(0);
+    Col_WordPreserve(kept);
+    for (i = 0; i < 1000; i++) {
+        /*
+         * Values refer to their key, which must not keep entries alive.
+         */
+
+        key = (i ? weakKey(i) : kept);
+        Col_HashMapSet(map, key, Col_NewVectorNV(1, key));
+    }
+    PICOTEST_ASSERT(Col_MapSize(map) == 1000);
+
+    fullGC();
+    PICOTEST_ASSERT(Col_MapSize(map) == 1);
+    PICOTEST_ASSERT(Col_HashMapGet(map, weakKey(0), &value));
+    PICOTEST_ASSERT(Col_CompareRopes(Col_VectorElements(value)[0], weakKey(0))
+                    == 0);
+    Col_WordRelease(kept);
+    Col_WordRelease(map);
+}
+PICOTEST_CASE(testGcWeakGenerations, colibriFixture) {
+    Col_Word map, intMap, kept, value;
+    Col_GcStats stats;
+    size_t i, collections;
+
+    map = Col_NewWeakStringHashMap(0, COL_WEAK_VALUES);
+    intMap = Col_NewWeakIntHashMap(0, COL_WEAK_VALUES);
+    Col_WordPreserve(map);
+    Col_WordPreserve(intMap);
+    kept = Col_NewVectorNV(1, Col_NewIntWord(0));
+    Col_WordPreserve(kept);
+    for (i = 0; i < 1000; i++) {
+        value = (i ? Col_NewVectorNV(1, Col_NewIntWord(i)) : kept);
+        Col_HashMapSet(map, weakKey(i), value);
+        Col_IntHashMapSet(intMap, i, value);
+    }
+
+    /*
+     * Ordinary collections prune entries once they collect the generation
+     * of each map. Until then, remaining entries are held strongly.
+     */
+
+    Col_GetGcStats(&stats);
+    collections = stats.collections;
+    for (i = 0; i < 10000 && (Col_MapSize(map) > 1 || Col_MapSize(intMap) > 1);
+         i++) {
+        Col_NewVector(100, NULL);
+        Col_ResumeGC();
+        Col_PauseGC();
+    }
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.collections > collections);
+    PICOTEST_ASSERT(Col_MapSize(map) == 1);
+    PICOTEST_ASSERT(Col_MapSize(intMap) == 1);
+    PICOTEST_ASSERT(Col_HashMapGet(map, weakKey(0), &value));
+    PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(value)[0]) == 0);
+    PICOTEST_ASSERT(Col_IntHashMapGet(intMap, 0, &value));
+    PICOTEST_ASSERT(Col_IntWordValue(Col_VectorElements(value)[0]) == 0);
+    Col_WordRelease(kept);
+    Col_WordRelease(map);
+    Col_WordRelease(intMap);
+}
+
+#ifdef COL_USE_THREADS
+PICOTEST_SUITE(testGcLocal, testGcLocalParams, testGcLocalCollect,
+               testGcLocalHandOver, testGcLocalPublish);
+PICOTEST_CASE(testGcLocalParams, sharedFixture) {
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_LOCAL_COLLECT) == 0);
+    Col_SetGcParam(COL_GC_LOCAL_COLLECT, 2);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_LOCAL_COLLECT) == 1);
+    Col_SetGcParam(COL_GC_LOCAL_COLLECT, 0);
+    PICOTEST_ASSERT(Col_GetGcParam(COL_GC_LOCAL_COLLECT) == 0);
+}
+PICOTEST_CASE(testGcLocalCollect, sharedFixture) {
+    Col_GcStats stats;
+    size_t i;
+
+    Col_SetGcParam(COL_GC_LOCAL_COLLECT, 1);
+    for (i = 0; i < 10000; i++) {
+        Col_NewVector(100, NULL);
+        Col_ResumeGC();
+        Col_PauseGC();
+    }
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.localCollections > 0);
+}
+typedef struct HandOver {
+    Col_Word word;
+    TestEvent paused;
+    TestEvent resumed;
+    intptr_t value;
+} HandOver;
+static void handOverProc(void *clientData) {
+    HandOver *handOver = (HandOver *)clientData;
+
+    Col_Init(COL_SHARED);
+    Col_PauseGC();
+    setEvent(&handOver->paused);
+    waitEvent(&handOver->resumed);
+    handOver->value =
+        Col_IntWordValue(Col_VectorElements(handOver->word)[0]);
+    Col_ResumeGC();
+    Col_Cleanup();
+}
+static void checkHandOver(Col_Word word) {
+    HandOver handOver;
+    TestThread thread;
+    Col_GcStats stats;
+    size_t i;
+
+    initEvent(&handOver.paused);
+    initEvent(&handOver.resumed);
+    handOver.word = word;
+    handOver.value = 0;
+    startThread(&thread, handOverProc, &handOver);
+    waitEvent(&handOver.paused);
+
+    /*
+     * Leave the protected section with a full eden while the other thread
+     * uses the word, then try to reuse freed eden pages.
+     */
+
+    for (i = 0; i < 1000; i++) {
+        Col_NewVector(100, NULL);
+    }
+    Col_ResumeGC();
+    if (Col_TryPauseGC()) {
+        for (i = 0; i < 1000; i++) {
+            Col_NewVectorV(Col_NewIntWord(0));
+        }
+        Col_ResumeGC();
+    }
+    setEvent(&handOver.resumed);
+    joinThread(&thread);
+    Col_PauseGC();
+    freeEvent(&handOver.paused);
+    freeEvent(&handOver.resumed);
+
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.localCollections == 0);
+    PICOTEST_ASSERT(handOver.value == 1234);
+}
+PICOTEST_CASE(testGcLocalHandOver, sharedFixture) {
+    /*
+     * Words handed over through C variables are safe by default.
+     */
+
+    checkHandOver(Col_NewVectorV(Col_NewIntWord(1234)));
+}
+PICOTEST_CASE(testGcLocalPublish, sharedFixture) {
+    Col_Word word;
+
+    /*
+     * Local collections require explicit publication.
+     */
+
+    Col_SetGcParam(COL_GC_LOCAL_COLLECT, 1);
+    word = Col_NewVectorV(Col_NewIntWord(1234));
+    Col_WordPublish(word);
+    checkHandOver(word);
+}
+
+PICOTEST_SUITE(testGcPause, testGcPausePending, testGcPauseNested,
+               testGcPauseRace);
+typedef struct PauseThread {
+    size_t nesting;
+    TestEvent paused;
+    TestEvent resume;
+    TestEvent partial;
+    TestEvent finish;
+    int nestedTry;
+} PauseThread;
+static void pauseProc(void *clientData) {
+    PauseThread *pause = (PauseThread *)clientData;
+    size_t i;
+
+    Col_Init(COL_SHARED);
+    for (i = 0; i < pause->nesting; i++) {
+        Col_PauseGC();
+    }
+    setEvent(&pause->paused);
+    waitEvent(&pause->resume);
+
+    /*
+     * Nested calls never block, even with a GC pending.
+     */
+
+    pause->nestedTry = Col_TryPauseGC();
+    if (pause->nestedTry) {
+        Col_ResumeGC();
+    }
+    for (i = 1; i < pause->nesting; i++) {
+        Col_ResumeGC();
+    }
+    setEvent(&pause->partial);
+    waitEvent(&pause->finish);
+    Col_ResumeGC();
+    Col_Cleanup();
+}
+static void startPauseThread(PauseThread *pause, TestThread *thread,
+                             size_t nesting) {
+    pause->nesting = nesting;
+    pause->nestedTry = 0;
+    initEvent(&pause->paused);
+    initEvent(&pause->resume);
+    initEvent(&pause->partial);
+    initEvent(&pause->finish);
+    startThread(thread, pauseProc, pause);
+    waitEvent(&pause->paused);
+}
+static void joinPauseThread(PauseThread *pause, TestThread *thread) {
+    joinThread(thread);
+    freeEvent(&pause->paused);
+    freeEvent(&pause->resume);
+    freeEvent(&pause->partial);
+    freeEvent(&pause->finish);
+}
+static void waitPendingGC(size_t collections) {
+    Col_GcStats stats;
+
+    /*
+     * The GC is pending then active, try until it completes.
+     */
+
+    while (!Col_TryPauseGC())
+        ;
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.collections > collections);
+}
+PICOTEST_CASE(testGcPausePending, sharedFixture) {
+    PauseThread pause;
+    TestThread thread;
+    Col_GcStats stats;
+
+    startPauseThread(&pause, &thread, 1);
+    Col_GetGcStats(&stats);
+
+    /*
+     * Schedule a GC while the other thread is in a protected section.
+     */
+
+    Col_ResumeGC();
+    Col_CompactHeap();
+    PICOTEST_ASSERT(!Col_TryPauseGC());
+
+    setEvent(&pause.resume);
+    setEvent(&pause.finish);
+    waitPendingGC(stats.collections);
+    joinPauseThread(&pause, &thread);
+    PICOTEST_ASSERT(pause.nestedTry);
+}
+PICOTEST_CASE(testGcPauseNested, sharedFixture) {
+    PauseThread pause;
+    TestThread thread;
+    Col_GcStats stats;
+
+    startPauseThread(&pause, &thread, 3);
+    Col_GetGcStats(&stats);
+
+    /*
+     * Nested sections defer the GC to the outermost resume.
+     */
+
+    Col_PauseGC();
+    Col_CompactHeap();
+    Col_ResumeGC();
+    PICOTEST_ASSERT(Col_TryPauseGC());
+    Col_ResumeGC();
+    Col_ResumeGC();
+    PICOTEST_ASSERT(!Col_TryPauseGC());
+
+    /*
+     * The other thread leaving its nested sections keeps the GC pending.
+     */
+
+    setEvent(&pause.resume);
+    waitEvent(&pause.partial);
+    PICOTEST_ASSERT(!Col_TryPauseGC());
+
+    setEvent(&pause.finish);
+    waitPendingGC(stats.collections);
+    joinPauseThread(&pause, &thread);
+    PICOTEST_ASSERT(pause.nestedTry);
+}
+#define PAUSE_RACE_THREADS 4
+#define PAUSE_RACE_LOOPS 5000
+typedef struct PauseRace {
+    TestThread thread;
+    intptr_t value;
+} PauseRace;
+static intptr_t pauseRaceLoop(intptr_t value) {
+    Col_Word kept;
+    size_t i;
+
+    kept = Col_NewVectorV(Col_NewIntWord(value));
+    Col_WordPreserve(kept);
+    for (i = 0; i < PAUSE_RACE_LOOPS; i++) {
+        Col_NewVector(100, NULL);
+        Col_ResumeGC();
+        if (i & 1) {
+            Col_PauseGC();
+        } else {
+            while (!Col_TryPauseGC())
+                ;
+        }
+    }
+    value = Col_IntWordValue(Col_VectorElements(kept)[0]);
+    Col_WordRelease(kept);
+    return value;
+}
+static void pauseRaceProc(void *clientData) {
+    PauseRace *race = (PauseRace *)clientData;
+
+    Col_Init(COL_SHARED);
+    Col_PauseGC();
+    race->value = pauseRaceLoop(race->value);
+    Col_ResumeGC();
+    Col_Cleanup();
+}
+PICOTEST_CASE(testGcPauseRace, sharedFixture) {
+    PauseRace races[PAUSE_RACE_THREADS];
+    Col_GcStats stats;
+    size_t i;
+
+    /*
+     * All threads leave their sections with GCs due, so that resumes race
+     * with GC scheduling and blocked pauses.
+     */
+
+    for (i = 0; i < PAUSE_RACE_THREADS; i++) {
+        races[i].value = (intptr_t)i + 1;
+        startThread(&races[i].thread, pauseRaceProc, &races[i]);
+    }
+    PICOTEST_ASSERT(pauseRaceLoop(0) == 0);
+    Col_ResumeGC();
+    for (i = 0; i < PAUSE_RACE_THREADS; i++) {
+        joinThread(&races[i].thread);
+    }
+    Col_PauseGC();
+    for (i = 0; i < PAUSE_RACE_THREADS; i++) {
+        PICOTEST_ASSERT(races[i].value == (intptr_t)i + 1);
+    }
+    Col_GetGcStats(&stats);
+    PICOTEST_ASSERT(stats.collections > 0);
+}
+
+PICOTEST_SUITE(testGcThreadData, testGcThreadDataErrorProc);
+static int threadErrorProc(Col_ErrorLevel level, Col_ErrorDomain domain,
+                           int code, va_list args) {
+    return 1;
+}
+typedef struct ThreadErrorProcs {
+    TestEvent set;
+    TestEvent changed;
+    Col_ErrorProc *initial;
+    Col_ErrorProc *before;
+    Col_ErrorProc *after;
+} ThreadErrorProcs;
+static void threadDataProc(void *clientData) {
+    ThreadErrorProcs *procs = (ThreadErrorProcs *)clientData;
+
+    Col_Init(COL_SHARED);
+    procs->initial = Col_GetErrorProc();
+    Col_SetErrorProc(threadErrorProc);
+    procs->before = Col_GetErrorProc();
+    setEvent(&procs->set);
+    waitEvent(&procs->changed);
+    procs->after = Col_GetErrorProc();
+    Col_Cleanup();
+}
+PICOTEST_CASE(testGcThreadDataErrorProc, sharedFixture) {
+    ThreadErrorProcs procs;
+    TestThread thread;
+
+    /*
+     * Each thread of the group sees its own error proc.
+     */
+
+    initEvent(&procs.set);
+    initEvent(&procs.changed);
+    startThread(&thread, threadDataProc, &procs);
+    waitEvent(&procs.set);
+    PICOTEST_ASSERT(Col_GetErrorProc() == ERROR_PROC);
+    Col_SetErrorProc(NULL);
+    setEvent(&procs.changed);
+    joinThread(&thread);
+    freeEvent(&procs.set);
+    freeEvent(&procs.changed);
+    PICOTEST_ASSERT(Col_GetErrorProc() == NULL);
+    Col_SetErrorProc(ERROR_PROC);
+
+    PICOTEST_ASSERT(procs.initial == NULL);
+    PICOTEST_ASSERT(procs.before == threadErrorProc);
+    PICOTEST_ASSERT(procs.after == threadErrorProc);
+}
+#endif /* COL_USE_THREADS */
@@ -0,0 +1,84 @@
+#include <colibri.h>
+
+#include "threads.h"
+
+#ifdef COL_USE_THREADS
+
+#ifdef _WIN32
+
+/* Thread entry point, calls test proc */
+static DWORD WINAPI threadProc(LPVOID arg) {
+    TestThread *thread = (TestThread *)arg;
+    thread->proc(thread->clientData);
+    return 0;
+}
+
+void startThread(TestThread *thread, TestThreadProc *proc, void *clientData) {
+    thread->proc = proc;
+    thread->clientData = clientData;
+    thread->thread = CreateThread(NULL, 0, threadProc, thread, 0, NULL);
+}
+
+void joinThread(TestThread *thread) {
+    WaitForSingleObject(thread->thread, INFINITE);
+    CloseHandle(thread->thread);
+}
+
+void initEvent(TestEvent *event) {
+    event->event = CreateEvent(NULL, TRUE, FALSE, NULL);
+}
+
+void freeEvent(TestEvent *event) { CloseHandle(event->event); }
+
+void setEvent(TestEvent *event) { SetEvent(event->event); }
+
+void waitEvent(TestEvent *event) {
+    WaitForSingleObject(event->event, INFINITE);
+}
+
+#else /* _WIN32 */
+
+/* Thread entry point, calls test proc */
+static void *threadProc(void *arg) {
+    TestThread *thread = (TestThread *)arg;
+    thread->proc(thread->clientData);
+    return NULL;
+}
+
+void startThread(TestThread *thread, TestThreadProc *proc, void *clientData) {
+    thread->proc = proc;
+    thread->clientData = clientData;
+    pthread_create(&thread->thread, NULL, threadProc, thread);
+}
+
+void joinThread(TestThread *thread) { pthread_join(thread->thread, NULL); }
+
+void initEvent(TestEvent *event) {
+    pthread_mutex_init(&event->mutex, NULL);
+    pthread_cond_init(&event->cond, NULL);
+    event->set = 0;
+}
+
+void freeEvent(TestEvent *event) {
+    pthread_cond_destroy(&event->cond);
+    pthread_mutex_destroy(&event->mutex);
+}
+
+void setEvent(TestEvent *event) {
+    pthread_mutex_lock(&event->mutex);
+    event->set = 1;
+    pthread_cond_broadcast(&event->cond);
+    pthread_mutex_unlock(&event->mutex);
+}
+
+void waitEvent(TestEvent *event) {
+    pthread_mutex_lock(&event->mutex);
+    while (!event->set) {
+        pthread_cond_wait(&event->cond, &event->mutex);
+    }
+    pthread_mutex_unlock(&event->mutex);
+}
+
+#endif /* _WIN32 */
+
+#endif /* COL_USE_THREADS */
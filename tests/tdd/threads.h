@@ -0,0 +1,59 @@
+#ifndef _THREADS_H_
+#define _THREADS_H_
+
+#ifdef COL_USE_THREADS
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/*
+ * Minimal thread primitives for multithreaded test cases
+ */
+
+/* Thread procedure */
+typedef void(TestThreadProc)(void *clientData);
+
+/* Thread handle */
+typedef struct TestThread {
+    TestThreadProc *proc;
+    void *clientData;
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+} TestThread;
+
+/* Manual-reset event, threads wait until it gets set */
+typedef struct TestEvent {
+#ifdef _WIN32
+    HANDLE event;
+#else
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int set;
+#endif
+} TestEvent;
+
+/* Start thread, must be joined with joinThread */
+void startThread(TestThread *thread, TestThreadProc *proc, void *clientData);
+
+/* Wait for thread termination */
+void joinThread(TestThread *thread);
+
+/* Event lifetime */
+void initEvent(TestEvent *event);
+void freeEvent(TestEvent *event);
+
+/* Set event, releasing all waiting threads */
+void setEvent(TestEvent *event);
+
+/* Wait until event is set */
+void waitEvent(TestEvent *event);
+
+#endif /* COL_USE_THREADS */
+
+#endif /* _THREADS_H_ */